@@ -21,13 +21,17 @@
 
 #include "MyLogger.h"
 #include "ScriptHandler.h"
+#include "StudyCache.h"
 #include "custom.h"
+#include "file_tab.h"
+#include "math_taylor.h"
 
 #include <boost/filesystem.hpp>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <functional>
 #include <string>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -55,7 +59,8 @@ using namespace Wt;
 
 HomeLeft::HomeLeft(WContainerWidget *parent, ScriptHandler *scriptHandler)
     : WContainerWidget(parent), settingsContainer_(nullptr),
-      viewContainer_(nullptr), orbitsContainer_(nullptr)
+      viewContainer_(nullptr), orbitsContainer_(nullptr),
+      limitCyclesContainer_(nullptr)
 {
     loggedIn_ = false;
     evaluated_ = false;
@@ -67,6 +72,9 @@ HomeLeft::HomeLeft(WContainerWidget *parent, ScriptHandler *scriptHandler)
     evaluatedIsocline_ = false;
     nIsoclines_ = 0;
 
+    nLimitCycles_ = 0;
+    alive_ = std::make_shared<bool>(true);
+
     // set CSS class for inline 50% of the screen
     setId("HomeLeft");
     setStyleClass(WString::fromUTF8("half-box-left"));
@@ -82,6 +90,8 @@ HomeLeft::HomeLeft(WContainerWidget *parent, ScriptHandler *scriptHandler)
 
 HomeLeft::~HomeLeft()
 {
+    *alive_ = false;
+
     // main widget
 
     if (fileUploadWidget_ != nullptr) {
@@ -610,8 +620,60 @@ void HomeLeft::evaluate()
         return;
     }
 
-    siginfo_t status = scriptHandler_->evaluateMapleScript(
-        fileUploadName_, stoi(scriptHandler_->time_limit_));
+    // identical studies are served from the cache without running Maple
+    if (g_studyCache.restore(fileUploadName_)) {
+        g_globalLogger.debug("[HomeLeft] results of " + fileUploadName_ +
+                             " found in cache");
+        evaluatedSignal_.emit(fileUploadName_);
+        return;
+    }
+
+    // hyperbolic numeric studies are computed in place, Maple is only
+    // needed when the native finder gives up
+    if (scriptHandler_->evaluateNatively(fileUploadName_)) {
+        evaluatedSignal_.emit(fileUploadName_);
+        return;
+    }
+
+    // run Maple in the background, the result is pushed back to the browser
+    evalButton_->disable();
+    textSignal_.emit("Evaluating vector field...");
+    evaluateAsync(fileUploadName_, fileUploadName_, &HomeLeft::onEvaluated);
+}
+
+void HomeLeft::evaluateAsync(std::string script, std::string fname,
+                             void (HomeLeft::*done)(std::string, siginfo_t))
+{
+    std::shared_ptr<bool> alive = alive_;
+    scriptHandler_->evaluateMapleScriptAsync(
+        script, stoi(scriptHandler_->time_limit_),
+        [this, alive, fname, done](siginfo_t status) {
+            if (*alive)
+                (this->*done)(fname, status);
+        },
+        [this, alive](int position) {
+            if (*alive)
+                onMapleJobQueued(position);
+        });
+}
+
+void HomeLeft::onMapleJobQueued(int position)
+{
+    textSignal_.emit("The server is busy, waiting for a free Maple process "
+                     "(position " +
+                     std::to_string(position) + " in queue)...");
+}
+
+void HomeLeft::onEvaluated(std::string fname, siginfo_t status)
+{
+    // the results are those of fname even if another file has been uploaded
+    // since, but then they are no longer shown
+    evalButton_->enable();
+    if (status.si_status == 0)
+        g_studyCache.store(fname);
+    if (fname != fileUploadName_)
+        return;
+
     if (status.si_status == 0) {
         g_globalLogger.debug("[HomeLeft] Maple script executed");
         evaluatedSignal_.emit(fileUploadName_);
@@ -1009,6 +1071,27 @@ void HomeLeft::showSettings()
     t->bindWidget("dl", orbitsDeleteOneBtn_);
     t->bindWidget("da", orbitsDeleteAllBtn_);
 
+    // integrator, items in the order of INTEGRATOR_RK78 and INTEGRATOR_TAYLOR
+    int integrator = DEFAULT_INTEGRATOR;
+    int order = DEFAULT_TAYLOR_ORDER;
+    WVFStudy::readIntegratorConfig(integrator, order);
+    orbitsIntegratorComboBox_ = new WComboBox(orbitsContainer_);
+    orbitsIntegratorComboBox_->addItem("Runge-Kutta 7/8");
+    orbitsIntegratorComboBox_->addItem("Taylor series");
+    orbitsIntegratorComboBox_->setCurrentIndex(integrator);
+    t->bindWidget("integrator", orbitsIntegratorComboBox_);
+    t->bindString("integrator-tooltip", WString::tr("tooltip.integrator"));
+    orbitsTaylorOrderSpinBox_ = new WSpinBox(orbitsContainer_);
+    orbitsTaylorOrderSpinBox_->setRange(0, TAYLOR_MAX_ORDER);
+    orbitsTaylorOrderSpinBox_->setValue(order);
+    orbitsTaylorOrderSpinBox_->setEnabled(integrator == INTEGRATOR_TAYLOR);
+    t->bindWidget("taylor-order", orbitsTaylorOrderSpinBox_);
+    t->bindString("taylor-order-tooltip", WString::tr("tooltip.taylor-order"));
+    orbitsIntegratorComboBox_->changed().connect(
+        this, &HomeLeft::onOrbitsIntegratorChange);
+    orbitsTaylorOrderSpinBox_->changed().connect(
+        this, &HomeLeft::onOrbitsIntegratorChange);
+
     // enable delete orbits and continue if integrate button has been pressed
     orbitsForwardsBtn_->clicked().connect(this, &HomeLeft::onOrbitsForwardsBtn);
     orbitsBackwardsBtn_->clicked().connect(this,
@@ -1221,6 +1304,73 @@ void HomeLeft::showSettings()
     isoclinesDelAllBtn_->clicked().connect(this,
                                            &HomeLeft::onDelAllIsoclinesBtn);
 
+    /*
+     * Limit cycles
+     */
+    limitCyclesContainer_ = new WContainerWidget(this);
+    limitCyclesContainer_->setId("limitCyclesContainer_");
+    tabs_->addTab(limitCyclesContainer_, "Limit cycles");
+
+    t = new WTemplate(WString::tr("template.homeleft-limitcycles"),
+                      limitCyclesContainer_);
+    t->addFunction("id", WTemplate::Functions::id);
+
+    // ends of the transverse section
+    limitCyclesX0LineEdit_ = new WLineEdit(limitCyclesContainer_);
+    t->bindWidget("x0", limitCyclesX0LineEdit_);
+    limitCyclesY0LineEdit_ = new WLineEdit(limitCyclesContainer_);
+    t->bindWidget("y0", limitCyclesY0LineEdit_);
+    limitCyclesX1LineEdit_ = new WLineEdit(limitCyclesContainer_);
+    t->bindWidget("x1", limitCyclesX1LineEdit_);
+    limitCyclesY1LineEdit_ = new WLineEdit(limitCyclesContainer_);
+    t->bindWidget("y1", limitCyclesY1LineEdit_);
+    t->bindString("lc-tooltip-section", WString::tr("tooltip.lc-section"));
+
+    // grid
+    limitCyclesGridLineEdit_ = new WLineEdit(limitCyclesContainer_);
+    validator = new WDoubleValidator(MIN_LCGRID, MAX_LCGRID);
+    limitCyclesGridLineEdit_->setValidator(validator);
+    limitCyclesGridLineEdit_->setText(std::to_string(DEFAULT_LCGRID));
+    t->bindWidget("grid", limitCyclesGridLineEdit_);
+    t->bindString("lc-tooltip-grid", WString::tr("tooltip.lc-grid"));
+
+    // n points
+    limitCyclesNPointsSpinBox_ = new WSpinBox(limitCyclesContainer_);
+    limitCyclesNPointsSpinBox_->setRange(MIN_LCPOINTS, MAX_LCPOINTS);
+    limitCyclesNPointsSpinBox_->setValue(DEFAULT_LCPOINTS);
+    t->bindWidget("nps", limitCyclesNPointsSpinBox_);
+    t->bindString("lc-tooltip-nps", WString::tr("tooltip.lc-npoints"));
+
+    // search button
+    limitCyclesSearchBtn_ =
+        new WPushButton("Search limit cycles", limitCyclesContainer_);
+    t->bindWidget("lc-btn-search", limitCyclesSearchBtn_);
+    t->bindString("lc-tooltip-search", WString::tr("tooltip.lc-search"));
+
+    // delete one button
+    limitCyclesDelOneBtn_ =
+        new WPushButton("Delete last limit cycle", limitCyclesContainer_);
+    limitCyclesDelOneBtn_->setStyleClass("btn btn-warning");
+    limitCyclesDelOneBtn_->disable();
+    t->bindWidget("lc-btn-del-one", limitCyclesDelOneBtn_);
+    t->bindString("lc-tooltip-del-one", WString::tr("tooltip.lc-del-one"));
+
+    // delete all button
+    limitCyclesDelAllBtn_ =
+        new WPushButton("Delete all limit cycles", limitCyclesContainer_);
+    limitCyclesDelAllBtn_->setStyleClass("btn btn-danger");
+    limitCyclesDelAllBtn_->disable();
+    t->bindWidget("lc-btn-del-all", limitCyclesDelAllBtn_);
+    t->bindString("lc-tooltip-del-all", WString::tr("tooltip.lc-del-all"));
+
+    // connect buttons to functions
+    limitCyclesSearchBtn_->clicked().connect(this,
+                                             &HomeLeft::onSearchLimitCyclesBtn);
+    limitCyclesDelOneBtn_->clicked().connect(this,
+                                             &HomeLeft::onDelOneLimitCyclesBtn);
+    limitCyclesDelAllBtn_->clicked().connect(this,
+                                             &HomeLeft::onDelAllLimitCyclesBtn);
+
     tabs_->setCurrentWidget(settingsContainer_);
 }
 
@@ -1257,6 +1407,11 @@ void HomeLeft::hideSettings()
         delete isoclinesContainer_;
         isoclinesContainer_ = nullptr;
     }
+    if (limitCyclesContainer_ != nullptr) {
+        tabs_->removeTab(limitCyclesContainer_);
+        delete limitCyclesContainer_;
+        limitCyclesContainer_ = nullptr;
+    }
 }
 
 void HomeLeft::resetUI()
@@ -1268,6 +1423,8 @@ void HomeLeft::resetUI()
     evaluatedCurve_ = false;
     nCurves_ = 0;
 
+    nLimitCycles_ = 0;
+
     xEquationInput_->setText(std::string());
     yEquationInput_->setText(std::string());
     gcfEquationInput_->setText(std::string());
@@ -1436,6 +1593,19 @@ void HomeLeft::onOrbitsDeleteAllBtn()
     orbitDeleteSignal_.emit(0);
 }
 
+void HomeLeft::onOrbitsIntegratorChange()
+{
+    int integrator = orbitsIntegratorComboBox_->currentIndex();
+    // orders below TAYLOR_MIN_ORDER are raised by taylor_step()
+    int order = orbitsTaylorOrderSpinBox_->value();
+
+    orbitsTaylorOrderSpinBox_->setEnabled(integrator == INTEGRATOR_TAYLOR);
+    g_globalLogger.debug("[HomeLeft] integrator " +
+                         std::to_string(integrator) + " of order " +
+                         std::to_string(order));
+    integratorSignal_.emit(integrator, order);
+}
+
 void HomeLeft::onPlotGcfBtn()
 {
     if (!evaluated_) {
@@ -1508,14 +1678,28 @@ void HomeLeft::onPlotCurvesBtn()
         fileUploadName_ =
             scriptHandler_->randomFileName(TMP_DIR, "_curve_prep.mpl");
     }
+    // numeric curves are converted in place, without waiting for Maple
+    if (scriptHandler_->prepareCurveTableNatively(fileUploadName_)) {
+        evaluatedCurve_ = true;
+        plotCurve();
+        return;
+    }
     scriptHandler_->prepareCurveTable(fileUploadName_);
-    // execute file
-    siginfo_t status = scriptHandler_->evaluateMapleScript(
-        fileUploadName_ + "_curve_prep", stoi(scriptHandler_->time_limit_));
+    // execute file in the background
+    curvesPlotBtn_->disable();
+    evaluateAsync(fileUploadName_ + "_curve_prep", fileUploadName_,
+                  &HomeLeft::onCurveTableEvaluated);
+}
+
+void HomeLeft::onCurveTableEvaluated(std::string fname, siginfo_t status)
+{
+    curvesPlotBtn_->enable();
+    // the table belongs to a study that has been replaced
+    if (fname != fileUploadName_)
+        return;
     // check for errors in execution
     if (status.si_status == 0) {
         g_globalLogger.debug("[HomeLeft] Maple curve tables script executed");
-        curvesPlotBtn_->setEnabled(true);
         evaluatedCurve_ = true;
     } else {
         if (status.si_code == CLD_EXITED) {
@@ -1534,6 +1718,11 @@ void HomeLeft::onPlotCurvesBtn()
         }
         return;
     }
+    plotCurve();
+}
+
+void HomeLeft::plotCurve()
+{
     // check input curve parameters
     int npoints = curvesNPointsSpinBox_->value();
     if (npoints < CURVES_NP_MIN || npoints > CURVES_NP_MAX) {
@@ -1670,15 +1859,28 @@ void HomeLeft::onPlotIsoclinesBtn()
         fileUploadName_ =
             scriptHandler_->randomFileName(TMP_DIR, "_isocline_prep.mpl");
     }
+    if (scriptHandler_->prepareIsoclineTableNatively(fileUploadName_)) {
+        evaluatedIsocline_ = true;
+        plotIsocline();
+        return;
+    }
     scriptHandler_->prepareIsoclineTable(fileUploadName_);
-    // execute file
-    siginfo_t status = scriptHandler_->evaluateMapleScript(
-        fileUploadName_ + "_isocline_prep", stoi(scriptHandler_->time_limit_));
+    // execute file in the background
+    isoclinesPlotBtn_->disable();
+    evaluateAsync(fileUploadName_ + "_isocline_prep", fileUploadName_,
+                  &HomeLeft::onIsoclineTableEvaluated);
+}
+
+void HomeLeft::onIsoclineTableEvaluated(std::string fname, siginfo_t status)
+{
+    isoclinesPlotBtn_->enable();
+    // the table belongs to a study that has been replaced
+    if (fname != fileUploadName_)
+        return;
     // check for errors in execution
     if (status.si_status == 0) {
         g_globalLogger.debug(
             "[HomeLeft] Maple isocline tables script executed");
-        isoclinesPlotBtn_->setEnabled(true);
         evaluatedIsocline_ = true;
     } else {
         if (status.si_code == CLD_EXITED) {
@@ -1697,6 +1899,11 @@ void HomeLeft::onPlotIsoclinesBtn()
         }
         return;
     }
+    plotIsocline();
+}
+
+void HomeLeft::plotIsocline()
+{
     // check input isocline parameters
     int npoints = isoclinesNPointsSpinBox_->value();
     if (npoints < CURVES_NP_MIN || npoints > CURVES_NP_MAX) {
@@ -1764,3 +1971,109 @@ void HomeLeft::onDelAllIsoclinesBtn()
     g_globalLogger.debug("[HomeLeft] deleted all isoclines, nisoclines = " +
                          std::to_string(nIsoclines_));
 }
+
+void HomeLeft::onSearchLimitCyclesBtn()
+{
+    double x0, y0, x1, y1, grid;
+
+    if (!evaluated_) {
+        errorSignal_.emit(
+            "Cannot search limit cycles yet, evaluate a vector field first.");
+        return;
+    }
+    if (!plotted_) {
+        errorSignal_.emit("Click the main Plot button first\n"
+                          "in order to create the plot window.");
+        return;
+    }
+
+    try {
+        x0 = std::stod(limitCyclesX0LineEdit_->text().toUTF8());
+        y0 = std::stod(limitCyclesY0LineEdit_->text().toUTF8());
+        x1 = std::stod(limitCyclesX1LineEdit_->text().toUTF8());
+        y1 = std::stod(limitCyclesY1LineEdit_->text().toUTF8());
+    } catch (...) {
+        g_globalLogger.error("[HomeLeft] invalid limit cycle section.");
+        errorSignal_.emit("Invalid coordinates for the transverse section.");
+        return;
+    }
+    if (x0 == x1 && y0 == y1) {
+        errorSignal_.emit("The ends of the transverse section must be "
+                          "different points.");
+        return;
+    }
+
+    try {
+        grid = std::stod(limitCyclesGridLineEdit_->text().toUTF8());
+    } catch (...) {
+        grid = DEFAULT_LCGRID;
+    }
+    if (!(grid >= MIN_LCGRID && grid <= MAX_LCGRID)) {
+        grid = DEFAULT_LCGRID;
+        limitCyclesGridLineEdit_->setText(std::to_string(DEFAULT_LCGRID));
+        g_globalLogger.warning("[HomeLeft] limit cycle grid out of bounds, "
+                               "setting to default value");
+    }
+    int npoints = limitCyclesNPointsSpinBox_->value();
+    if (npoints < MIN_LCPOINTS || npoints > MAX_LCPOINTS) {
+        npoints = DEFAULT_LCPOINTS;
+        g_globalLogger.warning("[HomeLeft] limit cycle npoints out of bounds, "
+                               "setting to default value");
+    }
+
+    g_globalLogger.debug("[HomeLeft] searching limit cycles");
+    limitCyclesSignal_.emit(x0, y0, x1, y1, grid, npoints);
+}
+
+void HomeLeft::limitCyclesConfirmed(int found)
+{
+    if (found > 0) {
+        nLimitCycles_ += found;
+        if (!limitCyclesDelAllBtn_->isEnabled())
+            limitCyclesDelAllBtn_->enable();
+        if (!limitCyclesDelOneBtn_->isEnabled())
+            limitCyclesDelOneBtn_->enable();
+        g_globalLogger.debug(
+            "[HomeLeft] found limit cycles, nlimitcycles = " +
+            std::to_string(nLimitCycles_));
+    } else if (found == 0) {
+        errorSignal_.emit("No new limit cycles cross the transverse section. "
+                          "Try a finer grid or more points.");
+    } else {
+        errorSignal_.emit("Error while searching limit cycles, check inputs "
+                          "and try again.");
+    }
+}
+
+void HomeLeft::onDelOneLimitCyclesBtn()
+{
+    if (nLimitCycles_ <= 0)
+        return;
+
+    limitCyclesDeleteSignal_.emit(1);
+
+    if (--nLimitCycles_ == 0) {
+        limitCyclesDelOneBtn_->disable();
+        limitCyclesDelAllBtn_->disable();
+    }
+
+    g_globalLogger.debug(
+        "[HomeLeft] deleted last limit cycle, nlimitcycles = " +
+        std::to_string(nLimitCycles_));
+}
+
+void HomeLeft::onDelAllLimitCyclesBtn()
+{
+    if (nLimitCycles_ <= 0)
+        return;
+
+    limitCyclesDeleteSignal_.emit(0);
+
+    nLimitCycles_ = 0;
+    limitCyclesDelOneBtn_->disable();
+    limitCyclesDelAllBtn_->disable();
+
+    g_globalLogger.debug(
+        "[HomeLeft] deleted all limit cycles, nlimitcycles = " +
+        std::to_string(nLimitCycles_));
+}
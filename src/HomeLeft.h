@@ -31,6 +31,8 @@
 #include <Wt/WContainerWidget>
 #include <Wt/WSignal>
 
+#include <memory>
+
 /**
  * Maximum number of parameters
  */
@@ -254,6 +256,17 @@ class HomeLeft : public Wt::WContainerWidget
      */
     void isoclineConfirmed(bool computed);
 
+    /**
+     * Receive the result of a limit cycle search
+     *
+     * Add the limit cycles to the counter and activate the buttons if
+     * necessary
+     *
+     * @param found number of limit cycles found, or -1 if the search could
+     *              not be done
+     */
+    void limitCyclesConfirmed(int found);
+
     /**
      * Method that sends a signal when a vector field is evaluated by Maple
      */
@@ -301,6 +314,14 @@ class HomeLeft : public Wt::WContainerWidget
      * The int can be 1 (delete last) or 0 (delete all)
      */
     Wt::Signal<int> &orbitDeleteSignal() { return orbitDeleteSignal_; }
+    /**
+     * Signal to choose the integrator of orbits and separatrices
+     *
+     * The first int is INTEGRATOR_RK78 or INTEGRATOR_TAYLOR, the second one
+     * is the order of the Taylor integrator (0 to choose it from the
+     * tolerance)
+     */
+    Wt::Signal<int, int> &integratorSignal() { return integratorSignal_; }
     /**
      * Signal to reset everything
      *
@@ -359,6 +380,27 @@ class HomeLeft : public Wt::WContainerWidget
      * The int can be 1 (delete last) or 0 (delete all)
      */
     Wt::Signal<int> &isoclineDeleteSignal() { return isoclineDeleteSignal_; }
+    /**
+     * Signal to search limit cycles
+     *
+     * The first four doubles are the ends (x0,y0) and (x1,y1) of the
+     * transverse section, the fifth one is the grid and the int is the
+     * number of points to integrate for each orbit
+     */
+    Wt::Signal<double, double, double, double, double, int> &
+    limitCyclesSignal()
+    {
+        return limitCyclesSignal_;
+    }
+    /**
+     * Signal to delete limit cycles
+     *
+     * The int can be 1 (delete last) or 0 (delete all)
+     */
+    Wt::Signal<int> &limitCyclesDeleteSignal()
+    {
+        return limitCyclesDeleteSignal_;
+    }
     /**
      * Signal to tell HomeRight to refresh the plot and draw a sphere
      */
@@ -392,8 +434,14 @@ class HomeLeft : public Wt::WContainerWidget
     int nIsoclines_;
     bool evaluatedIsocline_;
 
+    int nLimitCycles_; // number of limit cycles that have been found
+
     int nParams_; // tells number of parameters added by user
 
+    // cleared on destruction, so pending Maple callbacks know the widget is
+    // gone
+    std::shared_ptr<bool> alive_;
+
     /* Script Handler */
     ScriptHandler *scriptHandler_;
 
@@ -449,6 +497,8 @@ class HomeLeft : public Wt::WContainerWidget
     Wt::WPushButton *orbitsBackwardsBtn_;
     Wt::WPushButton *orbitsDeleteOneBtn_;
     Wt::WPushButton *orbitsDeleteAllBtn_;
+    Wt::WComboBox *orbitsIntegratorComboBox_;
+    Wt::WSpinBox *orbitsTaylorOrderSpinBox_;
     bool orbitsStartSelected_;
     // gcf tab
     Wt::WContainerWidget *gcfContainer_;
@@ -475,6 +525,17 @@ class HomeLeft : public Wt::WContainerWidget
     Wt::WPushButton *isoclinesPlotBtn_;
     Wt::WPushButton *isoclinesDelOneBtn_;
     Wt::WPushButton *isoclinesDelAllBtn_;
+    // limit cycles tab
+    Wt::WContainerWidget *limitCyclesContainer_;
+    Wt::WLineEdit *limitCyclesX0LineEdit_;
+    Wt::WLineEdit *limitCyclesY0LineEdit_;
+    Wt::WLineEdit *limitCyclesX1LineEdit_;
+    Wt::WLineEdit *limitCyclesY1LineEdit_;
+    Wt::WLineEdit *limitCyclesGridLineEdit_;
+    Wt::WSpinBox *limitCyclesNPointsSpinBox_;
+    Wt::WPushButton *limitCyclesSearchBtn_;
+    Wt::WPushButton *limitCyclesDelOneBtn_;
+    Wt::WPushButton *limitCyclesDelAllBtn_;
 
     /* SIGNALS */
     Wt::Signal<std::string> evaluatedSignal_;
@@ -484,6 +545,7 @@ class HomeLeft : public Wt::WContainerWidget
         onPlotPlaneSignal_;
     Wt::Signal<int, double, double> orbitIntegrateSignal_;
     Wt::Signal<int> orbitDeleteSignal_;
+    Wt::Signal<int, int> integratorSignal_;
     Wt::Signal<int> resetSignal_;
     Wt::Signal<std::string, int, int, int> gcfSignal_;
     Wt::Signal<std::string, std::string> addParameterSignal_;
@@ -491,6 +553,8 @@ class HomeLeft : public Wt::WContainerWidget
     Wt::Signal<int> curveDeleteSignal_;
     Wt::Signal<std::string, int, int, int> plotIsoclineSignal_;
     Wt::Signal<int> isoclineDeleteSignal_;
+    Wt::Signal<double, double, double, double, double, int> limitCyclesSignal_;
+    Wt::Signal<int> limitCyclesDeleteSignal_;
     Wt::Signal<double> refreshPlotSphereSignal_;
     Wt::Signal<int, double, double, double, double> refreshPlotPlaneSignal_;
     Wt::Signal<std::string> errorSignal_;
@@ -512,6 +576,14 @@ class HomeLeft : public Wt::WContainerWidget
     void addParameterToList(std::string label, std::string value);
     // run maple on the script
     void evaluate();
+    // run a maple script in the background, done is called with the study
+    // fname it was started for unless this widget has been deleted
+    void evaluateAsync(std::string script, std::string fname,
+                       void (HomeLeft::*done)(std::string, siginfo_t));
+    // what to do when the maple evaluation has finished
+    void onEvaluated(std::string fname, siginfo_t status);
+    // inform the user that a maple job is waiting in the queue
+    void onMapleJobQueued(int position);
     // write a tmp save file in server for download
     void prepareSaveFile();
     void allowSaveFile();
@@ -528,16 +600,27 @@ class HomeLeft : public Wt::WContainerWidget
     void onOrbitsContinueBtn();
     void onOrbitsDeleteOneBtn();
     void onOrbitsDeleteAllBtn();
+    void onOrbitsIntegratorChange();
     // react to button presses in gcf tab
     void onPlotGcfBtn();
     // react to button clicks in curves tab
     void onPlotCurvesBtn();
+    void onCurveTableEvaluated(std::string fname, siginfo_t status);
+    // send the curve table to HomeRight for plotting
+    void plotCurve();
     void onDelOneCurvesBtn();
     void onDelAllCurvesBtn();
     // react to button clicks in isoclines tab
     void onPlotIsoclinesBtn();
+    void onIsoclineTableEvaluated(std::string fname, siginfo_t status);
+    // send the isocline table to HomeRight for plotting
+    void plotIsocline();
     void onDelOneIsoclinesBtn();
     void onDelAllIsoclinesBtn();
+    // react to button clicks in limit cycles tab
+    void onSearchLimitCyclesBtn();
+    void onDelOneLimitCyclesBtn();
+    void onDelAllLimitCyclesBtn();
 };
 
 #endif // HOMELEFT_H
\ No newline at end of file
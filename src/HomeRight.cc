@@ -20,6 +20,7 @@
 #include "MyLogger.h"
 #include "WSphere.h"
 #include "file_tab.h"
+#include "math_limitcycles.h"
 
 #include <fstream>
 
@@ -46,6 +47,9 @@ HomeRight::HomeRight(WContainerWidget *parent, ScriptHandler *s)
     
     loggedIn_=false;
     orbitStarted_=false;
+    integrator_ = DEFAULT_INTEGRATOR;
+    taylorOrder_ = DEFAULT_TAYLOR_ORDER;
+    WVFStudy::readIntegratorConfig(integrator_, taylorOrder_);
 
     g_globalLogger.debug("[HomeRight] setting up UI...");
     setupUI();
@@ -370,6 +374,7 @@ void HomeRight::setupSphereAndPlot()
     sphere_->setId("sphere_");
     sphere_->setMargin(5, Top);
     plotContainer_->addWidget(sphere_);
+    applyIntegrator();
 
     if (plotCaption_ != nullptr) {
         delete plotCaption_;
@@ -384,10 +389,24 @@ void HomeRight::setupSphereAndPlot()
     sphere_->errorSignal().connect(this, &HomeRight::printError);
     sphere_->clickedSignal().connect(this, &HomeRight::sphereClicked);
 
+    // the plot is drawn right away and again with the separatrices once
+    // they have been integrated
+    sphere_->computeSeparatrices([this]() {
+        sphere_->plotDone_ = false;
+        sphere_->update();
+    });
     sphere_->update();
     tabWidget_->setCurrentIndex(1);
 }
 
+void HomeRight::applyIntegrator()
+{
+    if (sphere_ != nullptr && sphere_->study_ != nullptr) {
+        sphere_->study_->config_integrator_ = integrator_;
+        sphere_->study_->config_taylor_order_ = taylorOrder_;
+    }
+}
+
 void HomeRight::mouseMovedEvent(WString caption)
 {
     plotCaption_->setText(caption);
@@ -422,6 +441,13 @@ void HomeRight::onReset(int dummy)
 
 void HomeRight::onOrbitsIntegrate(int dir, double x0, double y0)
 {
+    // orbits change the step size of the study
+    if (sphere_->computing()) {
+        printError("Wait until the current computation has finished.");
+        return;
+    }
+    applyIntegrator();
+
     if (dir == 1 || dir == -1)
         orbitStarted_ = sphere_->startOrbit(x0, y0, true);
 
@@ -458,6 +484,12 @@ void HomeRight::onOrbitsDelete(int flag)
         tabWidget_->setCurrentIndex(1);
 }
 
+void HomeRight::onIntegratorChange(int integrator, int order)
+{
+    integrator_ = integrator;
+    taylorOrder_ = order;
+}
+
 void HomeRight::onGcfEval(std::string fname, int pointdash, int npoints,
                           int prec)
 {
@@ -466,13 +498,18 @@ void HomeRight::onGcfEval(std::string fname, int pointdash, int npoints,
     if (sphere_ == nullptr)
         return;
 
-    sphere_->gcfEval_ = true;
     sphere_->gcfDashes_ = pointdash;
     sphere_->gcfFname_ = fname;
     sphere_->gcfNPoints_ = npoints;
     sphere_->gcfPrec_ = prec;
-    sphere_->plotDone_ = false;
-    sphere_->update(PaintUpdate);
+    // compute first, the plot is only repainted once the points are ready
+    sphere_->computeGcf([this](bool result) {
+        if (!result)
+            g_globalLogger.error("[HomeRight] error while computing Gcf");
+        sphere_->gcfEval_ = true;
+        sphere_->plotDone_ = false;
+        sphere_->update(PaintUpdate);
+    });
     if (tabWidget_->currentIndex() != 1)
         tabWidget_->setCurrentIndex(1);
 }
@@ -616,6 +653,11 @@ void HomeRight::onCurvePlot(std::string fname, int pointdash, int npoints,
         return;
         curveConfirmedSignal_.emit(false);
     }
+    if (sphere_->evaluating()) {
+        printError("Wait until the current computation has finished.");
+        curveConfirmedSignal_.emit(false);
+        return;
+    }
 
     // 1. read curve tables
     if (!sphere_->study_->readCurve(fname)) {
@@ -629,48 +671,22 @@ void HomeRight::onCurvePlot(std::string fname, int pointdash, int npoints,
     sphere_->curveFname_ = fname;
     sphere_->curveNPoints_ = npoints;
     sphere_->curvePrec_ = prec;
-    sphere_->plotDone_ = false;
 
-    int result =
-        sphere_->evalCurveStart(sphere_->curveFname_, sphere_->curveDashes_,
-                                sphere_->curveNPoints_, sphere_->curvePrec_);
-    if (!result) {
-        g_globalLogger.error("[HomeRight] cannot evaluate curve");
-        curveConfirmedSignal_.emit(false);
-        return;
-    } else {
-        int i = 0;
-        do {
-            result = sphere_->evalCurveContinue(sphere_->curveFname_,
-                                                CURVE_POINTS, CURVE_PRECIS);
-            if (sphere_->curveError_) {
-                g_globalLogger.error("[HomeRight] error while computing "
-                                     "evalCurveContinue at step: " +
-                                     std::to_string(i));
-                curveConfirmedSignal_.emit(false);
-                return;
-            }
-            i++;
-        } while (!result);
-        // finish evaluation
-        result = sphere_->evalCurveFinish();
+    sphere_->computeCurve([this](bool result) {
+        curveConfirmedSignal_.emit(result);
         if (!result) {
-            g_globalLogger.error("[HomeRight] error in evalCurveFinish");
-            curveConfirmedSignal_.emit(false);
+            g_globalLogger.error("[HomeRight] cannot evaluate curve");
             return;
-        } else {
-            g_globalLogger.debug("[HomeRight] computed curve");
-            curveConfirmedSignal_.emit(true);
         }
-    }
+        g_globalLogger.debug("[HomeRight] computed curve");
 
-    // 3. plot
-    sphere_->update(PaintUpdate);
+        // 3. plot
+        sphere_->plotDone_ = false;
+        sphere_->update(PaintUpdate);
 
-    // 4. Focus plot tab
-    tabWidget_->setCurrentIndex(1);
-
-    return;
+        // 4. Focus plot tab
+        tabWidget_->setCurrentIndex(1);
+    });
 }
 
 void HomeRight::onCurvesDelete(int flag)
@@ -684,9 +700,6 @@ void HomeRight::onCurvesDelete(int flag)
     } else if (flag == 1)
         sphere_->study_->curve_vector_.pop_back();
 
-    sphere_->study_->deleteOrbitPoint(sphere_->study_->last_curves_point_);
-    sphere_->study_->last_curves_point_ = nullptr;
-
     sphere_->plotDone_ = false;
     sphere_->update();
     if (tabWidget_->currentIndex() != 1)
@@ -703,6 +716,11 @@ void HomeRight::onIsoclinePlot(std::string fname, int pointdash, int npoints,
         isoclineConfirmedSignal_.emit(false);
         return;
     }
+    if (sphere_->evaluating()) {
+        printError("Wait until the current computation has finished.");
+        isoclineConfirmedSignal_.emit(false);
+        return;
+    }
 
     // 1. read isocline tables
     if (!sphere_->study_->readIsoclines(fname)) {
@@ -716,47 +734,25 @@ void HomeRight::onIsoclinePlot(std::string fname, int pointdash, int npoints,
     sphere_->isoclineFname_ = fname;
     sphere_->isoclineNPoints_ = npoints;
     sphere_->isoclinePrec_ = prec;
-    sphere_->plotDone_ = false;
 
-    int result = sphere_->evalIsoclineStart(
-        sphere_->isoclineFname_, sphere_->isoclineDashes_,
-        sphere_->isoclineNPoints_, sphere_->isoclinePrec_);
-    if (!result) {
-        g_globalLogger.error("[HomeRight] cannot evaluate isocline");
-        isoclineConfirmedSignal_.emit(false);
-    } else {
-        int i = 0;
-        do {
-            result = sphere_->evalIsoclineContinue(sphere_->isoclineFname_,
-                                                   CURVE_POINTS, CURVE_PRECIS);
-            if (sphere_->isoclineError_) {
-                g_globalLogger.error("[HomeRight] error while computing "
-                                     "evalIsoclineContinue at step: " +
-                                     std::to_string(i));
-                isoclineConfirmedSignal_.emit(false);
-                return;
-            }
-            i++;
-        } while (!result);
-        // finish evaluation
-        result = sphere_->evalIsoclineFinish();
+    sphere_->computeIsocline([this](bool result) {
+        // 3. assign color and plot
+        int nisocs = (sphere_->study_->isocline_vector_.size() - 1) % 4;
+        sphere_->study_->isocline_vector_.back().color = CISOC + nisocs;
+
+        isoclineConfirmedSignal_.emit(result);
         if (!result) {
-            g_globalLogger.error("[HomeRight] error in evalIsoclineFinish");
-            isoclineConfirmedSignal_.emit(false);
-        } else {
-            g_globalLogger.debug("[HomeRight] computed isocline");
-            isoclineConfirmedSignal_.emit(true);
+            g_globalLogger.error("[HomeRight] cannot evaluate isocline");
+            return;
         }
-    }
+        g_globalLogger.debug("[HomeRight] computed isocline");
 
-    // 3. assign color and plot
-    int nisocs = (sphere_->study_->isocline_vector_.size() - 1) % 4;
-    sphere_->study_->isocline_vector_.back().color = CISOC + nisocs;
-    sphere_->update(PaintUpdate);
+        sphere_->plotDone_ = false;
+        sphere_->update(PaintUpdate);
 
-    // 4. Focus plot tab
-    tabWidget_->setCurrentIndex(1);
-    return;
+        // 4. Focus plot tab
+        tabWidget_->setCurrentIndex(1);
+    });
 }
 
 void HomeRight::onIsoclinesDelete(int flag)
@@ -770,27 +766,72 @@ void HomeRight::onIsoclinesDelete(int flag)
     } else if (flag == 1)
         sphere_->study_->isocline_vector_.pop_back();
 
-    sphere_->study_->deleteOrbitPoint(sphere_->study_->last_isoclines_point_);
-    sphere_->study_->last_isoclines_point_ = nullptr;
-
     sphere_->plotDone_ = false;
     sphere_->update();
     if (tabWidget_->currentIndex() != 1)
         tabWidget_->setCurrentIndex(1);
 }
 
-void HomeRight::refreshPlotSphere(double p)
+void HomeRight::onLimitCyclesSearch(double x0, double y0, double x1,
+                                    double y1, double grid, int npoints)
 {
-    WVFStudy *study;
-    if (sphere_->study_ != nullptr) {
-        g_globalLogger.debug("[HomeRight] copying study");
-        study = new WVFStudy(*(sphere_->study_));
-    } else {
-        g_globalLogger.debug("[HomeRight] using null study");
-        study = nullptr;
+    if (sphere_ == nullptr || sphere_->study_ == nullptr) {
+        limitCyclesConfirmedSignal_.emit(-1);
+        return;
     }
+    if (sphere_->evaluating()) {
+        printError("Wait until the current computation has finished.");
+        limitCyclesConfirmedSignal_.emit(-1);
+        return;
+    }
+
+    g_globalLogger.debug("[HomeRight] searching limit cycles...");
+    sphere_->study_->config_lc_numpoints_ = npoints;
+    applyIntegrator();
+    // the plot is only repainted once the search has finished
+    sphere_->computeLimitCycles(x0, y0, x1, y1, grid, [this](int found) {
+        g_globalLogger.debug("[HomeRight] found " + std::to_string(found) +
+                             " limit cycles");
+        limitCyclesConfirmedSignal_.emit(found);
+        if (found <= 0)
+            return;
+        sphere_->plotDone_ = false;
+        sphere_->update(PaintUpdate);
+    });
+    if (tabWidget_->currentIndex() != 1)
+        tabWidget_->setCurrentIndex(1);
+}
+
+void HomeRight::onLimitCyclesDelete(int flag)
+{
+    if (sphere_ == nullptr || sphere_->study_ == nullptr ||
+        sphere_->study_->limit_cycle_vector_.empty())
+        return;
 
+    if (flag == 0)
+        sphere_->study_->limit_cycle_vector_.clear();
+    else if (flag == 1)
+        deleteLastLimitCycle(sphere_);
+
+    sphere_->plotDone_ = false;
+    sphere_->update();
+    if (tabWidget_->currentIndex() != 1)
+        tabWidget_->setCurrentIndex(1);
+}
+
+void HomeRight::refreshPlotSphere(double p)
+{
+    WVFStudy *study = nullptr;
     if (sphere_ != nullptr) {
+        // the new view takes over the study of the old one: the vector field,
+        // the singular points and everything plotted so far do not depend on
+        // the view, and WSphere::setupPlot() sets the rest
+        sphere_->cancelComputations();
+        study = sphere_->study_;
+        sphere_->study_ = nullptr;
+        g_globalLogger.debug(study != nullptr
+                                 ? "[HomeRight] moving study to the new view"
+                                 : "[HomeRight] using null study");
         delete sphere_;
         sphere_ = nullptr;
     }
@@ -803,16 +844,15 @@ void HomeRight::refreshPlotSphere(double p)
 void HomeRight::refreshPlotPlane(int type, double minx, double maxx,
                                  double miny, double maxy)
 {
-    WVFStudy *study;
-    if (sphere_->study_ != nullptr) {
-        g_globalLogger.debug("[HomeRight] copying study");
-        study = new WVFStudy(*(sphere_->study_));
-    } else {
-        g_globalLogger.debug("[HomeRight] using null study");
-        study = nullptr;
-    }
-
+    WVFStudy *study = nullptr;
     if (sphere_ != nullptr) {
+        // see refreshPlotSphere()
+        sphere_->cancelComputations();
+        study = sphere_->study_;
+        sphere_->study_ = nullptr;
+        g_globalLogger.debug(study != nullptr
+                                 ? "[HomeRight] moving study to the new view"
+                                 : "[HomeRight] using null study");
         delete sphere_;
         sphere_ = nullptr;
     }
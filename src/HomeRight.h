@@ -168,6 +168,14 @@ class HomeRight : public Wt::WContainerWidget
     {
         return isoclineConfirmedSignal_;
     }
+    /**
+     * Send the number of limit cycles found by a search, or -1 if the
+     * search could not be done
+     */
+    Wt::Signal<int> &limitCyclesConfirmedSignal()
+    {
+        return limitCyclesConfirmedSignal_;
+    }
     /**
      * React to an orbit integration request
      *
@@ -186,6 +194,16 @@ class HomeRight : public Wt::WContainerWidget
      * @param flag can be 0 (delete all) or 1 (delete last)
      */
     void onOrbitsDelete(int flag);
+    /**
+     * React to a change of integrator
+     *
+     * The choice is applied to the study when the next orbit or limit
+     * cycle search starts
+     *
+     * @param integrator INTEGRATOR_RK78 or INTEGRATOR_TAYLOR
+     * @param order      order of the Taylor integrator, 0 for automatic
+     */
+    void onIntegratorChange(int integrator, int order);
     /**
      * React to reset signal from HomeLeft
      *
@@ -247,6 +265,27 @@ class HomeRight : public Wt::WContainerWidget
      * @param flag can be 0 (delete all) or 1 (delete last)
      */
     void onIsoclinesDelete(int flag);
+    /**
+     * React to the limit cycles search signal
+     *
+     * Search the limit cycles that cross the transverse section from
+     * (x0,y0) to (x1,y1) in the background and plot the new ones
+     *
+     * @param x0      x coordinate of the first end of the section
+     * @param y0      y coordinate of the first end of the section
+     * @param x1      x coordinate of the second end of the section
+     * @param y1      y coordinate of the second end of the section
+     * @param grid    distance between the orbits integrated from the section
+     * @param npoints maximum number of points to integrate for each orbit
+     */
+    void onLimitCyclesSearch(double x0, double y0, double x1, double y1,
+                             double grid, int npoints);
+    /**
+     * React to a limit cycle delete request
+     *
+     * @param flag can be 0 (delete all) or 1 (delete last)
+     */
+    void onLimitCyclesDelete(int flag);
     /**
      * Add a parameter to the list and fill the label and value
      *
@@ -307,6 +346,8 @@ class HomeRight : public Wt::WContainerWidget
 
     bool loggedIn_;
     bool orbitStarted_;
+    int integrator_;  // integrator chosen in HomeLeft
+    int taylorOrder_; // Taylor order chosen in HomeLeft
     int projection_;
     double viewMinX_;
     double viewMaxX_;
@@ -370,6 +411,9 @@ class HomeRight : public Wt::WContainerWidget
 
     // plot functions
     void setupSphereAndPlot();
+    // copy the integrator choice to the study, only while the sphere is not
+    // computing in the background
+    void applyIntegrator();
 
     void sphereClicked(Wt::WMouseEvent e);
 
@@ -382,6 +426,7 @@ class HomeRight : public Wt::WContainerWidget
     Wt::Signal<bool, double, double> sphereClickedSignal_;
     Wt::Signal<bool> curveConfirmedSignal_;
     Wt::Signal<bool> isoclineConfirmedSignal_;
+    Wt::Signal<int> limitCyclesConfirmedSignal_;
 };
 
 #endif // HOMERIGHT_H
\ No newline at end of file
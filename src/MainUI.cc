@@ -189,6 +189,8 @@ void MainUI::setupUI()
         rightContainer_, &HomeRight::onOrbitsIntegrate);
     leftContainer_->orbitDeleteSignal().connect(rightContainer_,
                                                 &HomeRight::onOrbitsDelete);
+    leftContainer_->integratorSignal().connect(rightContainer_,
+                                               &HomeRight::onIntegratorChange);
     leftContainer_->gcfSignal().connect(rightContainer_, &HomeRight::onGcfEval);
     leftContainer_->addParameterSignal().connect(
         rightContainer_, &HomeRight::addParameterWithValue);
@@ -200,6 +202,10 @@ void MainUI::setupUI()
                                                  &HomeRight::onIsoclinePlot);
     leftContainer_->isoclineDeleteSignal().connect(
         rightContainer_, &HomeRight::onIsoclinesDelete);
+    leftContainer_->limitCyclesSignal().connect(
+        rightContainer_, &HomeRight::onLimitCyclesSearch);
+    leftContainer_->limitCyclesDeleteSignal().connect(
+        rightContainer_, &HomeRight::onLimitCyclesDelete);
     leftContainer_->refreshPlotSphereSignal().connect(
         rightContainer_, &HomeRight::refreshPlotSphere);
     leftContainer_->refreshPlotPlaneSignal().connect(
@@ -212,6 +218,8 @@ void MainUI::setupUI()
                                                     &HomeLeft::curveConfirmed);
     rightContainer_->isoclineConfirmedSignal().connect(
         leftContainer_, &HomeLeft::isoclineConfirmed);
+    rightContainer_->limitCyclesConfirmedSignal().connect(
+        leftContainer_, &HomeLeft::limitCyclesConfirmed);
 
     g_globalLogger.debug("[MainUI] signals connected");
 
@@ -227,10 +235,12 @@ void MainUI::onAuthEvent()
         g_globalLogger.info("[Auth] User " + session_.userName() +
                             " logged in.");
         setLoginIndicator(session_.userName());
+        scriptHandler_->str_jobowner_ = session_.userName();
         leftContainer_->showSettings();
         rightContainer_->showParamsTab();
     } else {
         g_globalLogger.info("[Auth] User logged out.");
+        scriptHandler_->str_jobowner_ = "";
         leftContainer_->hideSettings();
         rightContainer_->hideParamsTab(true);
         setLogoutIndicator();
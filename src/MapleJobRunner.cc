@@ -0,0 +1,398 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapleJobRunner.h"
+
+#include "MapleKernel.h"
+#include "MyLogger.h"
+#include "ScriptHandler.h"
+
+#include <Wt/WApplication>
+#include <Wt/WServer>
+
+#include <cstdlib>
+#include <memory>
+#include <sys/wait.h>
+#include <vector>
+
+using namespace Wt;
+
+// how often the reaper thread polls the running processes
+#define REAPER_POLL_MS 50
+// seconds between SIGTERM and SIGKILL for a process that ran out of time
+#define REAPER_KILL_GRACE 5
+
+MapleJobRunner g_mapleJobRunner;
+
+MapleJobRunner::MapleJobRunner()
+    : stopping_(false), maxProcesses_(0), warmKernels_(false),
+      kernelMaxJobs_(MAPLE_KERNEL_MAX_JOBS),
+      kernelMaxMemoryKb_(MAPLE_KERNEL_MAX_MEMORY * 1024L), submitted_(0),
+      finished_(0), timedOut_(0), totalWait_(0), maxWait_(0), dispatched_(0),
+      kernelsStarted_(0), warmJobs_(0)
+{
+}
+
+MapleJobRunner::~MapleJobRunner()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeUp_.notify_all();
+    if (reaper_.joinable())
+        reaper_.join();
+    while (!idleKernels_.empty()) {
+        delete idleKernels_.front();
+        idleKernels_.pop_front();
+    }
+}
+
+void MapleJobRunner::submit(std::string fname, std::string owner, int maxtime,
+                            Callback done, QueueCallback queued)
+{
+    MapleJob job;
+    job.fname = fname;
+    job.owner = owner;
+    job.sessionId = WApplication::instance()->sessionId();
+    job.maxtime = maxtime;
+    job.done = done;
+    job.queued = queued;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    enqueue(job, lock);
+}
+
+void MapleJobRunner::submitAll(const std::vector<std::string> &fnames,
+                               std::string owner, int maxtime,
+                               BatchCallback done)
+{
+    // the callbacks run one at a time in the session, no locking needed
+    std::shared_ptr<std::vector<siginfo_t>> status =
+        std::make_shared<std::vector<siginfo_t>>(fnames.size());
+    std::shared_ptr<size_t> pending = std::make_shared<size_t>(fnames.size());
+    if (fnames.empty()) {
+        done(*status);
+        return;
+    }
+    for (size_t i = 0; i < fnames.size(); i++) {
+        submit(fnames[i], owner, maxtime,
+               [status, pending, i, done](siginfo_t info) {
+                   (*status)[i] = info;
+                   if (--(*pending) == 0)
+                       done(*status);
+               });
+    }
+}
+
+MapleJobRunner::Metrics MapleJobRunner::metrics()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Metrics m;
+    m.maxProcesses = maxProcesses_ > 0 ? maxProcesses_ : MAPLE_MAX_PROCESSES;
+    m.running = jobs_.size();
+    m.queued = 0;
+    std::map<std::string, std::deque<MapleJob>>::const_iterator it;
+    for (it = queues_.begin(); it != queues_.end(); ++it)
+        m.queued += it->second.size();
+    m.submitted = submitted_;
+    m.finished = finished_;
+    m.timedOut = timedOut_;
+    m.idleKernels = idleKernels_.size();
+    m.kernelsStarted = kernelsStarted_;
+    m.warmJobs = warmJobs_;
+    m.meanWaitSeconds = dispatched_ > 0 ? totalWait_ / dispatched_ : 0;
+    m.maxWaitSeconds = maxWait_;
+    return m;
+}
+
+void MapleJobRunner::configure()
+{
+    if (maxProcesses_ > 0)
+        return;
+    maxProcesses_ = MAPLE_MAX_PROCESSES;
+
+    WServer *server = WServer::instance();
+    if (server == nullptr)
+        return;
+    std::string value;
+    if (server->readConfigurationProperty("maple-max-processes", value) &&
+        std::atoi(value.c_str()) > 0)
+        maxProcesses_ = std::atoi(value.c_str());
+    if (server->readConfigurationProperty("maple-warm-kernels", value))
+        warmKernels_ = (value == "true");
+    if (server->readConfigurationProperty("maple-kernel-max-jobs", value))
+        kernelMaxJobs_ = std::atoi(value.c_str());
+    if (server->readConfigurationProperty("maple-kernel-max-memory", value))
+        kernelMaxMemoryKb_ = std::atol(value.c_str()) * 1024L;
+}
+
+void MapleJobRunner::enqueue(MapleJob &job, std::unique_lock<std::mutex> &lock)
+{
+    configure();
+
+    job.pid = -1;
+    job.kernel = nullptr;
+    job.timedOut = false;
+    job.position = 0;
+    job.queuedAt = std::chrono::steady_clock::now();
+
+    std::deque<MapleJob> &queue = queues_[job.owner];
+    if (queue.empty())
+        owners_.push_back(job.owner);
+    queue.push_back(job);
+    submitted_++;
+
+    if (!reaper_.joinable())
+        reaper_ = std::thread(&MapleJobRunner::reap, this);
+
+    dispatch(lock);
+    updatePositions(lock);
+}
+
+void MapleJobRunner::dispatch(std::unique_lock<std::mutex> &lock)
+{
+    bool started = false;
+    while ((int)jobs_.size() < maxProcesses_ && !owners_.empty()) {
+        // round-robin between owners, FIFO inside each owner's queue
+        std::string owner = owners_.front();
+        owners_.pop_front();
+        std::deque<MapleJob> &queue = queues_[owner];
+        MapleJob job = queue.front();
+        queue.pop_front();
+        if (queue.empty())
+            queues_.erase(owner);
+        else
+            owners_.push_back(owner);
+        MyLogger::ThreadSession logSession(job.sessionId);
+
+        std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+        double wait = std::chrono::duration<double>(now - job.queuedAt).count();
+        totalWait_ += wait;
+        if (wait > maxWait_)
+            maxWait_ = wait;
+        dispatched_++;
+
+        if (!warmKernels_ || !startInKernel(job))
+            job.pid = ScriptHandler::launchMapleScript(job.fname);
+        if (job.pid < 0) {
+            siginfo_t info;
+            info.si_pid = -1;
+            info.si_code = -1;
+            info.si_status = -1;
+            finished_++;
+            lock.unlock();
+            post(job, info);
+            lock.lock();
+            continue;
+        }
+        job.deadline = now + std::chrono::seconds(job.maxtime);
+        jobs_.push_back(job);
+        started = true;
+    }
+    if (started)
+        wakeUp_.notify_all();
+}
+
+bool MapleJobRunner::startInKernel(MapleJob &job)
+{
+    std::string library;
+    if (!MapleKernel::splitScript(job.fname, library))
+        return false;
+
+    MapleKernel *kernel = nullptr;
+    std::list<MapleKernel *>::iterator it = idleKernels_.begin();
+    while (it != idleKernels_.end()) {
+        if (!(*it)->alive()) {
+            delete *it;
+            it = idleKernels_.erase(it);
+        } else if ((*it)->library() == library) {
+            kernel = *it;
+            idleKernels_.erase(it);
+            break;
+        } else {
+            ++it;
+        }
+    }
+
+    if (kernel == nullptr) {
+        // make room in the process slots, dropping the least recently used
+        while (!idleKernels_.empty() &&
+               (int)(idleKernels_.size() + jobs_.size()) >= maxProcesses_) {
+            delete idleKernels_.front();
+            idleKernels_.pop_front();
+        }
+        kernel = new MapleKernel(library);
+        if (!kernel->start()) {
+            delete kernel;
+            return false;
+        }
+        kernelsStarted_++;
+    }
+
+    if (!kernel->submit(job.fname)) {
+        delete kernel;
+        return false;
+    }
+    job.kernel = kernel;
+    job.pid = kernel->pid();
+    warmJobs_++;
+    return true;
+}
+
+void MapleJobRunner::releaseKernel(MapleJob &job)
+{
+    MapleKernel *kernel = job.kernel;
+    job.kernel = nullptr;
+    if (job.timedOut || !kernel->alive() ||
+        kernel->exhausted(kernelMaxJobs_, kernelMaxMemoryKb_)) {
+        g_globalLogger.debug("[MapleJobRunner] recycling Maple kernel " +
+                             std::to_string(kernel->pid()));
+        delete kernel;
+    } else {
+        idleKernels_.push_back(kernel);
+    }
+}
+
+void MapleJobRunner::updatePositions(std::unique_lock<std::mutex> &lock)
+{
+    // simulate the round-robin order in which pending jobs will start
+    std::vector<std::deque<MapleJob> *> order;
+    std::list<std::string>::const_iterator it;
+    for (it = owners_.begin(); it != owners_.end(); ++it)
+        order.push_back(&queues_[*it]);
+
+    std::vector<std::pair<std::string, std::function<void()>>> notify;
+    int position = 1;
+    for (size_t depth = 0;; depth++) {
+        bool any = false;
+        for (size_t i = 0; i < order.size(); i++) {
+            if (depth >= order[i]->size())
+                continue;
+            any = true;
+            MapleJob &job = (*order[i])[depth];
+            if (job.position != position && job.queued) {
+                QueueCallback queued = job.queued;
+                int p = position;
+                notify.push_back(std::make_pair(
+                    job.sessionId, std::function<void()>([queued, p]() {
+                        queued(p);
+                        WApplication::instance()->triggerUpdate();
+                    })));
+            }
+            job.position = position++;
+        }
+        if (!any)
+            break;
+    }
+
+    if (notify.empty() || WServer::instance() == nullptr)
+        return;
+    lock.unlock();
+    for (size_t i = 0; i < notify.size(); i++)
+        WServer::instance()->post(notify[i].first, notify[i].second);
+    lock.lock();
+}
+
+void MapleJobRunner::reap()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (jobs_.empty()) {
+            wakeUp_.wait(lock);
+            continue;
+        }
+
+        std::vector<std::pair<MapleJob, siginfo_t>> finished;
+        std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+        std::list<MapleJob>::iterator it = jobs_.begin();
+        while (it != jobs_.end()) {
+            siginfo_t info;
+            info.si_pid = 0;
+            if (it->kernel != nullptr) {
+                if (!it->kernel->poll(info))
+                    info.si_pid = 0;
+            } else {
+                waitid(P_PID, it->pid, &info, WEXITED | WNOHANG);
+            }
+            if (info.si_pid != 0) {
+                if (it->timedOut) {
+                    info.si_status = -2;
+                    info.si_code = -2;
+                    timedOut_++;
+                }
+                finished_++;
+                if (it->kernel != nullptr) {
+                    MyLogger::ThreadSession logSession(it->sessionId);
+                    releaseKernel(*it);
+                }
+                finished.push_back(std::make_pair(*it, info));
+                it = jobs_.erase(it);
+                continue;
+            }
+            if (now >= it->deadline) {
+                if (!it->timedOut) {
+                    // ask the process and its children to stop, they are
+                    // killed after a grace period
+                    std::string aux("pkill -TERM -P " +
+                                    std::to_string(it->pid));
+                    system(aux.c_str());
+                    kill(it->pid, SIGTERM);
+                    it->timedOut = true;
+                    it->deadline =
+                        now + std::chrono::seconds(REAPER_KILL_GRACE);
+                } else {
+                    kill(it->pid, SIGKILL);
+                }
+            }
+            ++it;
+        }
+
+        if (!finished.empty()) {
+            dispatch(lock);
+            updatePositions(lock);
+            // never call into Wt while holding our own lock
+            lock.unlock();
+            for (size_t i = 0; i < finished.size(); i++)
+                post(finished[i].first, finished[i].second);
+            lock.lock();
+        }
+
+        if (!stopping_ && !jobs_.empty())
+            wakeUp_.wait_for(lock, std::chrono::milliseconds(REAPER_POLL_MS));
+    }
+}
+
+void MapleJobRunner::post(const MapleJob &job, siginfo_t info)
+{
+    WServer *server = WServer::instance();
+    if (server == nullptr)
+        return;
+
+    Callback done = job.done;
+    pid_t pid = job.pid;
+    // if the session has already expired the function is simply dropped
+    server->post(job.sessionId, [done, pid, info]() {
+        g_globalLogger.debug("[MapleJobRunner] Maple process " +
+                             std::to_string(pid) + " finished");
+        done(info);
+        WApplication::instance()->triggerUpdate();
+    });
+}
@@ -0,0 +1,227 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MAPLEJOBRUNNER_H
+#define MAPLEJOBRUNNER_H
+
+/*!
+ * @brief Scheduling and supervision of forked Maple processes
+ * @file MapleJobRunner.h
+ *
+ * Every Maple script executed by the server goes through a single
+ * MapleJobRunner. It limits the number of Maple processes that run at
+ * the same time, queues the rest with per-user fairness, and watches the
+ * running processes from a reaper thread. When a process exits (or runs
+ * out of time) the result is posted back to the session that submitted
+ * it through Wt::WServer::post, so no Wt worker thread is blocked while
+ * Maple is running.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ * Default maximum number of simultaneous Maple processes. It can be
+ * overridden with the "maple-max-processes" property in wt_config.xml
+ */
+#define MAPLE_MAX_PROCESSES 4
+/**
+ * Default number of jobs a warm Maple kernel runs before being replaced
+ * ("maple-kernel-max-jobs" property)
+ */
+#define MAPLE_KERNEL_MAX_JOBS 50
+/**
+ * Default resident memory in MB above which a warm Maple kernel is replaced
+ * ("maple-kernel-max-memory" property)
+ */
+#define MAPLE_KERNEL_MAX_MEMORY 512
+
+class MapleKernel;
+
+/**
+ * Class that schedules and supervises Maple processes
+ *
+ * @class MapleJobRunner
+ *
+ * Jobs are submitted with #submit from a session thread. Pending jobs are
+ * kept in one FIFO queue per owner (a logged in user or an anonymous
+ * session), and free process slots are handed to the owners in
+ * round-robin order so that a single user cannot monopolize the server.
+ *
+ * If the "maple-warm-kernels" property is true, jobs are run by
+ * MapleKernel processes that keep the P4 library loaded between jobs
+ * instead of starting a new Maple for every script. Idle kernels are kept
+ * (at most one per process slot) and recycled after a number of jobs or
+ * when they grow too much.
+ *
+ * The completion and queue callbacks always run inside the session that
+ * submitted the job, with the update lock held, so they can safely modify
+ * widgets and emit signals.
+ */
+class MapleJobRunner
+{
+  public:
+    /**
+     * Completion callback type.
+     *
+     * The siginfo_t argument is the status of the Maple process as given by
+     * waitid(), except that si_code -1 means the process could not be
+     * forked and si_code -2 means it ran out of time.
+     */
+    typedef std::function<void(siginfo_t)> Callback;
+    /**
+     * Queue callback type, receives the 1-based position of a pending job
+     * in the global queue every time it changes
+     */
+    typedef std::function<void(int)> QueueCallback;
+    /**
+     * Completion callback type for a batch of jobs, receives the status of
+     * each job in the order they were submitted
+     */
+    typedef std::function<void(std::vector<siginfo_t>)> BatchCallback;
+
+    /**
+     * Snapshot of the scheduler state
+     */
+    struct Metrics {
+        int maxProcesses;             ///< process slots
+        int running;                  ///< Maple processes running now
+        int queued;                   ///< jobs waiting for a slot
+        unsigned long submitted;      ///< jobs submitted since start-up
+        unsigned long finished;       ///< jobs finished since start-up
+        unsigned long timedOut;       ///< jobs killed for running out of time
+        int idleKernels;              ///< warm kernels waiting for a job
+        unsigned long kernelsStarted; ///< warm kernels started
+        unsigned long warmJobs;       ///< jobs run by a warm kernel
+        double meanWaitSeconds;       ///< mean time spent in the queue
+        double maxWaitSeconds;        ///< longest time spent in the queue
+    };
+
+    /**
+     * Constructor method
+     */
+    MapleJobRunner();
+    /**
+     * Destructor method, stops the reaper thread
+     */
+    ~MapleJobRunner();
+
+    /**
+     * Submit a Maple script for execution
+     *
+     * @param fname   filename of Maple script (without .mpl extension)
+     * @param owner   key used for fairness (user name or session id)
+     * @param maxtime maximum number of seconds the process may run
+     * @param done    function called in the current session once the
+     *                process has finished
+     * @param queued  function called in the current session with the queue
+     *                position while the job waits for a free slot (optional)
+     *
+     * Must be called from a session thread (WApplication::instance() must
+     * not be null).
+     */
+    void submit(std::string fname, std::string owner, int maxtime,
+                Callback done, QueueCallback queued = QueueCallback());
+
+    /**
+     * Submit several Maple scripts that run concurrently
+     *
+     * @param fnames  filenames of Maple scripts (without .mpl extension)
+     * @param owner   key used for fairness (user name or session id)
+     * @param maxtime maximum number of seconds each process may run
+     * @param done    function called in the current session once all the
+     *                processes have finished
+     */
+    void submitAll(const std::vector<std::string> &fnames, std::string owner,
+                   int maxtime, BatchCallback done);
+
+    /**
+     * Get current queue depth and wait time statistics
+     */
+    Metrics metrics();
+
+  private:
+    struct MapleJob {
+        std::string fname;
+        std::string owner;
+        std::string sessionId; // session the callbacks are posted to
+        int maxtime;
+        pid_t pid;
+        MapleKernel *kernel; // null unless run by a warm kernel
+        std::chrono::steady_clock::time_point queuedAt;
+        std::chrono::steady_clock::time_point deadline;
+        bool timedOut;
+        int position;
+        Callback done;
+        QueueCallback queued;
+    };
+
+    std::list<MapleJob> jobs_;                          // running
+    std::map<std::string, std::deque<MapleJob>> queues_; // pending, per owner
+    std::list<std::string> owners_; // owners with pending jobs, next first
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    std::thread reaper_;
+    bool stopping_;
+    int maxProcesses_;
+    bool warmKernels_;
+    int kernelMaxJobs_;
+    long kernelMaxMemoryKb_;
+    std::list<MapleKernel *> idleKernels_; // least recently used first
+
+    unsigned long submitted_;
+    unsigned long finished_;
+    unsigned long timedOut_;
+    double totalWait_;
+    double maxWait_;
+    unsigned long dispatched_;
+    unsigned long kernelsStarted_;
+    unsigned long warmJobs_;
+
+    // read the configuration properties, once
+    void configure();
+
+    // add a job to its owner's queue and start what fits (mutex_ held)
+    void enqueue(MapleJob &job, std::unique_lock<std::mutex> &lock);
+    // start queued jobs while there are free slots (mutex_ held)
+    void dispatch(std::unique_lock<std::mutex> &lock);
+    // start a job in a warm kernel, false if it has to run in a new Maple
+    bool startInKernel(MapleJob &job);
+    // keep the kernel of a finished job for later, or get rid of it
+    void releaseKernel(MapleJob &job);
+    // recompute queue positions and notify the ones that changed
+    void updatePositions(std::unique_lock<std::mutex> &lock);
+    // reaper thread loop
+    void reap();
+    // deliver the result of a job to its session
+    void post(const MapleJob &job, siginfo_t info);
+};
+
+extern MapleJobRunner g_mapleJobRunner; ///< Global Maple job scheduler
+
+#endif // MAPLEJOBRUNNER_H
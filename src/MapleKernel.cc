@@ -0,0 +1,301 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapleKernel.h"
+
+#include "MyLogger.h"
+#include "ScriptHandler.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// marker written by the kernel after every job. The wrapper prints it in
+// two pieces, so that its source never contains the whole marker in case
+// the kernel echoes its input
+#define KERNEL_DONE_MARK1 "WP4_JOB_"
+#define KERNEL_DONE_MARK2 "DONE "
+#define KERNEL_DONE_MARK KERNEL_DONE_MARK1 KERNEL_DONE_MARK2
+
+MapleKernel::MapleKernel(std::string library)
+    : library_(library), pid_(-1), fd_(-1), dead_(false), jobs_(0)
+{
+}
+
+MapleKernel::~MapleKernel()
+{
+    if (fd_ != -1)
+        close(fd_);
+    if (pid_ > 0 && !dead_) {
+        std::string aux("pkill -KILL -P " + std::to_string(pid_));
+        system(aux.c_str());
+        kill(pid_, SIGKILL);
+        waitpid(pid_, nullptr, 0);
+    }
+    if (!job_.empty())
+        unlink((job_ + ".warm.mpl").c_str());
+}
+
+bool MapleKernel::start()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        g_globalLogger.error("[MapleKernel] cannot create socket");
+        return false;
+    }
+
+    // built before fork(), the child must not allocate (see
+    // ScriptHandler::launchMapleScript)
+    std::vector<std::string> args = ScriptHandler::mapleCommand();
+    args.push_back("-q");
+    std::vector<char *> commands;
+    for (size_t i = 0; i < args.size(); i++)
+        commands.push_back(&args[i][0]);
+    commands.push_back(nullptr);
+
+    pid_ = fork();
+    if (pid_ < 0) {
+        g_globalLogger.error("[MapleKernel] error forking Maple kernel");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    } else if (pid_ == 0) {
+        close(fds[0]);
+        dup2(fds[1], 0);
+        dup2(fds[1], 1);
+        close(fds[1]);
+        execvp(commands[0], commands.data());
+        _exit(127);
+    }
+
+    close(fds[1]);
+    fd_ = fds[0];
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+
+    // scripts end with `quit`(n): make it unwind to the job wrapper instead
+    // of terminating the kernel
+    std::string preamble =
+        "interface( quiet = true, screenwidth = infinity ):\n";
+    preamble += "unprotect( `quit` ):\n";
+    preamble += "`quit` := proc(n := 0) error \"wp4quit\", n end proc:\n";
+    preamble += "read( \"" + library_ + "\" ):\n";
+    // the names assigned by the library, with their values, so that every
+    // job starts from the state a restart would give (see submit)
+    preamble += "wp4_snapshot := proc() local n, t;\n";
+    preamble += "  t := table():\n";
+    preamble += "  for n in [anames('user')] do t[n] := eval(n, 2) end do:\n";
+    preamble += "  t\n";
+    preamble += "end proc:\n";
+    preamble += "wp4_reset := proc() local n;\n";
+    preamble += "  for n in [anames('user')] do\n";
+    preamble += "    if not assigned(wp4_base[n]) and not member(n,\n";
+    preamble += "        {'wp4_base', 'wp4_snapshot', 'wp4_reset', "
+                "'wp4_status'}) then\n";
+    preamble += "      try unassign(n) catch: end try\n";
+    preamble += "    end if\n";
+    preamble += "  end do:\n";
+    preamble += "  for n in [indices(wp4_base, 'nolist')] do\n";
+    preamble += "    try assign(n, eval(wp4_base[n], 1)) catch: end try\n";
+    preamble += "  end do:\n";
+    preamble += "  NULL\n";
+    preamble += "end proc:\n";
+    preamble += "wp4_base := wp4_snapshot():\n";
+    if (!send(preamble))
+        return false;
+
+    g_globalLogger.debug("[MapleKernel] started Maple kernel " +
+                         std::to_string(pid_) + " with " + library_);
+    return true;
+}
+
+bool MapleKernel::submit(std::string fname)
+{
+    job_ = fname;
+    jobs_++;
+    output_.clear();
+
+    // the script had a restart, which is replaced by wiping the names the
+    // previous job assigned and restoring the library and the environment
+    std::string wrapper = "wp4_reset():\n";
+    wrapper += "Digits := 10:\n";
+    wrapper += "interface( quiet = true, screenwidth = infinity ):\n";
+    wrapper += "wp4_status := 0:\n";
+    wrapper += "writeto( \"" + fname + ".res\" ):\n";
+    wrapper += "try read( \"" + fname + ".warm.mpl\" ):\n";
+    wrapper += "catch \"wp4quit\": wp4_status := lastexception[3]:\n";
+    wrapper += "catch: wp4_status := 1:\n";
+    wrapper += "end try:\n";
+    wrapper += "writeto( terminal ):\n";
+    wrapper += "printf( \"\\n%s%s%d\\n\", \"" KERNEL_DONE_MARK1
+               "\", \"" KERNEL_DONE_MARK2 "\", wp4_status ):\n";
+    wrapper += "fflush( terminal ):\n";
+    return send(wrapper);
+}
+
+bool MapleKernel::poll(siginfo_t &info)
+{
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd_, buf, sizeof(buf))) > 0)
+        output_.append(buf, n);
+
+    size_t mark = output_.find(KERNEL_DONE_MARK);
+    if (mark != std::string::npos &&
+        output_.find('\n', mark) != std::string::npos) {
+        info.si_pid = pid_;
+        info.si_code = CLD_EXITED;
+        info.si_status =
+            std::atoi(output_.c_str() + mark + strlen(KERNEL_DONE_MARK));
+        unlink((job_ + ".warm.mpl").c_str());
+        job_.clear();
+        output_.clear();
+        return true;
+    }
+
+    if (!alive()) {
+        info = exitInfo_;
+        return true;
+    }
+    return false;
+}
+
+bool MapleKernel::alive()
+{
+    if (dead_ || pid_ <= 0)
+        return false;
+    siginfo_t info;
+    info.si_pid = 0;
+    waitid(P_PID, pid_, &info, WEXITED | WNOHANG);
+    if (info.si_pid != 0) {
+        dead_ = true;
+        exitInfo_ = info;
+        g_globalLogger.debug("[MapleKernel] Maple kernel " +
+                             std::to_string(pid_) + " exited");
+        return false;
+    }
+    return true;
+}
+
+bool MapleKernel::exhausted(int maxJobs, long maxMemoryKb)
+{
+    if (maxJobs > 0 && jobs_ >= maxJobs)
+        return true;
+    if (maxMemoryKb > 0 && memoryKb() > maxMemoryKb)
+        return true;
+    return false;
+}
+
+bool MapleKernel::splitScript(std::string fname, std::string &library)
+{
+    std::ifstream in(fname + ".mpl");
+    std::string line;
+
+    if (!std::getline(in, line) || line != "restart;")
+        return false;
+    if (!std::getline(in, line) || line.compare(0, 5, "read(") != 0)
+        return false;
+    size_t first = line.find('"');
+    size_t last = line.rfind('"');
+    if (first == std::string::npos || last <= first)
+        return false;
+    library = line.substr(first + 1, last - first - 1);
+
+    std::ofstream out(fname + ".warm.mpl");
+    out << in.rdbuf();
+    return out.good();
+}
+
+bool MapleKernel::send(const std::string &text)
+{
+    size_t written = 0;
+    while (written < text.size()) {
+        // MSG_NOSIGNAL: a dead kernel must not raise SIGPIPE in the server
+        ssize_t n = ::send(fd_, text.c_str() + written, text.size() - written,
+                           MSG_NOSIGNAL);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            usleep(1000);
+            continue;
+        }
+        if (n <= 0) {
+            g_globalLogger.error("[MapleKernel] cannot write to Maple kernel " +
+                                 std::to_string(pid_));
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+long MapleKernel::memoryKb()
+{
+    // the maple launcher forks the actual kernel, so add up the whole tree
+    std::map<pid_t, std::vector<pid_t>> children;
+    std::map<pid_t, long> rss;
+    DIR *proc = opendir("/proc");
+    if (proc == nullptr)
+        return 0;
+    struct dirent *entry;
+    while ((entry = readdir(proc)) != nullptr) {
+        pid_t p = std::atoi(entry->d_name);
+        if (p <= 0)
+            continue;
+        std::ifstream stat("/proc/" + std::string(entry->d_name) + "/stat");
+        std::string content;
+        if (!std::getline(stat, content))
+            continue;
+        // skip "pid (comm)", comm may contain spaces
+        size_t end = content.rfind(')');
+        if (end == std::string::npos)
+            continue;
+        std::istringstream fields(content.substr(end + 2));
+        std::string field;
+        pid_t ppid = 0;
+        long pages = 0;
+        for (int i = 3; i <= 24 && fields >> field; i++) {
+            if (i == 4)
+                ppid = std::atoi(field.c_str());
+            else if (i == 24)
+                pages = std::atol(field.c_str());
+        }
+        children[ppid].push_back(p);
+        rss[p] = pages;
+    }
+    closedir(proc);
+
+    long total = 0;
+    long pageKb = sysconf(_SC_PAGESIZE) / 1024;
+    std::vector<pid_t> pending(1, pid_);
+    while (!pending.empty()) {
+        pid_t p = pending.back();
+        pending.pop_back();
+        total += rss[p] * pageKb;
+        std::vector<pid_t> &c = children[p];
+        pending.insert(pending.end(), c.begin(), c.end());
+    }
+    return total;
+}
@@ -0,0 +1,147 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MAPLEKERNEL_H
+#define MAPLEKERNEL_H
+
+/*!
+ * @brief Long-lived Maple process that executes scripts fed over a pipe
+ * @file MapleKernel.h
+ *
+ * Every script generated by ScriptHandler starts with a restart and a read
+ * of a P4 Maple library (p4.m or p4gcf.m). A MapleKernel loads the library
+ * once and then runs the body of each script, so a job does not pay the
+ * start-up of Maple and the library load again.
+ */
+
+#include <string>
+
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ * Class that wraps a warm Maple process
+ *
+ * @class MapleKernel
+ *
+ * The process reads Maple statements from its standard input, which is
+ * connected to a socket owned by this object. Each job is run inside a
+ * try block that turns `quit` into an exception, its output is redirected
+ * to fname.res exactly like in a normal Maple execution, and a marker line
+ * with the exit status is written back when it finishes.
+ *
+ * Jobs from different users share the process, so none may see what the
+ * previous one left behind. The names assigned after the library was read
+ * are unassigned before each job, the names of the library get back the
+ * values they had after the read, and Digits is reset, which is the state
+ * the `restart` of the script would have given.
+ *
+ * A kernel runs one job at a time. It is not thread safe, the owner
+ * (MapleJobRunner) serializes the calls.
+ */
+class MapleKernel
+{
+  public:
+    /**
+     * Constructor method
+     *
+     * @param library path of the Maple library this kernel keeps loaded
+     */
+    MapleKernel(std::string library);
+    /**
+     * Destructor method, kills the Maple process
+     */
+    ~MapleKernel();
+
+    /**
+     * Fork the Maple process and load the library
+     *
+     * @return @c true if the process was started
+     */
+    bool start();
+
+    /**
+     * Start the execution of a script
+     *
+     * @param fname filename of Maple script (without .mpl extension), as
+     *              prepared by #splitScript
+     * @return      @c true if the job was sent to the process
+     */
+    bool submit(std::string fname);
+
+    /**
+     * Check whether the current job has finished, without blocking
+     *
+     * @param info filled with the job status when it has finished
+     * @return     @c true if the job has finished or the process died
+     *
+     * A finished job reports si_code CLD_EXITED and the argument of the
+     * `quit` called by the script as si_status. If the process died, @p
+     * info is the status of the process.
+     */
+    bool poll(siginfo_t &info);
+
+    /**
+     * Check if the process is still running
+     */
+    bool alive();
+
+    /**
+     * Check if the kernel should be recycled
+     *
+     * @param maxJobs     maximum number of jobs per process
+     * @param maxMemoryKb maximum resident memory of the process tree
+     * @return            @c true if one of the limits has been reached
+     */
+    bool exhausted(int maxJobs, long maxMemoryKb);
+
+    /**
+     * Get the pid of the Maple process
+     */
+    pid_t pid() const { return pid_; }
+    /**
+     * Get the path of the library loaded in this kernel
+     */
+    const std::string &library() const { return library_; }
+
+    /**
+     * Strip the restart and library read from a generated script
+     *
+     * @param fname   filename of Maple script (without .mpl extension)
+     * @param library set to the path of the library read by the script
+     * @return        @c true if the script has the expected header, in
+     * which case the body is written to fname.warm.mpl
+     */
+    static bool splitScript(std::string fname, std::string &library);
+
+  private:
+    std::string library_;   ///< Maple library loaded in the process
+    pid_t pid_;             ///< pid of the Maple process
+    int fd_;                ///< socket connected to stdin and stdout
+    bool dead_;             ///< the process has exited
+    siginfo_t exitInfo_;    ///< exit status, valid if #dead_
+    int jobs_;              ///< number of jobs run by this process
+    std::string job_;       ///< current job (empty if idle)
+    std::string output_;    ///< pending output read from the process
+
+    // write a string to the process, false if it failed
+    bool send(const std::string &text);
+    // resident memory of the process and its children, in kB
+    long memoryKb();
+};
+
+#endif // MAPLEKERNEL_H
@@ -0,0 +1,54 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapleStatsResource.h"
+
+#include "MapleJobRunner.h"
+#include "custom.h"
+
+#include <Wt/Http/Request>
+#include <Wt/Http/Response>
+
+using namespace Wt;
+
+MapleStatsResource::MapleStatsResource() {}
+
+MapleStatsResource::~MapleStatsResource() { beingDeleted(); }
+
+void MapleStatsResource::handleRequest(const Http::Request &request,
+                                       Http::Response &response)
+{
+    UNUSED(request);
+    MapleJobRunner::Metrics m = g_mapleJobRunner.metrics();
+
+    response.setMimeType("text/plain");
+    response.out() << "maple_max_processes " << m.maxProcesses << "\n"
+                   << "maple_running " << m.running << "\n"
+                   << "maple_queued " << m.queued << "\n"
+                   << "maple_submitted_total " << m.submitted << "\n"
+                   << "maple_finished_total " << m.finished << "\n"
+                   << "maple_timed_out_total " << m.timedOut << "\n"
+                   << "maple_idle_kernels " << m.idleKernels << "\n"
+                   << "maple_kernels_started_total " << m.kernelsStarted
+                   << "\n"
+                   << "maple_warm_jobs_total " << m.warmJobs << "\n"
+                   << "maple_queue_wait_mean_seconds " << m.meanWaitSeconds
+                   << "\n"
+                   << "maple_queue_wait_max_seconds " << m.maxWaitSeconds
+                   << "\n";
+}
@@ -0,0 +1,57 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MAPLESTATSRESOURCE_H
+#define MAPLESTATSRESOURCE_H
+
+/*!
+ * @brief Static resource that publishes Maple queue metrics
+ * @file MapleStatsResource.h
+ */
+
+#include <Wt/WResource>
+
+/**
+ * Plain text resource with the state of #g_mapleJobRunner
+ *
+ * @class MapleStatsResource
+ *
+ * It is deployed by main() as a static resource, so monitoring tools can
+ * poll the number of running and queued Maple processes and the time jobs
+ * spend waiting in the queue. Each line has the form "name value". It is
+ * only deployed when the "maple-stats" configuration property is true.
+ */
+class MapleStatsResource : public Wt::WResource
+{
+  public:
+    /**
+     * Constructor method
+     */
+    MapleStatsResource();
+    /**
+     * Destructor method
+     */
+    ~MapleStatsResource();
+
+    /**
+     * Write the current metrics to the response
+     */
+    void handleRequest(const Wt::Http::Request &request,
+                       Wt::Http::Response &response);
+};
+
+#endif // MAPLESTATSRESOURCE_H
@@ -43,6 +43,9 @@ MyApplication::MyApplication(const WEnvironment &env) : WApplication(env)
 
     mainUI_ = new MainUI(root());
 
+    // Maple results are pushed to the browser when they are ready
+    enableUpdates(true);
+
     g_globalLogger.debug("[MyApplication] created correctly");
 }
 
@@ -23,6 +23,9 @@ using namespace Wt;
 
 MyLogger g_globalLogger("log.txt");
 
+// session set by a MyLogger::ThreadSession on this thread
+static thread_local std::string s_ThreadSession;
+
 MyLogger::MyLogger(std::string fname)
 {
     addField("datetime", false);
@@ -39,12 +42,29 @@ MyLogger::MyLogger(std::string fname)
 
 MyLogger::~MyLogger() {}
 
+MyLogger::ThreadSession::ThreadSession(std::string session)
+    : previous_(s_ThreadSession)
+{
+    s_ThreadSession = session;
+}
+
+MyLogger::ThreadSession::~ThreadSession() { s_ThreadSession = previous_; }
+
+std::string MyLogger::ThreadSession::current() { return s_ThreadSession; }
+
 void MyLogger::log(std::string type, std::string message)
 {
+    // background threads (e.g. the Maple job scheduler) have no session
+    // unless they set one with ThreadSession
+    std::string session = s_ThreadSession;
+    if (session.empty()) {
+        WApplication *app = WApplication::instance();
+        session = app != nullptr ? app->sessionId() : "-";
+    }
+
     WLogEntry entry = g_globalLogger.entry(type);
-    entry << WLogger::timestamp << WLogger::sep << '['
-          << WApplication::instance()->sessionId() << ']' << WLogger::sep << '['
-          << type << ']' << WLogger::sep << message;
+    entry << WLogger::timestamp << WLogger::sep << '[' << session << ']'
+          << WLogger::sep << '[' << type << ']' << WLogger::sep << message;
 }
 
 void MyLogger::debug(std::string message) { log("debug", message); }
@@ -26,6 +26,8 @@
 
 #include <Wt/WLogger>
 
+#include <string>
+
 /**
  * Logger class with routines to print log messages to a file
  * @class MyLogger
@@ -96,6 +98,39 @@ class MyLogger : public Wt::WLogger
      */
     void fatal(std::string message);
 
+    /**
+     * Tag the log messages of the current thread with a session
+     * @class ThreadSession
+     *
+     * Messages are tagged with the session of the current WApplication.
+     * Threads that work on behalf of a session without owning it (e.g.
+     * the Maple job scheduler) create one of these while they do, the
+     * previous tag is restored when it goes out of scope.
+     */
+    class ThreadSession
+    {
+      public:
+        /**
+         * Constructor method
+         * @param session Session id to tag messages with
+         */
+        ThreadSession(std::string session);
+        /**
+         * Destructor method
+         */
+        ~ThreadSession();
+        /**
+         * Session set on the current thread, empty if there is none
+         */
+        static std::string current();
+
+      private:
+        std::string previous_;
+
+        ThreadSession(const ThreadSession &) = delete;
+        ThreadSession &operator=(const ThreadSession &) = delete;
+    };
+
   private:
     void log(std::string type, std::string message);
 };
@@ -24,9 +24,13 @@
 #include "MyLogger.h"
 #include "custom.h"
 #include "file_tab.h"
+#include "math_findsing.h"
 #include "math_p4.h"
 #include "math_polynom.h"
 
+#include <Wt/WApplication>
+#include <Wt/WServer>
+
 #include <cctype>
 #include <cstdlib>
 #include <fcntl.h>
@@ -176,65 +180,69 @@ void ScriptHandler::fillMapleScript(FILE *f)
     g_globalLogger.debug("[ScriptHandler] filled Maple file");
 }
 
-siginfo_t ScriptHandler::evaluateMapleScript(std::string fname, int maxtime)
+pid_t ScriptHandler::launchMapleScript(std::string fname)
 {
     g_globalLogger.debug("[ScriptHandler] Will fork Maple process for script " +
                          fname);
+    // the server has other threads, so the child must not allocate: any
+    // malloc lock they held at fork() stays locked in it. Everything that
+    // execvp needs is built here
+    std::vector<std::string> args = mapleCommand();
+    args.push_back(fname + ".mpl");
+    std::vector<char *> commands;
+    for (size_t i = 0; i < args.size(); i++)
+        commands.push_back(&args[i][0]);
+    commands.push_back(nullptr);
+    std::string output = fname + ".res";
+
     pid_t pid = fork();
     if (pid < 0) {
-        g_globalLogger.error("[HomeLeft] error forking Maple thread.");
-        siginfo_t pinfo;
-        pinfo.si_pid = -1;
-        pinfo.si_code = -1;
-        return pinfo;
+        g_globalLogger.error("[ScriptHandler] error forking Maple thread.");
+        return -1;
     } else if (pid == 0) {
-        // create vector of arguments for execvp
-        std::vector<char *> commands;
-#ifdef ANTZ
-        commands.push_back("ssh");
-        commands.push_back("p4@a01");
-        commands.push_back("-i");
-        commands.push_back("/var/www/claus_ssh/idrsa-1");
-#endif
-        commands.push_back(MAPLE_PATH);
-        commands.push_back("-T ,1048576"); // 1GB memory limit
-        char *aux = new char[fname.length() + std::string(".mpl").length() + 1];
-        std::strcpy(aux, fname.c_str());
-        std::strcat(aux, ".mpl");
-        commands.push_back(aux);
-        commands.push_back(nullptr);
         // output from this thread goes to "fname.res"
-        int fd =
-            open((fname + ".res").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
         dup2(fd, 1);
-        // execute command
-        char **command = commands.data();
-        int status = execvp(command[0], command);
-        siginfo_t infop;
-        infop.si_status = status;
-        return infop;
-    } else {
-        siginfo_t infop;
-        infop.si_pid = 0;
-        for (int tries = 0; tries < maxtime; tries++) {
-            waitid(P_PID, pid, &infop, WEXITED | WSTOPPED | WNOHANG);
-            if (infop.si_pid != 0) {
-                g_globalLogger.debug(
-                    "[ScriptHandler] forked Maple execution finished");
-                return infop;
-            }
-            delay(1000);
-        }
-        std::string aux("pkill -TERM -P " + std::to_string(pid));
-        g_globalLogger.error("[ScriptHandler] " + aux);
-        system(aux.c_str());
-        kill(pid, SIGTERM);
-        g_globalLogger.error(
-            "[ScriptHandler] Maple execution took too much time");
-        infop.si_status = -2;
-        infop.si_code = -2;
-        return infop;
+        execvp(commands[0], commands.data());
+        // only reached if exec failed: never return into the server code
+        _exit(127);
     }
+    return pid;
+}
+
+std::vector<std::string> ScriptHandler::mapleCommand()
+{
+    std::vector<std::string> commands;
+#ifdef ANTZ
+    commands.push_back("ssh");
+    commands.push_back("p4@a01");
+    commands.push_back("-i");
+    commands.push_back("/var/www/claus_ssh/idrsa-1");
+#endif
+    commands.push_back(MAPLE_PATH);
+    commands.push_back("-T ,1048576"); // 1GB memory limit
+    return commands;
+}
+
+void ScriptHandler::evaluateMapleScriptsAsync(
+    std::vector<std::string> fnames, int maxtime,
+    MapleJobRunner::BatchCallback done)
+{
+    g_mapleJobRunner.submitAll(fnames, jobOwner(), maxtime, done);
+}
+
+void ScriptHandler::evaluateMapleScriptAsync(
+    std::string fname, int maxtime, MapleJobRunner::Callback done,
+    MapleJobRunner::QueueCallback queued)
+{
+    g_mapleJobRunner.submit(fname, jobOwner(), maxtime, done, queued);
+}
+
+std::string ScriptHandler::jobOwner()
+{
+    if (!str_jobowner_.empty())
+        return "user:" + str_jobowner_;
+    return "session:" + Wt::WApplication::instance()->sessionId();
 }
 
 /*
@@ -524,6 +532,60 @@ void ScriptHandler::writeMapleParameters(FILE *f)
     }
 }
 
+bool ScriptHandler::evaluateNatively(std::string fname)
+{
+    if (!stringToBool(str_numeric_) || str_userp_ != "1" || str_userq_ != "1" ||
+        str_gcf_ != "0")
+        return false;
+
+    Wt::WServer *server = Wt::WServer::instance();
+    std::string value;
+    if (server != nullptr &&
+        server->readConfigurationProperty("native-singular-points", value) &&
+        value != "true")
+        return false;
+
+    if (!find_singularities(fname, str_xeq_, str_yeq_, paramLabels_,
+                            paramValues_, atof(str_epsilon_.c_str()),
+                            atoi(str_taylor_.c_str()))) {
+        g_globalLogger.debug("[ScriptHandler] " + fname +
+                             " needs Maple to be studied");
+        return false;
+    }
+    g_globalLogger.debug("[ScriptHandler] " + fname + " studied natively");
+    return true;
+}
+
+bool ScriptHandler::writeTableNatively(std::string table, std::string curve)
+{
+    Wt::WServer *server = Wt::WServer::instance();
+    std::string value;
+    if (server != nullptr &&
+        server->readConfigurationProperty("native-curves", value) &&
+        value != "true")
+        return false;
+
+    return write_curve_table(table, curve, paramLabels_, paramValues_,
+                             atoi(str_userp_.c_str()),
+                             atoi(str_userq_.c_str()));
+}
+
+bool ScriptHandler::prepareCurveTableNatively(std::string fname)
+{
+    if (!writeTableNatively(fname + "_veccurve.tab", str_curve_))
+        return false;
+    str_curvetable_ = fname + "_veccurve.tab";
+    return true;
+}
+
+bool ScriptHandler::prepareIsoclineTableNatively(std::string fname)
+{
+    if (!writeTableNatively(fname + "_vecisoclines.tab", str_isocline_))
+        return false;
+    str_isoclinetable_ = fname + "_vecisoclines.tab";
+    return true;
+}
+
 bool ScriptHandler::stringToBool(std::string s)
 {
     if (s == "true")
@@ -28,8 +28,12 @@
  * in some casses.
  */
 
+#include "MapleJobRunner.h"
 #include "file_tab.h"
 
+#include <string>
+#include <vector>
+
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -231,6 +235,10 @@ class ScriptHandler
      * Vector of strings for values
      */
     std::vector<std::string> paramValues_;
+    /**
+     * name of the logged in user, empty for anonymous sessions
+     */
+    std::string str_jobowner_;
 
     /**
      * Generate a random name for a temp file
@@ -261,15 +269,73 @@ class ScriptHandler
     void fillMapleScript(FILE *f);
 
     /**
-     * Evaluate a Maple script
+     * Execute several Maple scripts in parallel without blocking
+     *
+     * @param fnames  filenames of Maple scripts (without .mpl extension)
+     * @param maxtime maximum number of seconds each script may run
+     * @param done    function called in the current session with the status
+     *                of each script once all of them have finished
+     */
+    void evaluateMapleScriptsAsync(std::vector<std::string> fnames,
+                                   int maxtime,
+                                   MapleJobRunner::BatchCallback done);
+
+    /**
+     * Evaluate a Maple script without blocking the calling thread
      *
      * @param fname   filename of Maple script
      * @param maxtime max number of seconds for execution
-     * @return        return status of the forked process
+     * @param done    function called in the current session with the
+     *                return status of the forked process
+     * @param queued  function called in the current session with the
+     *                queue position while the job waits for a free Maple
+     *                process
+     *
+     * Submits the script to #g_mapleJobRunner. The status passed to @p done
+     * follows the conventions of MapleJobRunner::Callback.
+     */
+    void evaluateMapleScriptAsync(
+        std::string fname, int maxtime, MapleJobRunner::Callback done,
+        MapleJobRunner::QueueCallback queued = MapleJobRunner::QueueCallback());
+
+    /**
+     * Compute the study of a prepared script without Maple
+     *
+     * @param fname filename of Maple script (without .mpl extension)
+     * @return      @c true if the results were written to the files the
+     * Maple script would have written, @c false if Maple is needed
+     *
+     * Only numeric studies on the Poincaré sphere without a common factor
+     * are tried, see find_singularities(). Can be turned off with the
+     * "native-singular-points" configuration property.
+     */
+    bool evaluateNatively(std::string fname);
+
+    /**
+     * Fork a Maple process that executes a script
      *
-     * Forks a Maple process and waits for it to finish
+     * @param fname filename of Maple script (without .mpl extension)
+     * @return      pid of the forked process, -1 if fork failed
+     *
+     * Standard output of the process is redirected to fname.res
      */
-    siginfo_t evaluateMapleScript(std::string fname, int maxtime);
+    static pid_t launchMapleScript(std::string fname);
+
+    /**
+     * Command line used to start Maple, without the script argument
+     *
+     * @return program and arguments, including the ssh prefix when compiled
+     * for antz
+     */
+    static std::vector<std::string> mapleCommand();
+
+    /**
+     * Key used to share Maple processes fairly between users
+     *
+     * @return "user:" + #str_jobowner_ if a user is logged in, otherwise
+     * "session:" + the current session id
+     */
+    std::string jobOwner();
 
     /**
      * Create a file that contains the execution parameters
@@ -361,6 +427,19 @@ class ScriptHandler
      * @param fname name of file where to write
      */
     void prepareCurveTable(std::string fname);
+    /**
+     * Write the table of the curve #str_curve_ without Maple
+     *
+     * @param fname name of the study, the table is written where the script
+     *              of prepareCurveTable() would write it
+     * @return      @c true if the table was written, @c false if the Maple
+     * script is needed
+     *
+     * Only curves whose parameters have numeric values can be converted,
+     * see write_curve_table(). Can be turned off with the "native-curves"
+     * configuration property.
+     */
+    bool prepareCurveTableNatively(std::string fname);
 
     /**
      * Prepare files in case of calculating curve in plane/U1/U2 charts.
@@ -423,6 +502,16 @@ class ScriptHandler
      * @param fname name of file where to write
      */
     void prepareIsoclineTable(std::string fname);
+    /**
+     * Write the table of the isocline #str_isocline_ without Maple
+     *
+     * @param fname name of the study
+     * @return      @c true if the table was written, @c false if the Maple
+     * script is needed
+     *
+     * Works like prepareCurveTableNatively().
+     */
+    bool prepareIsoclineTableNatively(std::string fname);
     /**
      * Prepare files in case of calculating isocline in plane/U1/U2 charts.
      *
@@ -506,6 +595,9 @@ class ScriptHandler
 
     void writeMapleParameters(FILE *f);
     bool stringToBool(std::string);
+    // write the chart table of a curve to the file table, unless the
+    // "native-curves" configuration property asks for Maple
+    bool writeTableNatively(std::string table, std::string curve);
 };
 
 #endif // SCRIPTHANDLER_H
\ No newline at end of file
@@ -0,0 +1,362 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StudyCache.h"
+
+#include "MyLogger.h"
+#include "ScriptHandler.h"
+
+#include <Wt/WServer>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+
+using namespace Wt;
+
+// token that replaces the temporary file name in cached files
+#define STUDY_CACHE_TOKEN "@WP4STUDY@"
+
+// files written by an evaluation, appended to the script file name
+static const char *s_StudyFiles[] = {".res",     "_vec.tab", "_fin.tab",
+                                     "_inf.tab", "_fin.res", "_inf.res"};
+
+StudyCache g_studyCache;
+
+static bool readFile(const std::string &name, std::string &content)
+{
+    std::ifstream in(name.c_str());
+    if (!in.good())
+        return false;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+static bool writeFile(const std::string &name, const std::string &content)
+{
+    std::ofstream out(name.c_str());
+    out << content;
+    return out.good();
+}
+
+static void replaceAll(std::string &s, const std::string &from,
+                       const std::string &to)
+{
+    size_t pos = 0;
+    while ((pos = s.find(from, pos)) != std::string::npos) {
+        s.replace(pos, from.length(), to);
+        pos += to.length();
+    }
+}
+
+static void removeDir(const std::string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d != nullptr) {
+        struct dirent *entry;
+        while ((entry = readdir(d)) != nullptr) {
+            std::string name(entry->d_name);
+            if (name != "." && name != "..")
+                unlink((dir + "/" + name).c_str());
+        }
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+}
+
+// name next to an entry for a directory that only this call uses
+static std::string privateName(const std::string &entry, const char *kind)
+{
+    static std::atomic<unsigned> counter(0);
+    return entry + kind + std::to_string(getpid()) + "_" +
+           std::to_string(counter++);
+}
+
+// remove an entry that readers may be copying: it disappears at once, and
+// a reader notices it when it checks the entry again (see restore)
+static void discardDir(const std::string &dir)
+{
+    std::string old = privateName(dir, ".old");
+    if (rename(dir.c_str(), old.c_str()) == 0)
+        removeDir(old);
+}
+
+static long long dirSize(const std::string &dir)
+{
+    long long size = 0;
+    DIR *d = opendir(dir.c_str());
+    if (d != nullptr) {
+        struct dirent *entry;
+        struct stat st;
+        while ((entry = readdir(d)) != nullptr) {
+            if (stat((dir + "/" + entry->d_name).c_str(), &st) == 0 &&
+                S_ISREG(st.st_mode))
+                size += st.st_size;
+        }
+        closedir(d);
+    }
+    return size;
+}
+
+StudyCache::StudyCache()
+    : configured_(false), dir_(std::string(TMP_DIR) + "wp4cache/"),
+      maxSize_(STUDY_CACHE_MAX_SIZE * 1024LL * 1024LL),
+      maxAge_(STUDY_CACHE_MAX_AGE * 24L * 3600L), total_(0)
+{
+}
+
+void StudyCache::configure()
+{
+    if (configured_)
+        return;
+    configured_ = true;
+
+    WServer *server = WServer::instance();
+    std::string value;
+    if (server != nullptr) {
+        if (server->readConfigurationProperty("study-cache-dir", value) &&
+            !value.empty())
+            dir_ = value[value.size() - 1] == '/' ? value : value + "/";
+        if (server->readConfigurationProperty("study-cache-max-size", value))
+            maxSize_ = std::atoll(value.c_str()) * 1024LL * 1024LL;
+        if (server->readConfigurationProperty("study-cache-max-age", value))
+            maxAge_ = std::atol(value.c_str()) * 24L * 3600L;
+    }
+    if (maxSize_ <= 0)
+        return;
+    mkdir(dir_.c_str(), 0755);
+
+    // entries left by previous runs; private directories (their names have
+    // a dot) are leftovers of interrupted stores once they are old enough
+    time_t now = time(nullptr);
+    DIR *d = opendir(dir_.c_str());
+    if (d == nullptr)
+        return;
+    struct dirent *de;
+    while ((de = readdir(d)) != nullptr) {
+        std::string name(de->d_name);
+        if (name == "." || name == "..")
+            continue;
+        std::string entry = dir_ + name;
+        struct stat st;
+        if (stat(entry.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+            continue;
+        if (name.find('.') != std::string::npos) {
+            if (now - st.st_mtime > 3600)
+                removeDir(entry);
+            continue;
+        }
+        Entry e;
+        e.size = dirSize(entry);
+        e.used = st.st_mtime;
+        index_[entry] = e;
+        total_ += e.size;
+    }
+    closedir(d);
+}
+
+std::string StudyCache::canonicalScript(const std::string &fname)
+{
+    std::string script;
+    if (!readFile(fname + ".mpl", script))
+        return "";
+    replaceAll(script, fname, STUDY_CACHE_TOKEN);
+    return script;
+}
+
+std::string StudyCache::entryDir(const std::string &script)
+{
+    // 64-bit FNV-1a, stable between server runs unlike std::hash
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < script.size(); i++) {
+        hash ^= (unsigned char)script[i];
+        hash *= 1099511628211ULL;
+    }
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", hash);
+    return dir_ + buf;
+}
+
+bool StudyCache::restore(std::string fname)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        configure();
+        if (maxSize_ <= 0)
+            return false;
+    }
+
+    std::string script = canonicalScript(fname);
+    if (script.empty())
+        return false;
+    std::string entry = entryDir(script);
+
+    struct stat st;
+    if (stat(entry.c_str(), &st) != 0)
+        return false;
+    std::string stored;
+    if (!readFile(entry + "/script.mpl", stored) || stored != script)
+        return false;
+    // every evaluation writes a different subset of the files
+    std::vector<std::string> contents;
+    std::vector<bool> found;
+    long long size = stored.size();
+    for (size_t i = 0; i < sizeof(s_StudyFiles) / sizeof(char *); i++) {
+        contents.push_back(std::string());
+        found.push_back(
+            readFile(entry + "/study" + s_StudyFiles[i], contents.back()));
+        size += contents.back().size();
+    }
+    // the entry was evicted or replaced while it was read
+    struct stat again;
+    if (stat(entry.c_str(), &again) != 0 || again.st_ino != st.st_ino)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        time_t now = time(nullptr);
+        std::map<std::string, Entry>::iterator it = index_.find(entry);
+        if (it == index_.end()) {
+            // stored by another server process
+            Entry e;
+            e.size = size;
+            e.used = st.st_mtime;
+            it = index_.insert(std::make_pair(entry, e)).first;
+            total_ += size;
+        }
+        // expired entries are removed by the next store
+        if (now - it->second.used > maxAge_)
+            return false;
+        it->second.used = now;
+    }
+
+    for (size_t i = 0; i < contents.size(); i++) {
+        if (!found[i])
+            continue;
+        replaceAll(contents[i], STUDY_CACHE_TOKEN, fname);
+        if (!writeFile(fname + s_StudyFiles[i], contents[i])) {
+            g_globalLogger.error("[StudyCache] cannot restore " + fname +
+                                 s_StudyFiles[i]);
+            return false;
+        }
+    }
+
+    // the last use survives a restart of the server
+    utime(entry.c_str(), nullptr);
+    g_globalLogger.debug("[StudyCache] restored " + fname + " from " + entry);
+    return true;
+}
+
+void StudyCache::store(std::string fname)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        configure();
+        if (maxSize_ <= 0)
+            return;
+    }
+
+    std::string script = canonicalScript(fname);
+    if (script.empty())
+        return;
+    std::string entry = entryDir(script);
+
+    // write to a private directory first, other sessions only ever see
+    // complete entries
+    std::string tmp = privateName(entry, ".tmp");
+    if (mkdir(tmp.c_str(), 0755) != 0)
+        return;
+    bool ok = writeFile(tmp + "/script.mpl", script);
+    long long size = script.size();
+    for (size_t i = 0; ok && i < sizeof(s_StudyFiles) / sizeof(char *); i++) {
+        std::string content;
+        if (!readFile(fname + s_StudyFiles[i], content))
+            continue;
+        replaceAll(content, fname, STUDY_CACHE_TOKEN);
+        ok = writeFile(tmp + "/study" + s_StudyFiles[i], content);
+        size += content.size();
+    }
+    // rename does not replace a directory that is not empty, so an older
+    // entry is moved away first
+    discardDir(entry);
+    if (!ok || rename(tmp.c_str(), entry.c_str()) != 0) {
+        g_globalLogger.error("[StudyCache] cannot store " + fname);
+        removeDir(tmp);
+        return;
+    }
+    g_globalLogger.debug("[StudyCache] stored " + fname + " in " + entry);
+
+    std::vector<std::string> evicted;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        time_t now = time(nullptr);
+        std::map<std::string, Entry>::iterator it = index_.find(entry);
+        if (it != index_.end())
+            total_ -= it->second.size;
+        Entry &e = index_[entry];
+        e.size = size;
+        e.used = now;
+        total_ += size;
+        evicted = evict(now);
+    }
+    for (size_t i = 0; i < evicted.size(); i++) {
+        discardDir(evicted[i]);
+        g_globalLogger.debug("[StudyCache] evicted " + evicted[i]);
+    }
+}
+
+std::vector<std::string> StudyCache::evict(time_t now)
+{
+    std::vector<std::string> evicted;
+    std::vector<std::pair<time_t, std::string>> byUse;
+    std::map<std::string, Entry>::iterator it = index_.begin();
+
+    while (it != index_.end()) {
+        if (now - it->second.used > maxAge_) {
+            evicted.push_back(it->first);
+            total_ -= it->second.size;
+            it = index_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (total_ <= maxSize_)
+        return evicted;
+    for (it = index_.begin(); it != index_.end(); ++it)
+        byUse.push_back(std::make_pair(it->second.used, it->first));
+    std::sort(byUse.begin(), byUse.end());
+    for (size_t i = 0; i < byUse.size() && total_ > maxSize_; i++) {
+        it = index_.find(byUse[i].second);
+        total_ -= it->second.size;
+        index_.erase(it);
+        evicted.push_back(byUse[i].second);
+    }
+    return evicted;
+}
@@ -0,0 +1,119 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STUDYCACHE_H
+#define STUDYCACHE_H
+
+/*!
+ * @brief Disk cache of the results of vector field evaluations
+ * @file StudyCache.h
+ *
+ * The result of an evaluation only depends on the Maple script written by
+ * ScriptHandler::fillMapleScript. The cache is keyed on that script, with
+ * the temporary file name replaced by a fixed token, so two sessions that
+ * evaluate the same vector field with the same options share the result.
+ */
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Default size limit of the cache in MB ("study-cache-max-size" property,
+ * 0 disables the cache)
+ */
+#define STUDY_CACHE_MAX_SIZE 256
+/**
+ * Default age limit of cache entries in days ("study-cache-max-age"
+ * property)
+ */
+#define STUDY_CACHE_MAX_AGE 30
+
+/**
+ * Class that stores and retrieves evaluation results
+ *
+ * @class StudyCache
+ *
+ * Each entry is a directory named after the hash of the canonical script,
+ * containing the script itself (to rule out hash collisions) and the
+ * .res and .tab files produced by Maple. Entries are evicted when they
+ * are older than the age limit, and least recently used first when the
+ * cache grows above the size limit.
+ *
+ * The size and last use of every entry are kept in memory, the directory
+ * is only scanned once when the cache is first used. The lock only guards
+ * this index: the files are copied outside of it, entries are written in
+ * a private directory and published with a rename, and evicted entries are
+ * renamed away before they are deleted.
+ */
+class StudyCache
+{
+  public:
+    /**
+     * Constructor method
+     */
+    StudyCache();
+
+    /**
+     * Copy cached results for a prepared script
+     *
+     * @param fname filename of Maple script (without .mpl extension)
+     * @return      @c true if the results were found and copied to the
+     * files the Maple script would have written
+     */
+    bool restore(std::string fname);
+
+    /**
+     * Store the results of a successful evaluation
+     *
+     * @param fname filename of Maple script (without .mpl extension)
+     */
+    void store(std::string fname);
+
+  private:
+    // size and last use of an entry
+    struct Entry {
+        long long size;
+        time_t used;
+    };
+
+    std::mutex mutex_;
+    bool configured_;
+    std::string dir_;   ///< cache directory
+    long long maxSize_; ///< size limit in bytes
+    long maxAge_;       ///< age limit in seconds
+    std::map<std::string, Entry> index_; ///< entries by directory
+    long long total_;                    ///< size of all the entries
+
+    // read the configuration properties and scan the directory, once; the
+    // caller holds the lock
+    void configure();
+    // script with the file name replaced, empty if it cannot be read
+    std::string canonicalScript(const std::string &fname);
+    // directory of the entry for a canonical script
+    std::string entryDir(const std::string &script);
+    // take the expired entries and the least recently used ones above the
+    // size limit out of the index and return their directories; the caller
+    // holds the lock
+    std::vector<std::string> evict(time_t now);
+};
+
+extern StudyCache g_studyCache; ///< Global study cache
+
+#endif // STUDYCACHE_H
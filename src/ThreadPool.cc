@@ -0,0 +1,242 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.h"
+
+#include "MyLogger.h"
+
+#include <Wt/WApplication>
+#include <Wt/WServer>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace Wt;
+
+ThreadPool g_threadPool;
+
+struct ThreadPool::Job {
+    Task task;             ///< task run in the background
+    Task done;             ///< function posted when the task has finished
+    std::string sessionId; ///< session that submitted the job
+    bool running;          ///< the task has been taken by a thread
+    bool finished;         ///< the task has returned
+    bool cancelled;        ///< done must not be posted
+};
+
+ThreadPool::ThreadPool() : configured_(false), stopping_(false) {}
+
+ThreadPool::~ThreadPool() { stop(); }
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // nothing may start threads once the pool is stopped
+        configured_ = true;
+        stopping_ = true;
+        for (size_t i = 0; i < jobs_.size(); i++)
+            jobs_[i]->cancelled = true;
+        jobs_.clear();
+    }
+    wakeUp_.notify_all();
+    jobReady_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++)
+        workers_[i].join();
+    workers_.clear();
+    for (size_t i = 0; i < background_.size(); i++)
+        background_[i].join();
+    background_.clear();
+}
+
+void ThreadPool::configure()
+{
+    if (configured_)
+        return;
+    configured_ = true;
+
+    int threads = WORKER_THREADS;
+    int background = BACKGROUND_THREADS;
+    WServer *server = WServer::instance();
+    std::string value;
+    if (server != nullptr &&
+        server->readConfigurationProperty("worker-threads", value))
+        threads = std::atoi(value.c_str());
+    if (threads <= 0)
+        threads = std::thread::hardware_concurrency();
+    if (server != nullptr &&
+        server->readConfigurationProperty("background-threads", value))
+        background = std::max(1, std::atoi(value.c_str()));
+
+    // the thread that submits a batch works on it as well
+    for (int i = 1; i < threads; i++)
+        workers_.push_back(std::thread(&ThreadPool::work, this));
+    for (int i = 0; i < background; i++)
+        background_.push_back(std::thread(&ThreadPool::background, this));
+    g_globalLogger.debug("[ThreadPool] started " +
+                         std::to_string(workers_.size()) + " workers and " +
+                         std::to_string(background_.size()) +
+                         " background threads");
+}
+
+void ThreadPool::run(std::vector<Task> &tasks)
+{
+    if (tasks.empty())
+        return;
+
+    Batch batch;
+    batch.tasks = &tasks;
+    batch.next = 0;
+    batch.remaining = tasks.size();
+    // batches of a background job belong to the session of the job
+    WApplication *app = WApplication::instance();
+    batch.sessionId = app != nullptr ? app->sessionId()
+                                     : MyLogger::ThreadSession::current();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    configure();
+    if (tasks.size() > 1 && !workers_.empty()) {
+        batches_.push_back(&batch);
+        wakeUp_.notify_all();
+    }
+
+    Task *task;
+    while ((task = take(&batch)) != nullptr)
+        execute(&batch, task, lock);
+    while (batch.remaining > 0)
+        finished_.wait(lock);
+}
+
+ThreadPool::Task *ThreadPool::take(Batch *batch)
+{
+    if (batch->next >= batch->tasks->size())
+        return nullptr;
+    Task *task = &(*batch->tasks)[batch->next++];
+    if (batch->next == batch->tasks->size()) {
+        std::deque<Batch *>::iterator it =
+            std::find(batches_.begin(), batches_.end(), batch);
+        if (it != batches_.end())
+            batches_.erase(it);
+    }
+    return task;
+}
+
+void ThreadPool::execute(Batch *batch, Task *task,
+                         std::unique_lock<std::mutex> &lock)
+{
+    lock.unlock();
+    {
+        MyLogger::ThreadSession logSession(batch->sessionId);
+        (*task)();
+    }
+    lock.lock();
+    if (--batch->remaining == 0)
+        finished_.notify_all();
+}
+
+void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (batches_.empty()) {
+            wakeUp_.wait(lock);
+            continue;
+        }
+        Batch *batch = batches_.front();
+        execute(batch, take(batch), lock);
+    }
+}
+
+ThreadPool::JobHandle ThreadPool::submit(Task task, Task done)
+{
+    JobHandle job = std::make_shared<Job>();
+    job->task = task;
+    job->done = done;
+    job->running = false;
+    job->finished = false;
+    job->cancelled = false;
+    WApplication *app = WApplication::instance();
+    if (app != nullptr)
+        job->sessionId = app->sessionId();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    configure();
+    if (stopping_) {
+        job->cancelled = true;
+        return job;
+    }
+    jobs_.push_back(job);
+    jobReady_.notify_one();
+    return job;
+}
+
+void ThreadPool::cancel(const JobHandle &job)
+{
+    if (job == nullptr)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job->cancelled = true;
+    if (!job->running) {
+        std::deque<JobHandle>::iterator it =
+            std::find(jobs_.begin(), jobs_.end(), job);
+        if (it != jobs_.end())
+            jobs_.erase(it);
+        return;
+    }
+    while (!job->finished)
+        jobFinished_.wait(lock);
+}
+
+void ThreadPool::background()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (jobs_.empty()) {
+            jobReady_.wait(lock);
+            continue;
+        }
+        JobHandle job = jobs_.front();
+        jobs_.pop_front();
+        job->running = true;
+        lock.unlock();
+        {
+            MyLogger::ThreadSession logSession(job->sessionId);
+            job->task();
+        }
+        lock.lock();
+        job->finished = true;
+        jobFinished_.notify_all();
+        if (job->cancelled)
+            continue;
+
+        lock.unlock();
+        Task done = job->done;
+        WServer *server = WServer::instance();
+        if (server == nullptr) {
+            done();
+        } else {
+            // if the session has already expired the function is dropped
+            server->post(job->sessionId, [done]() {
+                done();
+                WApplication::instance()->triggerUpdate();
+            });
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,165 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+/*!
+ * @brief Pool of worker threads for numeric computations
+ * @file ThreadPool.h
+ *
+ * Integrations that are independent of each other (e.g. the separatrices
+ * of different singular points) are handed to a single pool shared by all
+ * sessions, so that a plot uses every core without each session starting
+ * its own threads. Longer computations that must not block the session
+ * (e.g. a limit cycle search) run as background jobs on a few threads of
+ * their own.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Default number of worker threads, 0 means one per core. It can be
+ * overridden with the "worker-threads" property in wt_config.xml
+ */
+#define WORKER_THREADS 0
+/**
+ * Default number of background threads, i.e. of background jobs running at
+ * the same time. It can be overridden with the "background-threads" property
+ * in wt_config.xml
+ */
+#define BACKGROUND_THREADS 2
+
+/**
+ * Class that runs batches of tasks on a set of worker threads
+ *
+ * @class ThreadPool
+ *
+ * #run blocks until every task of the batch has finished, and the calling
+ * thread executes tasks of its own batch too, so a batch always makes
+ * progress even when all workers are busy with other sessions.
+ *
+ * Tasks run outside of the session: they must not touch widgets or the
+ * painter, and must not throw. Log messages written by a task are tagged
+ * with the session that submitted the batch.
+ *
+ * #submit queues a background job and returns immediately, the job may run
+ * batches of its own. Its @c done function is posted to the session once it
+ * has finished.
+ */
+class ThreadPool
+{
+  public:
+    /**
+     * Task type
+     */
+    typedef std::function<void()> Task;
+    /**
+     * Background job, only used through a JobHandle
+     */
+    struct Job;
+    /**
+     * Handle of a background job (see #submit)
+     */
+    typedef std::shared_ptr<Job> JobHandle;
+
+    /**
+     * Constructor method
+     */
+    ThreadPool();
+    /**
+     * Destructor method, calls #stop
+     */
+    ~ThreadPool();
+
+    /**
+     * Run a batch of tasks in parallel
+     *
+     * @param tasks tasks to run, in no particular order
+     */
+    void run(std::vector<Task> &tasks);
+    /**
+     * Queue a background job and return immediately
+     *
+     * @param task task to run in a background thread
+     * @param done function posted to the submitting session when @p task has
+     *             finished, it may touch widgets. Without a server it is called
+     *             in the background thread
+     * @return handle to cancel the job
+     */
+    JobHandle submit(Task task, Task done);
+    /**
+     * Cancel a background job
+     *
+     * @param job handle returned by #submit, may be null
+     *
+     * A job that has not started is dropped, a running one is waited for.
+     * Its @c done function is not posted afterwards, but it may already be in
+     * the session queue.
+     */
+    void cancel(const JobHandle &job);
+    /**
+     * Stop all threads of the pool, dropping the queued background jobs
+     *
+     * Running jobs are waited for. Must be called before the server is
+     * destroyed, since background threads post to it.
+     */
+    void stop();
+
+  private:
+    struct Batch {
+        std::vector<Task> *tasks; ///< tasks of the batch
+        size_t next;              ///< first task not started yet
+        size_t remaining;         ///< tasks not finished yet
+        std::string sessionId;    ///< session that submitted the batch
+    };
+
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;   ///< signals workers that there is work
+    std::condition_variable finished_; ///< signals that a batch has finished
+    std::deque<Batch *> batches_;      ///< batches with tasks not started
+    std::vector<std::thread> workers_;
+    std::condition_variable jobReady_;    ///< signals that a job was queued
+    std::condition_variable jobFinished_; ///< signals that a job has finished
+    std::deque<JobHandle> jobs_;          ///< background jobs not started
+    std::vector<std::thread> background_;
+    bool configured_;
+    bool stopping_;
+
+    // read the configuration properties and start the workers, once
+    void configure();
+    // take the next task of a batch, with mutex_ held
+    Task *take(Batch *batch);
+    // run a task of a batch and account for it, with the lock held
+    void execute(Batch *batch, Task *task, std::unique_lock<std::mutex> &lock);
+    // worker thread loop
+    void work();
+    // background thread loop
+    void background();
+};
+
+extern ThreadPool g_threadPool; ///< Global worker pool
+
+#endif // THREADPOOL_H
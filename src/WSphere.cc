@@ -40,8 +40,9 @@
 #include "file_tab.h"
 #include "math_p4.h"
 //#include "math_findpoint.h"
-//#include "math_limitcycles.h"
+#include "math_limitcycles.h"
 #include "MyLogger.h"
+#include "ThreadPool.h"
 #include "math_separatrice.h"
 #include "plot_points.h"
 #include "plot_tools.h"
@@ -109,6 +110,10 @@ WSphere::WSphere(WContainerWidget *parent, ScriptHandler *s, int width,
     gcfDashes_ = GCF_DASHES;
     gcfNPoints_ = GCF_POINTS;
     gcfPrec_ = GCF_PRECIS;
+    curveTask_ = EVAL_CURVE_NONE;
+    isoclineTask_ = EVAL_CURVE_NONE;
+    lastPointColor_ = -1;
+    alive_ = std::make_shared<bool>(true);
 
     mouseMoved().connect(this, &WSphere::mouseMovementEvent);
     clicked().connect(this, &WSphere::mouseClickEvent);
@@ -148,6 +153,10 @@ WSphere::WSphere(WContainerWidget *parent, ScriptHandler *s, int width,
     gcfDashes_ = GCF_DASHES;
     gcfNPoints_ = GCF_POINTS;
     gcfPrec_ = GCF_PRECIS;
+    curveTask_ = EVAL_CURVE_NONE;
+    isoclineTask_ = EVAL_CURVE_NONE;
+    lastPointColor_ = -1;
+    alive_ = std::make_shared<bool>(true);
 
     mouseMoved().connect(this, &WSphere::mouseMovementEvent);
     clicked().connect(this, &WSphere::mouseClickEvent);
@@ -155,6 +164,9 @@ WSphere::WSphere(WContainerWidget *parent, ScriptHandler *s, int width,
 
 WSphere::~WSphere()
 {
+    *alive_ = false;
+    cancelComputations();
+
     g_globalLogger.debug("[WSphere] Deleting circle at infinity...");
     struct P4POLYLINES *t;
     while (CircleAtInfinity != nullptr) {
@@ -183,13 +195,18 @@ WSphere::~WSphere()
     g_globalLogger.debug("[WSphere] Deleted correctly");
 }
 
+void WSphere::cancelComputations()
+{
+    g_threadPool.cancel(sepJob_);
+    sepJob_ = nullptr;
+    g_threadPool.cancel(limitCycleJob_);
+    limitCycleJob_ = nullptr;
+}
+
 bool WSphere::setupPlot(void)
 {
-    if (plotPrepared_) {
-        firstTimePlot_ = false;
+    if (plotPrepared_)
         return true;
-    } else
-        firstTimePlot_ = true;
 
     if (!studyCopied_ && !study_->readTables(basename_)) {
         return false;
@@ -337,42 +354,15 @@ void WSphere::paintEvent(WPaintDevice *p)
             } else
                 plotLineAtInfinity();
         }
-        if (gcfEval_) {
-            int result =
-                evalGcfStart(gcfFname_, gcfDashes_, gcfNPoints_, gcfPrec_);
-            if (!result) {
-                g_globalLogger.error("[WSphere] cannot compute Gcf");
-            } else {
-                // this calls evalGcfContinue at least once
-                int i = 0;
-                do {
-                    result = evalGcfContinue(gcfFname_, GCF_POINTS, GCF_PRECIS);
-                    if (gcfError_) {
-                        g_globalLogger.error("[WSphere] error while computing "
-                                             "evalGcfContinue at step: " +
-                                             std::to_string(i));
-                        break;
-                    }
-                    i++;
-                } while (!result);
-                // finish evaluation
-                result = evalGcfFinish();
-                if (!result) {
-                    g_globalLogger.error(
-                        "[WSphere] error while computing evalGcfFinish");
-                } else {
-                    g_globalLogger.debug("[WSphere] computed Gcf");
-                }
-            }
+        // the gcf is computed beforehand by computeGcf, only draw it here
+        if (gcfEval_)
             plotGcf();
-        }
-        // drawLimitCycles(this);
-        plotSeparatrices();
-        if (firstTimePlot_) {
-            for (int cnt = 0; cnt < 10; cnt++) {
-                plot_all_sep(this);
-            }
-        }
+        drawLimitCycles(this);
+        // computeSeparatrices may still be integrating them
+        if (sepJob_ == nullptr)
+            plotSeparatrices();
+        // singular points are painted directly, over the separatrices
+        flushLines();
         plotPoints();
         drawOrbits();
         plotCurves();
@@ -383,6 +373,7 @@ void WSphere::paintEvent(WPaintDevice *p)
         plotCurves();
         plotIsoclines();
     }
+    flushLines();
 }
 
 void WSphere::setChartString(int p, int q, bool isu1v1chart, bool negchart)
@@ -925,7 +916,7 @@ void WSphere::plotPointSeparatrices(struct semi_elementary *p)
 
     for (separatrice = p->separatrices; separatrice != nullptr;
          separatrice = separatrice->next_sep)
-        draw_sep(this, separatrice->first_sep_point);
+        draw_sep(this, separatrice->points);
 }
 
 void WSphere::plotPointSeparatrices(struct saddle *p)
@@ -934,7 +925,7 @@ void WSphere::plotPointSeparatrices(struct saddle *p)
 
     for (separatrice = p->separatrices; separatrice != nullptr;
          separatrice = separatrice->next_sep)
-        draw_sep(this, separatrice->first_sep_point);
+        draw_sep(this, separatrice->points);
 }
 
 void WSphere::plotPointSeparatrices(struct degenerate *p)
@@ -943,7 +934,7 @@ void WSphere::plotPointSeparatrices(struct degenerate *p)
 
     for (blow_up = p->blow_up; blow_up != nullptr;
          blow_up = blow_up->next_blow_up_point) {
-        draw_sep(this, blow_up->first_sep_point);
+        draw_sep(this, blow_up->points);
     }
 }
 
@@ -1246,8 +1237,7 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                 if (paintedYMax < wy2)
                     paintedYMax = wy2;
 
-                staticPainter->setPen(QXFIGCOLOR(color));
-                staticPainter->drawLine(wx1, wy1, wx2, wy2);
+                decimateLine(wx1, wy1, wx2, wy2, color);
             } else {
                 // only (_x2,_y2) is not visible
                 if (lineRectangleIntersect(_x1, _y1, _x2, _y2, x0, x1, y0,
@@ -1256,7 +1246,6 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                     wy1 = coWinY(_y1);
                     wx2 = coWinX(_x2);
                     wy2 = coWinY(_y2);
-                    staticPainter->setPen(QXFIGCOLOR(color));
 
                     if (paintedXMin > wx1)
                         paintedXMin = wx1;
@@ -1275,7 +1264,7 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                     if (paintedYMax < wy2)
                         paintedYMax = wy2;
 
-                    staticPainter->drawLine(wx1, wy1, wx2, wy2);
+                    decimateLine(wx1, wy1, wx2, wy2, color);
                 }
             }
         } else {
@@ -1287,7 +1276,6 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                     wy1 = coWinY(_y1);
                     wx2 = coWinX(_x2);
                     wy2 = coWinY(_y2);
-                    staticPainter->setPen(QXFIGCOLOR(color));
 
                     if (paintedXMin > wx1)
                         paintedXMin = wx1;
@@ -1306,7 +1294,7 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                     if (paintedYMax < wy2)
                         paintedYMax = wy2;
 
-                    staticPainter->drawLine(wx1, wy1, wx2, wy2);
+                    decimateLine(wx1, wy1, wx2, wy2, color);
                 }
             } else {
                 // both end points are invisible
@@ -1316,7 +1304,6 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                     wy1 = coWinY(_y1);
                     wx2 = coWinX(_x2);
                     wy2 = coWinY(_y2);
-                    staticPainter->setPen(QXFIGCOLOR(color));
 
                     if (paintedXMin > wx1)
                         paintedXMin = wx1;
@@ -1335,7 +1322,7 @@ void WSphere::drawLine(double _x1, double _y1, double _x2, double _y2,
                     if (paintedYMax < wy2)
                         paintedYMax = wy2;
 
-                    staticPainter->drawLine(wx1, wy1, wx2, wy2);
+                    decimateLine(wx1, wy1, wx2, wy2, color);
                 }
             }
         }
@@ -1348,7 +1335,7 @@ void WSphere::drawPoint(double x, double y, int color)
     if (staticPainter != nullptr) {
         if (x < x0 || x > x1 || y < y0 || y > y1)
             return;
-        staticPainter->setPen(QXFIGCOLOR(color));
+        flushLines();
         _x = coWinX(x);
         _y = coWinY(y);
 
@@ -1361,6 +1348,80 @@ void WSphere::drawPoint(double x, double y, int color)
         if (paintedYMax < _y)
             paintedYMax = _y;
 
+        // dotted curves often put many points in the same pixel
+        if (_x == lastPointX_ && _y == lastPointY_ && color == lastPointColor_)
+            return;
+        lastPointX_ = _x;
+        lastPointY_ = _y;
+        lastPointColor_ = color;
+
+        staticPainter->setPen(QXFIGCOLOR(color));
         staticPainter->drawPoint((double)_x, (double)_y);
     }
+}
+
+// distance from pixel (px,py) to the line from (ax,ay) to (bx,by)
+static double segmentDistance(double px, double py, double ax, double ay,
+                              double bx, double by)
+{
+    double dx = bx - ax, dy = by - ay, l, t;
+
+    l = dx * dx + dy * dy;
+    t = (l > 0) ? ((px - ax) * dx + (py - ay) * dy) / l : 0;
+    if (t < 0)
+        t = 0;
+    else if (t > 1)
+        t = 1;
+    return hypot(px - ax - t * dx, py - ay - t * dy);
+}
+
+void WSphere::decimateLine(int wx1, int wy1, int wx2, int wy2, int color)
+{
+    size_t i, n = lineRun_.size();
+
+    if (n != 0 && (color != lineRunColor_ || wx1 != lineRun_[n - 2] ||
+                   wy1 != lineRun_[n - 1])) {
+        flushLines();
+        n = 0;
+    }
+    if (n == 0) {
+        lineRun_.push_back(wx1);
+        lineRun_.push_back(wy1);
+        lineRunColor_ = color;
+        n = 2;
+    }
+    if (wx2 == lineRun_[n - 2] && wy2 == lineRun_[n - 1])
+        return;
+
+    // the polyline is drawn as one line from its first pixel, so every pixel
+    // after it has to stay close to the line that ends at the new one
+    for (i = 2; i < n && n < 2 * DECIMATE_RUN; i += 2) {
+        if (segmentDistance(lineRun_[i], lineRun_[i + 1], lineRun_[0],
+                            lineRun_[1], wx2, wy2) > DECIMATE_TOLERANCE)
+            break;
+    }
+    if (i < n) {
+        wx1 = lineRun_[n - 2];
+        wy1 = lineRun_[n - 1];
+        flushLines();
+        lineRun_.push_back(wx1);
+        lineRun_.push_back(wy1);
+        lineRunColor_ = color;
+    }
+    lineRun_.push_back(wx2);
+    lineRun_.push_back(wy2);
+}
+
+void WSphere::flushLines()
+{
+    size_t n = lineRun_.size();
+
+    if (n != 0 && staticPainter != nullptr) {
+        staticPainter->setPen(QXFIGCOLOR(lineRunColor_));
+        staticPainter->drawLine(lineRun_[0], lineRun_[1], lineRun_[n - 2],
+                                lineRun_[n - 1]);
+        // the line may have covered the last point
+        lastPointColor_ = -1;
+    }
+    lineRun_.clear();
 }
\ No newline at end of file
@@ -49,6 +49,7 @@
  */
 
 #include "ScriptHandler.h"
+#include "ThreadPool.h"
 #include "custom.h"
 #include "file_tab.h"
 
@@ -58,6 +59,10 @@
 #include <Wt/WPainter>
 #include <Wt/WPointF>
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 #define EVAL_GCF_NONE 0            ///< no gcf evaluation
 #define EVAL_GCF_R2 1              ///< gcf evaluation in R^2
 #define EVAL_GCF_U1 2              ///< gcf evaluation in U1
@@ -94,6 +99,13 @@
 #define CURVE_POINTS 400 ///< curve npoints is 400 by default
 #define CURVE_PRECIS 12  ///< curve precision is 12 by default
 
+/**
+ * Distance in pixels that consecutive segments of a polyline may deviate
+ * from a single line and still be drawn as one
+ */
+#define DECIMATE_TOLERANCE 0.5
+#define DECIMATE_RUN 64 ///< maximum number of segments drawn as one line
+
 //#define SELECTINGPOINTSTEPS         5
 //#define SELECTINGPOINTSPEED         150
 
@@ -349,6 +361,12 @@ class WSphere : public Wt::WPaintedWidget
      * @param x2    point 2 is (x2,y2)
      * @param y2    point 2 is (x2,y2)
      * @param color color (defined in color.h)
+     *
+     * Consecutive lines of the same color that continue each other are
+     * merged while they stay within #DECIMATE_TOLERANCE pixels of a single
+     * line, so dense polylines do not send one segment per stored point to
+     * the browser. Only the drawing is decimated: the stored points are
+     * kept, and a zoomed view draws them again at its own resolution.
      */
     void drawLine(double x1, double y1, double x2, double y2, int color);
 
@@ -377,6 +395,28 @@ class WSphere : public Wt::WPaintedWidget
      * @param dir -1, 1 indicates direction, 0 tells the function to continue
      */
     void integrateOrbit(int dir);
+    /**
+     * Integrate several orbits at once
+     *
+     * Implemented in math_orbits.cc
+     *
+     * @param n             number of orbits
+     * @param pcoord        start point of each orbit (3 coordinates each),
+     *                      replaced by its last point
+     * @param step          initial step size
+     * @param dir           direction of each orbit (-1 or 1)
+     * @param color         color of the points
+     * @param points_to_int number of points to integrate for each orbit
+     * @param orbit         polyline of each orbit, where the points are
+     *                      appended
+     *
+     * Gives the same points as integrating each orbit on its own, except
+     * that the last point of an orbit that meets an event (see OrbitEvents)
+     * is not interpolated. The Runge-Kutta steps of many orbits are taken
+     * together, which is faster when there are many seeds.
+     */
+    void integrate_orbits(int n, double *pcoord, double step, const int *dir,
+                          int color, int points_to_int, OrbitPolyline **orbit);
     /**
      * Start orbit integration from a point
      * @param  x x coordinate of starting point
@@ -454,7 +494,7 @@ class WSphere : public Wt::WPaintedWidget
     bool plotDone_;
 
     /**
-     * Flag used to make the sphere compute gcf
+     * Flag used to make the sphere plot the gcf computed by #computeGcf
      */
     bool gcfEval_;
     /**
@@ -500,22 +540,27 @@ class WSphere : public Wt::WPaintedWidget
     /**
      * Start curve evaluation
      *
-     * @param fname  name of script that will be used for sequential evaluations
+     * Scripts for all the charts are prepared and run in parallel, each one
+     * with its own files named after @p fname and the task number.
+     *
+     * @param fname  base name of the scripts for the chart tasks
      * @param dashes flag to use dashes or dots in plot
      * @param points number of points used in computations
      * @param precis precision used in computations
-     * @return       @c true if no error, @c false if error
+     * @param done   function called when all the chart tasks have finished,
+     *               with @c false if any of them failed
+     * @return       @c true if the tasks were started, @c false if error
      */
-    bool evalCurveStart(std::string fname, int dashes, int points, int precis);
+    bool evalCurveStart(std::string fname, int dashes, int points, int precis,
+                        std::function<void(bool)> done);
     /**
-     * After starting evaluation, continue with the other charts
+     * After starting evaluation, read the results of the next chart
      *
-     * @param fname  name of script that will be used for sequential evaluations
-     * @param points number of points used in computations
-     * @param prec   precision used in computations
-     * @return       @c true if no error, @c false if error
+     * @param fname base name of the scripts for the chart tasks
+     * @return      @c true when all charts are read or if there was an error
+     * (see #curveError_)
      */
-    bool evalCurveContinue(std::string fname, int points, int prec);
+    bool evalCurveContinue(std::string fname);
     /**
      * Finish the curve evaluation
      */
@@ -546,28 +591,114 @@ class WSphere : public Wt::WPaintedWidget
     /**
      * Start isocline evaluation
      *
-     * @param fname  name of script that will be used for sequential evaluations
+     * Scripts for all the charts are prepared and run in parallel, each one
+     * with its own files named after @p fname and the task number.
+     *
+     * @param fname  base name of the scripts for the chart tasks
      * @param dashes flag to use dashes or dots in plot
      * @param points number of points used in computations
      * @param precis precision used in computations
-     * @return       @c true if no error, @c false if error
+     * @param done   function called when all the chart tasks have finished,
+     *               with @c false if any of them failed
+     * @return       @c true if the tasks were started, @c false if error
      */
     bool evalIsoclineStart(std::string fname, int dashes, int points,
-                           int precis);
+                           int precis, std::function<void(bool)> done);
     /**
-     * After starting evaluation, continue with the other charts
+     * After starting evaluation, read the results of the next chart
      *
-     * @param fname  name of script that will be used for sequential evaluations
-     * @param points number of points used in computations
-     * @param prec   precision used in computations
-     * @return       @c true if no error, @c false if error
+     * @param fname base name of the scripts for the chart tasks
+     * @return      @c true when all charts are read or if there was an error
+     * (see #isoclineError_)
      */
-    bool evalIsoclineContinue(std::string fname, int points, int prec);
+    bool evalIsoclineContinue(std::string fname);
     /**
      * Finish the isocline evaluation
      */
     bool evalIsoclineFinish(void);
 
+    /**
+     * Compute the gcf with the current gcf parameters
+     *
+     * @param done function called when #study_ holds the gcf points, with
+     *             @c false if there was an error
+     *
+     * The charts are traced natively (see math_curvetrace.h) unless the
+     * "native-curves" configuration property is false, then Maple runs in
+     * the background and this returns immediately. The result is only drawn
+     * by the next paint event if #gcfEval_ is set.
+     */
+    void computeGcf(std::function<void(bool)> done);
+    /**
+     * Prepare the plot and integrate the separatrices of the singular points
+     *
+     * @param done function called when the separatrices are in #study_
+     *
+     * The separatrices are integrated by a background job of the pool (see
+     * ThreadPool) and this returns immediately, paint events skip them until
+     * @p done is called. Nothing is done if the plot cannot be prepared, the
+     * next paint event reports the error.
+     */
+    void computeSeparatrices(std::function<void()> done);
+    /**
+     * Compute the last curve read in #study_ with the current curve
+     * parameters
+     *
+     * @param done function called when the curve points are ready, with
+     *             @c false if there was an error
+     */
+    void computeCurve(std::function<void(bool)> done);
+    /**
+     * Compute the last isocline read in #study_ with the current isocline
+     * parameters
+     *
+     * @param done function called when the isocline points are ready, with
+     *             @c false if there was an error
+     */
+    void computeIsocline(std::function<void(bool)> done);
+    /**
+     * Search limit cycles across a transverse section (see
+     * math_limitcycles.h)
+     *
+     * @param x0   x coordinate of the first end of the section
+     * @param y0   y coordinate of the first end of the section
+     * @param x1   x coordinate of the second end of the section
+     * @param y1   y coordinate of the second end of the section
+     * @param grid distance between two seeds of the section
+     * @param done function called when the new cycles are in #study_, with
+     *             their number or -1 if the search could not start
+     *
+     * The search runs as a background job of the pool (see ThreadPool) and
+     * this returns immediately. Cycles that #study_ already has are not
+     * added.
+     */
+    void computeLimitCycles(double x0, double y0, double x1, double y1,
+                            double grid, std::function<void(int)> done);
+    /**
+     * Check if a background job is using #study_, which must not be modified
+     * until it has finished
+     */
+    bool computing() const
+    {
+        return sepJob_ != nullptr || limitCycleJob_ != nullptr;
+    }
+    /**
+     * Check if a gcf, curve, isocline, separatrice or limit cycle computation
+     * is running
+     */
+    bool evaluating() const
+    {
+        return gcfTask_ != EVAL_GCF_NONE || curveTask_ != EVAL_CURVE_NONE ||
+               isoclineTask_ != EVAL_CURVE_NONE || computing();
+    }
+    /**
+     * Cancel the background jobs, waiting for the running ones
+     *
+     * Their results are dropped. Must be called before #study_ is handed
+     * over to another sphere.
+     */
+    void cancelComputations();
+
   protected:
     /**
      * Paint event for this painted widget
@@ -614,36 +745,63 @@ class WSphere : public Wt::WPaintedWidget
      * the original
      */
     bool plotPrepared_;
-    /**
-     * used for plotting background the first time
-     */
-    bool firstTimePlot_;
-    // integrate orbit from a point and store the result as a linked list
-    orbits_points *integrate_orbit(double pcoord[3], double step, int dir,
-                                   int color, int points_to_int,
-                                   struct orbits_points **orbit);
+    // background job integrating the separatrices
+    ThreadPool::JobHandle sepJob_;
+    // integrate orbit from a point and append the result to a polyline, it
+    // stops early when the orbit meets an event (see OrbitEvents)
+    void integrate_orbit(double pcoord[3], double step, int dir, int color,
+                         int points_to_int, OrbitPolyline &orbit);
     // draw orbit starting from a point
-    void drawOrbit(double *pcoord, struct orbits_points *points, int color);
+    void drawOrbit(double *pcoord, const OrbitPolyline &points, int color);
     // draw all orbits (calling drawOrbit() for each one)
     void drawOrbits();
 
+    // pixels of the polyline that drawLine() has not drawn yet, 2
+    // coordinates each, and its color
+    std::vector<int> lineRun_;
+    int lineRunColor_;
+    // last pixel drawn by drawPoint(), to skip points that repeat it
+    int lastPointX_, lastPointY_, lastPointColor_;
+    // add a visible line in window coordinates to lineRun_, drawing the
+    // pending polyline first if the line cannot be merged into it
+    void decimateLine(int wx1, int wy1, int wx2, int wy2, int color);
+    // draw the pending polyline of drawLine(), must be called before
+    // painting anything else and before the painter is destroyed
+    void flushLines();
+
     // used for gcf
     bool gcfError_;
     int gcfTask_;
-    bool evalGcfStart(std::string fname, int dashes, int points, int precis);
-    bool evalGcfContinue(std::string fname, int points, int prec);
+    bool evalGcfStart(std::string fname, int dashes, int points, int precis,
+                      std::function<void(bool)> done);
+    bool evalGcfContinue(std::string fname);
     bool evalGcfFinish(void);
-    int runTask(std::string fname, int task, int points, int prec);
-    void draw_gcf(orbits_points *sep, int color, int dashes);
+    bool prepareTask(std::string fname, int task, int points, int prec);
+    void draw_gcf(const OrbitPolyline &sep, int color, int dashes);
     void plotGcf(void);
     bool read_gcf(std::string fname,
                   void (WVFStudy::*chart)(double, double, double *));
     bool readTaskResults(std::string fname, int task);
+    // name of the files used by one chart task
+    static std::string taskFileName(std::string fname, int task);
+    // prepare the chart tasks [first,last) and run them in parallel, done is
+    // called when all of them have finished
+    bool runTasks(std::string fname, int first, int last, int points, int prec,
+                  bool (WSphere::*prepare)(std::string, int, int, int),
+                  std::function<void(bool)> done);
+    // false if the "native-curves" configuration property asks for Maple
+    static bool nativeCurves();
+    // trace the polynomials of the charts in parallel and add their points
+    // with insert, in the same order as the results of the Maple tasks
+    void traceTasks(int points, int prec, P4POLYNOM2 r2, P4POLYNOM2 u1,
+                    P4POLYNOM2 u2, P4POLYNOM3 c,
+                    void (WVFStudy::*insert)(double, double, double, int),
+                    int dashes);
 
     // used for curves
     int curveTask_;
-    int runTaskCurve(std::string fname, int task, int points, int prec);
-    void draw_curve(orbits_points *sep, int color, int dashes);
+    bool prepareTaskCurve(std::string fname, int task, int points, int prec);
+    void draw_curve(const OrbitPolyline &sep, int color, int dashes);
     void plotCurves(void);
     bool read_curve(std::string fname,
                     void (WVFStudy::*chart)(double, double, double *));
@@ -651,17 +809,24 @@ class WSphere : public Wt::WPaintedWidget
 
     // used for isoclines
     int isoclineTask_;
-    int runTaskIsocline(std::string fname, int task, int points, int prec);
-    void draw_isocline(orbits_points *sep, int color, int dashes);
+    bool prepareTaskIsocline(std::string fname, int task, int points,
+                             int prec);
+    void draw_isocline(const OrbitPolyline &sep, int color, int dashes);
     void plotIsoclines(void);
     bool read_isocline(std::string fname,
                        void (WVFStudy::*chart)(double, double, double *));
     bool readTaskIsoclineResults(std::string fname, int task);
 
+    // background job of the running limit cycle search
+    ThreadPool::JobHandle limitCycleJob_;
+
     // script handler
     ScriptHandler *scriptHandler_;
     // flag to know if study was copied or will be created
     bool studyCopied_;
+    // cleared on destruction, so pending Maple callbacks know the sphere is
+    // gone
+    std::shared_ptr<bool> alive_;
 };
 
 #endif /* WIN_SPHERE_H */
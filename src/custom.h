@@ -138,6 +138,23 @@ struct P4POLYLINES {
  */
 #define MAX_TOLERANCE 1.0
 
+/**
+ * integrate orbits and separatrices with Runge-Kutta 7/8
+ */
+#define INTEGRATOR_RK78 0
+/**
+ * integrate orbits and separatrices with Taylor series (see math_taylor.h)
+ */
+#define INTEGRATOR_TAYLOR 1
+/**
+ * choose between INTEGRATOR_RK78 and INTEGRATOR_TAYLOR
+ */
+#define DEFAULT_INTEGRATOR INTEGRATOR_RK78
+/**
+ * order of the Taylor integrator, 0 to choose it from the tolerance
+ */
+#define DEFAULT_TAYLOR_ORDER 0
+
 /**
  * number of points during integration
  */
@@ -41,9 +41,16 @@
 #include "math_p4.h"
 #include "math_polynom.h"
 #include "math_separatrice.h"
+#include "math_taylor.h"
 
+#include <Wt/WServer>
+
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 using namespace Wt;
 
@@ -52,6 +59,46 @@ using namespace Wt;
     The relevant structures for saddles etc are set up here.
 */
 
+// -----------------------------------------------------------------------
+//                              OrbitPolyline
+// -----------------------------------------------------------------------
+
+OrbitPolyline::OrbitPolyline(const OrbitPolyline &other) : size_(other.size_)
+{
+    chunks_.reserve(other.chunks_.size());
+    for (size_t k = 0; k < other.chunks_.size(); k++)
+        chunks_.push_back(new chunk(*other.chunks_[k]));
+}
+
+OrbitPolyline::OrbitPolyline(OrbitPolyline &&other) noexcept
+    : chunks_(std::move(other.chunks_)), size_(other.size_)
+{
+    other.chunks_.clear();
+    other.size_ = 0;
+}
+
+OrbitPolyline &OrbitPolyline::operator=(OrbitPolyline other) noexcept
+{
+    chunks_.swap(other.chunks_);
+    std::swap(size_, other.size_);
+    return *this;
+}
+
+void OrbitPolyline::clear()
+{
+    for (size_t k = 0; k < chunks_.size(); k++)
+        delete chunks_[k];
+    chunks_.clear();
+    size_ = 0;
+}
+
+// the vectors of the study move their elements when they grow, instead of
+// copying every chunk, only if these cannot throw
+static_assert(std::is_nothrow_move_constructible<orbits>::value &&
+                  std::is_nothrow_move_constructible<curves>::value &&
+                  std::is_nothrow_move_constructible<isoclines>::value,
+              "study elements must be nothrow movable");
+
 // -----------------------------------------------------------------------
 //                              WVFStudy CONSTRUCTOR
 // -----------------------------------------------------------------------
@@ -87,16 +134,6 @@ WVFStudy::WVFStudy(double projection) : config_projection_(projection)
     gcf_V1_ = nullptr;
     gcf_V2_ = nullptr;
     gcf_C_ = nullptr;
-    gcf_points_ = nullptr;
-    last_gcf_point_ = nullptr;
-
-    // initialize curves and isoclines
-    last_curves_point_ = nullptr;
-    last_isoclines_point_ = nullptr;
-
-    // initialize limit cycles
-    // first_lim_cycle_ = nullptr;
-    // current_lim_cycle_ = nullptr;
 
     // initialize others
     xmin_ = -1.0;
@@ -129,6 +166,9 @@ WVFStudy::WVFStudy(double projection) : config_projection_(projection)
     // line style (dashes or points)
     config_dashes_ = DEFAULT_LINESTYLE;
     config_kindvf_ = DEFAULT_INTCONFIG;
+    config_integrator_ = DEFAULT_INTEGRATOR;
+    config_taylor_order_ = DEFAULT_TAYLOR_ORDER;
+    readIntegratorConfig(config_integrator_, config_taylor_order_);
 
     selected_saddle_point_ = nullptr;
     selected_se_point_ = nullptr;
@@ -173,6 +213,12 @@ WVFStudy::WVFStudy(const WVFStudy &obj)
     vec_field_V2_[1] = copy_term2(obj.vec_field_V2_[1]);
     vec_field_C_[0] = copy_term3(obj.vec_field_C_[0]);
     vec_field_C_[1] = copy_term3(obj.vec_field_C_[1]);
+    f_vec_field_fused_ = obj.f_vec_field_fused_;
+    vec_field_U1_fused_ = obj.vec_field_U1_fused_;
+    vec_field_U2_fused_ = obj.vec_field_U2_fused_;
+    vec_field_V1_fused_ = obj.vec_field_V1_fused_;
+    vec_field_V2_fused_ = obj.vec_field_V2_fused_;
+    vec_field_C_fused_ = obj.vec_field_C_fused_;
 
     first_saddle_point_ = copy_saddle(obj.first_saddle_point_);
     first_se_point_ = copy_semi_elementary(obj.first_se_point_);
@@ -187,34 +233,39 @@ WVFStudy::WVFStudy(const WVFStudy &obj)
     gcf_V1_ = copy_term2(obj.gcf_V1_);
     gcf_V2_ = copy_term2(obj.gcf_V2_);
     gcf_C_ = copy_term3(obj.gcf_C_);
-    gcf_points_ = copy_orbits_points(obj.gcf_points_);
-    last_gcf_point_ = copy_orbits_points(obj.last_gcf_point_);
+    gcf_flat_ = obj.gcf_flat_;
+    gcf_U1_flat_ = obj.gcf_U1_flat_;
+    gcf_U2_flat_ = obj.gcf_U2_flat_;
+    gcf_V1_flat_ = obj.gcf_V1_flat_;
+    gcf_V2_flat_ = obj.gcf_V2_flat_;
+    gcf_C_flat_ = obj.gcf_C_flat_;
+    gcf_points_ = obj.gcf_points_;
 
     std::vector<curves>::const_iterator it1;
     for (it1 = obj.curve_vector_.begin(); it1 != obj.curve_vector_.end();
          it1++) {
         curves *curve = copy_curves((curves *)&(*it1));
-        curve_vector_.push_back(*curve);
+        curve_vector_.push_back(std::move(*curve));
+        delete curve;
     }
-    last_curves_point_ = copy_orbits_points(obj.last_curves_point_);
 
     std::vector<isoclines>::const_iterator it2;
     for (it2 = obj.isocline_vector_.begin(); it2 != obj.isocline_vector_.end();
          it2++) {
         isoclines *isoc = copy_isoclines((isoclines *)&(*it2));
-        isocline_vector_.push_back(*isoc);
+        isocline_vector_.push_back(std::move(*isoc));
+        delete isoc;
     }
-    last_isoclines_point_ = copy_orbits_points(obj.last_isoclines_point_);
 
     std::vector<orbits>::const_iterator it3;
     for (it3 = obj.orbit_vector_.begin(); it3 != obj.orbit_vector_.end();
          it3++) {
         orbits *orb = copy_orbits((orbits *)&(*it3));
-        orbit_vector_.push_back(*orb);
+        orbit_vector_.push_back(std::move(*orb));
+        delete orb;
     }
 
-    //first_lim_cycle_ = copy_orbits(obj.first_lim_cycle_);
-    //current_lim_cycle_ = copy_orbits(obj.current_lim_cycle_);
+    limit_cycle_vector_ = obj.limit_cycle_vector_;
 
     config_lc_value_ = obj.config_lc_value_;
     config_hma_ = obj.config_hma_;
@@ -227,6 +278,8 @@ WVFStudy::WVFStudy(const WVFStudy &obj)
     config_lc_numpoints_ = obj.config_lc_numpoints_;
     config_dashes_ = obj.config_dashes_;
     config_kindvf_ = obj.config_kindvf_;
+    config_integrator_ = obj.config_integrator_;
+    config_taylor_order_ = obj.config_taylor_order_;
 
     selected_ucoord_[0] = obj.selected_ucoord_[0];
     selected_ucoord_[1] = obj.selected_ucoord_[1];
@@ -248,38 +301,12 @@ orbits *WVFStudy::copy_orbits(orbits *p)
         q->pcoord[1] = o->pcoord[1];
         q->pcoord[2] = o->pcoord[2];
         q->color = o->color;
-        q->f_orbits = copy_orbits_points(o->f_orbits);
-        q->current_f_orbits = copy_orbits_points(o->current_f_orbits);
+        q->points = o->points;
         result = q;
     }
     return result;
 }
 
-P4ORBIT WVFStudy::copy_orbits_points(P4ORBIT p)
-{
-    P4ORBIT result = nullptr;
-    P4ORBIT o = p;
-    P4ORBIT last = nullptr;
-    while (o != nullptr) {
-        P4ORBIT q = new orbits_points;
-        q->color = o->color;
-        q->pcoord[0] = o->pcoord[0];
-        q->pcoord[1] = o->pcoord[1];
-        q->pcoord[2] = o->pcoord[2];
-        q->dashes = o->dashes;
-        q->dir = o->dir;
-        q->type = o->type;
-        q->next_point = nullptr;
-        if (last != nullptr)
-            last->next_point = q;
-        else
-            result = q;
-        last = q;
-        o = o->next_point;
-    }
-    return result;
-}
-
 P4POLYNOM1 WVFStudy::copy_term1(P4POLYNOM1 p)
 {
     P4POLYNOM1 result = nullptr;
@@ -350,13 +377,13 @@ sep *WVFStudy::copy_sep(sep *p)
     sep *last = nullptr;
     while (o != nullptr) {
         sep *q = new sep;
-        q->first_sep_point = copy_orbits_points(o->first_sep_point);
-        q->last_sep_point = copy_orbits_points(o->last_sep_point);
+        q->points = o->points;
         q->type = o->type;
         q->direction = o->direction;
         q->d = o->d;
         q->notadummy = o->notadummy;
         q->separatrice = copy_term1(o->separatrice);
+        q->event = o->event;
         q->next_sep = nullptr;
         if (last != nullptr)
             last->next_sep = q;
@@ -414,8 +441,8 @@ blow_up_points *WVFStudy::copy_blow_up_points(blow_up_points *p)
         q->blow_up_vec_field = o->blow_up_vec_field;
         q->point[0] = o->point[0];
         q->point[1] = o->point[1];
-        q->first_sep_point = copy_orbits_points(o->first_sep_point);
-        q->last_sep_point = copy_orbits_points(o->last_sep_point);
+        q->points = o->points;
+        q->event = o->event;
         q->next_blow_up_point = nullptr;
         if (last != nullptr)
             last->next_blow_up_point = q;
@@ -592,7 +619,7 @@ curves *WVFStudy::copy_curves(curves *p)
         q->v1 = copy_term2(o->v1);
         q->v2 = copy_term2(o->v2);
         q->c = copy_term3(o->c);
-        q->points = copy_orbits_points(o->points);
+        q->points = o->points;
         result = q;
     }
     return result;
@@ -610,7 +637,7 @@ isoclines *WVFStudy::copy_isoclines(isoclines *p)
         q->v1 = copy_term2(o->v1);
         q->v2 = copy_term2(o->v2);
         q->c = copy_term3(o->c);
-        q->points = copy_orbits_points(o->points);
+        q->points = o->points;
         q->color = o->color;
         result = q;
     }
@@ -627,6 +654,30 @@ WVFStudy::~WVFStudy()
     g_globalLogger.debug("[WVFStudy] Deleted correctly");
 }
 
+// -----------------------------------------------------------------------
+//                      WVFStudy::readIntegratorConfig
+// -----------------------------------------------------------------------
+
+void WVFStudy::readIntegratorConfig(int &integrator, int &order)
+{
+    WServer *server = WServer::instance();
+    std::string value;
+
+    if (server == nullptr)
+        return;
+    if (server->readConfigurationProperty("integrator", value)) {
+        if (value == "rk78")
+            integrator = INTEGRATOR_RK78;
+        else if (value == "taylor")
+            integrator = INTEGRATOR_TAYLOR;
+    }
+    if (server->readConfigurationProperty("taylor-order", value)) {
+        int n = atoi(value.c_str());
+        if (n >= 0 && n <= TAYLOR_MAX_ORDER)
+            order = n;
+    }
+}
+
 // -----------------------------------------------------------------------
 //                          WVFStudy::DeleteVF
 // -----------------------------------------------------------------------
@@ -659,6 +710,12 @@ void WVFStudy::deleteVF()
     vec_field_C_[0] = nullptr;
     delete_term3(vec_field_C_[1]);
     vec_field_C_[1] = nullptr;
+    f_vec_field_fused_ = flatfield();
+    vec_field_U1_fused_ = flatfield();
+    vec_field_U2_fused_ = flatfield();
+    vec_field_V1_fused_ = flatfield();
+    vec_field_V2_fused_ = flatfield();
+    vec_field_C_fused_ = flatfield();
 
     // Delete singular points
     g_globalLogger.debug("[WVFStudy] Deleting singular points...");
@@ -689,31 +746,29 @@ void WVFStudy::deleteVF()
     gcf_V2_ = nullptr;
     delete_term3(gcf_C_);
     gcf_C_ = nullptr;
-    deleteOrbitPoint(gcf_points_);
-    gcf_points_ = nullptr;
-    deleteOrbitPoint(last_gcf_point_);
-    last_gcf_point_ = nullptr;
+    gcf_flat_ = flatpoly();
+    gcf_U1_flat_ = flatpoly();
+    gcf_U2_flat_ = flatpoly();
+    gcf_V1_flat_ = flatpoly();
+    gcf_V2_flat_ = flatpoly();
+    gcf_C_flat_ = flatpoly();
+    gcf_points_.clear();
 
     // Delete curves:
     g_globalLogger.debug("[WVFStudy] Deleting curves...");
     curve_vector_.clear();
-    deleteOrbitPoint(last_curves_point_);
-    last_curves_point_ = nullptr;
 
     // Delete isoclines
     g_globalLogger.debug("[WVFStudy] Deleting isoclines...");
     isocline_vector_.clear();
-    deleteOrbitPoint(last_isoclines_point_);
-    last_isoclines_point_ = nullptr;
 
     // Delete all orbits
     g_globalLogger.debug("[WVFStudy] Deleting orbits...");
     orbit_vector_.clear();
 
     // Delete limit cycles
-    //g_globalLogger.debug("[WVFStudy] Deleting limit cycles...");
-    // deleteLimitCycle(first_lim_cycle_);
-    // first_lim_cycle_ = nullptr;
+    g_globalLogger.debug("[WVFStudy] Deleting limit cycles...");
+    limit_cycle_vector_.clear();
 }
 
 // -----------------------------------------------------------------------
@@ -789,7 +844,6 @@ void WVFStudy::deleteSeparatrices(sep *p)
         q = p;
         p = p->next_sep;
 
-        deleteOrbitPoint(q->first_sep_point);
         if (q->notadummy)
             delete_term1(q->separatrice);
         delete q;
@@ -812,7 +866,6 @@ void WVFStudy::deleteBlowup(blow_up_points *b)
         delete_term2(c->vector_field[0]);
         delete_term2(c->vector_field[1]);
         delete_term1(c->sep);
-        deleteOrbitPoint(c->first_sep_point);
         delete c;
         c = nullptr;
     }
@@ -975,6 +1028,15 @@ bool WVFStudy::readTables(std::string basename)
 
     fclose(fp);
 
+    // the integrators evaluate gcf and vector field of a chart in one pass
+    flatten_field2(gcf_, f_vec_field_, &f_vec_field_fused_);
+    flatten_field2(gcf_U1_, vec_field_U1_, &vec_field_U1_fused_);
+    flatten_field2(gcf_U2_, vec_field_U2_, &vec_field_U2_fused_);
+    flatten_field2(gcf_V1_, vec_field_V1_, &vec_field_V1_fused_);
+    flatten_field2(gcf_V2_, vec_field_V2_, &vec_field_V2_fused_);
+    if (plweights_)
+        flatten_field3(gcf_C_, vec_field_C_, &vec_field_C_fused_);
+
     if (typeofstudy_ != TYPEOFSTUDY_INF) {
         fp = fopen((basename + "_fin.tab").c_str(), "rt");
         if (fp != nullptr) {
@@ -1057,6 +1119,7 @@ bool WVFStudy::readGCF(FILE *fp)
 
         if (!readTerm2(fp, gcf_, N))
             return false;
+        flatten_term2(gcf_, &gcf_flat_);
 
         if (fscanf(fp, "%d", &N) != 1)
             return false;
@@ -1066,6 +1129,7 @@ bool WVFStudy::readGCF(FILE *fp)
 
         if (!readTerm2(fp, gcf_U1_, N))
             return false;
+        flatten_term2(gcf_U1_, &gcf_U1_flat_);
 
         if (fscanf(fp, "%d", &N) != 1)
             return false;
@@ -1075,6 +1139,7 @@ bool WVFStudy::readGCF(FILE *fp)
 
         if (!readTerm2(fp, gcf_U2_, N))
             return false;
+        flatten_term2(gcf_U2_, &gcf_U2_flat_);
 
         if (fscanf(fp, "%d", &N) != 1)
             return false;
@@ -1083,6 +1148,7 @@ bool WVFStudy::readGCF(FILE *fp)
         gcf_V1_->next_term2 = nullptr;
         if (!readTerm2(fp, gcf_V1_, N))
             return false;
+        flatten_term2(gcf_V1_, &gcf_V1_flat_);
 
         if (fscanf(fp, "%d", &N) != 1)
             return false;
@@ -1090,6 +1156,7 @@ bool WVFStudy::readGCF(FILE *fp)
         gcf_V2_->next_term2 = nullptr;
         if (!readTerm2(fp, gcf_V2_, N))
             return false;
+        flatten_term2(gcf_V2_, &gcf_V2_flat_);
 
         if (p_ != 1 || q_ != 1) {
             if (fscanf(fp, "%d", &N) != 1)
@@ -1099,6 +1166,7 @@ bool WVFStudy::readGCF(FILE *fp)
             gcf_C_->next_term3 = nullptr;
             if (!readTerm3(fp, gcf_C_, N))
                 return false;
+            flatten_term3(gcf_C_, &gcf_C_flat_);
         }
     } else {
         gcf_ = nullptr;
@@ -1537,8 +1605,6 @@ bool WVFStudy::readSaddlePoint(FILE *fp)
     readTerm1(fp, sep1->separatrice, N);
     sep1->direction = 1;
     sep1->d = 0;
-    sep1->first_sep_point = nullptr;
-    sep1->last_sep_point = nullptr;
     sep1->next_sep = nullptr;
 
     if (point->chart == CHART_R2 || singinf_) {
@@ -1555,8 +1621,6 @@ bool WVFStudy::readSaddlePoint(FILE *fp)
         sep2->d = 0;
         sep2->notadummy = false;
         sep2->separatrice = sep1->separatrice;
-        sep2->first_sep_point = nullptr;
-        sep2->last_sep_point = nullptr;
 
         sep1 = sep2->next_sep = new sep;
 
@@ -1572,8 +1636,6 @@ bool WVFStudy::readSaddlePoint(FILE *fp)
         readTerm1(fp, sep1->separatrice, N);
         sep1->direction = 1;
         sep1->d = 1;
-        sep1->first_sep_point = nullptr;
-        sep1->last_sep_point = nullptr;
 
         sep2 = new sep;
         sep1->next_sep = sep2;
@@ -1583,8 +1645,6 @@ bool WVFStudy::readSaddlePoint(FILE *fp)
         sep2->d = 1;
         sep2->notadummy = false;
         sep2->separatrice = sep1->separatrice;
-        sep2->first_sep_point = nullptr;
-        sep2->last_sep_point = nullptr;
         sep2->next_sep = nullptr;
     }
 
@@ -1694,8 +1754,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->notadummy = true;
             sep1->separatrice = new term1;
             readTerm1(fp, sep1->separatrice, N);
-            sep1->first_sep_point = nullptr;
-            sep1->last_sep_point = nullptr;
             sep1->next_sep = nullptr;
             if (point->chart == CHART_R2 || singinf_) {
                 // read second (hyperbolic) separatrix
@@ -1710,8 +1768,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
                 sep1->notadummy = true;
                 sep1->separatrice = new term1;
                 readTerm1(fp, sep1->separatrice, N);
-                sep1->first_sep_point = nullptr;
-                sep1->last_sep_point = nullptr;
 
                 // it is two-sided, so make a copy in other direction
 
@@ -1721,8 +1777,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
                 sep1->next_sep->direction = -1;
                 sep1->next_sep->notadummy = false;
                 sep1->next_sep->separatrice = sep1->separatrice;
-                sep1->next_sep->first_sep_point = nullptr;
-                sep1->next_sep->last_sep_point = nullptr;
                 sep1->next_sep->next_sep = nullptr;
             }
         }
@@ -1748,8 +1802,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
         sep1->notadummy = true;
         sep1->separatrice = new term1;
         readTerm1(fp, sep1->separatrice, N);
-        sep1->first_sep_point = nullptr;
-        sep1->last_sep_point = nullptr;
         sep1->next_sep = nullptr;
         if (point->chart == CHART_R2 || singinf_) {
             sep1->next_sep = new sep;
@@ -1762,16 +1814,12 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->notadummy = true;
             sep1->separatrice = new term1;
             readTerm1(fp, sep1->separatrice, N);
-            sep1->first_sep_point = nullptr;
-            sep1->last_sep_point = nullptr;
             sep1->next_sep = new sep;
             sep1->next_sep->type = STYPE_STABLE;
             sep1->next_sep->d = 1;
             sep1->next_sep->direction = -1;
             sep1->next_sep->notadummy = false;
             sep1->next_sep->separatrice = sep1->separatrice;
-            sep1->next_sep->first_sep_point = nullptr;
-            sep1->next_sep->last_sep_point = nullptr;
             sep1->next_sep->next_sep = nullptr;
         }
         break;
@@ -1795,8 +1843,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
         sep1->notadummy = true;
         sep1->separatrice = new term1;
         readTerm1(fp, sep1->separatrice, N);
-        sep1->first_sep_point = nullptr;
-        sep1->last_sep_point = nullptr;
         sep1->next_sep = nullptr;
         if (point->chart == CHART_R2 || singinf_) {
             sep1->next_sep = new sep;
@@ -1809,16 +1855,12 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->notadummy = true;
             sep1->separatrice = new term1;
             readTerm1(fp, sep1->separatrice, N);
-            sep1->first_sep_point = nullptr;
-            sep1->last_sep_point = nullptr;
             sep1->next_sep = new sep;
             sep1->next_sep->type = STYPE_UNSTABLE;
             sep1->next_sep->d = 1;
             sep1->next_sep->direction = -1;
             sep1->next_sep->notadummy = false;
             sep1->next_sep->separatrice = sep1->separatrice;
-            sep1->next_sep->first_sep_point = nullptr;
-            sep1->next_sep->last_sep_point = nullptr;
             sep1->next_sep->next_sep = nullptr;
         }
         break;
@@ -1847,8 +1889,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->notadummy = true;
             sep1->separatrice = new term1;
             readTerm1(fp, sep1->separatrice, N);
-            sep1->first_sep_point = nullptr;
-            sep1->last_sep_point = nullptr;
             sep1->next_sep = nullptr;
             if (point->chart == CHART_R2 || singinf_) {
                 sep1->next_sep = new sep;
@@ -1861,16 +1901,12 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
                 sep1->notadummy = true;
                 sep1->separatrice = new term1;
                 readTerm1(fp, sep1->separatrice, N);
-                sep1->first_sep_point = nullptr;
-                sep1->last_sep_point = nullptr;
                 sep1->next_sep = new sep;
                 sep1->next_sep->type = STYPE_STABLE;
                 sep1->next_sep->d = 1;
                 sep1->next_sep->direction = -1;
                 sep1->next_sep->notadummy = false;
                 sep1->next_sep->separatrice = sep1->separatrice;
-                sep1->next_sep->first_sep_point = nullptr;
-                sep1->next_sep->last_sep_point = nullptr;
                 sep1->next_sep->next_sep = nullptr;
             }
         }
@@ -1894,8 +1930,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
         sep1->notadummy = true;
         sep1->separatrice = new term1;
         readTerm1(fp, sep1->separatrice, N);
-        sep1->first_sep_point = nullptr;
-        sep1->last_sep_point = nullptr;
         sep1->next_sep = nullptr;
         if (point->chart == CHART_R2 || singinf_) {
             sep1->next_sep = new sep;
@@ -1904,8 +1938,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->next_sep->direction = -1;
             sep1->next_sep->notadummy = false;
             sep1->next_sep->separatrice = sep1->separatrice;
-            sep1->next_sep->first_sep_point = nullptr;
-            sep1->next_sep->last_sep_point = nullptr;
             sep1->next_sep->next_sep = new sep;
             sep1 = sep1->next_sep->next_sep;
             sep1->type = STYPE_STABLE;
@@ -1916,16 +1948,12 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->notadummy = true;
             sep1->separatrice = new term1;
             readTerm1(fp, sep1->separatrice, N);
-            sep1->first_sep_point = nullptr;
-            sep1->last_sep_point = nullptr;
             sep1->next_sep = new sep;
             sep1->next_sep->type = STYPE_STABLE;
             sep1->next_sep->d = 1;
             sep1->next_sep->direction = -1;
             sep1->next_sep->notadummy = false;
             sep1->next_sep->separatrice = sep1->separatrice;
-            sep1->next_sep->first_sep_point = nullptr;
-            sep1->next_sep->last_sep_point = nullptr;
             sep1->next_sep->next_sep = nullptr;
         }
         break;
@@ -1948,8 +1976,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
         sep1->notadummy = true;
         sep1->separatrice = new term1;
         readTerm1(fp, sep1->separatrice, N);
-        sep1->first_sep_point = nullptr;
-        sep1->last_sep_point = nullptr;
         sep1->next_sep = nullptr;
         if (point->chart == CHART_R2 || singinf_) {
             sep1->next_sep = new sep;
@@ -1958,8 +1984,6 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->next_sep->direction = -1;
             sep1->next_sep->notadummy = false;
             sep1->next_sep->separatrice = sep1->separatrice;
-            sep1->next_sep->first_sep_point = nullptr;
-            sep1->next_sep->last_sep_point = nullptr;
             sep1->next_sep->next_sep = new sep;
             sep1 = sep1->next_sep->next_sep;
             sep1->type = STYPE_UNSTABLE;
@@ -1970,16 +1994,12 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
             sep1->notadummy = true;
             sep1->separatrice = new term1;
             readTerm1(fp, sep1->separatrice, N);
-            sep1->first_sep_point = nullptr;
-            sep1->last_sep_point = nullptr;
             sep1->next_sep = new sep;
             sep1->next_sep->type = STYPE_UNSTABLE;
             sep1->next_sep->d = 1;
             sep1->next_sep->direction = -1;
             sep1->next_sep->notadummy = false;
             sep1->next_sep->separatrice = sep1->separatrice;
-            sep1->next_sep->first_sep_point = nullptr;
-            sep1->next_sep->last_sep_point = nullptr;
             sep1->next_sep->next_sep = nullptr;
         }
         break;
@@ -1993,27 +2013,27 @@ bool WVFStudy::readSemiElementaryPoint(FILE *fp)
         ok = false;
         switch (point->chart) {
         case CHART_R2:
-            if (eval_term2(gcf_, y) < 0)
+            if (eval_flat2(gcf_flat_, y) < 0)
                 ok = true;
             break;
         case CHART_U1:
-            if (eval_term2(gcf_U1_, y) < 0)
+            if (eval_flat2(gcf_U1_flat_, y) < 0)
                 ok = true;
             break;
         case CHART_V1:
             if ((p_ == 1) && (q_ == 1))
                 y[0] = -y[0];
-            if (eval_term2(gcf_V1_, y) < 0)
+            if (eval_flat2(gcf_V1_flat_, y) < 0)
                 ok = true;
             break;
         case CHART_U2:
-            if (eval_term2(gcf_U2_, y) < 0)
+            if (eval_flat2(gcf_U2_flat_, y) < 0)
                 ok = true;
             break;
         case CHART_V2:
             if ((p_ == 1) && (q_ == 1))
                 y[0] = -y[0];
-            if (eval_term2(gcf_V2_, y) < 0)
+            if (eval_flat2(gcf_V2_flat_, y) < 0)
                 ok = true;
             break;
         }
@@ -2120,12 +2140,12 @@ bool WVFStudy::readStrongFocusPoint(FILE *fp)
 
     switch (point->chart) {
     case CHART_R2:
-        if (eval_term2(gcf_, y) < 0)
+        if (eval_flat2(gcf_flat_, y) < 0)
             point->stable *= -1;
         break;
 
     case CHART_U1:
-        if (eval_term2(gcf_U1_, y) < 0)
+        if (eval_flat2(gcf_U1_flat_, y) < 0)
             point->stable *= -1;
         break;
 
@@ -2133,12 +2153,12 @@ bool WVFStudy::readStrongFocusPoint(FILE *fp)
         if (p_ == 1 && q_ == 1)
             y[0] = -y[0];
 
-        if (eval_term2(gcf_V1_, y) < 0)
+        if (eval_flat2(gcf_V1_flat_, y) < 0)
             point->stable *= -1;
         break;
 
     case CHART_U2:
-        if (eval_term2(gcf_U2_, y) < 0)
+        if (eval_flat2(gcf_U2_flat_, y) < 0)
             point->stable *= -1;
         break;
 
@@ -2146,7 +2166,7 @@ bool WVFStudy::readStrongFocusPoint(FILE *fp)
         if (p_ == 1 && q_ == 1)
             y[0] = -y[0];
 
-        if (eval_term2(gcf_V2_, y) < 0)
+        if (eval_flat2(gcf_V2_flat_, y) < 0)
             point->stable *= -1;
         break;
     }
@@ -2204,31 +2224,31 @@ bool WVFStudy::readWeakFocusPoint(FILE *fp)
 
         switch (point->chart) {
         case CHART_R2:
-            if (eval_term2(gcf_, y) < 0)
+            if (eval_flat2(gcf_flat_, y) < 0)
                 point->type *= -1;
             break;
 
         case CHART_U1:
-            if (eval_term2(gcf_U1_, y) < 0)
+            if (eval_flat2(gcf_U1_flat_, y) < 0)
                 point->type *= -1;
             break;
 
         case CHART_V1:
             if ((p_ == 1) && (q_ == 1))
                 y[0] = -y[0];
-            if (eval_term2(gcf_V1_, y) < 0)
+            if (eval_flat2(gcf_V1_flat_, y) < 0)
                 point->type *= -1;
             break;
 
         case CHART_U2:
-            if (eval_term2(gcf_U2_, y) < 0)
+            if (eval_flat2(gcf_U2_flat_, y) < 0)
                 point->type *= -1;
             break;
 
         case CHART_V2:
             if ((p_ == 1) && (q_ == 1))
                 y[0] = -y[0];
-            if (eval_term2(gcf_V2_, y) < 0)
+            if (eval_flat2(gcf_V2_flat_, y) < 0)
                 point->type *= -1;
             break;
         }
@@ -2370,12 +2390,12 @@ bool WVFStudy::readNodePoint(FILE *fp)
 
     switch (point->chart) {
     case CHART_R2:
-        if (eval_term2(gcf_, y) < 0)
+        if (eval_flat2(gcf_flat_, y) < 0)
             point->stable *= -1;
         break;
 
     case CHART_U1:
-        if (eval_term2(gcf_U1_, y) < 0)
+        if (eval_flat2(gcf_U1_flat_, y) < 0)
             point->stable *= -1;
         break;
 
@@ -2383,19 +2403,19 @@ bool WVFStudy::readNodePoint(FILE *fp)
         if (p_ == 1 && q_ == 1)
             y[0] = -y[0];
 
-        if (eval_term2(gcf_V1_, y) < 0)
+        if (eval_flat2(gcf_V1_flat_, y) < 0)
             point->stable *= -1;
         break;
 
     case CHART_U2:
-        if (eval_term2(gcf_U2_, y) < 0)
+        if (eval_flat2(gcf_U2_flat_, y) < 0)
             point->stable *= -1;
         break;
 
     case CHART_V2:
         if (p_ == 1 && q_ == 1)
             y[0] = -y[0];
-        if (eval_term2(gcf_V2_, y) < 0)
+        if (eval_flat2(gcf_V2_flat_, y) < 0)
             point->stable *= -1;
         break;
     }
@@ -2527,8 +2547,6 @@ bool WVFStudy::readBlowupPoints(FILE *fp, blow_up_points *b, int n)
             b->type = STYPE_STABLE;
             break;
         }
-        b->first_sep_point = nullptr;
-        b->last_sep_point = nullptr;
         b->next_blow_up_point = nullptr;
 
         if (i < n) {
@@ -3006,6 +3024,84 @@ bool WVFStudy::isvalid_plsphereviewcoord(double u, double v, double *pcoord)
     return true;
 }
 
+// -----------------------------------------------------------------------
+//                          PL_ROOTS
+// -----------------------------------------------------------------------
+//
+// Every change of coordinates to the cylinder has to find the root z in
+// (0,1] of
+//
+//      a z^p + b z^q = 1,      a,b >= 0, a+b >= 1,
+//
+// with z=r^2 for R2_to_plsphere and z=(r/s)^2 for the charts at infinity.
+// The root has a closed form when p=q, or when one weight is twice the
+// other, since then w=z^min(p,q) is the root of a quadratic.
+//
+// Otherwise, Newton's method is applied to h(t)=log(a e^(pt) + b e^(qt)),
+// with t=log(z). h is convex with slope between p and q, so Newton's method
+// goes down monotonically from any t above the root. One of the two terms
+// is at least 1/2 at the root, so the smallest of the values of t where
+// each term is 1 is above the root by less than log(2)/min(p,q), and
+// PL_ROOT_ITERATIONS steps from there reach the root to machine precision.
+// The number of steps is fixed, so that the loops over several points do
+// not branch.
+
+#define PL_ROOT_ITERATIONS 6
+
+void WVFStudy::pl_roots(int n, const double *a, const double *b, double *z)
+{
+    double e, w, zp, zq, g;
+    int i, k;
+
+    if (p_ == q_) {
+        e = -1.0 / double_p_;
+        for (i = 0; i < n; i++)
+            z[i] = pow(a[i] + b[i], e);
+    } else if (q_ == 2 * p_) {
+        e = 1.0 / double_p_;
+        for (i = 0; i < n; i++) {
+            w = 2.0 / (a[i] + sqrt(a[i] * a[i] + 4.0 * b[i]));
+            z[i] = (p_ == 1) ? w : pow(w, e);
+        }
+    } else if (p_ == 2 * q_) {
+        e = 1.0 / double_q_;
+        for (i = 0; i < n; i++) {
+            w = 2.0 / (b[i] + sqrt(b[i] * b[i] + 4.0 * a[i]));
+            z[i] = (q_ == 1) ? w : pow(w, e);
+        }
+    } else {
+        // z holds t=log(z) during the iteration
+        for (i = 0; i < n; i++) {
+            if (b[i] == 0)
+                z[i] = -log(a[i]) / double_p_;
+            else if (a[i] == 0)
+                z[i] = -log(b[i]) / double_q_;
+            else
+                z[i] = std::min(-log(a[i]) / double_p_,
+                                -log(b[i]) / double_q_);
+        }
+        for (k = 0; k < PL_ROOT_ITERATIONS; k++) {
+            for (i = 0; i < n; i++) {
+                w = exp(z[i]);
+                zp = a[i] * ipow(w, p_);
+                zq = b[i] * ipow(w, q_);
+                g = zp + zq;
+                z[i] -= log(g) * g / (double_p_ * zp + double_q_ * zq);
+            }
+        }
+        for (i = 0; i < n; i++)
+            z[i] = exp(z[i]);
+    }
+}
+
+double WVFStudy::pl_root(double a, double b)
+{
+    double z;
+
+    pl_roots(1, &a, &b, &z);
+    return z;
+}
+
 // void cylinder_to_U1( double r, double theta, double * c);
 // void cylinder_to_U2( double r, double theta, double * c );
 // void cylinder_to_V1( double r, double theta, double * c);
@@ -3015,28 +3111,16 @@ bool WVFStudy::isvalid_plsphereviewcoord(double u, double v, double *pcoord)
 void V1_to_cylinder(double u, double s, double *c);
 void V2_to_cylinder(double u, double s, double *c);
 
-static double U = 0.0;
-
-double WVFStudy::func_U1(double x)
-{
-    return pow(x, double_p_) + U * U * pow(x, double_q_) - 1.0;
-}
-
-double WVFStudy::dfunc_U1(double x)
-{
-    return double_p_ * pow(x, double_p_minus_1_) +
-           U * U * double_q_ * pow(x, double_q_minus_1_);
-}
-
-double WVFStudy::func_U1_s0(double theta)
+double WVFStudy::func_U1_s0(double theta, const double *par)
 {
     /* find theta if s=0 and u<>0 */
-    return U * pow(cos(theta), double_q_) - pow(sin(theta), double_p_);
+    return par[0] * pow(cos(theta), double_q_) - pow(sin(theta), double_p_);
 }
 
-double WVFStudy::dfunc_U1_s0(double theta)
+double WVFStudy::dfunc_U1_s0(double theta, const double *par)
 {
-    return (-double_q_ * U * pow(cos(theta), double_q_minus_1_) * sin(theta) -
+    return (-double_q_ * par[0] * pow(cos(theta), double_q_minus_1_) *
+                sin(theta) -
             double_p_ * cos(theta) * pow(sin(theta), double_p_minus_1_));
 }
 
@@ -3045,7 +3129,7 @@ void WVFStudy::U1_to_cylinder(double u, double s, double *c)
     /* input (u,s) output c=(r,theta)
         x=1/s^p, y=u/s^q
     */
-    double x[2], y;
+    double x[2], y, U;
     if (u == 0) {
         c[0] = s;
         c[1] = 0;
@@ -3059,12 +3143,9 @@ void WVFStudy::U1_to_cylinder(double u, double s, double *c)
             x[0] = -PI / 2.0;
             x[1] = 0;
         }
-        c[1] = find_root(&WVFStudy::func_U1_s0, &WVFStudy::dfunc_U1_s0, x);
+        c[1] = find_root(&WVFStudy::func_U1_s0, &WVFStudy::dfunc_U1_s0, x, &U);
     } else {
-        x[0] = 0;
-        x[1] = 1;
-        U = u;
-        y = find_root(&WVFStudy::func_U1, &WVFStudy::dfunc_U1, x);
+        y = pl_root(1.0, u * u);
         c[0] = sqrt(y) * s;
         c[1] = atan(u * pow(sqrt(y), double_q_minus_p_));
     }
@@ -3083,7 +3164,7 @@ void WVFStudy::V1_to_cylinder(double u, double s, double *c)
     /* input (u,s) output c=(r,theta)
         x=-1/s^p, y=u/s^q
     */
-    double x[2], y;
+    double x[2], y, U;
     if (u == 0) {
         c[0] = s;
         c[1] = PI;
@@ -3097,12 +3178,9 @@ void WVFStudy::V1_to_cylinder(double u, double s, double *c)
             x[0] = -PI;
             x[1] = -PI / 2;
         }
-        c[1] = find_root(&WVFStudy::func_U1_s0, &WVFStudy::dfunc_U1_s0, x);
+        c[1] = find_root(&WVFStudy::func_U1_s0, &WVFStudy::dfunc_U1_s0, x, &U);
     } else {
-        x[0] = 0;
-        x[1] = 1;
-        U = u;
-        y = find_root(&WVFStudy::func_U1, &WVFStudy::dfunc_U1, x);
+        y = pl_root(1.0, u * u);
         c[0] = sqrt(y) * s;
         c[1] = atan(-u * pow(sqrt(y), double_q_minus_p_));
         if (c[1] > 0)
@@ -3124,30 +3202,20 @@ void WVFStudy::cylinder_to_V1( double r, double theta, double * c)
    on chart x=u/s^p, y=(+-)1/s^q
    on cylinder x=cos(theta)/r^p, y=sin(theta)/r^q
    (u,s) -> (r,theta)
-   find positive root of  u^2*y^p+y^q-1
+   find the root of  u^2*y^p+y^q-1  with pl_root
    r=sqrt(y)*s and theta=atan(sqrt(y)^(q-p)/u) if s<>0
    if s=0 then solve u^q*sin(theta)^p-cos(theta)^q
 */
 
-double WVFStudy::func_U2(double x)
-{
-    return (U * U * pow(x, double_p_) + pow(x, double_q_) - 1.0);
-}
-
-double WVFStudy::dfunc_U2(double x)
-{
-    return (double_p_ * U * U * pow(x, double_p_minus_1_) +
-            double_q_ * pow(x, double_q_minus_1_));
-}
-
-double WVFStudy::func_U2_s0(double theta)
+double WVFStudy::func_U2_s0(double theta, const double *par)
 {
-    return (U * pow(sin(theta), double_p_) - pow(cos(theta), double_q_));
+    return (par[0] * pow(sin(theta), double_p_) - pow(cos(theta), double_q_));
 }
 
-double WVFStudy::dfunc_U2_s0(double theta)
+double WVFStudy::dfunc_U2_s0(double theta, const double *par)
 {
-    return (double_p_ * U * cos(theta) * pow(sin(theta), double_p_minus_1_) +
+    return (double_p_ * par[0] * cos(theta) *
+                pow(sin(theta), double_p_minus_1_) +
             double_q_ * sin(theta) * pow(cos(theta), double_q_minus_1_)); ////
 }
 
@@ -3156,7 +3224,7 @@ void WVFStudy::U2_to_cylinder(double u, double s, double *c)
     x=u/s^p, y=1/s^q
 */
 {
-    double x[2], y;
+    double x[2], y, U;
     if (u == 0) {
         c[0] = s;
         c[1] = PI / 2;
@@ -3170,12 +3238,9 @@ void WVFStudy::U2_to_cylinder(double u, double s, double *c)
             x[0] = PI / 2.0;
             x[1] = PI;
         }
-        c[1] = find_root(&WVFStudy::func_U2_s0, &WVFStudy::dfunc_U2_s0, x);
+        c[1] = find_root(&WVFStudy::func_U2_s0, &WVFStudy::dfunc_U2_s0, x, &U);
     } else {
-        x[0] = 0;
-        x[1] = 1;
-        U = u;
-        y = find_root(&WVFStudy::func_U2, &WVFStudy::dfunc_U2, x);
+        y = pl_root(u * u, 1.0);
         c[0] = sqrt(y) * s;
         c[1] = atan(pow(sqrt(y), double_q_minus_p_) / u);
         if (c[1] < 0)
@@ -3196,7 +3261,7 @@ void WVFStudy::V2_to_cylinder(double u, double s, double *c)
     x=u/s^p, y=-1/s^q
 */
 {
-    double x[2], y;
+    double x[2], y, U;
 
     if (u == 0) {
         c[0] = s;
@@ -3212,12 +3277,10 @@ void WVFStudy::V2_to_cylinder(double u, double s, double *c)
                 x[0] = -PI;
                 x[1] = -PI / 2;
             }
-            c[1] = find_root(&WVFStudy::func_U2_s0, &WVFStudy::dfunc_U2_s0, x);
+            c[1] = find_root(&WVFStudy::func_U2_s0, &WVFStudy::dfunc_U2_s0, x,
+                             &U);
         } else {
-            x[0] = 0;
-            x[1] = 1;
-            U = u;
-            y = find_root(&WVFStudy::func_U2, &WVFStudy::dfunc_U2, x);
+            y = pl_root(u * u, 1.0);
             c[0] = sqrt(y) * s;
             c[1] = atan(-pow(sqrt(y), double_q_minus_p_) / u);
             if (c[1] > 0)
@@ -3304,44 +3367,52 @@ void WVFStudy::plsphere_annulus(double x, double y, double z, double *u)
 //
 //      (cos(v),sin(v)) = ( x*u^p, y*u^q )
 //
-//  Hence, u is a root of "x^2 u^(2p) + y^2 u^(2q) - 1 = 0".
-//  We calculate a root using numeric analysis.
+//  Hence, u^2 is the root of "x^2 (u^2)^p + y^2 (u^2)^q - 1 = 0" given by
+//  pl_root.
 //
 //  Once we have calculated u, we determine v using atan2.
 
-static double A = 0.0;
-static double B = 0.0;
-
-double WVFStudy::func(double z)
-{
-    return pow(z, double_p_) * A + pow(z, double_q_) * B - 1.0;
-}
-
-double WVFStudy::dfunc(double z)
-{
-    return double_p_ * pow(z, double_p_minus_1_) * A +
-           double_q_ * pow(z, double_q_minus_1_) * B;
-}
-
 void WVFStudy::R2_to_plsphere(double x, double y, double *pcoord)
 {
-    double z[2];
-
     if ((x * x + y * y) <= 1.0) {
         pcoord[0] = 0.0;
         pcoord[1] = x;
         pcoord[2] = y;
     } else {
         pcoord[0] = 1.0;
-        A = x * x;
-        B = y * y;
-        z[0] = 0.0;
-        z[1] = 1.0;
+        pcoord[1] = sqrt(pl_root(x * x, y * y));
+        pcoord[2] = atan2(ipow(pcoord[1], q_) * y, ipow(pcoord[1], p_) * x);
+    }
+}
+
+void WVFStudy::R2_to_plsphere_batch(int n, const double *x, const double *y,
+                                    double *pcoord)
+{
+    std::vector<double> a(n), b(n), z(n);
+    double *p;
+    int i;
 
-        pcoord[1] = find_root(&WVFStudy::func, &WVFStudy::dfunc, z);
-        pcoord[1] = sqrt(pcoord[1]);
-        pcoord[2] =
-            atan2(pow(pcoord[1], double_q_) * y, pow(pcoord[1], double_p_) * x);
+    // the points inside the unit ball get the harmless equation z=1
+    for (i = 0; i < n; i++) {
+        a[i] = x[i] * x[i];
+        b[i] = y[i] * y[i];
+        if (a[i] + b[i] <= 1.0) {
+            a[i] = 1.0;
+            b[i] = 0.0;
+        }
+    }
+    pl_roots(n, a.data(), b.data(), z.data());
+    for (i = 0; i < n; i++) {
+        p = pcoord + 3 * i;
+        if (x[i] * x[i] + y[i] * y[i] <= 1.0) {
+            p[0] = 0.0;
+            p[1] = x[i];
+            p[2] = y[i];
+        } else {
+            p[0] = 1.0;
+            p[1] = sqrt(z[i]);
+            p[2] = atan2(ipow(p[1], q_) * y[i], ipow(p[1], p_) * x[i]);
+        }
     }
 }
 
@@ -3613,80 +3684,37 @@ void WVFStudy::plsphere_to_V2(double ch, double x, double y, double *rcoord)
 
 void WVFStudy::eval_r_vec_field(double *y, double *f)
 {
-    double s = 1.0;
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && gcf_ != nullptr)
-        s = eval_term2(gcf_, y);
-
-    f[0] = s * eval_term2(f_vec_field_[0], y);
-    f[1] = s * eval_term2(f_vec_field_[1], y);
+    eval_field2(f_vec_field_fused_, y, config_kindvf_ == INTCONFIG_ORIGINAL,
+                false, f);
 }
 
 void WVFStudy::eval_U1_vec_field(double *y, double *f)
 {
-    double s = 1.0;
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && gcf_U1_ != nullptr)
-        s = eval_term2(gcf_U1_, y);
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && singinf_)
-        s *= y[1];
-
-    f[0] = s * eval_term2(vec_field_U1_[0], y);
-    f[1] = s * eval_term2(vec_field_U1_[1], y);
+    eval_field2(vec_field_U1_fused_, y, config_kindvf_ == INTCONFIG_ORIGINAL,
+                config_kindvf_ == INTCONFIG_ORIGINAL && singinf_, f);
 }
 
 void WVFStudy::eval_U2_vec_field(double *y, double *f)
 {
-    double s = 1.0;
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && gcf_U2_ != nullptr)
-        s = eval_term2(gcf_U2_, y);
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && singinf_)
-        s *= y[1];
-
-    f[0] = s * eval_term2(vec_field_U2_[0], y);
-    f[1] = s * eval_term2(vec_field_U2_[1], y);
+    eval_field2(vec_field_U2_fused_, y, config_kindvf_ == INTCONFIG_ORIGINAL,
+                config_kindvf_ == INTCONFIG_ORIGINAL && singinf_, f);
 }
 
 void WVFStudy::eval_V1_vec_field(double *y, double *f)
 {
-    double s = 1.0;
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && gcf_V1_ != nullptr)
-        s = eval_term2(gcf_V1_, y);
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && singinf_)
-        s *= y[1];
-
-    f[0] = s * eval_term2(vec_field_V1_[0], y);
-    f[1] = s * eval_term2(vec_field_V1_[1], y);
+    eval_field2(vec_field_V1_fused_, y, config_kindvf_ == INTCONFIG_ORIGINAL,
+                config_kindvf_ == INTCONFIG_ORIGINAL && singinf_, f);
 }
 
 void WVFStudy::eval_V2_vec_field(double *y, double *f)
 {
-    double s = 1.0;
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && gcf_V2_ != nullptr)
-        s = eval_term2(gcf_V2_, y);
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && singinf_)
-        s *= y[1];
-
-    f[0] = s * eval_term2(vec_field_V2_[0], y);
-    f[1] = s * eval_term2(vec_field_V2_[1], y);
+    eval_field2(vec_field_V2_fused_, y, config_kindvf_ == INTCONFIG_ORIGINAL,
+                config_kindvf_ == INTCONFIG_ORIGINAL && singinf_, f);
 }
 
 void WVFStudy::eval_vec_field_cyl(double *y, double *f)
 {
-    double s = 1.0;
-
-    if (config_kindvf_ == INTCONFIG_ORIGINAL && gcf_C_ != nullptr)
-        s = eval_term3(gcf_C_, y);
-
-    f[0] = s * eval_term3(vec_field_C_[0], y);
-    f[1] = s * eval_term3(vec_field_C_[1], y);
+    eval_field3(vec_field_C_fused_, y, config_kindvf_ == INTCONFIG_ORIGINAL, f);
 }
 
 void WVFStudy::default_finite_to_viewcoord(double x, double y, double *ucoord)
@@ -50,6 +50,8 @@
 
 #include <Wt/WString>
 
+#include <vector>
+
 // -----------------------------------------------------------------------
 //                      General polynomial expressions
 // -----------------------------------------------------------------------
@@ -114,60 +116,255 @@ struct term3 {
  */
 typedef struct term3 *P4POLYNOM3;
 
-// -----------------------------------------------------------------------
-//                              Orbits
-// -----------------------------------------------------------------------
-
 /**
- * Linked list of orbit points
+ * Polynomial in two or three variables stored for fast evaluation
  *
- * This struct holds information about coordinates and also about style
- * for plotting purposes.
+ * The terms of a P4POLYNOM2 or P4POLYNOM3 are kept in contiguous arrays,
+ * sorted by decreasing exponents, and evaluated with a nested Horner scheme
+ * (see eval_flat2() and eval_flat3()) instead of calling pow() for every
+ * term. Built with flatten_term2() and flatten_term3().
  */
-struct orbits_points {
-    int color; ///< color of seperatrice
+struct flatpoly {
+    int nvars;                  ///< number of variables (2 or 3)
+    std::vector<int> exps;      ///< nvars exponents of each term
+    std::vector<double> coeffs; ///< coefficient of each term
 
-    double pcoord[3]; /**< point on the poincare sphere -> p=(X,Y,Z)
-                       or on the poincare-lyapunov sphere -> p=(0,x,y)
-                       or p=(1,r,theta) */
-    int dashes;       ///< indicates if the line is dashed or continuous
-    int dir;  ///< if we have a line of sing at infinity and have to change
-    int type; /**< the direction if we integrate the orbit of separatrice
-               and sometimes the type */
+    /**
+     * Constructor method
+     */
+    flatpoly() : nvars(0){};
+};
 
-    struct orbits_points
-        *next_point; ///< pointer to next orbits_points (linked list)
+/**
+ * Vector field of a chart and its GCF stored for fast evaluation
+ *
+ * The monomials of the GCF and of both components are merged in one table
+ * with three coefficients each, so that eval_field2() and eval_field3()
+ * compute the powers of the variables once per evaluation. Built with
+ * flatten_field2() and flatten_field3().
+ */
+struct flatfield {
+    int nvars;                  ///< number of variables (2 or 3)
+    bool hasgcf;                ///< false if the GCF is 1
+    int maxexp[3];              ///< highest exponent of each variable
+    std::vector<int> exps;      ///< nvars exponents of each monomial
+    std::vector<double> coeffs; ///< gcf, xdot and ydot coefficients
 
     /**
      * Constructor method
      */
-    orbits_points() : next_point(nullptr){};
+    flatfield() : nvars(0), hasgcf(false)
+    {
+        maxexp[0] = maxexp[1] = maxexp[2] = 0;
+    };
 };
 
+// -----------------------------------------------------------------------
+//                              Orbits
+// -----------------------------------------------------------------------
+
+/**
+ * Number of points stored in each chunk of an OrbitPolyline
+ */
+#define POLYLINE_CHUNK 256
 /**
- * Typedef for a pointer to a struct orbits_points
+ * Bit of OrbitPolyline::chunk::style set when a point is joined to the
+ * previous one by a segment, the other bits are the color
  */
-typedef struct orbits_points *P4ORBIT;
+#define POLYLINE_DASHES 0x80
+
+/**
+ * Sequence of orbit points
+ *
+ * @class OrbitPolyline
+ *
+ * This class holds the coordinates of the points of an orbit, separatrice,
+ * curve or isocline, and also their style for plotting purposes. Points are
+ * stored in chunks of #POLYLINE_CHUNK points as a structure of arrays, so
+ * integrators append points without allocating each of them and redraws
+ * read the coordinates sequentially.
+ *
+ * Each point is a point on the poincare sphere -> p=(X,Y,Z) or on the
+ * poincare-lyapunov sphere -> p=(0,x,y) or p=(1,r,theta).
+ */
+class OrbitPolyline
+{
+  public:
+    /**
+     * Chunk of points
+     */
+    struct chunk {
+        double x[POLYLINE_CHUNK]; ///< first coordinate of the points
+        double y[POLYLINE_CHUNK]; ///< second coordinate of the points
+        double z[POLYLINE_CHUNK]; ///< third coordinate of the points
+        unsigned char style[POLYLINE_CHUNK]; ///< color and dashes
+        signed char dir[POLYLINE_CHUNK];     /**< direction of integration
+                                                  (changes if we have a line of
+                                                  singularities at infinity) */
+        signed char type[POLYLINE_CHUNK];    ///< type of separatrice
+    };
+
+    /**
+     * Consecutive points of a polyline, stored in the same chunk
+     */
+    struct span {
+        const double *x;            ///< first coordinates
+        const double *y;            ///< second coordinates
+        const double *z;            ///< third coordinates
+        const unsigned char *style; ///< color and dashes
+        int size;                   ///< number of points
+
+        /**
+         * Coordinates of the i-th point of the span
+         */
+        inline void point(int i, double *pcoord) const
+        {
+            pcoord[0] = x[i];
+            pcoord[1] = y[i];
+            pcoord[2] = z[i];
+        }
+        /**
+         * Color of the i-th point of the span
+         */
+        inline int color(int i) const { return style[i] & ~POLYLINE_DASHES; }
+        /**
+         * Whether the i-th point is joined to the previous one
+         */
+        inline bool dashes(int i) const
+        {
+            return (style[i] & POLYLINE_DASHES) != 0;
+        }
+    };
+
+    /**
+     * Constructor method
+     */
+    OrbitPolyline() : size_(0) {}
+    /**
+     * Copy constructor method
+     */
+    OrbitPolyline(const OrbitPolyline &other);
+    /**
+     * Move constructor method
+     */
+    OrbitPolyline(OrbitPolyline &&other) noexcept;
+    /**
+     * Assignment operator
+     */
+    OrbitPolyline &operator=(OrbitPolyline other) noexcept;
+    /**
+     * Destructor method
+     */
+    ~OrbitPolyline() { clear(); }
+
+    /**
+     * Append a point at the end of the polyline
+     *
+     * @param pcoord coordinates of the point
+     * @param color  color of the point
+     * @param dashes whether the point is joined to the previous one
+     * @param dir    direction of integration
+     * @param type   type of separatrice
+     */
+    inline void append(const double *pcoord, int color, int dashes,
+                       int dir = 0, int type = 0)
+    {
+        int i = size_ % POLYLINE_CHUNK;
+        if (i == 0)
+            chunks_.push_back(new chunk);
+        chunk *c = chunks_.back();
+        c->x[i] = pcoord[0];
+        c->y[i] = pcoord[1];
+        c->z[i] = pcoord[2];
+        c->style[i] = (unsigned char)(color | (dashes ? POLYLINE_DASHES : 0));
+        c->dir[i] = (signed char)dir;
+        c->type[i] = (signed char)type;
+        size_++;
+    }
+    /**
+     * Remove every point
+     */
+    void clear();
+
+    /**
+     * Whether the polyline has no points
+     */
+    inline bool empty() const { return size_ == 0; }
+    /**
+     * Number of points
+     */
+    inline size_t size() const { return size_; }
+
+    /**
+     * Coordinates of the last point, the polyline must not be empty
+     */
+    inline void lastPoint(double *pcoord) const
+    {
+        const chunk *c = chunks_.back();
+        int i = (size_ - 1) % POLYLINE_CHUNK;
+        pcoord[0] = c->x[i];
+        pcoord[1] = c->y[i];
+        pcoord[2] = c->z[i];
+    }
+    /**
+     * Direction of integration at the last point
+     */
+    inline int lastDir() const
+    {
+        return chunks_.back()->dir[(size_ - 1) % POLYLINE_CHUNK];
+    }
+    /**
+     * Type of separatrice at the last point
+     */
+    inline int lastType() const
+    {
+        return chunks_.back()->type[(size_ - 1) % POLYLINE_CHUNK];
+    }
+
+    /**
+     * Number of spans, the points are traversed in order by going through
+     * getSpan(0), ..., getSpan(spans()-1)
+     */
+    inline size_t spans() const { return chunks_.size(); }
+    /**
+     * Points stored in the k-th chunk
+     */
+    inline span getSpan(size_t k) const
+    {
+        const chunk *c = chunks_[k];
+        span s;
+        s.x = c->x;
+        s.y = c->y;
+        s.z = c->z;
+        s.style = c->style;
+        s.size = (k + 1 < chunks_.size() || size_ % POLYLINE_CHUNK == 0)
+                     ? POLYLINE_CHUNK
+                     : size_ % POLYLINE_CHUNK;
+        return s;
+    }
+
+  private:
+    std::vector<chunk *> chunks_; ///< chunks of points
+    size_t size_;                 ///< number of points
+};
 
 /**
  * Linked list of orbits
  *
- * Every orbit contains two pointers to a linked list of orbit points
- * (#orbits_points)
+ * Every orbit contains the points integrated from its startpoint
+ * (#OrbitPolyline)
  */
 struct orbits {
-    double pcoord[3];         ///< startpoint
-    int color;                ///< color of the orbit
-    P4ORBIT f_orbits;         /**< linked list of orbit points (which makes
-                                   the full orbit) */
-    P4ORBIT current_f_orbits; ///< current point
+    double pcoord[3];     ///< startpoint
+    int color;            ///< color of the orbit
+    OrbitPolyline points; ///< points of the orbit
     // struct orbits *next_orbit; ///< pointer to next orbits (linked lists)
 
     /**
      * Constructor method
      */
     // orbits() : next_orbit(nullptr){};
-    orbits() : f_orbits(nullptr), current_f_orbits(nullptr){};
+    orbits(){};
 };
 
 // -----------------------------------------------------------------------
@@ -180,20 +377,20 @@ struct orbits {
  * Not a linked list because we will use a vector
  */
 struct curves {
-    P4POLYNOM2 r2;  ///< points in the plane
-    P4POLYNOM2 u1;  ///< points in U1 chart
-    P4POLYNOM2 u2;  ///< points in U2 chart
-    P4POLYNOM2 v1;  ///< points in V1 chart
-    P4POLYNOM2 v2;  ///< points in V2 chart
-    P4POLYNOM3 c;   ///< points in cylinder
-    P4ORBIT points; ///< points structure for plotting
+    P4POLYNOM2 r2;        ///< points in the plane
+    P4POLYNOM2 u1;        ///< points in U1 chart
+    P4POLYNOM2 u2;        ///< points in U2 chart
+    P4POLYNOM2 v1;        ///< points in V1 chart
+    P4POLYNOM2 v2;        ///< points in V2 chart
+    P4POLYNOM3 c;         ///< points in cylinder
+    OrbitPolyline points; ///< points for plotting
 
     /**
      * Constructor method
      */
     curves()
         : r2(nullptr), u1(nullptr), u2(nullptr), v1(nullptr), v2(nullptr),
-          c(nullptr), points(nullptr){};
+          c(nullptr){};
 };
 
 /**
@@ -203,21 +400,21 @@ struct curves {
  * struct but with a color field
  */
 struct isoclines {
-    P4POLYNOM2 r2;  ///< points in the plane
-    P4POLYNOM2 u1;  ///< points in U1 chart
-    P4POLYNOM2 u2;  ///< points in U2 chart
-    P4POLYNOM2 v1;  ///< points in V1 chart
-    P4POLYNOM2 v2;  ///< points in V2 chart
-    P4POLYNOM3 c;   ///< points in cylinder
-    P4ORBIT points; ///< points structure for plotting
-    int color;      ///< color of this isocline
+    P4POLYNOM2 r2;        ///< points in the plane
+    P4POLYNOM2 u1;        ///< points in U1 chart
+    P4POLYNOM2 u2;        ///< points in U2 chart
+    P4POLYNOM2 v1;        ///< points in V1 chart
+    P4POLYNOM2 v2;        ///< points in V2 chart
+    P4POLYNOM3 c;         ///< points in cylinder
+    OrbitPolyline points; ///< points for plotting
+    int color;            ///< color of this isocline
 
     /**
      * Constructor method
      */
     isoclines()
         : r2(nullptr), u1(nullptr), u2(nullptr), v1(nullptr), v2(nullptr),
-          c(nullptr), points(nullptr){};
+          c(nullptr), color(0){};
 };
 
 // -----------------------------------------------------------------------
@@ -270,8 +467,8 @@ struct blow_up_points {
                             than 1 */
     double point[2];       ///< end point sep in blow up chart
 
-    struct orbits_points *first_sep_point; ///< first separatrice point
-    struct orbits_points *last_sep_point;  ///< last separatrice point
+    OrbitPolyline points; ///< points of the separatrice
+    int event; ///< event that ended the separatrice (see math_events.h)
     struct blow_up_points
         *next_blow_up_point; ///< pointer to next blow up point (linked list)
 
@@ -279,32 +476,30 @@ struct blow_up_points {
      * Constructor method
      */
     blow_up_points()
-        : trans(nullptr), sep(nullptr), first_sep_point(nullptr),
-          last_sep_point(nullptr){};
+        : trans(nullptr), sep(nullptr), event(0){};
 };
 
 /**
  * Linked list of separatrices
  */
 struct sep {
-    struct orbits_points *first_sep_point; ///< first separatrice point
-    struct orbits_points *last_sep_point;  ///< last separatrice point
-    int type;                              /**< possible values:
-                                               STYPE_STABLE, UNSTABLE,
-                                               CENSTABLE or CENUNSTABLE */
+    OrbitPolyline points; ///< points of the separatrice
+    int type;             /**< possible values:
+                              STYPE_STABLE, UNSTABLE,
+                              CENSTABLE or CENUNSTABLE */
     int direction;  ///< gives the direction of the separatrice
     int d;          ///< flag for @c separatrice
     bool notadummy; /**< false if separatrice is a copy of a structure (obtained
                      through a symmetry) */
     struct term1 *separatrice; ///< if d=0 -> (t,f(t)), d=1 ->(f(t),t)
-    struct sep *next_sep;      ///< pointer to next separatrice (linked list)
+    int event; ///< event that ended the separatrice (see math_events.h)
+    struct sep *next_sep; ///< pointer to next separatrice (linked list)
 
     /**
      * Constructor method
      */
     sep()
-        : first_sep_point(nullptr), last_sep_point(nullptr),
-          separatrice(nullptr), next_sep(nullptr){};
+        : separatrice(nullptr), event(0), next_sep(nullptr){};
 };
 
 // -----------------------------------------------------------------------
@@ -475,6 +670,56 @@ struct weak_focus {
 #define CHART_U2 2 ///< U2 chart (Poincaré sphere)
 #define CHART_V1 3 ///< V1 chart (Poincaré sphere)
 #define CHART_V2 4 ///< V2 chart (Poincaré sphere)
+#define CHART_CYL 5 ///< cylinder chart (Poincaré-Lyapunov sphere)
+#define CHART_NONE (-1) ///< no chart (see #chart_state)
+
+/**
+ * Whether an orbit is in a stiff region, where explicit integration steps
+ * are limited by stability instead of accuracy (see stiff_step())
+ */
+struct stiff_state {
+    bool stiff; ///< the orbit is integrated with rosenbrock_step()
+    int steps;  ///< consecutive steps that suggest switching integrator
+
+    /**
+     * Constructor method
+     */
+    stiff_state() : stiff(false), steps(0){};
+};
+
+/**
+ * Chart where an orbit is being integrated
+ *
+ * Holds the last point of an orbit in the coordinates of the chart where
+ * it takes its next step, so that consecutive steps in the same chart do
+ * not go back and forth through the sphere. It must be reset to
+ * CHART_NONE whenever the orbit starts from a different point. The end of
+ * every step is still mapped to the sphere, because it is a point of the
+ * orbit that is stored and drawn; only the way back into the chart is
+ * saved.
+ *
+ * It also keeps the last step, so that points inside the step can be
+ * interpolated (see WVFStudy::chart_step_point).
+ */
+struct chart_state {
+    int chart;   ///< chart of #y, or CHART_NONE
+    double y[2]; ///< last point of the orbit in chart coordinates
+
+    int stepchart; ///< chart of the last step, or CHART_NONE
+    double y0[2];  ///< point before the last step
+    double f0[2];  ///< vector field at #y0
+    double y1[2];  ///< point after the last step
+    double f1[2];  ///< vector field at #y1, if #hasf1
+    bool hasf1;    ///< #f1 has been evaluated
+    double h;      ///< size of the last step
+
+    stiff_state stiff; ///< integrator used for the orbit
+
+    /**
+     * Constructor method
+     */
+    chart_state() : chart(CHART_NONE), stepchart(CHART_NONE){};
+};
 
 #define SADDLE 1          ///< saddle identifier
 #define NODE 2            ///< node identifier
@@ -538,6 +783,17 @@ class WVFStudy
      * Destructor method
      */
     ~WVFStudy();
+    /**
+     * Read the default integrator from the configuration file
+     *
+     * Reads the properties @c integrator (@c rk78 or @c taylor) and
+     * @c taylor-order of wt_config.xml, leaving the arguments untouched
+     * when they are not set or not valid.
+     *
+     * @param integrator INTEGRATOR_RK78 or INTEGRATOR_TAYLOR
+     * @param order      order of the Taylor integrator, 0 for automatic
+     */
+    static void readIntegratorConfig(int &integrator, int &order);
 
     // general information
 
@@ -573,6 +829,13 @@ class WVFStudy
     P4POLYNOM2 vec_field_V2_[2]; ///< vectori field in V2
     P4POLYNOM3 vec_field_C_[2];  ///< vectori field in C
 
+    flatfield f_vec_field_fused_;  ///< gcf_ and f_vec_field_ for evaluation
+    flatfield vec_field_U1_fused_; ///< gcf_U1_ and vec_field_U1_ fused
+    flatfield vec_field_U2_fused_; ///< gcf_U2_ and vec_field_U2_ fused
+    flatfield vec_field_V1_fused_; ///< gcf_V1_ and vec_field_V1_ fused
+    flatfield vec_field_V2_fused_; ///< gcf_V2_ and vec_field_V2_ fused
+    flatfield vec_field_C_fused_;  ///< gcf_C_ and vec_field_C_ fused
+
     // singular points and their properties:
 
     saddle *first_saddle_point_;      ///< linked list of saddles
@@ -590,20 +853,20 @@ class WVFStudy
     P4POLYNOM2 gcf_V1_;             ///< gcf in chart V1
     P4POLYNOM2 gcf_V2_;             ///< gcf in chart V2
     P4POLYNOM3 gcf_C_;              ///< gcf in C
-    orbits_points *gcf_points_;     ///< orbits points of the gcf
-    orbits_points *last_gcf_point_; ///< last gcf point
+    flatpoly gcf_flat_;             ///< gcf_ for evaluation
+    flatpoly gcf_U1_flat_;          ///< gcf_U1_ for evaluation
+    flatpoly gcf_U2_flat_;          ///< gcf_U2_ for evaluation
+    flatpoly gcf_V1_flat_;          ///< gcf_V1_ for evaluation
+    flatpoly gcf_V2_flat_;          ///< gcf_V2_ for evaluation
+    flatpoly gcf_C_flat_;           ///< gcf_C_ for evaluation
+    OrbitPolyline gcf_points_;      ///< orbits points of the gcf
 
     std::vector<curves> curve_vector_;       ///< curves vector
-    P4ORBIT last_curves_point_;              ///< last curves points
     std::vector<isoclines> isocline_vector_; ///< isoclines vector
-    P4ORBIT last_isoclines_point_;           ///< last isoclines points
 
     std::vector<orbits> orbit_vector_; ///< orbits vector
 
-    // limit cycles
-
-    //orbits *first_lim_cycle_; ///< linked list of limit cycles
-    //orbits *current_lim_cycle_; ///< current limit cycle for plotting
+    std::vector<orbits> limit_cycle_vector_; ///< limit cycles vector
 
     // ------ Configuration
 
@@ -618,6 +881,8 @@ class WVFStudy
     int config_lc_numpoints_;   ///< number of points in the limit cycle window
     bool config_dashes_;        ///< line style (dashes or points)
     bool config_kindvf_;        ///< true for original VF, false for reduced
+    int config_integrator_;     ///< INTEGRATOR_RK78 or INTEGRATOR_TAYLOR
+    int config_taylor_order_;   ///< Taylor order, 0 to choose from tolerance
 
     // run-time when plotting
 
@@ -683,7 +948,7 @@ class WVFStudy
      */
     void (WVFStudy::*integrate_sphere_sep)(double, double, double, double *,
                                            double *, int *, int *, int *, int *,
-                                           double, double);
+                                           double, double, chart_state *);
     /**
      * U1 chart coordinates to sphere coordinates
      *
@@ -774,7 +1039,7 @@ class WVFStudy
      */
     void (WVFStudy::*integrate_sphere_orbit)(double, double, double, double *,
                                              double *, int *, int *, double,
-                                             double);
+                                             double, chart_state *);
     /**
      * Evaluate a limit cycle in the current sphere
      *
@@ -931,22 +1196,6 @@ class WVFStudy
      * This function is called by deleteVF()
      */
     //void deleteLimitCycle(orbits *o);
-    /**
-     * Delete the orbits points linked list
-     *
-     * @param p linked list of orbits points to delete
-     *
-     * This function is called by deleteVF(). It works recursively, deleting
-     * from bottom to top
-     */
-    inline void deleteOrbitPoint(P4ORBIT p)
-    {
-        if (p == nullptr)
-            return;
-        deleteOrbitPoint(p->next_point);
-        delete p;
-        p = nullptr;
-    }
     /*
      * Delete the orbits linked list
      *
@@ -1332,28 +1581,55 @@ class WVFStudy
      */
     void set_current_step(double curstep);
     // -----------------------------------------------------------------------
-    //                      INTEGRATE BLOWUP FUNCTIONS
-    // -----------------------------------------------------------------------
-    /**
-     * Evaluate blowup vector field
-     * @param y point to evaluate
-     * @param f vector for storing the result
-     */
-    void eval_blow_vec_field(double *y, double *f);
-    // -----------------------------------------------------------------------
     //                      NUMERIC FUNCTIONS
     // -----------------------------------------------------------------------
     /**
      * Runge-Kutta order 7/8 numeric integration
-     * @param deriv function to integrate, takes a member function of WVFStudy
-     * @param y     integration limits
-     * @param hh    initial step size
-     * @param hmi   minimum step size
-     * @param hma   maximum step size
-     * @param e1    epsilon
-     */
-    void rk78(void (WVFStudy::*deriv)(double *, double *), double y[2],
-              double *hh, double hmi, double hma, double e1);
+     * @tparam deriv function to integrate, a member function of WVFStudy
+     * @param  y     integration limits
+     * @param  hh    initial step size
+     * @param  hmi   minimum step size
+     * @param  hma   maximum step size
+     * @param  e1    epsilon
+     * @param  f0    if not null, receives the vector field at the point
+     *               before the step
+     * @return       size of the step that was taken
+     *
+     * Defined in math_numerics.h
+     */
+    template <void (WVFStudy::*deriv)(double *, double *)>
+    double rk78(double y[2], double *hh, double hmi, double hma, double e1,
+                double *f0 = nullptr);
+    /**
+     * One integration step of several orbits
+     * @param n      number of orbits
+     * @param pcoord point of each orbit (3 coordinates each), replaced by
+     *               the point after the step
+     * @param hhi    step size of each orbit, updated
+     * @param dashes @c false for orbits that jumped across the line of
+     *               singularities at infinity
+     * @param dir    -1 for orbits whose direction changed, 1 otherwise
+     * @param h_min  minimum step size
+     * @param h_max  maximum step size
+     *
+     * Same as calling #integrate_sphere_orbit for each orbit, but the
+     * orbits that are in the same chart take their step together with
+     * rk78_batch(). Defined in math_orbits.cc
+     */
+    void integrate_orbits(int n, double *pcoord, double *hhi, int *dashes,
+                          int *dir, double h_min, double h_max);
+    /**
+     * Point inside the last integration step of an orbit
+     *
+     * @param cs     chart state of the orbit
+     * @param theta  fraction of the step, between 0 and 1
+     * @param pcoord interpolated point on the sphere
+     * @return       @c false if the last step cannot be interpolated (it
+     * crossed the line of singularities at infinity)
+     *
+     * Defined in math_orbits.cc
+     */
+    bool chart_step_point(chart_state *cs, double theta, double *pcoord);
     // -----------------------------------------------------------------------
     //                      math_gcf.cc FUNCTIONS
     // -----------------------------------------------------------------------
@@ -1367,27 +1643,27 @@ class WVFStudy
      */
     void rplane_plsphere0(double x, double y, double *pcoord);
     /**
-     * Insert new point in GCF linked list
+     * Append a new point to the GCF
      * @param x0     1st coordinate
      * @param y0     2nd coordinate
      * @param z0     3rd coordinate
-     * @param dashes dashes for @c orbits_points struct
+     * @param dashes whether the point is joined to the previous one
      */
     void insert_gcf_point(double x0, double y0, double z0, int dashes);
     /**
-     * Insert new point in curve linked list
+     * Append a new point to the last curve
      * @param x0     1st coordinate
      * @param y0     2nd coordinate
      * @param z0     3rd coordinate
-     * @param dashes dashes for @c orbits_points struct
+     * @param dashes whether the point is joined to the previous one
      */
     void insert_curve_point(double x0, double y0, double z0, int dashes);
     /**
-     * Insert new point in isocline linked list
+     * Append a new point to the last isocline
      * @param x0     1st coordinate
      * @param y0     2nd coordinate
      * @param z0     3rd coordinate
-     * @param dashes dashes for @c orbits_points struct
+     * @param dashes whether the point is joined to the previous one
      */
     void insert_isocline_point(double x0, double y0, double z0, int dashes);
 
@@ -1421,6 +1697,18 @@ class WVFStudy
     //                          R2_TO_PLSPHERE
     // -----------------------------------------------------------------------
     void R2_to_plsphere(double x, double y, double *pcoord);
+    /**
+     * Change of real coordinates to Poincare-Lyapunov sphere at several
+     * points
+     * @param n      number of points
+     * @param x      x coordinate of each point
+     * @param y      y coordinate of each point
+     * @param pcoord result, three coordinates for each point
+     *
+     * The result is the same as calling R2_to_plsphere() at each point.
+     */
+    void R2_to_plsphere_batch(int n, const double *x, const double *y,
+                              double *pcoord);
     // -----------------------------------------------------------------------
     //                          plsphere_to_R2
     // -----------------------------------------------------------------------
@@ -1478,43 +1766,99 @@ class WVFStudy
     void U2_to_cylinder(double u, double s, double *c);
     void V1_to_cylinder(double u, double s, double *c);
     void V2_to_cylinder(double u, double s, double *c);
-    double func_U1(double x);
-    double dfunc_U1(double x);
-    double func_U1_s0(double theta);
-    double dfunc_U1_s0(double theta);
-    double func_U2(double x);
-    double dfunc_U2(double x);
-    double func_U2_s0(double theta);
-    double dfunc_U2_s0(double theta);
-    double func(double z);
-    double dfunc(double z);
+    /**
+     * Root in (0,1] of a*z^p+b*z^q=1, for a,b>=0 and a+b>=1
+     * @param  a coefficient of z^p
+     * @param  b coefficient of z^q
+     * @return   root z
+     */
+    double pl_root(double a, double b);
+    /**
+     * Roots of pl_root() for several equations
+     * @param n number of equations
+     * @param a coefficient of z^p of each equation
+     * @param b coefficient of z^q of each equation
+     * @param z root of each equation
+     */
+    void pl_roots(int n, const double *a, const double *b, double *z);
+    // the parameter of the equations is passed in par so that root solves
+    // on different threads do not share any state
+    double func_U1_s0(double theta, const double *par);
+    double dfunc_U1_s0(double theta, const double *par);
+    double func_U2_s0(double theta, const double *par);
+    double dfunc_U2_s0(double theta, const double *par);
     // -----------------------------------------------------------------------
     //                      NUMERIC FUNCTIONS
     // -----------------------------------------------------------------------
-    void bisection(double (WVFStudy::*f)(double), double *x, double e);
-    double regula_falsi(double (WVFStudy::*f)(double), double *x, double e);
-    double newton(double (WVFStudy::*f)(double), double (WVFStudy::*df)(double),
-                  double x, double e);
-    double find_root(double (WVFStudy::*f)(double),
-                     double (WVFStudy::*df)(double), double *value);
+    typedef double (WVFStudy::*rootfunc)(double, const double *);
+    void bisection(rootfunc f, double *x, double e, const double *par);
+    double regula_falsi(rootfunc f, double *x, double e, const double *par);
+    double newton(rootfunc f, rootfunc df, double x, double e,
+                  const double *par);
+    double find_root(rootfunc f, rootfunc df, double *value,
+                     const double *par);
     // -----------------------------------------------------------------------
     //                      SEPARATRICE INTEGRATION FUNCTIONS
     // -----------------------------------------------------------------------
     void integrate_poincare_sep(double p0, double p1, double p2, double *pcoord,
                                 double *hhi, int *type, int *color, int *dashes,
-                                int *dir, double h_min, double h_max);
+                                int *dir, double h_min, double h_max,
+                                chart_state *cs);
     void integrate_lyapunov_sep(double p0, double p1, double p2, double *pcoord,
                                 double *hhi, int *type, int *color, int *dashes,
-                                int *dir, double h_min, double h_max);
+                                int *dir, double h_min, double h_max,
+                                chart_state *cs);
     // -----------------------------------------------------------------------
     //                      ORBIT INTEGRATION FUNCTIONS
     // -----------------------------------------------------------------------
     void integrate_poincare_orbit(double p0, double p1, double p2,
                                   double *pcoord, double *hhi, int *dashes,
-                                  int *dir, double h_min, double h_max);
+                                  int *dir, double h_min, double h_max,
+                                  chart_state *cs);
     void integrate_lyapunov_orbit(double p0, double p1, double p2,
                                   double *pcoord, double *hhi, int *dashes,
-                                  int *dir, double h_min, double h_max);
+                                  int *dir, double h_min, double h_max,
+                                  chart_state *cs);
+    // chart of the Poincaré sphere where the integrators take a step from
+    // (p0,p1,p2)
+    int poincare_chart(double p0, double p1, double p2);
+    // (p0,p1,p2) in the coordinates of a chart of the Poincaré sphere
+    void psphere_to_chart(int chart, double p0, double p1, double p2,
+                          double *y);
+    // take a step from (p0,p1,p2) on the Poincaré sphere, the point after
+    // the step is left in cs
+    void poincare_chart_step(double p0, double p1, double p2, double *hhi,
+                             double h_min, double h_max, chart_state *cs);
+    // point of cs on the Poincaré sphere, returns false if the orbit crossed
+    // the line of singularities at infinity (cs is then moved to the
+    // opposite chart)
+    bool poincare_chart_to_psphere(chart_state *cs, double *pcoord);
+    // take a step from (p0,p1,p2) on the Poincaré-Lyapunov sphere, the point
+    // after the step is left in cs
+    void lyapunov_chart_step(double p0, double p1, double p2, double *hhi,
+                             double h_min, double h_max, chart_state *cs);
+    // vector field of a chart at y
+    void eval_chart_vec_field(int chart, double *y, double *f);
+    // flattened vector field of a chart, timesy tells whether it has to be
+    // multiplied by y
+    const flatfield *chart_field(int chart, bool *timesy);
+    // Taylor series step of the vector field of a chart, with the same
+    // arguments as rk78 (see math_taylor.h)
+    double taylor(int chart, double y[2], double *hh, double hmi, double hma,
+                  double *f0);
+    // step of the vector field of a chart with the integrator selected by
+    // config_integrator_
+    double explicit_chart_step(int chart, double y[2], double *hh,
+                               double hmi, double hma, double *f0);
+    // step of the vector field of a chart, which switches to a Rosenbrock
+    // method while the orbit is stiff (see stiff_step)
+    double chart_step(int chart, double y[2], double *hh, double hmi,
+                      double hma, double *f0, stiff_state *ss);
+    // point y of a chart on the current sphere
+    void chart_to_sphere(int chart, const double *y, double *pcoord);
+    // keep the step from y0 to cs->y for chart_step_point
+    void record_chart_step(chart_state *cs, const double *y0,
+                           const double *f0, double h);
     // -----------------------------------------------------------------------
     //                      math_p4.cc FUNCTIONS
     // -----------------------------------------------------------------------
@@ -1531,7 +1875,6 @@ class WVFStudy
     //                      COPY FUNCTIONS
     // -----------------------------------------------------------------------
     orbits *copy_orbits(orbits *p);
-    P4ORBIT copy_orbits_points(P4ORBIT p);
     P4POLYNOM1 copy_term1(P4POLYNOM1 p);
     P4POLYNOM2 copy_term2(P4POLYNOM2 p);
     P4POLYNOM3 copy_term3(P4POLYNOM3 p);
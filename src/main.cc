@@ -49,11 +49,15 @@
  * C++ code.
  */
 
+#include "MapleStatsResource.h"
 #include "MyApplication.h"
 #include "Session.h"
+#include "ThreadPool.h"
 
 #include <Wt/WServer>
 
+#include <string>
+
 using namespace Wt;
 
 WApplication *createApplication(const WEnvironment &env)
@@ -72,8 +76,16 @@ int main(int argc, char **argv)
         server.addEntryPoint(Wt::Application, createApplication, std::string(),
                              "favicon.ico");
 #endif
+        // queue metrics of the Maple job scheduler, only published when
+        // the deployment asks for them since they are not authenticated
+        std::string stats;
+        if (server.readConfigurationProperty("maple-stats", stats) &&
+            stats == "true")
+            server.addResource(new MapleStatsResource(), "/maple-stats");
         Session::configureAuth();
         server.run();
+        // the sessions are gone, background jobs can no longer post to them
+        g_threadPool.stop();
 
     } catch (Wt::WServer::Exception &e) {
         std::cerr << e.what() << std::endl;
@@ -58,7 +58,7 @@ int WVFStudy::change_dir_poincare(double p[3])
         // finite point
 
         psphere_to_R2(p[0], p[1], p[2], y);
-        if (eval_term2(gcf_, y) >= 0)
+        if (eval_flat2(gcf_flat_, y) >= 0)
             return 0;
         else
             return 1;
@@ -69,13 +69,13 @@ int WVFStudy::change_dir_poincare(double p[3])
     if ((theta < PI_DIV4) && (theta > -PI_DIV4)) {
         if (p[0] > 0) {
             psphere_to_U1(p[0], p[1], p[2], y);
-            if (eval_term2(gcf_U1_, y) >= 0)
+            if (eval_flat2(gcf_U1_flat_, y) >= 0)
                 return 0;
             else
                 return 1;
         } else {
             psphere_to_V1(p[0], p[1], p[2], y);
-            if (eval_term2(gcf_V1_, y) >= 0)
+            if (eval_flat2(gcf_V1_flat_, y) >= 0)
                 return 0;
             else
                 return 1;
@@ -83,13 +83,13 @@ int WVFStudy::change_dir_poincare(double p[3])
     } else {
         if (p[1] > 0) {
             psphere_to_U2(p[0], p[1], p[2], y);
-            if (eval_term2(gcf_U2_, y) >= 0)
+            if (eval_flat2(gcf_U2_flat_, y) >= 0)
                 return 0;
             else
                 return 1;
         } else {
             psphere_to_V2(p[0], p[1], p[2], y);
-            if (eval_term2(gcf_V2_, y) >= 0)
+            if (eval_flat2(gcf_V2_flat_, y) >= 0)
                 return 0;
             else
                 return 1;
@@ -108,14 +108,14 @@ int WVFStudy::change_dir_lyapunov(double p[3])
     if (p[0] == 0) {
         y[0] = p[1];
         y[1] = p[2];
-        if (eval_term2(gcf_, y) >= 0)
+        if (eval_flat2(gcf_flat_, y) >= 0)
             return 0;
         else
             return 1;
     } else {
         y[0] = p[1];
         y[1] = p[2];
-        if (eval_term3(gcf_C_, y) >= 0)
+        if (eval_flat3(gcf_C_flat_, y) >= 0)
             return 0;
         else
             return 1;
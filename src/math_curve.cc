@@ -26,34 +26,35 @@
 #include "plot_tools.h"
 
 #include <cmath>
-
-// static global variables
-static int s_CurveDashes = 1;
+#include <functional>
 
 // function definitions
 bool WSphere::evalCurveStart(std::string fname, int dashes, int points,
-                             int precis)
+                             int precis, std::function<void(bool)> done)
 {
-    if (study_->plweights_)
+    int last;
+    if (study_->plweights_) {
         curveTask_ = EVAL_CURVE_LYP_R2;
-    else
+        last = EVAL_CURVE_FINISHLYAPUNOV;
+    } else {
         curveTask_ = EVAL_CURVE_R2;
+        last = EVAL_CURVE_FINISHPOINCARE;
+    }
 
     curveError_ = false;
-    s_CurveDashes = dashes;
-    if (runTaskCurve(fname, curveTask_, points, precis) < 0)
-        return false;
-    return true;
+    curveDashes_ = dashes;
+    return runTasks(fname, curveTask_, last, points, precis,
+                    &WSphere::prepareTaskCurve, done);
 }
 
 // returns true when finished.  Then run EvalGCfFinish to see if error occurred
 // or not
-bool WSphere::evalCurveContinue(std::string fname, int points, int prec)
+bool WSphere::evalCurveContinue(std::string fname)
 {
     if (curveTask_ == EVAL_CURVE_NONE)
         return true;
 
-    if (!readTaskCurveResults(fname, curveTask_)) {
+    if (!readTaskCurveResults(taskFileName(fname, curveTask_), curveTask_)) {
         curveError_ = true;
         g_globalLogger.error("[WSphere] error at curve readTaskCurveResults");
         return true;
@@ -64,12 +65,6 @@ bool WSphere::evalCurveContinue(std::string fname, int points, int prec)
         return true;
     }
 
-    if (runTaskCurve(fname, curveTask_, points, prec) < 0) {
-        curveError_ = true;
-        g_globalLogger.error("[WSphere] error at curve runTaskCurve");
-        return true;
-    }
-
     return false; // still busy
 }
 
@@ -85,11 +80,54 @@ bool WSphere::evalCurveFinish(void) // return false in case an error occured
     return true;
 }
 
-int WSphere::runTaskCurve(std::string fname, int task, int points, int prec)
+void WSphere::computeCurve(std::function<void(bool)> done)
+{
+    if (curveTask_ != EVAL_CURVE_NONE) {
+        g_globalLogger.error("[WSphere] previous evaluation still running");
+        done(false);
+        return;
+    }
+    if (nativeCurves()) {
+        const curves &last = study_->curve_vector_.back();
+        traceTasks(curveNPoints_, curvePrec_, last.r2, last.u1, last.u2,
+                   last.c, &WVFStudy::insert_curve_point, curveDashes_);
+        g_globalLogger.debug("[WSphere] traced curve");
+        done(true);
+        return;
+    }
+    bool started = evalCurveStart(
+        curveFname_, curveDashes_, curveNPoints_, curvePrec_,
+        [this, done](bool ok) {
+            if (!ok) {
+                curveError_ = true;
+                g_globalLogger.error("[WSphere] error running curve tasks");
+            }
+            // read the charts in order, stop at the first error
+            int i = 0;
+            while (!curveError_ && !evalCurveContinue(curveFname_))
+                i++;
+            if (curveError_)
+                g_globalLogger.error("[WSphere] error while computing "
+                                     "evalCurveContinue at step: " +
+                                     std::to_string(i));
+            bool result = evalCurveFinish();
+            if (result)
+                g_globalLogger.debug("[WSphere] computed curve");
+            done(result);
+        });
+    if (!started) {
+        g_globalLogger.error("[WSphere] cannot evaluate curve");
+        curveTask_ = EVAL_CURVE_NONE;
+        done(false);
+    }
+}
+
+bool WSphere::prepareTaskCurve(std::string fname, int task, int points,
+                               int prec)
 {
     bool value;
 
-    g_globalLogger.debug("[WSphere] will run curve task=" +
+    g_globalLogger.debug("[WSphere] will prepare curve task=" +
                          std::to_string(task) + " using file=" + fname);
     // TODO: prepareCurve functions
     switch (task) {
@@ -142,10 +180,7 @@ int WSphere::runTaskCurve(std::string fname, int task, int points, int prec)
         break;
     }
 
-    if (value)
-        return scriptHandler_->evaluateMapleScript(fname, 60).si_status;
-    else
-        return -1;
+    return value;
 }
 
 bool WSphere::readTaskCurveResults(std::string fname, int task)
@@ -192,38 +227,28 @@ bool WSphere::readTaskCurveResults(std::string fname, int task)
     return value;
 }
 
-void WSphere::draw_curve(orbits_points *sep, int color, int dashes)
+void WSphere::draw_curve(const OrbitPolyline &sep, int color, int dashes)
 {
-    double pcoord[3];
-
-    while (sep != nullptr) {
-        if (sep->dashes && dashes)
-            (*plot_l)(this, pcoord, sep->pcoord, color);
-        else
-            (*plot_p)(this, sep->pcoord, color);
-        copy_x_into_y(sep->pcoord, pcoord);
+    double pcoord[3], point[3];
 
-        sep = sep->next_point;
+    for (size_t k = 0; k < sep.spans(); k++) {
+        OrbitPolyline::span s = sep.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, point);
+            if (s.dashes(i) && dashes)
+                (*plot_l)(this, pcoord, point, color);
+            else
+                (*plot_p)(this, point, color);
+            copy_x_into_y(point, pcoord);
+        }
     }
 }
 
 void WVFStudy::insert_curve_point(double x0, double y0, double z0, int dashes)
 {
-    if (curve_vector_.back().points != nullptr) {
-        last_curves_point_->next_point = new orbits_points;
-        last_curves_point_ = last_curves_point_->next_point;
-    } else {
-        last_curves_point_ = new orbits_points;
-        curve_vector_.back().points = last_curves_point_;
-    }
-
-    last_curves_point_->pcoord[0] = x0;
-    last_curves_point_->pcoord[1] = y0;
-    last_curves_point_->pcoord[2] = z0;
+    double pcoord[3] = {x0, y0, z0};
 
-    last_curves_point_->dashes = dashes;
-    last_curves_point_->color = CCURV;
-    last_curves_point_->next_point = nullptr;
+    curve_vector_.back().points.append(pcoord, CCURV, dashes);
 }
 
 bool WSphere::read_curve(std::string fname,
@@ -251,7 +276,7 @@ bool WSphere::read_curve(std::string fname,
             (study_->*chart)(x, y, pcoord);
             study_->insert_curve_point(pcoord[0], pcoord[1], pcoord[2], d);
             // d=1;
-            d = s_CurveDashes;
+            d = curveDashes_;
         }
         for (c = getc(fp); isspace(c);)
             c = getc(fp);
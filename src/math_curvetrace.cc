@@ -0,0 +1,590 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "math_curvetrace.h"
+
+#include "file_tab.h"
+#include "math_polynom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define TRACE_MIN_POINTS 4    // minimum number of cells in each direction
+#define TRACE_MAX_POINTS 4096 // maximum number of cells in each direction
+#define TRACE_COARSE 8        // minimum number of blocks of the quadtree
+#define TRACE_ITERATIONS 60   // iterations of the Illinois method on a side
+#define TRACE_NEWTON 8        // iterations of Newton's method
+#define TRACE_BENDS 4         // levels of points added inside a cell
+// distance in cells from a segment to the curve above which a point is added
+// between its ends
+#define TRACE_BEND 1e-3
+// steps in cells of the divided differences of the gradient and hessian
+#define TRACE_DIFF 1e-4
+#define TRACE_HESSIAN 1e-2
+// value at a critical point, relative to the values at the corners of its
+// cell, below which it is taken as a crossing of two branches of the curve
+#define TRACE_SINGULAR 1e-6
+// distance in cells from a segment to the curve above which a segment next
+// to a singular point goes through it
+#define TRACE_DETOUR 0.1
+// rounding error of the bound of the polynomial in a block, relative to the
+// size of its terms
+#define TRACE_ROUNDING 1e-10
+#define TRACE_SPLIT 4 // cells of the largest block split without a bound
+
+// closed interval of values
+struct interval {
+    double lo, hi;
+};
+
+// state of the tracing of one polynomial in one rectangle
+struct tracer {
+    const flatpoly *f;
+    int coords;
+    int n; // cells in each direction
+    double x1, x2, y1, y2;
+    double hx, hy; // size of a cell
+    double tol;    // tolerance in cells
+    std::unordered_map<long long, double> nodes; // values at the grid nodes
+    std::unordered_map<long long, int> ids; // points on sides and crossings
+    std::vector<double> pts;                // coordinates of the points
+    std::vector<int> segs;                  // ends of the segments
+    std::deque<int> queue;                  // cells to be marched
+    std::unordered_set<int> queued;
+};
+
+static double eval_point(const tracer &t, double x, double y)
+{
+    double v[2];
+
+    if (t.coords == TRACE_POLAR) {
+        v[0] = x * cos(y);
+        v[1] = x * sin(y);
+    } else {
+        v[0] = x;
+        v[1] = y;
+    }
+    if (t.coords == TRACE_CYLINDER)
+        return eval_flat3(*t.f, v);
+    return eval_flat2(*t.f, v);
+}
+
+static double node_x(const tracer &t, int i)
+{
+    return (i == t.n) ? t.x2 : t.x1 + i * t.hx;
+}
+
+static double node_y(const tracer &t, int j)
+{
+    return (j == t.n) ? t.y2 : t.y1 + j * t.hy;
+}
+
+static long long node_key(const tracer &t, int i, int j)
+{
+    return (long long)j * (t.n + 1) + i;
+}
+
+static double node_value(tracer &t, int i, int j)
+{
+    long long key = node_key(t, i, j);
+    std::unordered_map<long long, double>::const_iterator it =
+        t.nodes.find(key);
+
+    if (it != t.nodes.end())
+        return it->second;
+    double v = eval_point(t, node_x(t, i), node_y(t, j));
+    t.nodes[key] = v;
+    return v;
+}
+
+// gradient by central differences, scaled to the size of a cell
+static void gradient(const tracer &t, double x, double y, double h,
+                     double *g)
+{
+    double dx = h * t.hx, dy = h * t.hy;
+
+    g[0] = (eval_point(t, x + dx, y) - eval_point(t, x - dx, y)) / (2 * h);
+    g[1] = (eval_point(t, x, y + dy) - eval_point(t, x, y - dy)) / (2 * h);
+}
+
+static int add_point(tracer &t, long long id, double x, double y)
+{
+    int k = (int)t.pts.size() / 2;
+
+    t.ids[id] = k;
+    t.pts.push_back(x);
+    t.pts.push_back(y);
+    return k;
+}
+
+// point where the curve crosses the side between the nodes a and b, which
+// is only computed once for the two cells that share the side
+static int side_point(tracer &t, long long id, int ia, int ja, int ib,
+                      int jb)
+{
+    std::unordered_map<long long, int>::const_iterator it = t.ids.find(id);
+    if (it != t.ids.end())
+        return it->second;
+
+    double xa = node_x(t, ia), ya = node_y(t, ja);
+    double dx = node_x(t, ib) - xa, dy = node_y(t, jb) - ya;
+    double fa = node_value(t, ia, ja), fb = node_value(t, ib, jb);
+    double a = 0, b = 1, s = 0, fs;
+    int last = 0;
+
+    for (int k = 0; k < TRACE_ITERATIONS && b - a > t.tol; k++) {
+        s = b - fb * (b - a) / (fb - fa);
+        fs = eval_point(t, xa + s * dx, ya + s * dy);
+        if (fs == 0)
+            break;
+        if ((fs < 0) == (fb < 0)) {
+            b = s;
+            fb = fs;
+            if (last == -1)
+                fa /= 2;
+            last = -1;
+        } else {
+            a = s;
+            fa = fs;
+            if (last == 1)
+                fb /= 2;
+            last = 1;
+        }
+    }
+    return add_point(t, id, xa + s * dx, ya + s * dy);
+}
+
+// move p onto the curve with Newton's method, false if it goes farther than
+// maxdist cells or the gradient vanishes
+static bool project(const tracer &t, double *p, double maxdist)
+{
+    double x = p[0], y = p[1], v, g[2], g2, dx, dy;
+
+    for (int k = 0; k < TRACE_NEWTON; k++) {
+        v = eval_point(t, x, y);
+        gradient(t, x, y, TRACE_DIFF, g);
+        g2 = g[0] * g[0] + g[1] * g[1];
+        if (!(g2 > 0))
+            return false;
+        dx = v * g[0] / g2;
+        dy = v * g[1] / g2;
+        x -= dx * t.hx;
+        y -= dy * t.hy;
+        if (hypot((x - p[0]) / t.hx, (y - p[1]) / t.hy) > maxdist)
+            return false;
+        if (fabs(dx) + fabs(dy) < t.tol)
+            break;
+    }
+    p[0] = x;
+    p[1] = y;
+    return true;
+}
+
+// singular point of the curve near cell (i,j), where its branches cross,
+// found as a critical point of the polynomial where it vanishes; -1 if there
+// is none in the cell or the cells around it
+static int singular_point(tracer &t, int i, int j, const double *f)
+{
+    double x0 = node_x(t, std::max(i - 1, 0));
+    double x1 = node_x(t, std::min(i + 2, t.n));
+    double y0 = node_y(t, std::max(j - 1, 0));
+    double y1 = node_y(t, std::min(j + 2, t.n));
+    double x = node_x(t, i) + t.hx / 2, y = node_y(t, j) + t.hy / 2;
+    double g[2], gx[2], gy[2], a, b, c, d, det, dx, dy, fmax = 0;
+    double h = TRACE_HESSIAN;
+    int k;
+
+    for (k = 0; k < 4; k++)
+        fmax = std::max(fmax, fabs(f[k]));
+    for (k = 0; k < TRACE_NEWTON; k++) {
+        gradient(t, x, y, TRACE_DIFF, g);
+        gradient(t, x + h * t.hx, y, TRACE_DIFF, gx);
+        gradient(t, x, y + h * t.hy, TRACE_DIFF, gy);
+        a = (gx[0] - g[0]) / h;
+        b = (gy[0] - g[0]) / h;
+        c = (gx[1] - g[1]) / h;
+        d = (gy[1] - g[1]) / h;
+        det = a * d - b * c;
+        if (det == 0)
+            return -1;
+        dx = (b * g[1] - d * g[0]) / det;
+        dy = (c * g[0] - a * g[1]) / det;
+        x += dx * t.hx;
+        y += dy * t.hy;
+        if (x < x0 || x > x1 || y < y0 || y > y1)
+            return -1;
+        if (fabs(dx) + fabs(dy) < t.tol)
+            break;
+    }
+    if (fabs(eval_point(t, x, y)) > TRACE_SINGULAR * fmax)
+        return -1;
+
+    // the cells around it find it again, the first point found is kept
+    i = std::min((int)((x - t.x1) / t.hx), t.n - 1);
+    j = std::min((int)((y - t.y1) / t.hy), t.n - 1);
+    long long id = -1 - ((long long)j * t.n + i);
+    std::unordered_map<long long, int>::const_iterator it = t.ids.find(id);
+    if (it != t.ids.end())
+        return it->second;
+    return add_point(t, id, x, y);
+}
+
+static void add_segment(tracer &t, int a, int b)
+{
+    t.segs.push_back(a);
+    t.segs.push_back(b);
+}
+
+static void queue_cell(tracer &t, int i, int j)
+{
+    if (i < 0 || j < 0 || i >= t.n || j >= t.n)
+        return;
+    if (t.queued.insert(j * t.n + i).second)
+        t.queue.push_back(j * t.n + i);
+}
+
+// true if the curve between the points a and b is too far from the segment
+// that joins them
+static bool detour(const tracer &t, int a, int b)
+{
+    const double *pa = &t.pts[2 * a], *pb = &t.pts[2 * b];
+    double c[2], m[2], len;
+
+    c[0] = m[0] = (pa[0] + pb[0]) / 2;
+    c[1] = m[1] = (pa[1] + pb[1]) / 2;
+    len = hypot((pb[0] - pa[0]) / t.hx, (pb[1] - pa[1]) / t.hy);
+    if (!project(t, m, len / 2))
+        return true;
+    return hypot((m[0] - c[0]) / t.hx, (m[1] - c[1]) / t.hy) > TRACE_DETOUR;
+}
+
+// segments of the curve in cell (i,j), the cells on the other side of the
+// sides it crosses are queued
+static void march_cell(tracer &t, int i, int j)
+{
+    // corners and sides counterclockwise from (i,j), side s goes from corner
+    // s to corner s+1, starts at node si,sj and is next to cell ni,nj
+    static const int ci[5] = {0, 1, 1, 0, 0}, cj[5] = {0, 0, 1, 1, 0};
+    static const int si[4] = {0, 1, 0, 0}, sj[4] = {0, 0, 1, 0};
+    static const int ni[4] = {0, 1, 0, -1}, nj[4] = {-1, 0, 1, 0};
+    double f[4];
+    int p[4], cross[4], nc = 0, s, k, sing;
+    long long id;
+
+    for (k = 0; k < 4; k++)
+        f[k] = node_value(t, i + ci[k], j + cj[k]);
+    for (s = 0; s < 4; s++) {
+        if ((f[s] < 0) == (f[(s + 1) % 4] < 0))
+            continue;
+        // horizontal sides have even ids and vertical sides odd ids
+        id = 2 * node_key(t, i + si[s], j + sj[s]) + (s & 1);
+        p[s] = side_point(t, id, i + ci[s], j + cj[s], i + ci[s + 1],
+                          j + cj[s + 1]);
+        cross[nc++] = s;
+        queue_cell(t, i + ni[s], j + nj[s]);
+    }
+
+    // the sides crossed are paired along the curve, the center of the cell
+    // tells which corners a saddle cuts off
+    if (nc == 4 && (eval_point(t, node_x(t, i) + t.hx / 2,
+                               node_y(t, j) + t.hy / 2) < 0) != (f[0] < 0)) {
+        for (k = 0; k < 4; k++)
+            cross[k] = (k + 3) % 4;
+    }
+
+    // next to a singular point, a pair of sides may belong to two branches
+    // that meet there
+    sing = singular_point(t, i, j, f);
+    for (k = 0; k < nc; k += 2) {
+        if (sing >= 0 && detour(t, p[cross[k]], p[cross[k + 1]])) {
+            add_segment(t, p[cross[k]], sing);
+            add_segment(t, sing, p[cross[k + 1]]);
+        } else {
+            add_segment(t, p[cross[k]], p[cross[k + 1]]);
+        }
+    }
+}
+
+static interval add(interval a, interval b)
+{
+    interval r = {a.lo + b.lo, a.hi + b.hi};
+    return r;
+}
+
+static interval mul(interval a, interval b)
+{
+    double p[4] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+    interval r;
+
+    r.lo = *std::min_element(p, p + 4);
+    r.hi = *std::max_element(p, p + 4);
+    return r;
+}
+
+static interval scale(double c, interval a)
+{
+    interval r = {c, c};
+    return mul(r, a);
+}
+
+static double magnitude(interval a)
+{
+    return std::max(fabs(a.lo), fabs(a.hi));
+}
+
+static interval power(interval a, int k)
+{
+    interval r;
+    double l = ipow(a.lo, k), h = ipow(a.hi, k);
+
+    if (k % 2 == 1 || a.lo >= 0) {
+        r.lo = l;
+        r.hi = h;
+    } else if (a.hi <= 0) {
+        r.lo = h;
+        r.hi = l;
+    } else {
+        r.lo = 0;
+        r.hi = std::max(l, h);
+    }
+    return r;
+}
+
+// values of cos in [a,b], which reaches 1 at the even multiples of pi and
+// -1 at the odd ones
+static interval cos_range(double a, double b)
+{
+    interval r;
+    double k = ceil(a / M_PI);
+
+    r.lo = std::min(cos(a), cos(b));
+    r.hi = std::max(cos(a), cos(b));
+    for (; k * M_PI <= b && (r.lo > -1 || r.hi < 1); k++) {
+        if (fmod(fabs(k), 2) == 0)
+            r.hi = 1;
+        else
+            r.lo = -1;
+    }
+    return r;
+}
+
+// bound of the polynomial in the block of sx by sy cells at node (i,j),
+// false if it cannot vanish in it. The values of the terms over the ranges
+// of the variables give one bound, the value at the center of the block
+// and the ranges of the derivatives another one, much closer for small
+// blocks, and both are intersected.
+static bool may_vanish(const tracer &t, int i, int j, int sx, int sy)
+{
+    interval v[3], x, y, c, s, term, d, dx, dy;
+    interval sum = {0, 0}, grad[3] = {{0, 0}, {0, 0}, {0, 0}};
+    const int n = t.f->nvars;
+    const int *e;
+    double size = 0, f0, dev, lo, hi;
+    int k, m, l;
+
+    x.lo = node_x(t, i);
+    x.hi = node_x(t, i + sx);
+    y.lo = node_y(t, j);
+    y.hi = node_y(t, j + sy);
+    c = cos_range(y.lo, y.hi);
+    s = cos_range(y.lo - M_PI / 2, y.hi - M_PI / 2);
+    if (t.coords == TRACE_PLANE) {
+        v[0] = x;
+        v[1] = y;
+    } else if (t.coords == TRACE_POLAR) {
+        v[0] = mul(x, c);
+        v[1] = mul(x, s);
+    } else {
+        v[0] = x;
+        v[1] = c;
+        v[2] = s;
+    }
+
+    for (k = 0; k < (int)t.f->coeffs.size(); k++) {
+        e = &t.f->exps[k * n];
+        term.lo = term.hi = t.f->coeffs[k];
+        for (m = 0; m < n; m++)
+            term = mul(term, power(v[m], e[m]));
+        sum = add(sum, term);
+        size += magnitude(term);
+        for (m = 0; m < n; m++) {
+            if (e[m] == 0)
+                continue;
+            d.lo = d.hi = t.f->coeffs[k] * e[m];
+            for (l = 0; l < n; l++)
+                d = mul(d, power(v[l], (l == m) ? e[l] - 1 : e[l]));
+            grad[m] = add(grad[m], d);
+        }
+    }
+
+    // derivatives with respect to the coordinates of the rectangle
+    if (t.coords == TRACE_PLANE) {
+        dx = grad[0];
+        dy = grad[1];
+    } else if (t.coords == TRACE_POLAR) {
+        dx = add(mul(grad[0], c), mul(grad[1], s));
+        dy = mul(x, add(mul(grad[1], c), scale(-1, mul(grad[0], s))));
+    } else {
+        dx = grad[0];
+        dy = add(mul(grad[2], c), scale(-1, mul(grad[1], s)));
+    }
+    f0 = eval_point(t, (x.lo + x.hi) / 2, (y.lo + y.hi) / 2);
+    dev = magnitude(dx) * (x.hi - x.lo) / 2 + magnitude(dy) * (y.hi - y.lo) / 2;
+    lo = std::max(sum.lo, f0 - dev);
+    hi = std::min(sum.hi, f0 + dev);
+    return lo <= TRACE_ROUNDING * size && hi >= -TRACE_ROUNDING * size;
+}
+
+// queue the cells of the block of sx by sy cells at node (i,j) where the
+// polynomial changes sign, the subblocks where it cannot vanish are skipped
+static void find_cells(tracer &t, int i, int j, int sx, int sy)
+{
+    double v[4], lo, hi;
+    int ax, ay, k;
+
+    v[0] = node_value(t, i, j);
+    v[1] = node_value(t, i + sx, j);
+    v[2] = node_value(t, i + sx, j + sy);
+    v[3] = node_value(t, i, j + sy);
+    lo = hi = v[0];
+    for (k = 1; k < 4; k++) {
+        lo = std::min(lo, v[k]);
+        hi = std::max(hi, v[k]);
+    }
+
+    if (sx == 1 && sy == 1) {
+        if (lo < 0 && hi >= 0)
+            queue_cell(t, i, j);
+        return;
+    }
+    // blocks of a few cells are cheaper to split than to bound
+    if (!(lo < 0 && hi >= 0) && sx * sy > TRACE_SPLIT &&
+        !may_vanish(t, i, j, sx, sy))
+        return;
+
+    ax = (sx > 1) ? sx / 2 : sx;
+    ay = (sy > 1) ? sy / 2 : sy;
+    find_cells(t, i, j, ax, ay);
+    if (sx > 1)
+        find_cells(t, i + ax, j, sx - ax, ay);
+    if (sy > 1)
+        find_cells(t, i, j + ay, ax, sy - ay);
+    if (sx > 1 && sy > 1)
+        find_cells(t, i + ax, j + ay, sx - ax, sy - ay);
+}
+
+// append the points of the curve between a and b to path, ending with b
+static void append_arc(const tracer &t, const double *a, const double *b,
+                       int level, std::vector<double> &path)
+{
+    double c[2], m[2], len;
+
+    c[0] = m[0] = (a[0] + b[0]) / 2;
+    c[1] = m[1] = (a[1] + b[1]) / 2;
+    len = hypot((b[0] - a[0]) / t.hx, (b[1] - a[1]) / t.hy);
+    if (level < TRACE_BENDS && project(t, m, len / 2) &&
+        hypot((m[0] - c[0]) / t.hx, (m[1] - c[1]) / t.hy) > TRACE_BEND) {
+        append_arc(t, a, m, level + 1, path);
+        append_arc(t, m, b, level + 1, path);
+        return;
+    }
+    path.push_back(b[0]);
+    path.push_back(b[1]);
+}
+
+// polyline of segments from point p through segment s, until it reaches a
+// side of the rectangle, a crossing or the segment it started from
+static void follow(const tracer &t, const std::vector<std::vector<int>> &adj,
+                   std::vector<char> &used, int p, int s,
+                   std::vector<std::vector<double>> *paths)
+{
+    std::vector<double> path;
+    int q;
+
+    path.push_back(t.pts[2 * p]);
+    path.push_back(t.pts[2 * p + 1]);
+    while (true) {
+        used[s] = 1;
+        q = (t.segs[2 * s] == p) ? t.segs[2 * s + 1] : t.segs[2 * s];
+        append_arc(t, &t.pts[2 * p], &t.pts[2 * q], 0, path);
+        if (adj[q].size() != 2)
+            break;
+        s = (adj[q][0] == s) ? adj[q][1] : adj[q][0];
+        if (used[s])
+            break;
+        p = q;
+    }
+    paths->push_back(path);
+}
+
+void trace_curve(const flatpoly &f, int coords, double x1, double x2,
+                 double y1, double y2, int points, int prec,
+                 std::vector<std::vector<double>> *paths)
+{
+    tracer t;
+    int block, i, j, k, c;
+
+    // the zero polynomial has no curve to draw
+    if (f.coeffs.empty())
+        return;
+
+    t.f = &f;
+    t.coords = coords;
+    t.n = std::min(std::max(points, TRACE_MIN_POINTS), TRACE_MAX_POINTS);
+    t.x1 = x1;
+    t.x2 = x2;
+    t.y1 = y1;
+    t.y2 = y2;
+    t.hx = (x2 - x1) / t.n;
+    t.hy = (y2 - y1) / t.n;
+    t.tol = pow(10.0, -prec);
+
+    for (block = 1; t.n / (2 * block) >= TRACE_COARSE; block *= 2)
+        ;
+    for (j = 0; j < t.n; j += block) {
+        for (i = 0; i < t.n; i += block)
+            find_cells(t, i, j, std::min(block, t.n - i),
+                       std::min(block, t.n - j));
+    }
+    while (!t.queue.empty()) {
+        c = t.queue.front();
+        t.queue.pop_front();
+        march_cell(t, c % t.n, c / t.n);
+    }
+
+    // open polylines start at the sides of the rectangle and at crossings,
+    // then the closed ones are left
+    std::vector<std::vector<int>> adj(t.pts.size() / 2);
+    std::vector<char> used(t.segs.size() / 2, 0);
+    for (k = 0; k < (int)t.segs.size(); k++)
+        adj[t.segs[k]].push_back(k / 2);
+    for (int pass = 0; pass < 2; pass++) {
+        for (k = 0; k < (int)adj.size(); k++) {
+            if (pass == 0 && adj[k].size() == 2)
+                continue;
+            for (size_t m = 0; m < adj[k].size(); m++) {
+                if (!used[adj[k][m]])
+                    follow(t, adj, used, k, adj[k][m], paths);
+            }
+        }
+    }
+}
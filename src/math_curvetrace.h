@@ -0,0 +1,66 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATH_CURVETRACE_H
+#define MATH_CURVETRACE_H
+
+/*!
+ * @brief Native tracing of the zero set of a polynomial in a chart
+ * @file math_curvetrace.h
+ *
+ * The gcf, the curves and the isoclines are the zero sets of polynomials
+ * in each chart of the sphere. The rectangle of a chart is divided in a
+ * grid of cells, and a quadtree over the grid discards the regions where
+ * the polynomial cannot vanish, bounded with interval arithmetic from the
+ * ranges of its variables. The cells where it changes sign are followed
+ * from one to the next along the curve (marching squares), the points where
+ * the curve crosses the sides of the cells are found with the Illinois
+ * method, and more points are projected onto the curve with Newton's method
+ * where it bends inside a cell. Cells where two branches of the curve cross
+ * contain a singular point of the polynomial, which is located and joined
+ * to the four branches.
+ */
+
+#include <vector>
+
+struct flatpoly;
+
+#define TRACE_PLANE 0    ///< polynomial f(x,y) of flatten_term2()
+#define TRACE_POLAR 1    ///< f(r*cos(t),r*sin(t)) for f of flatten_term2()
+#define TRACE_CYLINDER 2 ///< polynomial f(r,t) of flatten_term3()
+
+/**
+ * Trace the zero set of a polynomial in a rectangle
+ *
+ * @param f      polynomial
+ * @param coords coordinates of the rectangle (#TRACE_PLANE, #TRACE_POLAR or
+ *               #TRACE_CYLINDER)
+ * @param x1     lower bound of the first coordinate
+ * @param x2     upper bound of the first coordinate
+ * @param y1     lower bound of the second coordinate
+ * @param y2     upper bound of the second coordinate
+ * @param points number of cells of the grid in each direction
+ * @param prec   number of digits of the points of the curve
+ * @param paths  the zero set is appended as polylines, each one stored as
+ *               x0,y0,x1,y1,...
+ */
+void trace_curve(const flatpoly &f, int coords, double x1, double x2,
+                 double y1, double y2, int points, int prec,
+                 std::vector<std::vector<double>> *paths);
+
+#endif // MATH_CURVETRACE_H
@@ -0,0 +1,235 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "math_events.h"
+
+#include "WSphere.h"
+#include "file_tab.h"
+
+#include "math_p4.h"
+
+#include <cmath>
+
+// number of points of a step sampled to find the closest one to the start
+#define CLOSEST_SAMPLES 16
+
+static double distance(const double *p, const double *q)
+{
+    return sqrt((p[0] - q[0]) * (p[0] - q[0]) + (p[1] - q[1]) * (p[1] - q[1]) +
+                (p[2] - q[2]) * (p[2] - q[2]));
+}
+
+OrbitEvents::OrbitEvents(WSphere *spherewnd, const double *start,
+                         bool closing)
+    : study_(spherewnd->study_), x0_(spherewnd->x0), x1_(spherewnd->x1),
+      y0_(spherewnd->y0), y1_(spherewnd->y1), hasPrev_(false),
+      closing_(closing && start != nullptr), away_(false), stuck_(0)
+{
+    node *n;
+    strong_focus *sf;
+    weak_focus *wf;
+
+    if (start != nullptr) {
+        copy_x_into_y((double *)start, start_);
+        copy_x_into_y((double *)start, prev_);
+        hasPrev_ = true;
+    }
+
+    // orbits that get this close to a node or a focus only go into it
+    for (n = study_->first_node_point_; n != nullptr; n = n->next_node)
+        addSink(n->chart, n->x0, n->y0);
+    for (sf = study_->first_sf_point_; sf != nullptr; sf = sf->next_sf)
+        addSink(sf->chart, sf->x0, sf->y0);
+    for (wf = study_->first_wf_point_; wf != nullptr; wf = wf->next_wf)
+        addSink(wf->chart, wf->x0, wf->y0);
+}
+
+void OrbitEvents::addSink(int chart, double x0, double y0)
+{
+    double pcoord[3];
+
+    // same placement as WSphere::getChartPos
+    switch (chart) {
+    case CHART_R2:
+        (study_->*(study_->R2_to_sphere))(x0, y0, pcoord);
+        break;
+    case CHART_U1:
+        (study_->*(study_->U1_to_sphere))(x0, 0, pcoord);
+        break;
+    case CHART_U2:
+        (study_->*(study_->U2_to_sphere))(x0, 0, pcoord);
+        break;
+    case CHART_V1:
+        (study_->*(study_->V1_to_sphere))(x0, 0, pcoord);
+        break;
+    case CHART_V2:
+        (study_->*(study_->V2_to_sphere))(x0, 0, pcoord);
+        break;
+    default:
+        return;
+    }
+    sinks_.insert(sinks_.end(), pcoord, pcoord + 3);
+}
+
+double OrbitEvents::sinkDistance(const double *p)
+{
+    double d, dmin = HUGE_VAL;
+
+    for (size_t i = 0; i < sinks_.size(); i += 3) {
+        d = distance(p, &sinks_[i]);
+        if (d < dmin)
+            dmin = d;
+    }
+    return dmin;
+}
+
+bool OrbitEvents::inView(const double *p)
+{
+    double ucoord[2];
+
+    (study_->*(study_->sphere_to_viewcoord))(p[0], p[1], p[2], ucoord);
+    return ucoord[0] >= x0_ && ucoord[0] <= x1_ && ucoord[1] >= y0_ &&
+           ucoord[1] <= y1_;
+}
+
+bool OrbitEvents::happening(int event, const double *p)
+{
+    if (event == EVENT_SINGULARITY)
+        return sinkDistance(p) < EVENT_SING_DISTANCE;
+    return !inView(p);
+}
+
+void OrbitEvents::locate(chart_state *cs, int event, double *pcoord)
+{
+    double lo = 0, hi = 1, mid, p[3];
+
+    for (int i = 0; i < EVENT_BISECTIONS; i++) {
+        mid = (lo + hi) / 2;
+        study_->chart_step_point(cs, mid, p);
+        if (happening(event, p))
+            hi = mid;
+        else
+            lo = mid;
+    }
+    study_->chart_step_point(cs, hi, pcoord);
+}
+
+double OrbitEvents::closest(chart_state *cs, double *pcoord)
+{
+    double p[3], d, dmin, t, lo, hi, a, b, da, db;
+    int k, kmin = 0;
+    const double g = (sqrt(5.0) - 1) / 2;
+
+    dmin = HUGE_VAL;
+    for (k = 0; k <= CLOSEST_SAMPLES; k++) {
+        study_->chart_step_point(cs, (double)k / CLOSEST_SAMPLES, p);
+        d = distance(p, start_);
+        if (d < dmin) {
+            dmin = d;
+            kmin = k;
+        }
+    }
+
+    // golden section search around the closest sample
+    lo = (double)(kmin > 0 ? kmin - 1 : 0) / CLOSEST_SAMPLES;
+    hi = (double)(kmin < CLOSEST_SAMPLES ? kmin + 1 : kmin) / CLOSEST_SAMPLES;
+    a = hi - g * (hi - lo);
+    b = lo + g * (hi - lo);
+    study_->chart_step_point(cs, a, p);
+    da = distance(p, start_);
+    study_->chart_step_point(cs, b, p);
+    db = distance(p, start_);
+    for (k = 0; k < EVENT_BISECTIONS; k++) {
+        if (da < db) {
+            hi = b;
+            b = a;
+            db = da;
+            a = hi - g * (hi - lo);
+            study_->chart_step_point(cs, a, p);
+            da = distance(p, start_);
+        } else {
+            lo = a;
+            a = b;
+            da = db;
+            b = lo + g * (hi - lo);
+            study_->chart_step_point(cs, b, p);
+            db = distance(p, start_);
+        }
+    }
+    t = (lo + hi) / 2;
+    study_->chart_step_point(cs, t, pcoord);
+    return distance(pcoord, start_);
+}
+
+int OrbitEvents::check(double *pcoord, double hhi, chart_state *cs)
+{
+    int event = EVENT_NONE;
+    double d, q[3];
+
+    if (!hasPrev_) {
+        copy_x_into_y(pcoord, prev_);
+        hasPrev_ = true;
+        return EVENT_NONE;
+    }
+    if (cs != nullptr && cs->stepchart == CHART_NONE)
+        cs = nullptr;
+
+    // only when the orbit enters the region during this step, so that an
+    // orbit that starts inside can still leave it
+    if (!sinks_.empty() && happening(EVENT_SINGULARITY, pcoord) &&
+        !happening(EVENT_SINGULARITY, prev_))
+        event = EVENT_SINGULARITY;
+    else if (happening(EVENT_VIEW, pcoord) && !happening(EVENT_VIEW, prev_))
+        event = EVENT_VIEW;
+    if (event != EVENT_NONE) {
+        if (cs != nullptr)
+            locate(cs, event, pcoord);
+        return event;
+    }
+
+    if (closing_) {
+        d = distance(pcoord, start_);
+        if (!away_) {
+            away_ = (d > EVENT_AWAY_DISTANCE);
+        } else if (d < distance(pcoord, prev_) + EVENT_CLOSED_DISTANCE) {
+            // the start point may be passed inside this step
+            copy_x_into_y(pcoord, q);
+            if (cs != nullptr)
+                d = closest(cs, q);
+            if (d < EVENT_CLOSED_DISTANCE) {
+                copy_x_into_y(q, pcoord);
+                return EVENT_CLOSED;
+            }
+        }
+    }
+
+    if (fabs(hhi) <= study_->config_hmi_) {
+        if (stuck_++ == 0) {
+            copy_x_into_y(prev_, stuckFrom_);
+        } else if (stuck_ >= EVENT_STUCK_STEPS) {
+            if (distance(pcoord, stuckFrom_) < EVENT_STUCK_DISTANCE)
+                return EVENT_STUCK;
+            stuck_ = 0;
+        }
+    } else {
+        stuck_ = 0;
+    }
+
+    copy_x_into_y(pcoord, prev_);
+    return EVENT_NONE;
+}
@@ -0,0 +1,137 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATH_EVENTS_H
+#define MATH_EVENTS_H
+
+/*!
+ * @brief Events that end the integration of an orbit early
+ * @file math_events.h
+ *
+ * Orbits and separatrices are integrated for a fixed number of points, but
+ * there is nothing more to draw once they fall into a node or focus, leave
+ * the window, close up on themselves or stop moving. OrbitEvents watches
+ * the points of an integration and tells it when to stop, placing the last
+ * point where the event happened with the interpolant of the last step.
+ */
+
+#include <vector>
+
+class WSphere;
+class WVFStudy;
+struct chart_state;
+
+#define EVENT_NONE 0        ///< keep integrating
+#define EVENT_SINGULARITY 1 ///< the orbit reached a node or a focus
+#define EVENT_VIEW 2        ///< the orbit left the window of the view
+#define EVENT_CLOSED 3      ///< the orbit came back to its start point
+#define EVENT_STUCK 4       ///< the orbit does not move at minimum step size
+
+/**
+ * Distance (on the sphere) to a node or focus at which an orbit is
+ * considered to have reached it
+ */
+#define EVENT_SING_DISTANCE 1E-5
+/**
+ * Distance (on the sphere) to its start point at which an orbit is
+ * considered closed
+ */
+#define EVENT_CLOSED_DISTANCE 1E-5
+/**
+ * Distance an orbit has to move away from its start point before it can
+ * close
+ */
+#define EVENT_AWAY_DISTANCE 1E-3
+/**
+ * Number of steps at minimum step size after which an orbit that has not
+ * moved more than #EVENT_STUCK_DISTANCE is stopped
+ */
+#define EVENT_STUCK_STEPS 100
+/**
+ * Distance (on the sphere) that an orbit must travel in #EVENT_STUCK_STEPS
+ * steps at minimum step size to keep going
+ */
+#define EVENT_STUCK_DISTANCE 1E-6
+/**
+ * Number of bisections to locate an event inside a step
+ */
+#define EVENT_BISECTIONS 30
+
+/**
+ * Class that detects the events of an orbit integration
+ *
+ * @class OrbitEvents
+ *
+ * An object is created for each integration run and #check is called after
+ * every step. It only reads the study and the view, so it can be used from
+ * the worker threads that integrate separatrices.
+ */
+class OrbitEvents
+{
+  public:
+    /**
+     * Constructor method
+     * @param spherewnd sphere object of the study, gives the singular points
+     *                  and the window of the view
+     * @param start     point where the integration starts, or @c nullptr
+     *                  if unknown (then the first step is not checked)
+     * @param closing   whether to stop when the orbit comes back to
+     *                  @p start (not for separatrices, which start next to
+     *                  a singular point)
+     */
+    OrbitEvents(WSphere *spherewnd, const double *start, bool closing);
+
+    /**
+     * Check the step of an orbit that ended at a point
+     * @param pcoord point after the step, moved to where the event happened
+     *               when one is found
+     * @param hhi    step size for the next step
+     * @param cs     chart state of the orbit, to interpolate the step, or
+     *               @c nullptr if the step cannot be interpolated
+     * @return       EVENT_NONE, or the event that ends the integration
+     */
+    int check(double *pcoord, double hhi, chart_state *cs);
+
+  private:
+    WVFStudy *study_;
+    double x0_, x1_, y0_, y1_;  ///< window of the view
+    std::vector<double> sinks_; ///< nodes and foci, 3 coordinates each
+    double start_[3];           ///< start point of the orbit
+    double prev_[3];            ///< point before the last step
+    bool hasPrev_;              ///< whether #prev_ is known
+    bool closing_;              ///< whether to check #EVENT_CLOSED
+    bool away_; ///< whether the orbit has moved away from #start_
+    int stuck_; ///< steps taken at minimum step size
+    double stuckFrom_[3]; ///< point where those steps started
+
+    // add a singular point of the study to sinks_
+    void addSink(int chart, double x0, double y0);
+    // distance to the closest node or focus
+    double sinkDistance(const double *p);
+    // whether a point is inside the window of the view
+    bool inView(const double *p);
+    // point of the last step where an event starts, by bisection between
+    // theta=0 (no event) and theta=1 (event)
+    void locate(chart_state *cs, int event, double *pcoord);
+    // whether the event is happening at p
+    bool happening(int event, const double *p);
+    // closest point of the last step to start_, returns its distance
+    double closest(chart_state *cs, double *pcoord);
+};
+
+#endif // MATH_EVENTS_H
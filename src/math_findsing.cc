@@ -0,0 +1,1287 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// -----------------------------------------------------------------------
+//
+//              NATIVE COMPUTATION OF SINGULAR POINTS
+//
+// -----------------------------------------------------------------------
+
+#include "math_findsing.h"
+
+#include "MyLogger.h"
+#include "file_tab.h"
+#include "math_p4.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+
+typedef std::complex<double> cplx;
+
+// polynomial in two variables, (exp_x,exp_y) -> coefficient
+typedef std::map<std::pair<int, int>, double> poly2;
+
+// a singular point together with the data written to the .tab files
+struct singpoint {
+    int type;                 // SADDLE, NODE or STRONG_FOCUS
+    int chart;                // chart where the point is located
+    double x0;                // coordinates of the point
+    double y0;                // coordinates of the point
+    double l1;                // eigenvalues (real and imaginary part of
+    double l2;                // the eigenvalues for a focus)
+    int stable;               // -1 if stable, 1 if unstable
+    double a[4];              // transformation matrix (a11,a12,a21,a22)
+    poly2 vf[2];              // vector field in the transformed coordinates
+    int type1;                // type of the separatrice along (a11,a21)
+    int type2;                // type of the separatrice along (a12,a22)
+    std::vector<double> sep1; // separatrice (t,sep1(t))
+    std::vector<double> sep2; // separatrice (sep2(t),t)
+};
+
+// -----------------------------------------------------------------------
+//                      POLYNOMIAL ARITHMETIC
+// -----------------------------------------------------------------------
+
+// zero coefficients are never stored
+static void poly_add(poly2 &p, int i, int j, double c)
+{
+    if (c == 0)
+        return;
+    std::pair<int, int> e(i, j);
+    poly2::iterator it = p.insert(std::make_pair(e, 0.0)).first;
+    it->second += c;
+    if (it->second == 0)
+        p.erase(it);
+}
+
+static poly2 poly_sum(const poly2 &p, const poly2 &q, double c)
+{
+    poly2 r = p;
+    for (poly2::const_iterator it = q.begin(); it != q.end(); ++it)
+        poly_add(r, it->first.first, it->first.second, c * it->second);
+    return r;
+}
+
+static poly2 poly_mul(const poly2 &p, const poly2 &q)
+{
+    poly2 r;
+    for (poly2::const_iterator a = p.begin(); a != p.end(); ++a)
+        for (poly2::const_iterator b = q.begin(); b != q.end(); ++b)
+            poly_add(r, a->first.first + b->first.first,
+                     a->first.second + b->first.second, a->second * b->second);
+    return r;
+}
+
+static poly2 poly_scale(const poly2 &p, double c)
+{
+    poly2 r;
+    return poly_sum(r, p, c);
+}
+
+static poly2 poly_diff(const poly2 &p, int var)
+{
+    poly2 r;
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it) {
+        int i = it->first.first;
+        int j = it->first.second;
+        if (var == 0 && i > 0)
+            poly_add(r, i - 1, j, i * it->second);
+        else if (var == 1 && j > 0)
+            poly_add(r, i, j - 1, j * it->second);
+    }
+    return r;
+}
+
+// exchange the roles of x and y
+static poly2 poly_swap(const poly2 &p)
+{
+    poly2 r;
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        poly_add(r, it->first.second, it->first.first, it->second);
+    return r;
+}
+
+// remove coefficients that are negligible with respect to the largest one
+static void poly_clean(poly2 &p, double tol)
+{
+    double m = 0;
+    for (poly2::iterator it = p.begin(); it != p.end(); ++it)
+        m = std::max(m, fabs(it->second));
+    for (poly2::iterator it = p.begin(); it != p.end();) {
+        if (fabs(it->second) <= tol * m)
+            it = p.erase(it);
+        else
+            ++it;
+    }
+}
+
+// total degree, -1 for the zero polynomial
+static int poly_degree(const poly2 &p, int var = -1)
+{
+    int d = -1;
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it) {
+        if (it->second == 0)
+            continue;
+        int e = (var == 0) ? it->first.first
+                           : (var == 1) ? it->first.second
+                                        : it->first.first + it->first.second;
+        d = std::max(d, e);
+    }
+    return d;
+}
+
+static bool poly_is_constant(const poly2 &p)
+{
+    return poly_degree(p) <= 0;
+}
+
+static double poly_constant(const poly2 &p)
+{
+    poly2::const_iterator it = p.find(std::make_pair(0, 0));
+    return (it == p.end()) ? 0.0 : it->second;
+}
+
+static double poly_eval(const poly2 &p, double x, double y)
+{
+    double s = 0;
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        s += it->second * pow(x, it->first.first) * pow(y, it->first.second);
+    return s;
+}
+
+// size of the terms of p around (x,y), used as the scale of rounding errors
+static double poly_scale_at(const poly2 &p, double x, double y)
+{
+    double s = 0;
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        s += fabs(it->second) * pow(1 + fabs(x), it->first.first) *
+             pow(1 + fabs(y), it->first.second);
+    return s;
+}
+
+// coefficients in y of p(x,y) for a fixed x, up to degree n
+static std::vector<cplx> coefficients_in_y(const poly2 &p, cplx x, int n)
+{
+    std::vector<cplx> c(n + 1, 0.0);
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        c[it->first.second] += it->second * std::pow(x, it->first.first);
+    return c;
+}
+
+// coefficients in x of p(x,0)
+static std::vector<cplx> coefficients_on_axis(const poly2 &p)
+{
+    std::vector<cplx> c(std::max(poly_degree(p, 0), 0) + 1, 0.0);
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        if (it->first.second == 0)
+            c[it->first.first] += it->second;
+    return c;
+}
+
+// -----------------------------------------------------------------------
+//                      PARSER OF POLYNOMIALS
+// -----------------------------------------------------------------------
+//
+// Reads polynomials in x and y written in Maple syntax. Parameters are
+// replaced by their values, anything else (functions, unknown names,
+// divisions by non-constants) is rejected.
+
+struct polyparser {
+    const std::string &s;
+    size_t pos;
+    const std::map<std::string, double> &consts;
+};
+
+static bool parse_expr(polyparser &ps, poly2 &p);
+static bool parse_unary(polyparser &ps, poly2 &p);
+
+static bool accept(polyparser &ps, const char *token)
+{
+    while (ps.pos < ps.s.size() && isspace(ps.s[ps.pos]))
+        ps.pos++;
+    size_t n = strlen(token);
+    if (ps.s.compare(ps.pos, n, token) != 0)
+        return false;
+    ps.pos += n;
+    return true;
+}
+
+static bool parse_primary(polyparser &ps, poly2 &p)
+{
+    p.clear();
+    if (accept(ps, "("))
+        return parse_expr(ps, p) && accept(ps, ")");
+    if (ps.pos >= ps.s.size())
+        return false;
+
+    const std::string &s = ps.s;
+    size_t start = ps.pos;
+    if (isdigit(s[ps.pos]) || s[ps.pos] == '.') {
+        while (ps.pos < s.size() && isdigit(s[ps.pos]))
+            ps.pos++;
+        if (ps.pos < s.size() && s[ps.pos] == '.')
+            ps.pos++;
+        while (ps.pos < s.size() && isdigit(s[ps.pos]))
+            ps.pos++;
+        if (ps.pos < s.size() && (s[ps.pos] == 'e' || s[ps.pos] == 'E')) {
+            size_t e = ps.pos + 1;
+            if (e < s.size() && (s[e] == '+' || s[e] == '-'))
+                e++;
+            if (e < s.size() && isdigit(s[e])) {
+                ps.pos = e;
+                while (ps.pos < s.size() && isdigit(s[ps.pos]))
+                    ps.pos++;
+            }
+        }
+        std::string number = s.substr(start, ps.pos - start);
+        if (number == ".")
+            return false;
+        poly_add(p, 0, 0, atof(number.c_str()));
+        return true;
+    }
+    if (isalpha(s[ps.pos]) || s[ps.pos] == '_') {
+        while (ps.pos < s.size() && (isalnum(s[ps.pos]) || s[ps.pos] == '_'))
+            ps.pos++;
+        std::string name = s.substr(start, ps.pos - start);
+        if (name == "x") {
+            poly_add(p, 1, 0, 1.0);
+        } else if (name == "y") {
+            poly_add(p, 0, 1, 1.0);
+        } else {
+            std::map<std::string, double>::const_iterator it =
+                ps.consts.find(name);
+            if (it == ps.consts.end())
+                return false;
+            poly_add(p, 0, 0, it->second);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool parse_power(polyparser &ps, poly2 &p)
+{
+    if (!parse_primary(ps, p))
+        return false;
+    if (!accept(ps, "^") && !accept(ps, "**"))
+        return true;
+
+    poly2 e;
+    if (!parse_unary(ps, e) || !poly_is_constant(e))
+        return false;
+    double n = poly_constant(e);
+    if (poly_is_constant(p)) {
+        double v = pow(poly_constant(p), n);
+        if (!std::isfinite(v))
+            return false;
+        p.clear();
+        poly_add(p, 0, 0, v);
+    } else {
+        if (n < 0 || n > 100 || n != floor(n))
+            return false;
+        poly2 r;
+        poly_add(r, 0, 0, 1.0);
+        for (int k = 0; k < (int)n; k++)
+            r = poly_mul(r, p);
+        p = r;
+    }
+    return true;
+}
+
+static bool parse_unary(polyparser &ps, poly2 &p)
+{
+    if (accept(ps, "-")) {
+        if (!parse_unary(ps, p))
+            return false;
+        p = poly_scale(p, -1.0);
+        return true;
+    }
+    if (accept(ps, "+"))
+        return parse_unary(ps, p);
+    return parse_power(ps, p);
+}
+
+static bool parse_term(polyparser &ps, poly2 &p)
+{
+    if (!parse_unary(ps, p))
+        return false;
+    for (;;) {
+        poly2 q;
+        if (accept(ps, "*")) {
+            if (!parse_unary(ps, q))
+                return false;
+            p = poly_mul(p, q);
+        } else if (accept(ps, "/")) {
+            if (!parse_unary(ps, q) || !poly_is_constant(q) ||
+                poly_constant(q) == 0)
+                return false;
+            p = poly_scale(p, 1.0 / poly_constant(q));
+        } else {
+            return true;
+        }
+    }
+}
+
+static bool parse_expr(polyparser &ps, poly2 &p)
+{
+    if (!parse_term(ps, p))
+        return false;
+    for (;;) {
+        poly2 q;
+        if (accept(ps, "+")) {
+            if (!parse_term(ps, q))
+                return false;
+            p = poly_sum(p, q, 1.0);
+        } else if (accept(ps, "-")) {
+            if (!parse_term(ps, q))
+                return false;
+            p = poly_sum(p, q, -1.0);
+        } else {
+            return true;
+        }
+    }
+}
+
+static bool parse_poly(const std::string &s,
+                       const std::map<std::string, double> &consts, poly2 &p)
+{
+    polyparser ps = {s, 0, consts};
+    if (!parse_expr(ps, p))
+        return false;
+    while (ps.pos < s.size() && isspace(s[ps.pos]))
+        ps.pos++;
+    return ps.pos == s.size();
+}
+
+// -----------------------------------------------------------------------
+//                      ROOTS OF POLYNOMIALS
+// -----------------------------------------------------------------------
+
+// all complex roots of sum c[i] t^i (Aberth iteration), false if the
+// polynomial is zero or the iteration does not converge
+static bool poly1_roots(std::vector<cplx> c, std::vector<cplx> &roots)
+{
+    roots.clear();
+    while (!c.empty() && c.back() == 0.0)
+        c.pop_back();
+    if (c.empty())
+        return false;
+    while (c.size() > 1 && c.front() == 0.0) {
+        roots.push_back(0.0);
+        c.erase(c.begin());
+    }
+    int n = c.size() - 1;
+    if (n == 0)
+        return true;
+
+    // start on a circle with the geometric mean of the moduli of the roots
+    std::vector<cplx> z(n);
+    double r = pow(std::abs(c[0] / c[n]), 1.0 / n);
+    for (int k = 0; k < n; k++)
+        z[k] = std::polar(r, 2 * PI * k / n + 0.4);
+
+    // a root is done when the correction is negligible or the value of the
+    // polynomial is at the level of rounding errors (multiple roots)
+    std::vector<bool> done(n, false);
+    bool converged = false;
+    for (int iter = 0; iter < 1000 && !converged; iter++) {
+        converged = true;
+        for (int k = 0; k < n; k++) {
+            if (done[k])
+                continue;
+            cplx p = c[n];
+            cplx dp = 0.0;
+            double scale = std::abs(c[n]);
+            for (int i = n - 1; i >= 0; i--) {
+                dp = dp * z[k] + p;
+                p = p * z[k] + c[i];
+                scale = scale * std::abs(z[k]) + std::abs(c[i]);
+            }
+            if (std::abs(p) <= 1e-15 * n * scale) {
+                done[k] = true;
+                continue;
+            }
+            cplx sum = 0.0;
+            for (int j = 0; j < n; j++)
+                if (j != k)
+                    sum += 1.0 / (z[k] - z[j]);
+            cplx ratio = (dp == 0.0) ? cplx(1e-3 * (1 + std::abs(z[k])))
+                                     : p / dp;
+            cplx w = ratio / (1.0 - ratio * sum);
+            z[k] -= w;
+            if (std::abs(w) <= 1e-15 * (1 + std::abs(z[k])))
+                done[k] = true;
+            else
+                converged = false;
+        }
+    }
+    if (!converged)
+        return false;
+    roots.insert(roots.end(), z.begin(), z.end());
+    return true;
+}
+
+// a cluster of roots, multiple roots are only found up to a few digits
+struct rootgroup {
+    cplx z;
+    int mult;
+};
+
+static std::vector<rootgroup> group_roots(const std::vector<cplx> &roots)
+{
+    std::vector<rootgroup> groups;
+    for (size_t i = 0; i < roots.size(); i++) {
+        size_t g;
+        for (g = 0; g < groups.size(); g++) {
+            if (std::abs(groups[g].z - roots[i]) <=
+                1e-4 * (1 + std::abs(roots[i]))) {
+                groups[g].z = (groups[g].z * (double)groups[g].mult + roots[i]) /
+                              (double)(groups[g].mult + 1);
+                groups[g].mult++;
+                break;
+            }
+        }
+        if (g == groups.size()) {
+            rootgroup r = {roots[i], 1};
+            groups.push_back(r);
+        }
+    }
+    return groups;
+}
+
+// 1 for real roots, 0 for complex ones, -1 if it cannot be told apart
+static int root_is_real(cplx z)
+{
+    double s = 1 + fabs(z.real());
+    if (fabs(z.imag()) <= 1e-7 * s)
+        return 1;
+    if (fabs(z.imag()) > 1e-3 * s)
+        return 0;
+    return -1;
+}
+
+// refine a real root of a polynomial with Newton
+static double newton1(const std::vector<cplx> &c, double t)
+{
+    for (int iter = 0; iter < 50; iter++) {
+        double p = 0;
+        double dp = 0;
+        for (int i = c.size() - 1; i >= 0; i--) {
+            dp = dp * t + p;
+            p = p * t + c[i].real();
+        }
+        if (dp == 0)
+            break;
+        double step = p / dp;
+        t -= step;
+        if (fabs(step) <= 1e-15 * (1 + fabs(t)))
+            break;
+    }
+    return t;
+}
+
+// refine a common root of p and q with Newton, false if it does not
+// converge or the jacobian becomes singular
+static bool newton2(const poly2 &p, const poly2 &q, double &x, double &y)
+{
+    poly2 px = poly_diff(p, 0);
+    poly2 py = poly_diff(p, 1);
+    poly2 qx = poly_diff(q, 0);
+    poly2 qy = poly_diff(q, 1);
+    double x0 = x;
+    double y0 = y;
+
+    for (int iter = 0; iter < 100; iter++) {
+        double f = poly_eval(p, x, y);
+        double g = poly_eval(q, x, y);
+        double a = poly_eval(px, x, y);
+        double b = poly_eval(py, x, y);
+        double c = poly_eval(qx, x, y);
+        double d = poly_eval(qy, x, y);
+        double det = a * d - b * c;
+        if (det == 0 || !std::isfinite(det))
+            return false;
+        double dx = (d * f - b * g) / det;
+        double dy = (a * g - c * f) / det;
+        x -= dx;
+        y -= dy;
+        if (fabs(dx) + fabs(dy) <= 1e-14 * (1 + fabs(x) + fabs(y)))
+            return fabs(x - x0) + fabs(y - y0) <=
+                   1e-3 * (1 + fabs(x0) + fabs(y0));
+    }
+    return false;
+}
+
+// Sylvester resultant of two polynomials in one variable, bound is the
+// Hadamard bound of its modulus
+static cplx sylvester(const std::vector<cplx> &a, const std::vector<cplx> &b,
+                      double &bound)
+{
+    int m = a.size() - 1;
+    int n = b.size() - 1;
+    int s = m + n;
+    std::vector<std::vector<cplx>> mat(s, std::vector<cplx>(s, 0.0));
+    int i, j, k;
+
+    for (i = 0; i < n; i++)
+        for (j = 0; j <= m; j++)
+            mat[i][i + j] = a[m - j];
+    for (i = 0; i < m; i++)
+        for (j = 0; j <= n; j++)
+            mat[n + i][i + j] = b[n - j];
+
+    bound = 1;
+    for (i = 0; i < s; i++) {
+        double norm = 0;
+        for (j = 0; j < s; j++)
+            norm += std::norm(mat[i][j]);
+        bound *= sqrt(norm);
+    }
+
+    // LU decomposition with partial pivoting
+    cplx det = 1.0;
+    for (k = 0; k < s; k++) {
+        int piv = k;
+        for (i = k + 1; i < s; i++)
+            if (std::abs(mat[i][k]) > std::abs(mat[piv][k]))
+                piv = i;
+        if (mat[piv][k] == 0.0)
+            return 0.0;
+        if (piv != k) {
+            std::swap(mat[piv], mat[k]);
+            det = -det;
+        }
+        det *= mat[k][k];
+        for (i = k + 1; i < s; i++) {
+            cplx f = mat[i][k] / mat[k][k];
+            for (j = k; j < s; j++)
+                mat[i][j] -= f * mat[k][j];
+        }
+    }
+    return det;
+}
+
+// -----------------------------------------------------------------------
+//                      FINITE SINGULAR POINTS
+// -----------------------------------------------------------------------
+
+static void add_point(std::vector<std::pair<double, double>> &pts, double x,
+                      double y)
+{
+    for (size_t i = 0; i < pts.size(); i++)
+        if (fabs(pts[i].first - x) + fabs(pts[i].second - y) <=
+            1e-7 * (1 + fabs(x) + fabs(y)))
+            return;
+    pts.push_back(std::make_pair(x, y));
+}
+
+// common real roots of p and q with the given x coordinate
+static bool points_on_vertical(const poly2 &p, const poly2 &q, double x0,
+                               int mult,
+                               std::vector<std::pair<double, double>> &pts)
+{
+    const poly2 *f = &p;
+    const poly2 *g = &q;
+    std::vector<cplx> c = coefficients_in_y(p, x0, poly_degree(p, 1));
+    double m = 0;
+    for (size_t i = 0; i < c.size(); i++)
+        m = std::max(m, std::abs(c[i]));
+    if (m <= 1e-10 * poly_scale_at(p, x0, 0)) {
+        // p vanishes on the whole line x=x0, use q
+        f = &q;
+        g = &p;
+        c = coefficients_in_y(q, x0, poly_degree(q, 1));
+        m = 0;
+        for (size_t i = 0; i < c.size(); i++)
+            m = std::max(m, std::abs(c[i]));
+        if (m <= 1e-10 * poly_scale_at(q, x0, 0))
+            return false;
+    }
+
+    std::vector<cplx> roots;
+    if (!poly1_roots(c, roots))
+        return false;
+    std::vector<rootgroup> groups = group_roots(roots);
+    int found = 0;
+    for (size_t i = 0; i < groups.size(); i++) {
+        int real = root_is_real(groups[i].z);
+        if (real < 0)
+            return false;
+        if (real == 0)
+            continue;
+        double x = x0;
+        double y = groups[i].z.real();
+        if (fabs(poly_eval(*g, x, y)) > 1e-6 * poly_scale_at(*g, x, y))
+            continue;
+        if (!newton2(*f, *g, x, y))
+            return false;
+        add_point(pts, x, y);
+        found++;
+    }
+
+    // a simple root of the resultant always comes from a real point
+    return found > 0 || mult > 1;
+}
+
+// finite singular points: real roots of the resultant of p and q with
+// respect to y, followed by the common roots on each vertical line
+static bool finite_points(const poly2 &p, const poly2 &q,
+                          std::vector<std::pair<double, double>> &pts)
+{
+    int dp = poly_degree(p);
+    int dq = poly_degree(q);
+    if (dp < 0 || dq < 0)
+        return false; // a whole curve of singular points
+    if (dp == 0 || dq == 0)
+        return true;
+    int m = poly_degree(p, 1);
+    int n = poly_degree(q, 1);
+    if (m == 0 && n == 0)
+        return false;
+
+    // the resultant has degree at most dp*dq in x: interpolate it from its
+    // values on the roots of unity, which is well conditioned
+    int N = dp * dq + 1;
+    std::vector<cplx> values(N);
+    double bound = 0;
+    double maxval = 0;
+    for (int k = 0; k < N; k++) {
+        cplx x = std::polar(1.0, 2 * PI * k / N);
+        double b;
+        values[k] = sylvester(coefficients_in_y(p, x, m),
+                              coefficients_in_y(q, x, n), b);
+        bound = std::max(bound, b);
+        maxval = std::max(maxval, std::abs(values[k]));
+    }
+    if (maxval <= 1e-10 * bound)
+        return false; // p and q have a common factor
+
+    std::vector<cplx> res(N, 0.0);
+    double maxcoeff = 0;
+    for (int j = 0; j < N; j++) {
+        for (int k = 0; k < N; k++)
+            res[j] += values[k] * std::polar(1.0, -2 * PI * j * k / N);
+        res[j] = (res[j] / (double)N).real();
+        maxcoeff = std::max(maxcoeff, std::abs(res[j]));
+    }
+    for (int j = 0; j < N; j++)
+        if (std::abs(res[j]) <= 1e-12 * maxcoeff)
+            res[j] = 0.0;
+
+    std::vector<cplx> roots;
+    if (!poly1_roots(res, roots))
+        return false;
+    std::vector<rootgroup> groups = group_roots(roots);
+    for (size_t i = 0; i < groups.size(); i++) {
+        int real = root_is_real(groups[i].z);
+        if (real < 0)
+            return false;
+        if (real == 1 && !points_on_vertical(p, q, groups[i].z.real(),
+                                             groups[i].mult, pts))
+            return false;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------
+//                      LINEARIZATION AND SEPARATRICES
+// -----------------------------------------------------------------------
+
+static void eigenvector(const double *J, double l, double *v)
+{
+    double v1[2] = {J[1], l - J[0]};
+    double v2[2] = {l - J[3], J[2]};
+    double *w = (hypot(v1[0], v1[1]) >= hypot(v2[0], v2[1])) ? v1 : v2;
+    double norm = hypot(w[0], w[1]);
+    v[0] = w[0] / norm;
+    v[1] = w[1] / norm;
+}
+
+// classify a singular point from its jacobian matrix, false if it is not
+// hyperbolic (these need the symbolic machinery of Maple)
+static bool classify(const double *J, singpoint &s)
+{
+    double scale = std::max(std::max(fabs(J[0]), fabs(J[1])),
+                            std::max(fabs(J[2]), fabs(J[3])));
+    double tr = J[0] + J[3];
+    double det = J[0] * J[3] - J[1] * J[2];
+    double disc = tr * tr - 4 * det;
+
+    if (scale == 0 || fabs(det) <= 1e-8 * scale * scale)
+        return false; // semi-hyperbolic or nilpotent
+
+    if (det < 0) {
+        double v1[2], v2[2];
+        s.type = SADDLE;
+        s.l1 = (tr + sqrt(disc)) / 2;
+        s.l2 = (tr - sqrt(disc)) / 2;
+        eigenvector(J, s.l1, v1);
+        eigenvector(J, s.l2, v2);
+        s.a[0] = v1[0];
+        s.a[1] = v2[0];
+        s.a[2] = v1[1];
+        s.a[3] = v2[1];
+        s.type1 = OT_UNSTABLE;
+        s.type2 = OT_STABLE;
+    } else if (disc >= 0) {
+        s.type = NODE;
+        s.l1 = (tr + sqrt(disc)) / 2;
+        s.l2 = (tr - sqrt(disc)) / 2;
+        s.stable = (tr < 0) ? -1 : 1;
+    } else {
+        if (fabs(tr) <= 1e-6 * sqrt(det))
+            return false; // weak focus or center
+        s.type = STRONG_FOCUS;
+        s.l1 = tr / 2;
+        s.l2 = sqrt(-disc) / 2;
+        s.stable = (tr < 0) ? -1 : 1;
+    }
+    return true;
+}
+
+// vector field in the coordinates (u,v) given by (x,y) = (x0,y0) + A (u,v)
+static void transform_field(const poly2 *f, double x0, double y0,
+                            const double *A, poly2 *g)
+{
+    int d = std::max(poly_degree(f[0]), poly_degree(f[1]));
+    std::vector<poly2> X(d + 1), Y(d + 1);
+    poly2 x, y;
+    poly_add(x, 0, 0, x0);
+    poly_add(x, 1, 0, A[0]);
+    poly_add(x, 0, 1, A[1]);
+    poly_add(y, 0, 0, y0);
+    poly_add(y, 1, 0, A[2]);
+    poly_add(y, 0, 1, A[3]);
+    poly_add(X[0], 0, 0, 1.0);
+    poly_add(Y[0], 0, 0, 1.0);
+    for (int k = 1; k <= d; k++) {
+        X[k] = poly_mul(X[k - 1], x);
+        Y[k] = poly_mul(Y[k - 1], y);
+    }
+
+    poly2 h[2];
+    for (int c = 0; c < 2; c++)
+        for (poly2::const_iterator it = f[c].begin(); it != f[c].end(); ++it)
+            h[c] = poly_sum(h[c],
+                            poly_mul(X[it->first.first], Y[it->first.second]),
+                            it->second);
+
+    double det = A[0] * A[3] - A[1] * A[2];
+    g[0] = poly_sum(poly_scale(h[0], A[3] / det), h[1], -A[1] / det);
+    g[1] = poly_sum(poly_scale(h[0], -A[2] / det), h[1], A[0] / det);
+    poly_clean(g[0], 1e-12);
+    poly_clean(g[1], 1e-12);
+}
+
+// p(t,f(t)) truncated at the given order
+static std::vector<double> compose_curve(const poly2 &p,
+                                         const std::vector<double> &f,
+                                         int order)
+{
+    std::vector<std::vector<double>> fp(1, std::vector<double>(order + 1, 0));
+    std::vector<double> r(order + 1, 0);
+    fp[0][0] = 1;
+
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it) {
+        int i = it->first.first;
+        int j = it->first.second;
+        if (i > order)
+            continue;
+        while ((int)fp.size() <= j) {
+            // next power of f, f starts at order 2
+            const std::vector<double> &last = fp.back();
+            std::vector<double> next(order + 1, 0);
+            for (int a = 0; a <= order; a++)
+                for (int b = 2; a + b <= order; b++)
+                    next[a + b] += last[a] * f[b];
+            fp.push_back(next);
+        }
+        for (int k = 0; i + k <= order; k++)
+            r[i + k] += it->second * fp[j][k];
+    }
+    return r;
+}
+
+// Taylor coefficients of the invariant curve v = f(u) tangent to the u axis
+// of u' = l1 u + g1(u,v), v' = l2 v + g2(u,v), obtained order by order
+// from f'(u) u' = v'
+static std::vector<double> invariant_curve(const poly2 *g, double l1,
+                                           double l2, int order)
+{
+    poly2 h[2];
+    for (int c = 0; c < 2; c++)
+        for (poly2::const_iterator it = g[c].begin(); it != g[c].end(); ++it)
+            if (it->first.first + it->first.second >= 2)
+                poly_add(h[c], it->first.first, it->first.second, it->second);
+
+    std::vector<double> f(order + 1, 0);
+    for (int k = 2; k <= order; k++) {
+        std::vector<double> s1 = compose_curve(h[0], f, k);
+        std::vector<double> s2 = compose_curve(h[1], f, k);
+        double r = -s2[k];
+        for (int j = 2; j < k; j++)
+            r += j * f[j] * s1[k - j + 1];
+        f[k] = -r / (k * l1 - l2);
+    }
+    return f;
+}
+
+// linearize the vector field at a singular point and fill in its record;
+// side is 0 for finite points, and for points at infinity the sign of the
+// second coordinate on the visible side of the chart
+static bool study_point(const poly2 *vf, int chart, double x0, double y0,
+                        int side, int order, singpoint &s)
+{
+    double J[4];
+    J[0] = poly_eval(poly_diff(vf[0], 0), x0, y0);
+    J[1] = poly_eval(poly_diff(vf[0], 1), x0, y0);
+    J[2] = poly_eval(poly_diff(vf[1], 0), x0, y0);
+    J[3] = poly_eval(poly_diff(vf[1], 1), x0, y0);
+
+    s.chart = chart;
+    s.x0 = x0;
+    s.y0 = y0;
+    if (!classify(J, s))
+        return false;
+    if (s.type != SADDLE)
+        return true;
+
+    if (side != 0) {
+        // at infinity only the separatrice that leaves the line at
+        // infinity is drawn, it is the first one
+        if (fabs(s.a[2]) < fabs(s.a[3])) {
+            std::swap(s.a[0], s.a[1]);
+            std::swap(s.a[2], s.a[3]);
+            std::swap(s.l1, s.l2);
+            std::swap(s.type1, s.type2);
+        }
+        if (s.a[2] * side < 0) {
+            s.a[0] = -s.a[0];
+            s.a[2] = -s.a[2];
+        }
+    }
+
+    transform_field(vf, x0, y0, s.a, s.vf);
+    s.sep1 = invariant_curve(s.vf, s.l1, s.l2, order);
+    poly2 swapped[2] = {poly_swap(s.vf[1]), poly_swap(s.vf[0])};
+    s.sep2 = invariant_curve(swapped, s.l2, s.l1, order);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+//                      CHARTS OF THE POINCARE SPHERE
+// -----------------------------------------------------------------------
+//
+// (P,Q) of degree d, written in the charts of the Poincaré sphere and
+// multiplied by z2^(d-1):
+//   U1: x=1/z2, y=z1/z2        V1: x=-1/z2, y=z1/z2
+//   U2: x=z1/z2, y=1/z2        V2: x=z1/z2, y=-1/z2
+
+static void chart_fields(const poly2 &p, const poly2 &q, int d, poly2 *U1,
+                         poly2 *V1, poly2 *U2, poly2 *V2)
+{
+    for (int c = 0; c < 2; c++) {
+        const poly2 &f = c == 0 ? p : q;
+        for (poly2::const_iterator it = f.begin(); it != f.end(); ++it) {
+            int i = it->first.first;
+            int j = it->first.second;
+            int e = d - i - j;
+            double a = it->second;
+            double si = (i % 2 == 0) ? a : -a;
+            double sj = (j % 2 == 0) ? a : -a;
+            if (c == 0) {
+                // terms of P
+                poly_add(U1[0], j + 1, e, -a);
+                poly_add(U1[1], j, e + 1, -a);
+                poly_add(V1[0], j + 1, e, si);
+                poly_add(V1[1], j, e + 1, si);
+                poly_add(U2[0], i, e, a);
+                poly_add(V2[0], i, e, sj);
+            } else {
+                // terms of Q
+                poly_add(U1[0], j, e, a);
+                poly_add(V1[0], j, e, si);
+                poly_add(U2[0], i + 1, e, -a);
+                poly_add(U2[1], i, e + 1, -a);
+                poly_add(V2[0], i + 1, e, sj);
+                poly_add(V2[1], i, e + 1, sj);
+            }
+        }
+    }
+}
+
+// singular points at infinity of a chart U1 or U2, and their copies in the
+// opposite chart, where the vector field is the same up to the factor
+// (-1)^(d-1) (V1 and V2 points are given in the coordinates of U1 and U2)
+static bool infinite_point(const poly2 *U, int d, int chart, int opposite,
+                           double z1, int order, std::vector<singpoint> &pts)
+{
+    poly2 V[2] = {poly_scale(U[0], (d % 2 == 1) ? 1.0 : -1.0),
+                  poly_scale(U[1], (d % 2 == 1) ? 1.0 : -1.0)};
+    singpoint s;
+    if (!study_point(U, chart, z1, 0, 1, order, s))
+        return false;
+    pts.push_back(s);
+    if (!study_point(V, opposite, z1, 0, -1, order, s))
+        return false;
+    pts.push_back(s);
+    return true;
+}
+
+// -----------------------------------------------------------------------
+//                      OUTPUT
+// -----------------------------------------------------------------------
+
+static void write_poly2(FILE *fp, const poly2 &p)
+{
+    int n = 0;
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        if (it->second != 0)
+            n++;
+    if (n == 0) {
+        // the readers expect at least one term
+        fprintf(fp, "1 0 0 0\n");
+        return;
+    }
+    fprintf(fp, "%d", n);
+    for (poly2::const_iterator it = p.begin(); it != p.end(); ++it)
+        if (it->second != 0)
+            fprintf(fp, " %d %d %.17g", it->first.first, it->first.second,
+                    it->second);
+    fprintf(fp, "\n");
+}
+
+static void write_term1(FILE *fp, const std::vector<double> &f)
+{
+    int n = 0;
+    for (size_t k = 2; k < f.size(); k++)
+        if (f[k] != 0)
+            n++;
+    if (n == 0) {
+        fprintf(fp, "1 1 0\n");
+        return;
+    }
+    fprintf(fp, "%d", n);
+    for (size_t k = 2; k < f.size(); k++)
+        if (f[k] != 0)
+            fprintf(fp, " %d %.17g", (int)k, f[k]);
+    fprintf(fp, "\n");
+}
+
+static void write_points(FILE *fp, const std::vector<singpoint> &pts,
+                         double epsilon)
+{
+    fprintf(fp, "%d\n", (int)pts.size());
+    for (size_t i = 0; i < pts.size(); i++) {
+        const singpoint &s = pts[i];
+        switch (s.type) {
+        case SADDLE:
+            fprintf(fp, "%d\n%.17g %.17g\n%.17g %.17g %.17g %.17g\n", SADDLE,
+                    s.x0, s.y0, s.a[0], s.a[1], s.a[2], s.a[3]);
+            write_poly2(fp, s.vf[0]);
+            write_poly2(fp, s.vf[1]);
+            fprintf(fp, "%d\n%d ", s.chart, s.type1);
+            write_term1(fp, s.sep1);
+            if (s.chart == CHART_R2) {
+                fprintf(fp, "%d ", s.type2);
+                write_term1(fp, s.sep2);
+            }
+            fprintf(fp, "%.17g\n", epsilon);
+            break;
+        case NODE:
+            fprintf(fp, "%d\n%.17g %.17g %d %d\n", NODE, s.x0, s.y0, s.stable,
+                    s.chart);
+            break;
+        case STRONG_FOCUS:
+            fprintf(fp, "%d\n%d %.17g %.17g %d\n", STRONG_FOCUS, s.stable,
+                    s.x0, s.y0, s.chart);
+            break;
+        }
+    }
+}
+
+static void write_summary(FILE *fp, const std::vector<singpoint> &pts)
+{
+    static const char *charts[] = {"", "U1 ", "U2 ", "V1 ", "V2 "};
+    for (size_t i = 0; i < pts.size(); i++) {
+        const singpoint &s = pts[i];
+        fprintf(fp, "%s(%.8g, %.8g): ", charts[s.chart], s.x0, s.y0);
+        switch (s.type) {
+        case SADDLE:
+            fprintf(fp, "saddle, eigenvalues %.8g, %.8g\n", s.l1, s.l2);
+            break;
+        case NODE:
+            fprintf(fp, "%s node, eigenvalues %.8g, %.8g\n",
+                    s.stable == -1 ? "stable" : "unstable", s.l1, s.l2);
+            break;
+        case STRONG_FOCUS:
+            fprintf(fp, "%s strong focus, eigenvalues %.8g +- %.8g i\n",
+                    s.stable == -1 ? "stable" : "unstable", s.l1, s.l2);
+            break;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+//                      CHARTS OF CURVES
+// -----------------------------------------------------------------------
+//
+// A curve f(x,y)=0 of weighted degree d (the largest p*i+q*j of its terms),
+// written in the charts of the Poincaré-Lyapunov sphere and multiplied by
+// z2^d or r^d:
+//   U1: x=1/z2^p, y=z1/z2^q        V1: x=-1/z2^p, y=z1/z2^q
+//   U2: x=z1/z2^p, y=1/z2^q        V2: x=z1/z2^p, y=-1/z2^q
+//   cylinder: x=cos(t)/r^p, y=sin(t)/r^q
+
+static void curve_charts(const poly2 &f, int p, int q, int d, poly2 &U1,
+                         poly2 &V1, poly2 &U2, poly2 &V2)
+{
+    for (poly2::const_iterator it = f.begin(); it != f.end(); ++it) {
+        int i = it->first.first;
+        int j = it->first.second;
+        int e = d - p * i - q * j;
+        double a = it->second;
+        poly_add(U1, j, e, a);
+        poly_add(V1, j, e, (i % 2 == 0) ? a : -a);
+        poly_add(U2, i, e, a);
+        poly_add(V2, i, e, (j % 2 == 0) ? a : -a);
+    }
+}
+
+// the terms r^(d-p*i-q*j) cos(t)^i sin(t)^j of the curve in the cylinder
+static void write_cylinder(FILE *fp, const poly2 &f, int p, int q, int d)
+{
+    if (f.empty()) {
+        fprintf(fp, "1 0 0 0 0\n");
+        return;
+    }
+    fprintf(fp, "%d", (int)f.size());
+    for (poly2::const_iterator it = f.begin(); it != f.end(); ++it)
+        fprintf(fp, " %d %d %d %.17g",
+                d - p * it->first.first - q * it->first.second,
+                it->first.first, it->first.second, it->second);
+    fprintf(fp, "\n");
+}
+
+// values of the parameters, false if one of them is not a number
+static bool parameter_values(const std::vector<std::string> &labels,
+                             const std::vector<std::string> &values,
+                             std::map<std::string, double> &consts)
+{
+    for (size_t i = 0; i < labels.size() && i < values.size(); i++) {
+        if (labels[i].empty())
+            continue;
+        poly2 v;
+        if (!parse_poly(values[i], consts, v) || !poly_is_constant(v)) {
+            g_globalLogger.debug("[findsing] cannot evaluate parameter " +
+                                 labels[i]);
+            return false;
+        }
+        consts[labels[i]] = poly_constant(v);
+    }
+    return true;
+}
+
+bool write_curve_table(std::string fname, std::string curve,
+                       const std::vector<std::string> &labels,
+                       const std::vector<std::string> &values, int p, int q)
+{
+    std::map<std::string, double> consts;
+    poly2 f;
+    if (p < 1 || q < 1 || !parameter_values(labels, values, consts) ||
+        !parse_poly(curve, consts, f)) {
+        g_globalLogger.debug("[findsing] curve is not a numeric polynomial");
+        return false;
+    }
+
+    int d = 0;
+    for (poly2::const_iterator it = f.begin(); it != f.end(); ++it)
+        d = std::max(d, p * it->first.first + q * it->first.second);
+    poly2 U1, V1, U2, V2;
+    curve_charts(f, p, q, d, U1, V1, U2, V2);
+
+    // the same table the Maple script would have written, a curve of
+    // degree 0 is rejected by its reader
+    FILE *fp = fopen(fname.c_str(), "w");
+    if (fp == nullptr)
+        return false;
+    fprintf(fp, "%d\n", poly_degree(f));
+    write_poly2(fp, f);
+    write_poly2(fp, U1);
+    write_poly2(fp, U2);
+    write_poly2(fp, V1);
+    write_poly2(fp, V2);
+    if (p != 1 || q != 1)
+        write_cylinder(fp, f, p, q, d);
+    fclose(fp);
+
+    g_globalLogger.debug("[findsing] wrote chart table " + fname);
+    return true;
+}
+
+bool find_singularities(std::string fname, std::string xeq, std::string yeq,
+                        const std::vector<std::string> &labels,
+                        const std::vector<std::string> &values, double epsilon,
+                        int order)
+{
+    std::map<std::string, double> consts;
+    if (!parameter_values(labels, values, consts))
+        return false;
+
+    poly2 f[2];
+    if (!parse_poly(xeq, consts, f[0]) || !parse_poly(yeq, consts, f[1])) {
+        g_globalLogger.debug("[findsing] vector field is not a numeric "
+                             "polynomial");
+        return false;
+    }
+    int d = std::max(poly_degree(f[0]), poly_degree(f[1]));
+    if (d < 0)
+        return false;
+    order = std::max(2, std::min(order, 20));
+
+    // finite region
+    std::vector<std::pair<double, double>> coords;
+    if (!finite_points(f[0], f[1], coords)) {
+        g_globalLogger.debug("[findsing] cannot isolate finite singular "
+                             "points");
+        return false;
+    }
+    std::vector<singpoint> fin;
+    for (size_t i = 0; i < coords.size(); i++) {
+        singpoint s;
+        if (!study_point(f, CHART_R2, coords[i].first, coords[i].second, 0,
+                         order, s)) {
+            g_globalLogger.debug("[findsing] finite singular point is not "
+                                 "hyperbolic");
+            return false;
+        }
+        fin.push_back(s);
+    }
+
+    // infinite region: roots of the U1 vector field on z2=0 with |z1|<=1,
+    // the remaining directions are looked for in U2
+    poly2 U1[2], V1[2], U2[2], V2[2];
+    chart_fields(f[0], f[1], d, U1, V1, U2, V2);
+    std::vector<cplx> axis1 = coefficients_on_axis(U1[0]);
+    std::vector<cplx> axis2 = coefficients_on_axis(U2[0]);
+    std::vector<cplx> roots;
+    if (!poly1_roots(axis1, roots)) {
+        g_globalLogger.debug("[findsing] line of singular points at "
+                             "infinity");
+        return false;
+    }
+    std::vector<rootgroup> groups = group_roots(roots);
+    std::vector<singpoint> inf1, inf2;
+    for (size_t i = 0; i < groups.size(); i++) {
+        int real = root_is_real(groups[i].z);
+        if (real < 0)
+            return false;
+        if (real == 0)
+            continue;
+        double z = groups[i].z.real();
+        bool ok;
+        if (fabs(z) <= 1)
+            ok = infinite_point(U1, d, CHART_U1, CHART_V1, newton1(axis1, z),
+                                order, inf1);
+        else
+            ok = infinite_point(U2, d, CHART_U2, CHART_V2,
+                                newton1(axis2, 1 / z), order, inf2);
+        if (!ok) {
+            g_globalLogger.debug("[findsing] infinite singular point is not "
+                                 "hyperbolic");
+            return false;
+        }
+    }
+    if (axis2[0] == 0.0 &&
+        !infinite_point(U2, d, CHART_U2, CHART_V2, 0, order, inf2)) {
+        g_globalLogger.debug("[findsing] infinite singular point is not "
+                             "hyperbolic");
+        return false;
+    }
+
+    // write the files the Maple script would have written
+    FILE *fp = fopen((fname + "_vec.tab").c_str(), "w");
+    if (fp == nullptr)
+        return false;
+    fprintf(fp, "%d 1 1\n0\n", TYPEOFSTUDY_ALL);
+    write_poly2(fp, f[0]);
+    write_poly2(fp, f[1]);
+    write_poly2(fp, U1[0]);
+    write_poly2(fp, U1[1]);
+    write_poly2(fp, V1[0]);
+    write_poly2(fp, V1[1]);
+    write_poly2(fp, U2[0]);
+    write_poly2(fp, U2[1]);
+    write_poly2(fp, V2[0]);
+    write_poly2(fp, V2[1]);
+    // no line of singularities at infinity, the vector field in the
+    // opposite charts is multiplied by (-1)^(d-1)
+    fprintf(fp, "0 %d\n", (d % 2 == 1) ? 1 : -1);
+    fclose(fp);
+
+    fp = fopen((fname + "_fin.tab").c_str(), "w");
+    if (fp == nullptr)
+        return false;
+    write_points(fp, fin, epsilon);
+    fclose(fp);
+
+    fp = fopen((fname + "_inf.tab").c_str(), "w");
+    if (fp == nullptr)
+        return false;
+    write_points(fp, inf1, epsilon);
+    write_points(fp, inf2, epsilon);
+    fclose(fp);
+
+    fp = fopen((fname + "_fin.res").c_str(), "w");
+    if (fp != nullptr) {
+        write_summary(fp, fin);
+        fclose(fp);
+    }
+    fp = fopen((fname + "_inf.res").c_str(), "w");
+    if (fp != nullptr) {
+        write_summary(fp, inf1);
+        write_summary(fp, inf2);
+        fclose(fp);
+    }
+    fp = fopen((fname + ".res").c_str(), "w");
+    if (fp != nullptr) {
+        fprintf(fp, "Numeric study of the vector field\n");
+        fprintf(fp, "  x' = %s\n  y' = %s\n", xeq.c_str(), yeq.c_str());
+        fprintf(fp, "All singular points are hyperbolic.\n\n");
+        fprintf(fp, "FINITE SINGULAR POINTS (%d)\n", (int)fin.size());
+        write_summary(fp, fin);
+        fprintf(fp, "\nSINGULAR POINTS AT INFINITY (%d)\n",
+                (int)(inf1.size() + inf2.size()));
+        write_summary(fp, inf1);
+        write_summary(fp, inf2);
+        fclose(fp);
+    }
+
+    g_globalLogger.debug("[findsing] computed study " + fname + " with " +
+                         std::to_string(fin.size()) + " finite and " +
+                         std::to_string(inf1.size() + inf2.size()) +
+                         " infinite singular points");
+    return true;
+}
@@ -0,0 +1,85 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATH_FINDSING_H
+#define MATH_FINDSING_H
+
+/*!
+ * @brief Native computation of the singular points of a numeric study
+ * @file math_findsing.h
+ *
+ * When a vector field is studied numerically on the Poincaré sphere and all
+ * its singular points are hyperbolic, the tables written by the P4 Maple
+ * library can be computed in floating point arithmetic: the finite
+ * singular points are the common roots of x' and y' (found through their
+ * resultant and refined with Newton), the infinite ones are the roots of
+ * the chart vector fields on the line at infinity, and saddles get their
+ * separatrices as Taylor series of the invariant manifolds.
+ *
+ * Anything that needs symbolic work (semi-hyperbolic, non-elementary and
+ * weak focus points, lines of singularities, parameters without a value)
+ * makes the native study fail, and the caller falls back to Maple.
+ *
+ * The tables of curves and isoclines in every chart are obtained in the
+ * same way, substituting the chart coordinates in the parsed polynomial.
+ */
+
+#include <string>
+#include <vector>
+
+/**
+ * Compute a numeric study without Maple
+ *
+ * @param fname   filename of the study (without extension), the results
+ *                are written to the same .res and .tab files that the
+ *                Maple script would write
+ * @param xeq     x' polynomial
+ * @param yeq     y' polynomial
+ * @param labels  names of the parameters of the vector field
+ * @param values  values of the parameters
+ * @param epsilon radius around saddles where separatrices start
+ * @param order   order of the Taylor approximation of separatrices
+ * @return        @c true if the study was computed, @c false if it has to
+ * be done by Maple
+ */
+bool find_singularities(std::string fname, std::string xeq, std::string yeq,
+                        const std::vector<std::string> &labels,
+                        const std::vector<std::string> &values, double epsilon,
+                        int order);
+
+/**
+ * Write the table of a curve in the charts of the sphere without Maple
+ *
+ * @param fname  name of the table file (_veccurve.tab or _vecisoclines.tab)
+ * @param curve  polynomial of the curve, f(x,y)=0
+ * @param labels names of the parameters of the curve
+ * @param values values of the parameters
+ * @param p      weight of x in the Poincaré-Lyapunov compactification
+ * @param q      weight of y in the Poincaré-Lyapunov compactification
+ * @return       @c true if the table was written, @c false if the curve
+ * has to be prepared by Maple
+ *
+ * The table holds the curve in the plane, in the charts U1, U2, V1 and V2,
+ * and in the cylinder when the weights are not 1, as read by
+ * WVFStudy::readCurve().
+ */
+bool write_curve_table(std::string fname, std::string curve,
+                       const std::vector<std::string> &labels,
+                       const std::vector<std::string> &values, int p, int q);
+
+#endif // MATH_FINDSING_H
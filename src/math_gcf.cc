@@ -21,14 +21,47 @@
 
 #include "MyLogger.h"
 #include "ScriptHandler.h"
+#include "ThreadPool.h"
 #include "custom.h"
+#include "math_curvetrace.h"
 #include "math_p4.h"
+#include "math_polynom.h"
 #include "plot_tools.h"
 
-#include <cmath>
+#include <Wt/WServer>
 
-// static global variables
-static int s_GcfDashes = 1;
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// rectangle of the chart of each gcf, curve and isocline task (the same one
+// the Maple scripts use), the polynomial traced in it (0 for the plane, 1
+// for U1, 2 for U2 and 3 for the cylinder) and its map to the sphere
+struct trace_chart {
+    int coords;
+    double x1, x2, y1, y2;
+    int poly;
+    void (WVFStudy::*map)(double, double, double *);
+};
+
+static const trace_chart s_traceCharts[EVAL_GCF_FINISHLYAPUNOV] = {
+    {TRACE_PLANE, 0, 0, 0, 0, 0, nullptr},
+    {TRACE_PLANE, -1, 1, -1, 1, 0, &WVFStudy::R2_to_psphere},
+    {TRACE_PLANE, -1, 1, 0, 1, 1, &WVFStudy::U1_to_psphere},
+    {TRACE_PLANE, -1, 1, 0, 1, 2, &WVFStudy::U2_to_psphere},
+    {TRACE_PLANE, -1, 1, -1, 0, 1, &WVFStudy::VV1_to_psphere},
+    {TRACE_PLANE, -1, 1, -1, 0, 2, &WVFStudy::VV2_to_psphere},
+    {TRACE_PLANE, 0, 0, 0, 0, 0, nullptr},
+    {TRACE_POLAR, 0, 1, 0, TWOPI, 0, &WVFStudy::rplane_plsphere0},
+    {TRACE_CYLINDER, 0, 1, -PI_DIV4, PI_DIV4, 3,
+     &WVFStudy::cylinder_to_plsphere},
+    {TRACE_CYLINDER, 0, 1, PI_DIV4, PI - PI_DIV4, 3,
+     &WVFStudy::cylinder_to_plsphere},
+    {TRACE_CYLINDER, 0, 1, PI - PI_DIV4, PI + PI_DIV4, 3,
+     &WVFStudy::cylinder_to_plsphere},
+    {TRACE_CYLINDER, 0, 1, -PI + PI_DIV4, -PI_DIV4, 3,
+     &WVFStudy::cylinder_to_plsphere}};
 
 // function definitions
 void WVFStudy::rplane_plsphere0(double x, double y, double *pcoord)
@@ -37,33 +70,33 @@ void WVFStudy::rplane_plsphere0(double x, double y, double *pcoord)
 }
 
 bool WSphere::evalGcfStart(std::string fname, int dashes, int points,
-                           int precis)
+                           int precis, std::function<void(bool)> done)
 {
-    if (study_->gcf_points_ != nullptr) {
-        study_->deleteOrbitPoint(study_->gcf_points_);
-        study_->gcf_points_ = nullptr;
-    }
+    study_->gcf_points_.clear();
 
-    if (study_->plweights_)
+    int last;
+    if (study_->plweights_) {
         gcfTask_ = EVAL_GCF_LYP_R2;
-    else
+        last = EVAL_GCF_FINISHLYAPUNOV;
+    } else {
         gcfTask_ = EVAL_GCF_R2;
+        last = EVAL_GCF_FINISHPOINCARE;
+    }
 
     gcfError_ = false;
-    s_GcfDashes = dashes;
-    if (runTask(fname, gcfTask_, points, precis) < 0)
-        return false;
-    return true;
+    gcfDashes_ = dashes;
+    return runTasks(fname, gcfTask_, last, points, precis,
+                    &WSphere::prepareTask, done);
 }
 
 // returns true when finished.  Then run EvalGCfFinish to see if error occurred
 // or not
-bool WSphere::evalGcfContinue(std::string fname, int points, int prec)
+bool WSphere::evalGcfContinue(std::string fname)
 {
     if (gcfTask_ == EVAL_GCF_NONE)
         return true;
 
-    if (!readTaskResults(fname, gcfTask_)) {
+    if (!readTaskResults(taskFileName(fname, gcfTask_), gcfTask_)) {
         gcfError_ = true;
         g_globalLogger.error("[WSphere] error at gcf readTaskResults");
         return true;
@@ -74,12 +107,6 @@ bool WSphere::evalGcfContinue(std::string fname, int points, int prec)
         return true;
     }
 
-    if (runTask(fname, gcfTask_, points, prec) < 0) {
-        gcfError_ = true;
-        g_globalLogger.error("[WSphere] error at gcf runTask");
-        return true;
-    }
-
     return false; // still busy
 }
 
@@ -97,11 +124,147 @@ bool WSphere::evalGcfFinish(void) // return false in case an error occured
     return true;
 }
 
-int WSphere::runTask(std::string fname, int task, int points, int prec)
+std::string WSphere::taskFileName(std::string fname, int task)
+{
+    return fname + "_" + std::to_string(task);
+}
+
+bool WSphere::runTasks(std::string fname, int first, int last, int points,
+                       int prec,
+                       bool (WSphere::*prepare)(std::string, int, int, int),
+                       std::function<void(bool)> done)
+{
+    // every chart task writes its own files, so they can all run at once
+    std::vector<std::string> fnames;
+    for (int task = first; task < last; task++) {
+        std::string taskFname = taskFileName(fname, task);
+        if (!(this->*prepare)(taskFname, task, points, prec))
+            return false;
+        fnames.push_back(taskFname);
+    }
+
+    std::shared_ptr<bool> alive = alive_;
+    scriptHandler_->evaluateMapleScriptsAsync(
+        fnames, 60, [alive, done](std::vector<siginfo_t> status) {
+            // the sphere may have been replaced while Maple was running
+            if (!*alive)
+                return;
+            bool ok = true;
+            for (size_t i = 0; i < status.size(); i++) {
+                if (status[i].si_status < 0)
+                    ok = false;
+            }
+            done(ok);
+        });
+    return true;
+}
+
+bool WSphere::nativeCurves()
+{
+    Wt::WServer *server = Wt::WServer::instance();
+    std::string value;
+
+    return server == nullptr ||
+           !server->readConfigurationProperty("native-curves", value) ||
+           value == "true";
+}
+
+void WSphere::traceTasks(int points, int prec, P4POLYNOM2 r2, P4POLYNOM2 u1,
+                         P4POLYNOM2 u2, P4POLYNOM3 c,
+                         void (WVFStudy::*insert)(double, double, double,
+                                                  int),
+                         int dashes)
+{
+    int first, last;
+    if (study_->plweights_) {
+        first = EVAL_GCF_LYP_R2;
+        last = EVAL_GCF_FINISHLYAPUNOV;
+    } else {
+        first = EVAL_GCF_R2;
+        last = EVAL_GCF_FINISHPOINCARE;
+    }
+
+    flatpoly flat[4];
+    flatten_term2(r2, &flat[0]);
+    flatten_term2(u1, &flat[1]);
+    flatten_term2(u2, &flat[2]);
+    flatten_term3(c, &flat[3]);
+
+    std::vector<std::vector<std::vector<double>>> paths(last - first);
+    std::vector<ThreadPool::Task> tasks;
+    for (int task = first; task < last; task++) {
+        tasks.push_back([&flat, &paths, first, task, points, prec]() {
+            const trace_chart &chart = s_traceCharts[task];
+            trace_curve(flat[chart.poly], chart.coords, chart.x1, chart.x2,
+                        chart.y1, chart.y2, points, prec,
+                        &paths[task - first]);
+        });
+    }
+    g_threadPool.run(tasks);
+
+    // the points are added in the order of the charts, like read_gcf does
+    double pcoord[3];
+    for (int task = first; task < last; task++) {
+        const std::vector<std::vector<double>> &chart = paths[task - first];
+        for (size_t i = 0; i < chart.size(); i++) {
+            for (size_t k = 0; k < chart[i].size(); k += 2) {
+                (study_->*s_traceCharts[task].map)(chart[i][k],
+                                                   chart[i][k + 1], pcoord);
+                (study_->*insert)(pcoord[0], pcoord[1], pcoord[2],
+                                  (k == 0) ? 0 : dashes);
+            }
+        }
+    }
+}
+
+void WSphere::computeGcf(std::function<void(bool)> done)
+{
+    if (gcfTask_ != EVAL_GCF_NONE) {
+        g_globalLogger.error("[WSphere] previous evaluation still running");
+        done(false);
+        return;
+    }
+    if (nativeCurves()) {
+        study_->gcf_points_.clear();
+        traceTasks(gcfNPoints_, gcfPrec_, study_->gcf_, study_->gcf_U1_,
+                   study_->gcf_U2_, study_->gcf_C_,
+                   &WVFStudy::insert_gcf_point, gcfDashes_);
+        g_globalLogger.debug("[WSphere] traced Gcf");
+        done(true);
+        return;
+    }
+    bool started = evalGcfStart(
+        gcfFname_, gcfDashes_, gcfNPoints_, gcfPrec_, [this, done](bool ok) {
+            if (!ok) {
+                gcfError_ = true;
+                g_globalLogger.error("[WSphere] error running gcf tasks");
+            }
+            // read the charts in order, stop at the first error
+            int i = 0;
+            while (!gcfError_ && !evalGcfContinue(gcfFname_))
+                i++;
+            if (gcfError_)
+                g_globalLogger.error("[WSphere] error while computing "
+                                     "evalGcfContinue at step: " +
+                                     std::to_string(i));
+            bool result = evalGcfFinish();
+            if (result)
+                g_globalLogger.debug("[WSphere] computed Gcf");
+            done(result);
+        });
+    if (!started) {
+        g_globalLogger.error("[WSphere] cannot compute Gcf");
+        gcfTask_ = EVAL_GCF_NONE;
+        done(false);
+    }
+}
+
+bool WSphere::prepareTask(std::string fname, int task, int points,
+                          int prec)
 {
     bool value;
 
-    g_globalLogger.debug("[WSphere] will run GCF task=" +
+    g_globalLogger.debug("[WSphere] will prepare GCF task=" +
                          std::to_string(task) + " using file=" + fname);
 
     switch (task) {
@@ -150,10 +313,7 @@ int WSphere::runTask(std::string fname, int task, int points, int prec)
         break;
     }
 
-    if (value)
-        return scriptHandler_->evaluateMapleScript(fname, 60).si_status;
-    else
-        return -1;
+    return value;
 }
 
 bool WSphere::readTaskResults(std::string fname, int task)
@@ -200,38 +360,28 @@ bool WSphere::readTaskResults(std::string fname, int task)
     return value;
 }
 
-void WSphere::draw_gcf(orbits_points *sep, int color, int dashes)
+void WSphere::draw_gcf(const OrbitPolyline &sep, int color, int dashes)
 {
-    double pcoord[3];
-
-    while (sep != nullptr) {
-        if (sep->dashes && dashes)
-            (*plot_l)(this, pcoord, sep->pcoord, color);
-        else
-            (*plot_p)(this, sep->pcoord, color);
-        copy_x_into_y(sep->pcoord, pcoord);
-
-        sep = sep->next_point;
+    double pcoord[3], point[3];
+
+    for (size_t k = 0; k < sep.spans(); k++) {
+        OrbitPolyline::span s = sep.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, point);
+            if (s.dashes(i) && dashes)
+                (*plot_l)(this, pcoord, point, color);
+            else
+                (*plot_p)(this, point, color);
+            copy_x_into_y(point, pcoord);
+        }
     }
 }
 
 void WVFStudy::insert_gcf_point(double x0, double y0, double z0, int dashes)
 {
-    if (gcf_points_ != nullptr) {
-        last_gcf_point_->next_point = new orbits_points;
-        last_gcf_point_ = last_gcf_point_->next_point;
-    } else {
-        last_gcf_point_ = new orbits_points;
-        gcf_points_ = last_gcf_point_;
-    }
-
-    last_gcf_point_->pcoord[0] = x0;
-    last_gcf_point_->pcoord[1] = y0;
-    last_gcf_point_->pcoord[2] = z0;
+    double pcoord[3] = {x0, y0, z0};
 
-    last_gcf_point_->dashes = dashes;
-    last_gcf_point_->color = CSING;
-    //last_gcf_point_->next_point = nullptr;
+    gcf_points_.append(pcoord, CSING, dashes);
 }
 
 bool WSphere::read_gcf(std::string fname,
@@ -258,7 +408,7 @@ bool WSphere::read_gcf(std::string fname,
             (study_->*chart)(x, y, pcoord);
             study_->insert_gcf_point(pcoord[0], pcoord[1], pcoord[2], d);
             // d=1;
-            d = s_GcfDashes;
+            d = gcfDashes_;
         }
         for (c = getc(fp); isspace(c);)
             c = getc(fp);
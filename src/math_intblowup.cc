@@ -36,41 +36,34 @@
 
 #include "math_intblowup.h"
 
+#include "math_events.h"
+#include "math_numerics.h"
 #include "math_p4.h"
 #include "math_polynom.h"
 #include "math_separatrice.h"
-#include "plot_tools.h"
-
-// static global variables
-/* To get rid of this, we would have to change the interface of
-    WVFStudy::rk78 and add a void pointer in which to pass any
-    additional arguments if needed (and this means we would
-    have to change the interface of any function passed to
-    rk78 to match this change)
-*/
-static struct term2 *vec_field[2];
 
 // function definitions
-void WVFStudy::eval_blow_vec_field(double *y, double *f)
-{
-    f[0] = eval_term2(vec_field[0], y);
-    f[1] = eval_term2(vec_field[1], y);
-}
-
-struct orbits_points *
-integrate_blow_up(WSphere *spherewnd, // double x0, double y0,
-                  double *pcoord2, struct blow_up_points *de_sep, double step,
-                  int dir, int type, struct orbits_points **orbit, int chart)
+int integrate_blow_up(WSphere *spherewnd, struct blow_up_points *de_sep,
+                      double step, int dir, int type, OrbitPolyline &orbit,
+                      int chart)
 {
     int i;
     double hhi, point[2];
     double pcoord[3];
     double y[2];
-    int color, dashes, ok = true;
-    struct orbits_points *first_orbit_ = nullptr, *last_orbit = nullptr;
+    int color, dashes, event = EVENT_NONE, ok = true;
+    P4POLYNOM2 *vec_field = de_sep->vector_field;
+    // steps in blow-up coordinates cannot be interpolated on the sphere
+    OrbitEvents events(spherewnd, nullptr, false);
+    double hmi = spherewnd->study_->config_hmi_;
+    double hma = spherewnd->study_->config_hma_;
+    double tol = spherewnd->study_->config_tolerance_;
+    flatfield ff;
+    stiff_state stiff;
+
+    // the Jacobian is needed to detect stiffness
+    flatten_field2(nullptr, vec_field, &ff);
 
-    vec_field[0] = de_sep->vector_field[0];
-    vec_field[1] = de_sep->vector_field[1];
     if (spherewnd->study_->plweights_ == false &&
         (chart == CHART_V1 || chart == CHART_V2))
         dir = spherewnd->study_->dir_vec_field_ * dir;
@@ -79,10 +72,21 @@ integrate_blow_up(WSphere *spherewnd, // double x0, double y0,
     y[0] = de_sep->point[0];
     y[1] = de_sep->point[1];
     for (i = 1; i <= spherewnd->study_->config_intpoints_; ++i) {
-        spherewnd->study_->rk78(&WVFStudy::eval_blow_vec_field, y, &hhi,
-                                spherewnd->study_->config_hmi_,
-                                spherewnd->study_->config_hma_,
-                                spherewnd->study_->config_tolerance_);
+        stiff_step(
+            [&ff, hmi, hma, tol](double *b, double *h, double *f0) {
+                return rk78_step(
+                    [&ff](double *c, double *f) {
+                        eval_field2(ff, c, false, false, f);
+                    },
+                    b, h, hmi, hma, tol, f0);
+            },
+            [&ff](const double *b, double *f, double *J) {
+                if (J == nullptr)
+                    eval_field2(ff, b, false, false, f);
+                else
+                    eval_field2_jacobian(ff, b, false, false, f, J);
+            },
+            &stiff, y, &hhi, hmi, hma, tol);
         make_transformations(
             de_sep->trans, de_sep->x0 + de_sep->a11 * y[0] + de_sep->a12 * y[1],
             de_sep->y0 + de_sep->a21 * y[0] + de_sep->a22 * y[1], point);
@@ -178,38 +182,23 @@ integrate_blow_up(WSphere *spherewnd, // double x0, double y0,
             break;
         }
 
-        if (last_orbit == nullptr) {
-            first_orbit_ = new orbits_points;
-            last_orbit = first_orbit_;
-        } else {
-            last_orbit->next_point = new orbits_points;
-            last_orbit = last_orbit->next_point;
-        }
-        last_orbit->pcoord[0] = pcoord[0];
-        last_orbit->pcoord[1] = pcoord[1];
-        last_orbit->pcoord[2] = pcoord[2];
-        last_orbit->color = color;
-        last_orbit->dashes = dashes * spherewnd->study_->config_dashes_;
-        last_orbit->dir = ((spherewnd->study_->plweights_ == false) &&
-                           (chart == CHART_V1 || chart == CHART_V2))
-                              ? spherewnd->study_->dir_vec_field_ * dir
-                              : dir;
-        last_orbit->type = type;
-        last_orbit->next_point = nullptr;
-        if (last_orbit->dashes)
-            (*plot_l)(spherewnd, pcoord, pcoord2, color);
-        else
-            (*plot_p)(spherewnd, pcoord, color);
+        event = events.check(pcoord, hhi, nullptr);
+        dashes *= spherewnd->study_->config_dashes_;
+        orbit.append(pcoord, color, dashes,
+                     ((spherewnd->study_->plweights_ == false) &&
+                      (chart == CHART_V1 || chart == CHART_V2))
+                         ? spherewnd->study_->dir_vec_field_ * dir
+                         : dir,
+                     type);
 
         if (y[0] * y[0] + y[1] * y[1] >= 1.0) {
             de_sep->blow_up_vec_field = false;
             break;
         }
-        copy_x_into_y(pcoord, pcoord2);
+        if (event != EVENT_NONE)
+            break;
     }
     de_sep->point[0] = y[0];
     de_sep->point[1] = y[1];
-    *orbit = last_orbit;
-
-    return (first_orbit_);
+    return event;
 }
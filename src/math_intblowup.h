@@ -48,17 +48,17 @@
 /**
  * Integrate blowup separatrices for a non elementary singular point
  * @param  spherewnd sphere object of the study
- * @param  pcoord2   coordinates in Poincaré sphere
  * @param  de_sep    blowup separatrices
  * @param  step      step size for integration
  * @param  dir       direction for integration
  * @param  type      stability type of singularity
- * @param  orbit     linked list where last orbit will be stored
+ * @param  orbit     polyline where the integrated points are appended
  * @param  chart     chart in which to perform computations
- * @return           pointer to first orbit
+ * @return           event that ended the integration (see math_events.h),
+ *                   EVENT_NONE if it can be continued
  */
-orbits_points *integrate_blow_up(WSphere *spherewnd, double *pcoord2,
-                                 blow_up_points *de_sep, double step, int dir,
-                                 int type, orbits_points **orbit, int chart);
+int integrate_blow_up(WSphere *spherewnd, blow_up_points *de_sep,
+                      double step, int dir, int type, OrbitPolyline &orbit,
+                      int chart);
 
 #endif // MATH_INTBLOWUP_H
@@ -26,34 +26,36 @@
 #include "plot_tools.h"
 
 #include <cmath>
-
-// static global variables
-static int s_IsoclineDashes = 1;
+#include <functional>
 
 // function definitions
 bool WSphere::evalIsoclineStart(std::string fname, int dashes, int points,
-                             int precis)
+                                int precis, std::function<void(bool)> done)
 {
-    if (study_->plweights_)
+    int last;
+    if (study_->plweights_) {
         isoclineTask_ = EVAL_CURVE_LYP_R2;
-    else
+        last = EVAL_CURVE_FINISHLYAPUNOV;
+    } else {
         isoclineTask_ = EVAL_CURVE_R2;
+        last = EVAL_CURVE_FINISHPOINCARE;
+    }
 
     isoclineError_ = false;
-    s_IsoclineDashes = dashes;
-    if (runTaskIsocline(fname, isoclineTask_, points, precis) < 0)
-        return false;
-    return true;
+    isoclineDashes_ = dashes;
+    return runTasks(fname, isoclineTask_, last, points, precis,
+                    &WSphere::prepareTaskIsocline, done);
 }
 
 // returns true when finished.  Then run EvalGCfFinish to see if error occurred
 // or not
-bool WSphere::evalIsoclineContinue(std::string fname, int points, int prec)
+bool WSphere::evalIsoclineContinue(std::string fname)
 {
     if (isoclineTask_ == EVAL_CURVE_NONE)
         return true;
 
-    if (!readTaskIsoclineResults(fname, isoclineTask_)) {
+    if (!readTaskIsoclineResults(taskFileName(fname, isoclineTask_),
+                                 isoclineTask_)) {
         isoclineError_ = true;
         g_globalLogger.error("[WSphere] error at isocline readTaskIsoclineResults");
         return true;
@@ -64,12 +66,6 @@ bool WSphere::evalIsoclineContinue(std::string fname, int points, int prec)
         return true;
     }
 
-    if (runTaskIsocline(fname, isoclineTask_, points, prec) < 0) {
-        isoclineError_ = true;
-        g_globalLogger.error("[WSphere] error at isocline runTaskIsocline");
-        return true;
-    }
-
     return false; // still busy
 }
 
@@ -85,11 +81,55 @@ bool WSphere::evalIsoclineFinish(void) // return false in case an error occured
     return true;
 }
 
-int WSphere::runTaskIsocline(std::string fname, int task, int points, int prec)
+void WSphere::computeIsocline(std::function<void(bool)> done)
+{
+    if (isoclineTask_ != EVAL_CURVE_NONE) {
+        g_globalLogger.error("[WSphere] previous evaluation still running");
+        done(false);
+        return;
+    }
+    if (nativeCurves()) {
+        const isoclines &last = study_->isocline_vector_.back();
+        traceTasks(isoclineNPoints_, isoclinePrec_, last.r2, last.u1,
+                   last.u2, last.c, &WVFStudy::insert_isocline_point,
+                   isoclineDashes_);
+        g_globalLogger.debug("[WSphere] traced isocline");
+        done(true);
+        return;
+    }
+    bool started = evalIsoclineStart(
+        isoclineFname_, isoclineDashes_, isoclineNPoints_, isoclinePrec_,
+        [this, done](bool ok) {
+            if (!ok) {
+                isoclineError_ = true;
+                g_globalLogger.error("[WSphere] error running isocline tasks");
+            }
+            // read the charts in order, stop at the first error
+            int i = 0;
+            while (!isoclineError_ && !evalIsoclineContinue(isoclineFname_))
+                i++;
+            if (isoclineError_)
+                g_globalLogger.error("[WSphere] error while computing "
+                                     "evalIsoclineContinue at step: " +
+                                     std::to_string(i));
+            bool result = evalIsoclineFinish();
+            if (result)
+                g_globalLogger.debug("[WSphere] computed isocline");
+            done(result);
+        });
+    if (!started) {
+        g_globalLogger.error("[WSphere] cannot evaluate isocline");
+        isoclineTask_ = EVAL_CURVE_NONE;
+        done(false);
+    }
+}
+
+bool WSphere::prepareTaskIsocline(std::string fname, int task, int points,
+                                  int prec)
 {
     bool value;
 
-    g_globalLogger.debug("[WSphere] will run isocline task=" +
+    g_globalLogger.debug("[WSphere] will prepare isocline task=" +
                          std::to_string(task) + " using file=" + fname);
     // TODO: prepareIsocline functions
     switch (task) {
@@ -142,10 +182,7 @@ int WSphere::runTaskIsocline(std::string fname, int task, int points, int prec)
         break;
     }
 
-    if (value)
-        return scriptHandler_->evaluateMapleScript(fname, 60).si_status;
-    else
-        return -1;
+    return value;
 }
 
 bool WSphere::readTaskIsoclineResults(std::string fname, int task)
@@ -192,38 +229,28 @@ bool WSphere::readTaskIsoclineResults(std::string fname, int task)
     return value;
 }
 
-void WSphere::draw_isocline(orbits_points *sep, int color, int dashes)
+void WSphere::draw_isocline(const OrbitPolyline &sep, int color, int dashes)
 {
-    double pcoord[3];
-
-    while (sep != nullptr) {
-        if (sep->dashes && dashes)
-            (*plot_l)(this, pcoord, sep->pcoord, color);
-        else
-            (*plot_p)(this, sep->pcoord, color);
-        copy_x_into_y(sep->pcoord, pcoord);
+    double pcoord[3], point[3];
 
-        sep = sep->next_point;
+    for (size_t k = 0; k < sep.spans(); k++) {
+        OrbitPolyline::span s = sep.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, point);
+            if (s.dashes(i) && dashes)
+                (*plot_l)(this, pcoord, point, color);
+            else
+                (*plot_p)(this, point, color);
+            copy_x_into_y(point, pcoord);
+        }
     }
 }
 
 void WVFStudy::insert_isocline_point(double x0, double y0, double z0, int dashes)
 {
-    if (isocline_vector_.back().points != nullptr) {
-        last_isoclines_point_->next_point = new orbits_points;
-        last_isoclines_point_ = last_isoclines_point_->next_point;
-    } else {
-        last_isoclines_point_ = new orbits_points;
-        isocline_vector_.back().points = last_isoclines_point_;
-    }
-
-    last_isoclines_point_->pcoord[0] = x0;
-    last_isoclines_point_->pcoord[1] = y0;
-    last_isoclines_point_->pcoord[2] = z0;
+    double pcoord[3] = {x0, y0, z0};
 
-    last_isoclines_point_->dashes = dashes;
-    last_isoclines_point_->color = CCURV;
-    last_isoclines_point_->next_point = nullptr;
+    isocline_vector_.back().points.append(pcoord, CCURV, dashes);
 }
 
 bool WSphere::read_isocline(std::string fname,
@@ -251,7 +278,7 @@ bool WSphere::read_isocline(std::string fname,
             (study_->*chart)(x, y, pcoord);
             study_->insert_isocline_point(pcoord[0], pcoord[1], pcoord[2], d);
             // d=1;
-            d = s_IsoclineDashes;
+            d = isoclineDashes_;
         }
         for (c = getc(fp); isspace(c);)
             c = getc(fp);
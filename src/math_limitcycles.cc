@@ -0,0 +1,366 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "math_limitcycles.h"
+
+#include "MyLogger.h"
+#include "ThreadPool.h"
+#include "WSphere.h"
+#include "file_tab.h"
+
+#include "custom.h"
+#include "math_events.h"
+#include "math_p4.h"
+#include "plot_tools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// iterations of the secant method on the return map
+#define LC_ITERATIONS 50
+// secant iterations with steps of exact size that refine a crossing of the
+// section after the bisection on the interpolant of the step
+#define LC_CROSSING_ITERATIONS 3
+// a displacement larger than this many times the tolerance at the end of
+// the refinement is a jump of the return map, not a fixed point
+#define LC_JUMP 1000
+// two fixed points closer than this many times the tolerance belong to the
+// same cycle
+#define LC_SAME LC_JUMP
+
+// transverse section, its points are (x0,y0) + s*(dx,dy) with (dx,dy) a
+// unit vector and 0 <= s <= len
+struct section {
+    WVFStudy *study;
+    double x0, y0, dx, dy, len;
+    double a, b, c; // line a*x+b*y+c=0 of the section
+};
+
+static void section_point(const section &sec, double s, double *pcoord)
+{
+    (sec.study->*(sec.study->R2_to_sphere))(sec.x0 + s * sec.dx,
+                                            sec.y0 + s * sec.dy, pcoord);
+}
+
+// positive on one side of the line of the section and negative on the other
+static double section_side(const section &sec, double *pcoord)
+{
+    return (sec.study->*(sec.study->eval_lc))(pcoord, sec.a, sec.b, sec.c);
+}
+
+// parameter of the projection of a point of the sphere on the section, NaN
+// or out of [0,len] if the point is not on the section
+static double section_param(const section &sec, double *pcoord)
+{
+    double ucoord[2];
+
+    (sec.study->*(sec.study->sphere_to_R2))(pcoord[0], pcoord[1], pcoord[2],
+                                            ucoord);
+    return (ucoord[0] - sec.x0) * sec.dx + (ucoord[1] - sec.y0) * sec.dy;
+}
+
+// step of size theta*h from p, with the integrator of the orbit in ss
+static double exact_step(const section &sec, const double *p, double h,
+                         double theta, const stiff_state &ss, double *q)
+{
+    WVFStudy *study = sec.study;
+    chart_state cs;
+    double hhi = theta * h;
+    int dashes, dir;
+
+    if (hhi == 0) {
+        copy_x_into_y((double *)p, q);
+    } else {
+        cs.stiff = ss;
+        (study->*(study->integrate_sphere_orbit))(p[0], p[1], p[2], q, &hhi,
+                                                  &dashes, &dir, fabs(hhi),
+                                                  fabs(hhi), &cs);
+    }
+    return section_side(sec, q);
+}
+
+// point where the last step of an orbit, which started at p, crosses the
+// line of the section
+static void locate_crossing(const section &sec, const double *p,
+                            chart_state *cs, double *pcoord)
+{
+    double lo = 0, hi = 1, mid, t0, t1, g, g0, g1, q[3];
+    int i;
+
+    g0 = section_side(sec, (double *)p);
+    for (i = 0; i < EVENT_BISECTIONS; i++) {
+        mid = (lo + hi) / 2;
+        sec.study->chart_step_point(cs, mid, q);
+        if ((section_side(sec, q) < 0) == (g0 < 0))
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    // the interpolant is only third order, so the return map would be too
+    // noisy for the secant method without this
+    t0 = lo;
+    t1 = hi;
+    g0 = exact_step(sec, p, cs->h, t0, cs->stiff, q);
+    g1 = exact_step(sec, p, cs->h, t1, cs->stiff, pcoord);
+    for (i = 0; i < LC_CROSSING_ITERATIONS && g1 != 0 && g1 != g0; i++) {
+        mid = t1 - g1 * (t1 - t0) / (g1 - g0);
+        g = exact_step(sec, p, cs->h, mid, cs->stiff, pcoord);
+        t0 = t1;
+        g0 = g1;
+        t1 = mid;
+        g1 = g;
+    }
+}
+
+// first return to the section of the orbit through the point s of the
+// section, integrated forwards (dir=1) or backwards (dir=-1), in the
+// direction it left the section; false if it does not come back in
+// config_lc_numpoints_ steps. The points of the orbit are appended to orbit
+// if it is not null
+static bool return_map(const section &sec, int dir0, double s, double *r,
+                       OrbitPolyline *orbit)
+{
+    WVFStudy *study = sec.study;
+    chart_state cs;
+    double pcoord[3], prev[3], q[3], hhi, g, gprev = 0, side = 0;
+    int k, dashes, dir;
+
+    section_point(sec, s, pcoord);
+    hhi = dir0 * study->config_step_;
+    for (k = 0; k < study->config_lc_numpoints_; k++) {
+        copy_x_into_y(pcoord, prev);
+        (study->*(study->integrate_sphere_orbit))(
+            prev[0], prev[1], prev[2], pcoord, &hhi, &dashes, &dir,
+            study->config_hmi_, study->config_hma_, &cs);
+        dir *= (orbit == nullptr || orbit->empty()) ? 1 : orbit->lastDir();
+        dashes *= study->config_dashes_;
+
+        g = section_side(sec, pcoord);
+        if (side == 0) {
+            side = g;
+        } else if (gprev * side < 0 && g * side >= 0 &&
+                   cs.stepchart != CHART_NONE) {
+            // the orbit crosses the line of the section, but it may be
+            // outside of the section
+            locate_crossing(sec, prev, &cs, q);
+            *r = section_param(sec, q);
+            if (*r >= 0 && *r <= sec.len) {
+                if (orbit != nullptr)
+                    orbit->append(q, CLIMIT, dashes, dir);
+                return true;
+            }
+        }
+        gprev = g;
+        if (orbit != nullptr)
+            orbit->append(pcoord, CLIMIT, dashes, dir);
+    }
+    return false;
+}
+
+// limit cycle with its fixed point between s0 and s1, where the
+// displacement P(s)-s of the return map in direction dir takes the values
+// d0 and d1 of opposite sign, by the Illinois variant of the secant method
+static bool refine_cycle(const section &sec, int dir, double s0, double d0,
+                         double s1, double d1, orbits *cycle)
+{
+    double tol = sec.study->config_tolerance_, s, d, r;
+
+    for (int i = 0; i < LC_ITERATIONS; i++) {
+        if (fabs(d1) < tol || fabs(s1 - s0) < tol)
+            break;
+        s = s1 - d1 * (s1 - s0) / (d1 - d0);
+        if (!return_map(sec, dir, s, &r, nullptr))
+            return false;
+        d = r - s;
+        if (d * d1 < 0) {
+            s0 = s1;
+            d0 = d1;
+        } else {
+            d0 /= 2;
+        }
+        s1 = s;
+        d1 = d;
+    }
+    if (fabs(d1) > LC_JUMP * tol)
+        return false;
+
+    section_point(sec, s1, cycle->pcoord);
+    cycle->color = CLIMIT;
+    return return_map(sec, dir, s1, &r, &cycle->points);
+}
+
+int searchLimitCycle(WVFStudy *study, double x0, double y0, double x1,
+                     double y1, double grid, std::vector<orbits> *result)
+{
+    std::vector<ThreadPool::Task> tasks;
+    std::vector<double> seed, disp;
+    std::vector<int> back, valid;
+    std::vector<orbits> cycles;
+    std::vector<size_t> bracket;
+    section sec;
+    int n, i, j, found;
+
+    sec.study = study;
+    sec.x0 = x0;
+    sec.y0 = y0;
+    sec.len = sqrt((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+    if (sec.len == 0 || !(grid > 0))
+        return 0;
+    sec.dx = (x1 - x0) / sec.len;
+    sec.dy = (y1 - y0) / sec.len;
+    sec.a = -sec.dy;
+    sec.b = sec.dx;
+    sec.c = -(sec.a * x0 + sec.b * y0);
+
+    n = (int)std::min(ceil(sec.len / grid), (double)MAX_LCORBITS);
+    n = std::max(n, MIN_LCORBITS);
+
+    // displacement of every seed forwards (j=i) and backwards (j=n+1+i),
+    // since the orbits next to an unstable cycle only come back backwards;
+    // each one is a task
+    seed.resize(n + 1);
+    disp.resize(2 * (n + 1));
+    back.resize(2 * (n + 1));
+    for (i = 0; i <= n; i++)
+        seed[i] = sec.len * i / n;
+    for (j = 0; j < 2 * (n + 1); j++) {
+        tasks.push_back([&sec, &seed, &disp, &back, n, j]() {
+            int i = j % (n + 1);
+            double r;
+            back[j] = return_map(sec, j > n ? -1 : 1, seed[i], &r, nullptr);
+            disp[j] = back[j] ? r - seed[i] : 0;
+        });
+    }
+    g_threadPool.run(tasks);
+
+    // a sign change between two seeds that come back encloses a fixed point
+    // of the return map, each one is refined in a task; a cycle found in
+    // both directions is only refined forwards
+    for (j = 0; j < 2 * (n + 1) - 1; j++) {
+        if (j == n || !back[j] || !back[j + 1] ||
+            (disp[j] < 0) == (disp[j + 1] < 0))
+            continue;
+        if (j > n && std::find(bracket.begin(), bracket.end(),
+                               (size_t)(j - n - 1)) != bracket.end())
+            continue;
+        bracket.push_back(j);
+    }
+    cycles.resize(bracket.size());
+    valid.resize(bracket.size());
+    tasks.clear();
+    for (size_t k = 0; k < bracket.size(); k++) {
+        tasks.push_back(
+            [&sec, &seed, &disp, &valid, &cycles, &bracket, n, k]() {
+                int j = (int)bracket[k], i = j % (n + 1);
+                valid[k] = refine_cycle(sec, j > n ? -1 : 1, seed[i], disp[j],
+                                        seed[i + 1], disp[j + 1], &cycles[k]);
+            });
+    }
+    g_threadPool.run(tasks);
+
+    found = 0;
+    for (size_t k = 0; k < cycles.size(); k++) {
+        if (!valid[k])
+            continue;
+        result->push_back(std::move(cycles[k]));
+        found++;
+    }
+    return found;
+}
+
+int addLimitCycles(WVFStudy *study, std::vector<orbits> &cycles)
+{
+    std::vector<orbits> &known = study->limit_cycle_vector_;
+    double tol = LC_SAME * study->config_tolerance_, p[2], q[2];
+    int added = 0;
+
+    for (size_t k = 0; k < cycles.size(); k++) {
+        (study->*(study->sphere_to_R2))(
+            cycles[k].pcoord[0], cycles[k].pcoord[1], cycles[k].pcoord[2], p);
+        bool same = false;
+        for (size_t i = 0; i < known.size() && !same; i++) {
+            (study->*(study->sphere_to_R2))(
+                known[i].pcoord[0], known[i].pcoord[1], known[i].pcoord[2], q);
+            same = hypot(p[0] - q[0], p[1] - q[1]) < tol;
+        }
+        if (same)
+            continue;
+        known.push_back(std::move(cycles[k]));
+        added++;
+    }
+    return added;
+}
+
+void WSphere::computeLimitCycles(double x0, double y0, double x1, double y1,
+                                 double grid, std::function<void(int)> done)
+{
+    if (limitCycleJob_ != nullptr) {
+        g_globalLogger.error("[WSphere] previous search still running");
+        done(-1);
+        return;
+    }
+
+    // the search only reads study_, which the session leaves alone while
+    // computing(), and the destructor cancels the job before deleting it
+    std::shared_ptr<std::vector<orbits>> cycles =
+        std::make_shared<std::vector<orbits>>();
+    std::shared_ptr<bool> alive = alive_;
+    limitCycleJob_ = g_threadPool.submit(
+        [this, cycles, x0, y0, x1, y1, grid]() {
+            searchLimitCycle(study_, x0, y0, x1, y1, grid, cycles.get());
+        },
+        [this, alive, cycles, done]() {
+            if (!*alive)
+                return;
+            limitCycleJob_ = nullptr;
+            done(addLimitCycles(study_, *cycles));
+        });
+}
+
+void drawLimitCycles(WSphere *spherewnd)
+{
+    std::vector<orbits>::const_iterator it;
+    double pcoord[3], point[3];
+
+    for (it = spherewnd->study_->limit_cycle_vector_.begin();
+         it != spherewnd->study_->limit_cycle_vector_.end(); it++) {
+        copy_x_into_y((double *)it->pcoord, pcoord);
+        (*plot_p)(spherewnd, pcoord, it->color);
+        for (size_t k = 0; k < it->points.spans(); k++) {
+            OrbitPolyline::span s = it->points.getSpan(k);
+            for (int i = 0; i < s.size; i++) {
+                s.point(i, point);
+                if (s.dashes(i))
+                    (*plot_l)(spherewnd, pcoord, point, it->color);
+                else
+                    (*plot_p)(spherewnd, point, it->color);
+                copy_x_into_y(point, pcoord);
+            }
+        }
+    }
+}
+
+void deleteLastLimitCycle(WSphere *spherewnd)
+{
+    if (spherewnd->study_->limit_cycle_vector_.empty())
+        return;
+    spherewnd->study_->limit_cycle_vector_.pop_back();
+}
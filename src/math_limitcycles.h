@@ -0,0 +1,81 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATH_LIMITCYCLES_H
+#define MATH_LIMITCYCLES_H
+
+/*!
+ * @brief Search and plot limit cycles
+ * @file math_limitcycles.h
+ *
+ * A limit cycle crosses a transverse section of the plane once, at a fixed
+ * point of the return map of the section. The section is scanned on a grid
+ * of seeds, the displacement P(s)-s of each seed is computed in parallel on
+ * the worker pool, and every sign change between two seeds is refined with
+ * the secant method. WSphere::computeLimitCycles runs the search outside of
+ * the session.
+ */
+
+#include <vector>
+
+class WSphere;
+class WVFStudy;
+struct orbits;
+
+/**
+ * Search the limit cycles that cross a transverse section
+ *
+ * @param study  study with the vector field, it is not modified
+ * @param x0     x coordinate of the first end of the section
+ * @param y0     y coordinate of the first end of the section
+ * @param x1     x coordinate of the second end of the section
+ * @param y1     y coordinate of the second end of the section
+ * @param grid   distance between two seeds of the section
+ * @param result vector where the cycles found are appended
+ * @return       number of limit cycles found
+ *
+ * The ends of the section are points of the plane. Each seed is integrated
+ * for at most WVFStudy::config_lc_numpoints_ steps, and the cycles found
+ * are appended to @p result with one period of their orbit.
+ */
+int searchLimitCycle(WVFStudy *study, double x0, double y0, double x1,
+                     double y1, double grid, std::vector<orbits> *result);
+/**
+ * Add limit cycles to a study, skipping the ones it already has
+ *
+ * @param study  study where the cycles are added
+ * @param cycles cycles found by searchLimitCycle(), they are moved out
+ * @return       number of limit cycles added
+ *
+ * A cycle is already in WVFStudy::limit_cycle_vector_ if its fixed point is
+ * closer to the fixed point of another one than a small multiple of
+ * WVFStudy::config_tolerance_.
+ */
+int addLimitCycles(WVFStudy *study, std::vector<orbits> &cycles);
+/**
+ * Draw all limit cycles
+ * @param spherewnd sphere object
+ */
+void drawLimitCycles(WSphere *spherewnd);
+/**
+ * Delete the last limit cycle found
+ * @param spherewnd sphere object
+ */
+void deleteLastLimitCycle(WSphere *spherewnd);
+
+#endif // MATH_LIMITCYCLES_H
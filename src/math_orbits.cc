@@ -38,11 +38,15 @@
 #include "file_tab.h"
 
 #include "custom.h"
+#include "math_events.h"
+#include "math_numerics.h"
 #include "math_p4.h"
 #include "math_polynom.h"
+#include "math_taylor.h"
 #include "plot_tools.h"
 
 #include <cmath>
+#include <vector>
 
 // -----------------------------------------------------------------------
 //                      INTEGRATEORBIT
@@ -52,20 +56,16 @@
 
 void WSphere::integrateOrbit(int dir)
 {
-    orbits_points *sep;
     double pcoord[3], ucoord[2];
+    OrbitPolyline &points = study_->orbit_vector_.back().points;
 
     if (dir == 0) {
         // continue orbit button has been pressed
-        dir = study_->orbit_vector_.back().current_f_orbits->dir;
+        dir = points.lastDir();
 
-        copy_x_into_y(study_->orbit_vector_.back().current_f_orbits->pcoord,
-                      pcoord);
-        study_->orbit_vector_.back().current_f_orbits->next_point =
-            integrate_orbit(pcoord, study_->config_currentstep_, dir, CORBIT,
-                            study_->config_intpoints_, &sep);
-
-        study_->orbit_vector_.back().current_f_orbits = sep;
+        points.lastPoint(pcoord);
+        integrate_orbit(pcoord, study_->config_currentstep_, dir, CORBIT,
+                        study_->config_intpoints_, points);
         return;
     }
 
@@ -73,28 +73,13 @@ void WSphere::integrateOrbit(int dir)
     ((study_)->*(study_->sphere_to_R2))(pcoord[0], pcoord[1], pcoord[2],
                                         ucoord);
     if (study_->config_kindvf_ == INTCONFIG_ORIGINAL)
-        if (eval_term2(study_->gcf_, ucoord) < 0)
+        if (eval_flat2(study_->gcf_flat_, ucoord) < 0)
             dir = -dir;
 
-    if (study_->orbit_vector_.back().f_orbits == nullptr) {
-        study_->orbit_vector_.back().f_orbits =
-            integrate_orbit(pcoord, study_->config_step_, dir, CORBIT,
-                            study_->config_intpoints_, &sep);
-    } else {
-        study_->orbit_vector_.back().current_f_orbits->next_point =
-            new orbits_points;
-        study_->orbit_vector_.back().current_f_orbits =
-            study_->orbit_vector_.back().current_f_orbits->next_point;
-        copy_x_into_y(pcoord,
-                      study_->orbit_vector_.back().current_f_orbits->pcoord);
-        study_->orbit_vector_.back().current_f_orbits->dashes = 0;
-        study_->orbit_vector_.back().current_f_orbits->color = CORBIT;
-        study_->orbit_vector_.back().current_f_orbits->dir = dir;
-        study_->orbit_vector_.back().current_f_orbits->next_point =
-            integrate_orbit(pcoord, study_->config_step_, dir, CORBIT,
-                            study_->config_intpoints_, &sep);
-    }
-    study_->orbit_vector_.back().current_f_orbits = sep;
+    if (!points.empty())
+        points.append(pcoord, CORBIT, 0, dir);
+    integrate_orbit(pcoord, study_->config_step_, dir, CORBIT,
+                    study_->config_intpoints_, points);
 }
 
 //// -----------------------------------------------------------------------
@@ -130,23 +115,26 @@ bool WSphere::startOrbit(double x, double y, bool R)
 ////                      DRAWORBIT
 //// -----------------------------------------------------------------------
 
-void WSphere::drawOrbit(double *pcoord, orbits_points *points, int color)
+void WSphere::drawOrbit(double *pcoord, const OrbitPolyline &points,
+                        int color)
 {
-    double pcoord1[3];
+    double pcoord1[3], point[3];
 
     copy_x_into_y(pcoord, pcoord1);
     (*plot_p)(this, pcoord, color);
 
-    while (points != nullptr) {
-        if (points->dashes) {
-            (*plot_l)(this, pcoord1, points->pcoord, color);
-        } else {
-            (*plot_p)(this, points->pcoord, color);
-        }
-
-        copy_x_into_y(points->pcoord, pcoord1);
+    for (size_t k = 0; k < points.spans(); k++) {
+        OrbitPolyline::span s = points.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, point);
+            if (s.dashes(i)) {
+                (*plot_l)(this, pcoord1, point, color);
+            } else {
+                (*plot_p)(this, point, color);
+            }
 
-        points = points->next_point;
+            copy_x_into_y(point, pcoord1);
+        }
     }
 }
 
@@ -159,7 +147,7 @@ void WSphere::drawOrbits()
     std::vector<orbits>::iterator it;
     for (it = study_->orbit_vector_.begin(); it != study_->orbit_vector_.end();
          it++) {
-        drawOrbit(it->pcoord, it->f_orbits, it->color);
+        drawOrbit(it->pcoord, it->points, it->color);
     }
 }
 
@@ -171,163 +159,518 @@ void WSphere::deleteLastOrbit()
 {
     if (study_->orbit_vector_.empty())
         return;
-    study_->deleteOrbitPoint(study_->orbit_vector_.back().f_orbits);
     study_->orbit_vector_.pop_back();
 }
 
+int WVFStudy::poincare_chart(double p0, double p1, double p2)
+{
+    if (p2 > ZCOORD)
+        return CHART_R2;
+    // same sectors as atan2(|p1|,|p0|) < PI_DIV4
+    if (fabs(p1) < fabs(p0))
+        return (p0 > 0) ? CHART_U1 : CHART_V1;
+    return (p1 > 0) ? CHART_U2 : CHART_V2;
+}
+
+void WVFStudy::psphere_to_chart(int chart, double p0, double p1, double p2,
+                                double *y)
+{
+    switch (chart) {
+    case CHART_R2:
+        psphere_to_R2(p0, p1, p2, y);
+        break;
+    case CHART_U1:
+        psphere_to_U1(p0, p1, p2, y);
+        break;
+    case CHART_V1:
+        psphere_to_V1(p0, p1, p2, y);
+        break;
+    case CHART_U2:
+        psphere_to_U2(p0, p1, p2, y);
+        break;
+    case CHART_V2:
+        psphere_to_V2(p0, p1, p2, y);
+        break;
+    }
+}
+
+void WVFStudy::poincare_chart_step(double p0, double p1, double p2,
+                                   double *hhi, double h_min, double h_max,
+                                   chart_state *cs)
+{
+    int chart = poincare_chart(p0, p1, p2);
+    double y0[2], f0[2], h = 0;
+
+    // cs->y is the point the previous step ended at, reuse it unless the
+    // orbit has moved to another chart
+    if (cs->chart != chart) {
+        psphere_to_chart(chart, p0, p1, p2, cs->y);
+        cs->chart = chart;
+    }
+    y0[0] = cs->y[0];
+    y0[1] = cs->y[1];
+    h = chart_step(chart, cs->y, hhi, h_min, h_max, f0, &cs->stiff);
+    record_chart_step(cs, y0, f0, h);
+}
+
+void WVFStudy::lyapunov_chart_step(double p0, double p1, double p2,
+                                   double *hhi, double h_min, double h_max,
+                                   chart_state *cs)
+{
+    double y0[2], f0[2], h;
+
+    // the Poincare-Lyapunov sphere coordinates already are chart coordinates
+    cs->chart = (p0 == 0) ? CHART_R2 : CHART_CYL;
+    cs->y[0] = y0[0] = p1;
+    cs->y[1] = y0[1] = p2;
+    h = chart_step(cs->chart, cs->y, hhi, h_min, h_max, f0, &cs->stiff);
+    record_chart_step(cs, y0, f0, h);
+}
+
+double WVFStudy::explicit_chart_step(int chart, double y[2], double *hh,
+                                     double hmi, double hma, double *f0)
+{
+    if (config_integrator_ == INTEGRATOR_TAYLOR)
+        return taylor(chart, y, hh, hmi, hma, f0);
+
+    switch (chart) {
+    case CHART_U1:
+        return rk78<&WVFStudy::eval_U1_vec_field>(y, hh, hmi, hma,
+                                                  config_tolerance_, f0);
+    case CHART_V1:
+        return rk78<&WVFStudy::eval_V1_vec_field>(y, hh, hmi, hma,
+                                                  config_tolerance_, f0);
+    case CHART_U2:
+        return rk78<&WVFStudy::eval_U2_vec_field>(y, hh, hmi, hma,
+                                                  config_tolerance_, f0);
+    case CHART_V2:
+        return rk78<&WVFStudy::eval_V2_vec_field>(y, hh, hmi, hma,
+                                                  config_tolerance_, f0);
+    case CHART_CYL:
+        return rk78<&WVFStudy::eval_vec_field_cyl>(y, hh, hmi, hma,
+                                                   config_tolerance_, f0);
+    default:
+        return rk78<&WVFStudy::eval_r_vec_field>(y, hh, hmi, hma,
+                                                 config_tolerance_, f0);
+    }
+}
+
+double WVFStudy::chart_step(int chart, double y[2], double *hh, double hmi,
+                            double hma, double *f0, stiff_state *ss)
+{
+    bool withgcf = (config_kindvf_ == INTCONFIG_ORIGINAL);
+    bool timesy;
+    const flatfield &ff = *chart_field(chart, &timesy);
+
+    return stiff_step(
+        [this, chart, hmi, hma](double *b, double *h, double *f) {
+            return explicit_chart_step(chart, b, h, hmi, hma, f);
+        },
+        [&ff, withgcf, timesy](const double *b, double *f, double *J) {
+            if (ff.nvars == 3) {
+                if (J == nullptr)
+                    eval_field3(ff, b, withgcf, f);
+                else
+                    eval_field3_jacobian(ff, b, withgcf, f, J);
+            } else {
+                if (J == nullptr)
+                    eval_field2(ff, b, withgcf, timesy, f);
+                else
+                    eval_field2_jacobian(ff, b, withgcf, timesy, f, J);
+            }
+        },
+        ss, y, hh, hmi, hma, config_tolerance_, f0);
+}
+
+void WVFStudy::record_chart_step(chart_state *cs, const double *y0,
+                                 const double *f0, double h)
+{
+    cs->stepchart = cs->chart;
+    cs->y0[0] = y0[0];
+    cs->y0[1] = y0[1];
+    cs->f0[0] = f0[0];
+    cs->f0[1] = f0[1];
+    cs->y1[0] = cs->y[0];
+    cs->y1[1] = cs->y[1];
+    cs->hasf1 = false;
+    cs->h = h;
+}
+
+void WVFStudy::eval_chart_vec_field(int chart, double *y, double *f)
+{
+    switch (chart) {
+    case CHART_R2:
+        eval_r_vec_field(y, f);
+        break;
+    case CHART_U1:
+        eval_U1_vec_field(y, f);
+        break;
+    case CHART_V1:
+        eval_V1_vec_field(y, f);
+        break;
+    case CHART_U2:
+        eval_U2_vec_field(y, f);
+        break;
+    case CHART_V2:
+        eval_V2_vec_field(y, f);
+        break;
+    case CHART_CYL:
+        eval_vec_field_cyl(y, f);
+        break;
+    }
+}
+
+const flatfield *WVFStudy::chart_field(int chart, bool *timesy)
+{
+    // same fields as eval_chart_vec_field
+    *timesy = (config_kindvf_ == INTCONFIG_ORIGINAL && singinf_);
+    switch (chart) {
+    case CHART_U1:
+        return &vec_field_U1_fused_;
+    case CHART_V1:
+        return &vec_field_V1_fused_;
+    case CHART_U2:
+        return &vec_field_U2_fused_;
+    case CHART_V2:
+        return &vec_field_V2_fused_;
+    case CHART_CYL:
+        *timesy = false;
+        return &vec_field_C_fused_;
+    default:
+        *timesy = false;
+        return &f_vec_field_fused_;
+    }
+}
+
+double WVFStudy::taylor(int chart, double y[2], double *hh, double hmi,
+                        double hma, double *f0)
+{
+    bool timesy;
+    const flatfield *ff = chart_field(chart, &timesy);
+
+    return taylor_step(*ff, config_kindvf_ == INTCONFIG_ORIGINAL, timesy,
+                       config_taylor_order_, y, hh, hmi, hma,
+                       config_tolerance_, f0);
+}
+
+void WVFStudy::chart_to_sphere(int chart, const double *y, double *pcoord)
+{
+    double theta;
+
+    switch (chart) {
+    case CHART_R2:
+        if (plweights_)
+            R2_to_plsphere(y[0], y[1], pcoord);
+        else
+            R2_to_psphere(y[0], y[1], pcoord);
+        break;
+    case CHART_U1:
+        U1_to_psphere(y[0], y[1], pcoord);
+        break;
+    case CHART_V1:
+        V1_to_psphere(y[0], y[1], pcoord);
+        break;
+    case CHART_U2:
+        U2_to_psphere(y[0], y[1], pcoord);
+        break;
+    case CHART_V2:
+        V2_to_psphere(y[0], y[1], pcoord);
+        break;
+    case CHART_CYL:
+        theta = y[1];
+        if (theta >= TWOPI)
+            theta -= TWOPI;
+        cylinder_to_plsphere(y[0], theta, pcoord);
+        break;
+    }
+}
+
+bool WVFStudy::chart_step_point(chart_state *cs, double theta, double *pcoord)
+{
+    double y[2];
+
+    if (cs->stepchart == CHART_NONE)
+        return false;
+    if (!cs->hasf1) {
+        y[0] = cs->y1[0];
+        y[1] = cs->y1[1];
+        eval_chart_vec_field(cs->stepchart, y, cs->f1);
+        cs->hasf1 = true;
+    }
+    rk78_dense(cs->y0, cs->f0, cs->y1, cs->f1, cs->h, theta, y);
+    chart_to_sphere(cs->stepchart, y, pcoord);
+    return true;
+}
+
+bool WVFStudy::poincare_chart_to_psphere(chart_state *cs, double *pcoord)
+{
+    double *y = cs->y;
+
+    if (cs->chart == CHART_R2) {
+        R2_to_psphere(y[0], y[1], pcoord);
+        return true;
+    }
+    if (y[1] >= 0 || !singinf_) {
+        switch (cs->chart) {
+        case CHART_U1:
+            U1_to_psphere(y[0], y[1], pcoord);
+            break;
+        case CHART_V1:
+            V1_to_psphere(y[0], y[1], pcoord);
+            break;
+        case CHART_U2:
+            U2_to_psphere(y[0], y[1], pcoord);
+            break;
+        case CHART_V2:
+            V2_to_psphere(y[0], y[1], pcoord);
+            break;
+        }
+        return true;
+    }
+
+    // the orbit crossed the line of singularities at infinity, the step
+    // jumps to the other side of the sphere and cannot be interpolated
+    cs->stepchart = CHART_NONE;
+    switch (cs->chart) {
+    case CHART_U1:
+        VV1_to_psphere(y[0], y[1], pcoord);
+        cs->chart = CHART_V1;
+        break;
+    case CHART_V1:
+        UU1_to_psphere(y[0], y[1], pcoord);
+        cs->chart = CHART_U1;
+        break;
+    case CHART_U2:
+        VV2_to_psphere(y[0], y[1], pcoord);
+        cs->chart = CHART_V2;
+        break;
+    case CHART_V2:
+        UU2_to_psphere(y[0], y[1], pcoord);
+        cs->chart = CHART_U2;
+        break;
+    }
+    psphere_to_chart(cs->chart, pcoord[0], pcoord[1], pcoord[2], y);
+    return false;
+}
+
 /*integrate poincare sphere case p=q=1 */
 void WVFStudy::integrate_poincare_orbit(double p0, double p1, double p2,
                                         double *pcoord, double *hhi,
                                         int *dashes, int *dir, double h_min,
-                                        double h_max)
+                                        double h_max, chart_state *cs)
 {
-    double y[2], theta;
+    *dashes = true;
+    *dir = 1;
+    poincare_chart_step(p0, p1, p2, hhi, h_min, h_max, cs);
+    if (!poincare_chart_to_psphere(cs, pcoord)) {
+        if (dir_vec_field_ == 1) {
+            *dir = -1;
+            *hhi = -(*hhi);
+        }
+        *dashes = false;
+    }
+}
 
+/* integrate on the Poincare-Lyapunov sphere */
+void WVFStudy::integrate_lyapunov_orbit(double p0, double p1, double p2,
+                                        double *pcoord, double *hhi,
+                                        int *dashes, int *dir, double h_min,
+                                        double h_max, chart_state *cs)
+{
     *dashes = true;
     *dir = 1;
-    if (pcoord[2] > ZCOORD) {
-        psphere_to_R2(p0, p1, p2, y);
-        rk78(&WVFStudy::eval_r_vec_field, y, hhi, h_min, h_max,
-             config_tolerance_);
-        R2_to_psphere(y[0], y[1], pcoord);
-    } else {
-        theta = atan2(fabs(p1), fabs(p0));
-        if ((theta < PI_DIV4) && (theta > -PI_DIV4)) {
-            if (p0 > 0) {
-                psphere_to_U1(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_U1_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_)
-                    U1_to_psphere(y[0], y[1], pcoord);
-                else {
-                    VV1_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                    }
-                    psphere_to_V1(pcoord[0], pcoord[1], pcoord[2], y);
-                    *dashes = false;
-                }
-            } else {
-                psphere_to_V1(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_V1_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_)
-                    V1_to_psphere(y[0], y[1], pcoord);
-                else {
-                    UU1_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                    }
-                    psphere_to_U1(pcoord[0], pcoord[1], pcoord[2], y);
-                    *dashes = false;
-                }
+    lyapunov_chart_step(p0, p1, p2, hhi, h_min, h_max, cs);
+    chart_to_sphere(cs->chart, cs->y, pcoord);
+}
+
+void WVFStudy::integrate_orbits(int n, double *pcoord, double *hhi,
+                                int *dashes, int *dir, double h_min,
+                                double h_max)
+{
+    std::vector<int> chart(n), order(n);
+    std::vector<double> y0(n), y1(n), hh(n), plr2;
+    bool withgcf = (config_kindvf_ == INTCONFIG_ORIGINAL);
+    const flatfield *field[CHART_CYL] = {
+        &f_vec_field_fused_, &vec_field_U1_fused_, &vec_field_U2_fused_,
+        &vec_field_V1_fused_, &vec_field_V2_fused_};
+    int count[CHART_CYL + 2] = {0};
+    chart_state cs;
+    double y[2], *p;
+    int i, j, k;
+
+    // chart where each orbit takes its step, as in integrate_poincare_orbit
+    // and integrate_lyapunov_orbit
+    for (i = 0; i < n; i++) {
+        p = pcoord + 3 * i;
+        if (plweights_) {
+            chart[i] = (p[0] == 0) ? CHART_R2 : CHART_CYL;
+        } else {
+            chart[i] = poincare_chart(p[0], p[1], p[2]);
+        }
+        count[chart[i] + 1]++;
+    }
+
+    // group the orbits by chart, in chart coordinates
+    for (k = 1; k <= CHART_CYL + 1; k++)
+        count[k] += count[k - 1];
+    for (i = 0; i < n; i++) {
+        p = pcoord + 3 * i;
+        j = count[chart[i]]++;
+        order[j] = i;
+        if (plweights_) {
+            y[0] = p[1];
+            y[1] = p[2];
+        } else {
+            psphere_to_chart(chart[i], p[0], p[1], p[2], y);
+        }
+        y0[j] = y[0];
+        y1[j] = y[1];
+        hh[j] = hhi[i];
+    }
+
+    // count[k] is now the end of the group of chart k
+    for (k = 0, j = 0; k <= CHART_CYL; j = count[k++]) {
+        if (count[k] == j)
+            continue;
+        if (config_integrator_ == INTEGRATOR_TAYLOR) {
+            // the series of each orbit have to be computed on their own
+            for (i = j; i < count[k]; i++) {
+                y[0] = y0[i];
+                y[1] = y1[i];
+                taylor(k, y, &hh[i], h_min, h_max, nullptr);
+                y0[i] = y[0];
+                y1[i] = y[1];
             }
+        } else if (k == CHART_CYL) {
+            rk78_batch(
+                [this, withgcf](int m, const double *b0, const double *b1,
+                                double *f0, double *f1) {
+                    eval_field3_batch(vec_field_C_fused_, m, b0, b1, withgcf,
+                                      f0, f1);
+                },
+                count[k] - j, &y0[j], &y1[j], &hh[j], h_min, h_max,
+                config_tolerance_);
         } else {
-            if (p1 > 0) {
-                psphere_to_U2(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_U2_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_)
-                    U2_to_psphere(y[0], y[1], pcoord);
-                else {
-                    VV2_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                    }
-                    psphere_to_V2(pcoord[0], pcoord[1], pcoord[2], y);
-                    *dashes = false;
-                }
+            const flatfield &ff = *field[k];
+            bool timesy = (k != CHART_R2 && withgcf && singinf_);
+            rk78_batch(
+                [&ff, withgcf, timesy](int m, const double *b0,
+                                       const double *b1, double *f0,
+                                       double *f1) {
+                    eval_field2_batch(ff, m, b0, b1, withgcf, timesy, f0, f1);
+                },
+                count[k] - j, &y0[j], &y1[j], &hh[j], h_min, h_max,
+                config_tolerance_);
+        }
+    }
+
+    // back to the sphere, the orbits in R2 of the Poincare-Lyapunov sphere
+    // all at once
+    if (plweights_ && count[CHART_R2] > 0) {
+        plr2.resize(3 * count[CHART_R2]);
+        R2_to_plsphere_batch(count[CHART_R2], y0.data(), y1.data(),
+                             plr2.data());
+    }
+    for (j = 0; j < n; j++) {
+        i = order[j];
+        p = pcoord + 3 * i;
+        y[0] = y0[j];
+        y[1] = y1[j];
+        dashes[i] = true;
+        dir[i] = 1;
+        if (plweights_) {
+            if (chart[i] == CHART_R2) {
+                copy_x_into_y(&plr2[3 * j], p);
             } else {
-                psphere_to_V2(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_V2_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_)
-                    V2_to_psphere(y[0], y[1], pcoord);
-                else {
-                    UU2_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                    }
-                    psphere_to_U2(pcoord[0], pcoord[1], pcoord[2], y);
-                    *dashes = false;
+                if (y[1] >= TWOPI)
+                    y[1] -= TWOPI;
+                cylinder_to_plsphere(y[0], y[1], p);
+            }
+        } else {
+            cs.chart = chart[i];
+            cs.y[0] = y0[j];
+            cs.y[1] = y1[j];
+            if (!poincare_chart_to_psphere(&cs, p)) {
+                if (dir_vec_field_ == 1) {
+                    dir[i] = -1;
+                    hh[j] = -hh[j];
                 }
+                dashes[i] = false;
             }
         }
+        hhi[i] = hh[j];
     }
 }
 
-/* integrate on the Poincare-Lyapunov sphere */
-void WVFStudy::integrate_lyapunov_orbit(double p0, double p1, double p2,
-                                        double *pcoord, double *hhi,
-                                        int *dashes, int *dir, double h_min,
-                                        double h_max)
+void WSphere::integrate_orbits(int n, double *pcoord, double step,
+                               const int *dir, int color, int points_to_int,
+                               OrbitPolyline **orbit)
 {
-    double y[2];
+    std::vector<double> hhi(n), pc(pcoord, pcoord + 3 * n);
+    std::vector<int> dashes(n), d(n), live(n);
+    std::vector<OrbitEvents> events;
+    double laststep = step;
+    int i, k, h, l, m;
 
-    *dashes = true;
-    *dir = 1;
-    if (p0 == 0) {
-        y[0] = p1;
-        y[1] = p2;
-        rk78(&WVFStudy::eval_r_vec_field, y, hhi, h_min, h_max,
-             config_tolerance_);
-        R2_to_plsphere(y[0], y[1], pcoord);
-    } else {
-        y[0] = p1;
-        y[1] = p2;
-        rk78(&WVFStudy::eval_vec_field_cyl, y, hhi, h_min, h_max,
-             config_tolerance_);
-        if (y[1] >= TWOPI)
-            y[1] -= TWOPI;
-        cylinder_to_plsphere(y[0], y[1], pcoord);
+    if (n <= 0)
+        return;
+    for (i = 0; i < n; i++) {
+        hhi[i] = (double)dir[i] * step;
+        live[i] = i;
+        events.push_back(OrbitEvents(this, pcoord + 3 * i, true));
+    }
+    // pc, hhi and live hold the m orbits that have not met an event yet
+    m = n;
+    for (k = 1; k <= points_to_int && m > 0; ++k) {
+        study_->integrate_orbits(m, pc.data(), hhi.data(), dashes.data(),
+                                 d.data(), study_->config_hmi_,
+                                 study_->config_hma_);
+        laststep = fabs(hhi[m - 1]);
+        for (l = 0, i = 0; l < m; l++) {
+            h = (k == 1) ? dir[live[l]] : orbit[live[l]]->lastDir();
+            orbit[live[l]]->append(&pc[3 * l], color,
+                                   dashes[l] * study_->config_dashes_,
+                                   d[l] * h);
+            copy_x_into_y(&pc[3 * l], pcoord + 3 * live[l]);
+            if (events[live[l]].check(pcoord + 3 * live[l], hhi[l],
+                                      nullptr) != EVENT_NONE)
+                continue;
+            copy_x_into_y(&pc[3 * l], &pc[3 * i]);
+            hhi[i] = hhi[l];
+            live[i++] = live[l];
+        }
+        m = i;
     }
+    study_->set_current_step(laststep);
 }
 
-orbits_points *WSphere::integrate_orbit(double pcoord[3], double step, int dir,
-                                        int color, int points_to_int,
-                                        orbits_points **orbit)
+void WSphere::integrate_orbit(double pcoord[3], double step, int dir,
+                              int color, int points_to_int,
+                              OrbitPolyline &orbit)
 {
     int i, d, h;
-    int dashes;
+    int dashes, event;
     double hhi;
-    double pcoord2[3], h_min, h_max;
-    orbits_points *first_orbit_ = nullptr, *last_orbit = nullptr;
+    double h_min, h_max;
+    chart_state cs;
+    OrbitEvents events(this, pcoord, true);
 
     hhi = (double)dir * step;
     h_min = study_->config_hmi_;
     h_max = study_->config_hma_;
-    copy_x_into_y(pcoord, pcoord2);
     for (i = 1; i <= points_to_int; ++i) {
         ((study_)->*(study_->integrate_sphere_orbit))(
             pcoord[0], pcoord[1], pcoord[2], pcoord, &hhi, &dashes, &d, h_min,
-            h_max);
+            h_max, &cs);
+        event = events.check(pcoord, hhi, &cs);
 
         if ((i % UPDATEFREQ_STEPSIZE) == 0)
             study_->set_current_step(fabs(hhi));
 
-        if (last_orbit == nullptr) {
-            first_orbit_ = new orbits_points;
-            last_orbit = first_orbit_;
-            h = dir;
-        } else {
-            last_orbit->next_point = new orbits_points;
-            h = last_orbit->dir;
-            last_orbit = last_orbit->next_point;
-        }
-
-        copy_x_into_y(pcoord, last_orbit->pcoord);
-        last_orbit->color = color;
-        last_orbit->dashes = dashes * study_->config_dashes_;
-        last_orbit->dir = d * h;
-        last_orbit->next_point = nullptr;
-        copy_x_into_y(pcoord, pcoord2);
+        h = (i == 1) ? dir : orbit.lastDir();
+        orbit.append(pcoord, color, dashes * study_->config_dashes_, d * h);
+        if (event != EVENT_NONE)
+            break;
     }
     study_->set_current_step(fabs(hhi));
-    *orbit = last_orbit;
-
-    return (first_orbit_);
 }
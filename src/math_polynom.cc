@@ -44,8 +44,11 @@
 
 #include "file_tab.h"
 
+#include <algorithm>
 #include <cmath>
+#include <map>
 #include <string.h>
+#include <utility>
 
 using namespace Wt;
 
@@ -140,6 +143,502 @@ double eval_term3(P4POLYNOM3 F, double *value)
     return s;
 }
 
+// -----------------------------------------------------------------------
+//                              FLATTEN_TERM2/3
+// -----------------------------------------------------------------------
+//
+// The terms are sorted by decreasing exponents (first variable first), so
+// that terms sharing the exponent of the first variables are contiguous and
+// each variable can be factored out with Horner's rule.
+
+static void flatten_terms(std::vector<std::pair<std::vector<int>, double>> &t,
+                          int nvars, flatpoly *flat)
+{
+    std::sort(t.begin(), t.end(),
+              [](const std::pair<std::vector<int>, double> &a,
+                 const std::pair<std::vector<int>, double> &b) {
+                  return a.first > b.first;
+              });
+
+    flat->nvars = nvars;
+    flat->exps.clear();
+    flat->coeffs.clear();
+    for (size_t i = 0; i < t.size(); i++) {
+        if (!flat->coeffs.empty() &&
+            std::equal(t[i].first.begin(), t[i].first.end(),
+                       flat->exps.end() - nvars)) {
+            flat->coeffs.back() += t[i].second;
+            continue;
+        }
+        flat->exps.insert(flat->exps.end(), t[i].first.begin(),
+                          t[i].first.end());
+        flat->coeffs.push_back(t[i].second);
+    }
+}
+
+void flatten_term2(P4POLYNOM2 f, flatpoly *flat)
+{
+    std::vector<std::pair<std::vector<int>, double>> t;
+
+    for (; f != nullptr; f = f->next_term2) {
+        std::vector<int> e(2);
+        e[0] = f->exp_x;
+        e[1] = f->exp_y;
+        t.push_back(std::make_pair(e, f->coeff));
+    }
+    flatten_terms(t, 2, flat);
+}
+
+void flatten_term3(P4POLYNOM3 F, flatpoly *flat)
+{
+    std::vector<std::pair<std::vector<int>, double>> t;
+
+    for (; F != nullptr; F = F->next_term3) {
+        std::vector<int> e(3);
+        e[0] = F->exp_r;
+        e[1] = F->exp_Co;
+        e[2] = F->exp_Si;
+        t.push_back(std::make_pair(e, F->coeff));
+    }
+    flatten_terms(t, 3, flat);
+}
+
+// -----------------------------------------------------------------------
+//                              EVAL_FLAT2/3
+// -----------------------------------------------------------------------
+
+// Evaluates the terms [begin,end) of f, which share the exponents of the
+// variables before var, by Horner's rule in variable var.
+static double eval_flat(const flatpoly &f, const double *value, int var,
+                        int begin, int end)
+{
+    const int n = f.nvars;
+    const int *e = f.exps.data();
+    double s = 0.0;
+    double c;
+    int prev = 0;
+    int i, j, k;
+
+    for (i = begin; i < end; i = j) {
+        k = e[i * n + var];
+        j = i + 1;
+        if (var == n - 1) {
+            c = f.coeffs[i];
+        } else {
+            while (j < end && e[j * n + var] == k)
+                j++;
+            c = eval_flat(f, value, var + 1, i, j);
+        }
+        s = (i == begin) ? c : s * ipow(value[var], prev - k) + c;
+        prev = k;
+    }
+    if (prev > 0)
+        s *= ipow(value[var], prev);
+
+    return s;
+}
+
+double eval_flat2(const flatpoly &f, const double *value)
+{
+    return eval_flat(f, value, 0, 0, (int)f.coeffs.size());
+}
+
+double eval_flat3(const flatpoly &F, const double *value)
+{
+    double v[3];
+
+    v[0] = value[0];
+    v[1] = cos(value[1]);
+    v[2] = sin(value[1]);
+    return eval_flat(F, v, 0, 0, (int)F.coeffs.size());
+}
+
+// -----------------------------------------------------------------------
+//                              FLATTEN_FIELD2/3
+// -----------------------------------------------------------------------
+//
+// Each monomial of the gcf or of a component of the vector field gets one
+// entry with three coefficients (gcf, xdot, ydot), zero where the monomial
+// does not appear.
+
+typedef std::map<std::vector<int>, std::vector<double>> monomial_table;
+
+static void add_monomial(monomial_table &t, const std::vector<int> &e,
+                         int which, double coeff)
+{
+    std::vector<double> &c = t[e];
+    if (c.empty())
+        c.assign(3, 0.0);
+    c[which] += coeff;
+}
+
+static void build_field(const monomial_table &t, int nvars, bool hasgcf,
+                        flatfield *ff)
+{
+    monomial_table::const_iterator it;
+    int k;
+
+    ff->nvars = nvars;
+    ff->hasgcf = hasgcf;
+    ff->maxexp[0] = ff->maxexp[1] = ff->maxexp[2] = 0;
+    ff->exps.clear();
+    ff->coeffs.clear();
+    for (it = t.begin(); it != t.end(); ++it) {
+        for (k = 0; k < nvars; k++) {
+            ff->exps.push_back(it->first[k]);
+            ff->maxexp[k] = std::max(ff->maxexp[k], it->first[k]);
+        }
+        ff->coeffs.insert(ff->coeffs.end(), it->second.begin(),
+                          it->second.end());
+    }
+}
+
+void flatten_field2(P4POLYNOM2 gcf, P4POLYNOM2 *vf, flatfield *ff)
+{
+    monomial_table t;
+    std::vector<int> e(2);
+    P4POLYNOM2 f;
+    int i;
+
+    for (f = gcf; f != nullptr; f = f->next_term2) {
+        e[0] = f->exp_x;
+        e[1] = f->exp_y;
+        add_monomial(t, e, 0, f->coeff);
+    }
+    for (i = 0; i < 2; i++) {
+        for (f = vf[i]; f != nullptr; f = f->next_term2) {
+            e[0] = f->exp_x;
+            e[1] = f->exp_y;
+            add_monomial(t, e, i + 1, f->coeff);
+        }
+    }
+    build_field(t, 2, gcf != nullptr, ff);
+}
+
+void flatten_field3(P4POLYNOM3 gcf, P4POLYNOM3 *vf, flatfield *ff)
+{
+    monomial_table t;
+    std::vector<int> e(3);
+    P4POLYNOM3 F;
+    int i;
+
+    for (F = gcf; F != nullptr; F = F->next_term3) {
+        e[0] = F->exp_r;
+        e[1] = F->exp_Co;
+        e[2] = F->exp_Si;
+        add_monomial(t, e, 0, F->coeff);
+    }
+    for (i = 0; i < 2; i++) {
+        for (F = vf[i]; F != nullptr; F = F->next_term3) {
+            e[0] = F->exp_r;
+            e[1] = F->exp_Co;
+            e[2] = F->exp_Si;
+            add_monomial(t, e, i + 1, F->coeff);
+        }
+    }
+    build_field(t, 3, gcf != nullptr, ff);
+}
+
+// -----------------------------------------------------------------------
+//                              EVAL_FIELD2/3
+// -----------------------------------------------------------------------
+
+// powers kept on the stack, larger degrees use the heap
+#define FIELD_STACK_POWERS 64
+
+static void eval_field(const flatfield &ff, const double *value, bool withgcf,
+                       bool timesy, double *f)
+{
+    double stackpw[FIELD_STACK_POWERS];
+    std::vector<double> heappw;
+    double *pw = stackpw;
+    const double *px, *py, *pz;
+    const int *e = ff.exps.data();
+    const double *c = ff.coeffs.data();
+    size_t i, n = ff.coeffs.size() / 3;
+    double g = 0.0, P = 0.0, Q = 0.0;
+    double t, s;
+    int k, j, total;
+    int offs[3] = {0, 0, 0};
+
+    // one table with value[k]^0 .. value[k]^maxexp[k] for each variable
+    total = 0;
+    for (k = 0; k < ff.nvars; k++) {
+        offs[k] = total;
+        total += ff.maxexp[k] + 1;
+    }
+    if (total > FIELD_STACK_POWERS) {
+        heappw.resize(total);
+        pw = heappw.data();
+    }
+    for (k = 0; k < ff.nvars; k++) {
+        pw[offs[k]] = 1.0;
+        for (j = 1; j <= ff.maxexp[k]; j++)
+            pw[offs[k] + j] = pw[offs[k] + j - 1] * value[k];
+    }
+
+    px = pw + offs[0];
+    py = pw + offs[1];
+    if (ff.nvars == 2) {
+        for (i = 0; i < n; i++, e += 2, c += 3) {
+            t = px[e[0]] * py[e[1]];
+            g += c[0] * t;
+            P += c[1] * t;
+            Q += c[2] * t;
+        }
+    } else if (ff.nvars == 3) {
+        pz = pw + offs[2];
+        for (i = 0; i < n; i++, e += 3, c += 3) {
+            t = px[e[0]] * py[e[1]] * pz[e[2]];
+            g += c[0] * t;
+            P += c[1] * t;
+            Q += c[2] * t;
+        }
+    }
+
+    s = (withgcf && ff.hasgcf) ? g : 1.0;
+    if (timesy)
+        s *= value[1];
+    f[0] = s * P;
+    f[1] = s * Q;
+}
+
+void eval_field2(const flatfield &ff, const double *value, bool withgcf,
+                 bool timesy, double *f)
+{
+    eval_field(ff, value, withgcf, timesy, f);
+}
+
+void eval_field3(const flatfield &ff, const double *value, bool withgcf,
+                 double *f)
+{
+    double v[3];
+
+    v[0] = value[0];
+    v[1] = cos(value[1]);
+    v[2] = sin(value[1]);
+    eval_field(ff, v, withgcf, false, f);
+}
+
+// points evaluated together by eval_field_batch
+#define FIELD_BATCH 8
+
+// same as eval_field for n points, value[k] holds variable k of every
+// point; the inner loops run over the points so that they vectorize
+static void eval_field_batch(const flatfield &ff, int n,
+                             const double *const *value, bool withgcf,
+                             bool timesy, double *f0, double *f1)
+{
+    double stackpw[FIELD_STACK_POWERS * FIELD_BATCH];
+    std::vector<double> heappw;
+    double *pw = stackpw;
+    const double *px, *py, *pz;
+    double g[FIELD_BATCH], P[FIELD_BATCH], Q[FIELD_BATCH];
+    double c0, c1, c2, t, s;
+    size_t i, nterms = ff.coeffs.size() / 3;
+    int k, j, l, w, first, total;
+    int offs[3] = {0, 0, 0};
+
+    total = 0;
+    for (k = 0; k < ff.nvars; k++) {
+        offs[k] = total;
+        total += ff.maxexp[k] + 1;
+    }
+    if (total > FIELD_STACK_POWERS) {
+        heappw.resize(total * FIELD_BATCH);
+        pw = heappw.data();
+    }
+
+    for (first = 0; first < n; first += FIELD_BATCH) {
+        w = std::min(FIELD_BATCH, n - first);
+        // row j of the table of variable k holds value[k]^j of each point
+        for (k = 0; k < ff.nvars; k++) {
+            double *row = pw + offs[k] * FIELD_BATCH;
+            for (l = 0; l < w; l++)
+                row[l] = 1.0;
+            for (j = 1; j <= ff.maxexp[k]; j++, row += FIELD_BATCH) {
+                for (l = 0; l < w; l++)
+                    row[FIELD_BATCH + l] = row[l] * value[k][first + l];
+            }
+        }
+        for (l = 0; l < w; l++)
+            g[l] = P[l] = Q[l] = 0.0;
+
+        const int *e = ff.exps.data();
+        const double *c = ff.coeffs.data();
+        for (i = 0; i < nterms; i++, e += ff.nvars, c += 3) {
+            px = pw + (offs[0] + e[0]) * FIELD_BATCH;
+            py = pw + (offs[1] + e[1]) * FIELD_BATCH;
+            c0 = c[0];
+            c1 = c[1];
+            c2 = c[2];
+            if (ff.nvars == 2) {
+                for (l = 0; l < w; l++) {
+                    t = px[l] * py[l];
+                    g[l] += c0 * t;
+                    P[l] += c1 * t;
+                    Q[l] += c2 * t;
+                }
+            } else {
+                pz = pw + (offs[2] + e[2]) * FIELD_BATCH;
+                for (l = 0; l < w; l++) {
+                    t = px[l] * py[l] * pz[l];
+                    g[l] += c0 * t;
+                    P[l] += c1 * t;
+                    Q[l] += c2 * t;
+                }
+            }
+        }
+
+        for (l = 0; l < w; l++) {
+            s = (withgcf && ff.hasgcf) ? g[l] : 1.0;
+            if (timesy)
+                s *= value[1][first + l];
+            f0[first + l] = s * P[l];
+            f1[first + l] = s * Q[l];
+        }
+    }
+}
+
+void eval_field2_batch(const flatfield &ff, int n, const double *x,
+                       const double *y, bool withgcf, bool timesy, double *fx,
+                       double *fy)
+{
+    const double *value[2] = {x, y};
+
+    eval_field_batch(ff, n, value, withgcf, timesy, fx, fy);
+}
+
+void eval_field3_batch(const flatfield &ff, int n, const double *r,
+                       const double *theta, bool withgcf, double *fr,
+                       double *ftheta)
+{
+    double co[FIELD_BATCH], si[FIELD_BATCH];
+    const double *value[3] = {r, co, si};
+    int first, l, w;
+
+    for (first = 0; first < n; first += FIELD_BATCH) {
+        w = std::min(FIELD_BATCH, n - first);
+        for (l = 0; l < w; l++) {
+            co[l] = cos(theta[first + l]);
+            si[l] = sin(theta[first + l]);
+        }
+        value[0] = r + first;
+        eval_field_batch(ff, w, value, withgcf, false, fr + first,
+                         ftheta + first);
+    }
+}
+
+// -----------------------------------------------------------------------
+//                          EVAL_FIELD2/3_JACOBIAN
+// -----------------------------------------------------------------------
+//
+// In the cylinder the monomials are r^i*cos(theta)^j*sin(theta)^k, whose
+// derivative with respect to theta is r^i times
+// k*cos(theta)^(j+1)*sin(theta)^(k-1) - j*cos(theta)^(j-1)*sin(theta)^(k+1)
+
+static void eval_field_jacobian(const flatfield &ff, const double *value,
+                                bool withgcf, bool timesy, double *f,
+                                double *J)
+{
+    double stackpw[FIELD_STACK_POWERS];
+    std::vector<double> heappw;
+    double *pw = stackpw;
+    const double *px, *py, *pz;
+    const int *e = ff.exps.data();
+    const double *c = ff.coeffs.data();
+    size_t i, n = ff.coeffs.size() / 3;
+    double v[3], t[3], s[3];
+    // value and the two partial derivatives of the gcf and the components
+    double g[3] = {0.0, 0.0, 0.0}, P[3] = {0.0, 0.0, 0.0},
+           Q[3] = {0.0, 0.0, 0.0};
+    int k, j, total;
+    int offs[3] = {0, 0, 0};
+
+    v[0] = value[0];
+    if (ff.nvars == 2) {
+        v[1] = value[1];
+    } else {
+        v[1] = cos(value[1]);
+        v[2] = sin(value[1]);
+    }
+
+    // powers up to maxexp[k]+1, which the derivative in theta needs
+    total = 0;
+    for (k = 0; k < ff.nvars; k++) {
+        offs[k] = total;
+        total += ff.maxexp[k] + 2;
+    }
+    if (total > FIELD_STACK_POWERS) {
+        heappw.resize(total);
+        pw = heappw.data();
+    }
+    for (k = 0; k < ff.nvars; k++) {
+        pw[offs[k]] = 1.0;
+        for (j = 1; j <= ff.maxexp[k] + 1; j++)
+            pw[offs[k] + j] = pw[offs[k] + j - 1] * v[k];
+    }
+
+    px = pw + offs[0];
+    py = pw + offs[1];
+    pz = pw + offs[2];
+    for (i = 0; i < n; i++, e += ff.nvars, c += 3) {
+        if (ff.nvars == 2) {
+            t[0] = px[e[0]] * py[e[1]];
+            t[1] = (e[0] != 0) ? e[0] * px[e[0] - 1] * py[e[1]] : 0.0;
+            t[2] = (e[1] != 0) ? e[1] * px[e[0]] * py[e[1] - 1] : 0.0;
+        } else {
+            t[0] = px[e[0]] * py[e[1]] * pz[e[2]];
+            t[1] =
+                (e[0] != 0) ? e[0] * px[e[0] - 1] * py[e[1]] * pz[e[2]] : 0.0;
+            t[2] = 0.0;
+            if (e[2] != 0)
+                t[2] += e[2] * py[e[1] + 1] * pz[e[2] - 1];
+            if (e[1] != 0)
+                t[2] -= e[1] * py[e[1] - 1] * pz[e[2] + 1];
+            t[2] *= px[e[0]];
+        }
+        for (k = 0; k < 3; k++) {
+            g[k] += c[0] * t[k];
+            P[k] += c[1] * t[k];
+            Q[k] += c[2] * t[k];
+        }
+    }
+
+    // f = s*(P,Q), with s the gcf (or 1) times y (or 1)
+    if (withgcf && ff.hasgcf) {
+        s[0] = g[0];
+        s[1] = g[1];
+        s[2] = g[2];
+    } else {
+        s[0] = 1.0;
+        s[1] = s[2] = 0.0;
+    }
+    if (timesy) {
+        s[2] = s[2] * value[1] + s[0];
+        s[1] *= value[1];
+        s[0] *= value[1];
+    }
+    f[0] = s[0] * P[0];
+    f[1] = s[0] * Q[0];
+    J[0] = s[1] * P[0] + s[0] * P[1];
+    J[1] = s[2] * P[0] + s[0] * P[2];
+    J[2] = s[1] * Q[0] + s[0] * Q[1];
+    J[3] = s[2] * Q[0] + s[0] * Q[2];
+}
+
+void eval_field2_jacobian(const flatfield &ff, const double *value,
+                          bool withgcf, bool timesy, double *f, double *J)
+{
+    eval_field_jacobian(ff, value, withgcf, timesy, f, J);
+}
+
+void eval_field3_jacobian(const flatfield &ff, const double *value,
+                          bool withgcf, double *f, double *J)
+{
+    eval_field_jacobian(ff, value, withgcf, false, f, J);
+}
+
 // -----------------------------------------------------------------------
 //                              DELETE_TERM1
 // -----------------------------------------------------------------------
@@ -44,6 +44,25 @@
 
 #include "file_tab.h"
 
+/**
+ * Calculates x^n for a natural number n by repeated squaring
+ * @param  x Value x
+ * @param  n Exponent n, n>=0
+ * @return   Result x^n
+ */
+inline double ipow(double x, int n)
+{
+    double r = 1.0;
+
+    while (n != 0) {
+        if (n & 1)
+            r *= x;
+        x *= x;
+        n >>= 1;
+    }
+    return r;
+}
+
 /**
  * Calculates p(t) for a polynomial p and a value t
  * @param  p     Polynomial p
@@ -67,6 +86,122 @@ double eval_term2(P4POLYNOM2 f, double *value);
  */
 double eval_term3(P4POLYNOM3 F, double *value);
 
+/**
+ * Store a two variables polynomial for fast evaluation
+ * @param f    polynomial
+ * @param flat result, terms with equal exponents are merged
+ */
+void flatten_term2(P4POLYNOM2 f, flatpoly *flat);
+/**
+ * Store a three variables polynomial for fast evaluation
+ * @param F    polynomial
+ * @param flat result, terms with equal exponents are merged
+ */
+void flatten_term3(P4POLYNOM3 F, flatpoly *flat);
+/**
+ * Calculates f(x,y) for a polynomial built by flatten_term2()
+ * @param  f     Polynomial f
+ * @param  value Array (x,y)
+ * @return       Result f(x,y), same as eval_term2() up to rounding
+ */
+double eval_flat2(const flatpoly &f, const double *value);
+/**
+ * Calculates F( r, cos(theta), sin(theta) ) for a polynomial built by
+ * flatten_term3()
+ * @param  F     Polynomial F
+ * @param  value Array (r,theta)
+ * @return       Result, same as eval_term3() up to rounding
+ */
+double eval_flat3(const flatpoly &F, const double *value);
+
+/**
+ * Store a vector field and its GCF for fast evaluation
+ * @param gcf GCF, @c nullptr if there is none
+ * @param vf  vector field (xdot,ydot)
+ * @param ff  result
+ */
+void flatten_field2(P4POLYNOM2 gcf, P4POLYNOM2 *vf, flatfield *ff);
+/**
+ * Store a vector field in the cylinder and its GCF for fast evaluation
+ * @param gcf GCF, @c nullptr if there is none
+ * @param vf  vector field (rdot,thetadot)
+ * @param ff  result
+ */
+void flatten_field3(P4POLYNOM3 gcf, P4POLYNOM3 *vf, flatfield *ff);
+/**
+ * Evaluate a vector field built by flatten_field2() in one pass
+ * @param ff      vector field
+ * @param value   Array (x,y)
+ * @param withgcf multiply the field by the GCF (original vector field)
+ * @param timesy  also multiply the field by y (singularities at infinity)
+ * @param f       result (xdot,ydot)
+ */
+void eval_field2(const flatfield &ff, const double *value, bool withgcf,
+                 bool timesy, double *f);
+/**
+ * Evaluate a vector field built by flatten_field3() in one pass
+ * @param ff      vector field
+ * @param value   Array (r,theta)
+ * @param withgcf multiply the field by the GCF (original vector field)
+ * @param f       result (rdot,thetadot)
+ */
+void eval_field3(const flatfield &ff, const double *value, bool withgcf,
+                 double *f);
+/**
+ * Evaluate a vector field built by flatten_field2() at several points
+ * @param ff      vector field
+ * @param n       number of points
+ * @param x       x coordinate of each point
+ * @param y       y coordinate of each point
+ * @param withgcf multiply the field by the GCF (original vector field)
+ * @param timesy  also multiply the field by y (singularities at infinity)
+ * @param fx      xdot at each point
+ * @param fy      ydot at each point
+ *
+ * The result is the same as calling eval_field2() at each point.
+ */
+void eval_field2_batch(const flatfield &ff, int n, const double *x,
+                       const double *y, bool withgcf, bool timesy, double *fx,
+                       double *fy);
+/**
+ * Evaluate a vector field built by flatten_field3() at several points
+ * @param ff      vector field
+ * @param n       number of points
+ * @param r       r coordinate of each point
+ * @param theta   theta coordinate of each point
+ * @param withgcf multiply the field by the GCF (original vector field)
+ * @param fr      rdot at each point
+ * @param ftheta  thetadot at each point
+ */
+void eval_field3_batch(const flatfield &ff, int n, const double *r,
+                       const double *theta, bool withgcf, double *fr,
+                       double *ftheta);
+/**
+ * Evaluate a vector field built by flatten_field2() and its Jacobian matrix
+ * @param ff      vector field
+ * @param value   Array (x,y)
+ * @param withgcf multiply the field by the GCF (original vector field)
+ * @param timesy  also multiply the field by y (singularities at infinity)
+ * @param f       result (xdot,ydot)
+ * @param J       Jacobian matrix by rows (dxdot/dx, dxdot/dy, dydot/dx,
+ *                dydot/dy)
+ *
+ * The partial derivatives are taken term by term from the exponents of the
+ * monomials, so they cost about as much as the field itself.
+ */
+void eval_field2_jacobian(const flatfield &ff, const double *value,
+                          bool withgcf, bool timesy, double *f, double *J);
+/**
+ * Evaluate a vector field built by flatten_field3() and its Jacobian matrix
+ * @param ff      vector field
+ * @param value   Array (r,theta)
+ * @param withgcf multiply the field by the GCF (original vector field)
+ * @param f       result (rdot,thetadot)
+ * @param J       Jacobian matrix by rows, with respect to r and theta
+ */
+void eval_field3_jacobian(const flatfield &ff, const double *value,
+                          bool withgcf, double *f, double *J);
+
 /**
  * Delete a one variable polynomial
  * @param p polynomial
@@ -36,14 +36,18 @@
 
 #include "math_separatrice.h"
 
+#include "ThreadPool.h"
 #include "custom.h"
 #include "file_tab.h"
+#include "math_events.h"
 #include "math_intblowup.h"
+#include "math_numerics.h"
 #include "math_p4.h"
 #include "math_polynom.h"
 #include "plot_tools.h"
 
 #include <cmath>
+#include <vector>
 
 /*void (*change_epsilon)( WSphere *, double ) = nullptr;
 void (*start_plot_sep)( WSphere * ) = nullptr;
@@ -143,97 +147,36 @@ int findSepColor3(P4POLYNOM3 f, int type, double y[2])
 void WVFStudy::integrate_poincare_sep(double p0, double p1, double p2,
                                       double *pcoord, double *hhi, int *type,
                                       int *color, int *dashes, int *dir,
-                                      double h_min, double h_max)
+                                      double h_min, double h_max,
+                                      chart_state *cs)
 {
-    double y[2], theta;
-
     *dashes = true;
     *dir = 1;
-    if (pcoord[2] > ZCOORD) {
-        psphere_to_R2(p0, p1, p2, y);
-        rk78(&WVFStudy::eval_r_vec_field, y, hhi, h_min, h_max,
-             config_tolerance_);
-        R2_to_psphere(y[0], y[1], pcoord);
-        *color = findSepColor2(gcf_, *type, y);
-    } else {
-        theta = atan2(fabs(p1), fabs(p0));
-        if ((theta < PI_DIV4) && (theta > -PI_DIV4)) {
-            if (p0 > 0) {
-                psphere_to_U1(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_U1_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_) {
-                    U1_to_psphere(y[0], y[1], pcoord);
-                    *color = findSepColor2(gcf_U1_, *type, y);
-                } else {
-                    VV1_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                        *type = change_type(*type);
-                    }
-                    psphere_to_V1(pcoord[0], pcoord[1], pcoord[2], y);
-                    *color = findSepColor2(gcf_V1_, *type, y);
-                    *dashes = false;
-                }
-            } else {
-                psphere_to_V1(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_V1_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_) {
-                    V1_to_psphere(y[0], y[1], pcoord);
-                    *color = findSepColor2(gcf_V1_, *type, y);
-                } else {
-                    UU1_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                        *type = change_type(*type);
-                    }
-                    psphere_to_U1(pcoord[0], pcoord[1], pcoord[2], y);
-                    *color = findSepColor2(gcf_U1_, *type, y);
-                    *dashes = false;
-                }
-            }
-        } else {
-            if (p1 > 0) {
-                psphere_to_U2(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_U2_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_) {
-                    U2_to_psphere(y[0], y[1], pcoord);
-                    *color = findSepColor2(gcf_U2_, *type, y);
-                } else {
-                    VV2_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                        *type = change_type(*type);
-                    }
-                    psphere_to_V2(pcoord[0], pcoord[1], pcoord[2], y);
-                    *color = findSepColor2(gcf_V2_, *type, y);
-                    *dashes = false;
-                }
-            } else {
-                psphere_to_V2(p0, p1, p2, y);
-                rk78(&WVFStudy::eval_V2_vec_field, y, hhi, h_min, h_max,
-                     config_tolerance_);
-                if (y[1] >= 0 || !singinf_) {
-                    V2_to_psphere(y[0], y[1], pcoord);
-                    *color = findSepColor2(gcf_V2_, *type, y);
-                } else {
-                    UU2_to_psphere(y[0], y[1], pcoord);
-                    if (dir_vec_field_ == 1) {
-                        *dir = -1;
-                        *hhi = -(*hhi);
-                        *type = change_type(*type);
-                    }
-                    psphere_to_U2(pcoord[0], pcoord[1], pcoord[2], y);
-                    *color = findSepColor2(gcf_U2_, *type, y);
-                    *dashes = false;
-                }
-            }
+    poincare_chart_step(p0, p1, p2, hhi, h_min, h_max, cs);
+    if (!poincare_chart_to_psphere(cs, pcoord)) {
+        if (dir_vec_field_ == 1) {
+            *dir = -1;
+            *hhi = -(*hhi);
+            *type = change_type(*type);
         }
+        *dashes = false;
+    }
+    switch (cs->chart) {
+    case CHART_R2:
+        *color = findSepColor2(gcf_, *type, cs->y);
+        break;
+    case CHART_U1:
+        *color = findSepColor2(gcf_U1_, *type, cs->y);
+        break;
+    case CHART_V1:
+        *color = findSepColor2(gcf_V1_, *type, cs->y);
+        break;
+    case CHART_U2:
+        *color = findSepColor2(gcf_U2_, *type, cs->y);
+        break;
+    case CHART_V2:
+        *color = findSepColor2(gcf_V2_, *type, cs->y);
+        break;
     }
 }
 
@@ -241,40 +184,29 @@ void WVFStudy::integrate_poincare_sep(double p0, double p1, double p2,
 void WVFStudy::integrate_lyapunov_sep(double p0, double p1, double p2,
                                       double *pcoord, double *hhi, int *type,
                                       int *color, int *dashes, int *dir,
-                                      double h_min, double h_max)
+                                      double h_min, double h_max,
+                                      chart_state *cs)
 {
-    double y[2];
-
     *dashes = true;
     *dir = 1;
-    if (p0 == 0) {
-        y[0] = p1;
-        y[1] = p2;
-        rk78(&WVFStudy::eval_r_vec_field, y, hhi, h_min, h_max,
-             config_tolerance_);
-        R2_to_plsphere(y[0], y[1], pcoord);
-        *color = findSepColor2(gcf_, *type, y);
-    } else {
-        y[0] = p1;
-        y[1] = p2;
-        rk78(&WVFStudy::eval_vec_field_cyl, y, hhi, h_min, h_max,
-             config_tolerance_);
-        if (y[1] >= TWOPI)
-            y[1] -= TWOPI;
-        cylinder_to_plsphere(y[0], y[1], pcoord);
-        *color = findSepColor3(gcf_C_, *type, y);
-    }
+    lyapunov_chart_step(p0, p1, p2, hhi, h_min, h_max, cs);
+    chart_to_sphere(cs->chart, cs->y, pcoord);
+    if (cs->chart == CHART_R2)
+        *color = findSepColor2(gcf_, *type, cs->y);
+    else
+        *color = findSepColor3(gcf_C_, *type, cs->y);
 }
 
-static orbits_points *integrate_sep(WSphere *spherewnd, double pcoord[3],
-                                    double step, int dir, int type,
-                                    int points_to_int, orbits_points **orbit)
+static double integrate_sep(WSphere *spherewnd, double pcoord[3], double step,
+                            int dir, int type, int points_to_int,
+                            OrbitPolyline &orbit, int *stop)
 {
     int i, d, h;
-    int color, dashes;
+    int color, dashes, event = EVENT_NONE;
     double hhi;
-    double pcoord2[3], h_min, h_max;
-    orbits_points *first_orbit_ = nullptr, *last_orbit = nullptr;
+    double h_min, h_max;
+    chart_state cs;
+    OrbitEvents events(spherewnd, pcoord, false);
 
     /* if we intergrate a separatrice and use the original vector field
     then it is possible that we have to change the direction of the
@@ -289,39 +221,21 @@ static orbits_points *integrate_sep(WSphere *spherewnd, double pcoord[3],
 
     h_min = spherewnd->study_->config_hmi_;
     h_max = spherewnd->study_->config_hma_;
-    copy_x_into_y(pcoord, pcoord2);
     for (i = 1; i <= points_to_int; ++i) {
         ((spherewnd->study_)->*(spherewnd->study_->integrate_sphere_sep))(
             pcoord[0], pcoord[1], pcoord[2], pcoord, &hhi, &type, &color,
-            &dashes, &d, h_min, h_max);
-
-        if ((i % UPDATEFREQ_STEPSIZE) == 0)
-            spherewnd->study_->set_current_step(fabs(hhi));
-        if (last_orbit == nullptr) {
-            first_orbit_ = new orbits_points;
-            last_orbit = first_orbit_;
-            h = dir;
-        } else {
-            last_orbit->next_point = new orbits_points;
-            h = last_orbit->dir;
-            last_orbit = last_orbit->next_point;
-        }
+            &dashes, &d, h_min, h_max, &cs);
+        event = events.check(pcoord, hhi, &cs);
 
-        copy_x_into_y(pcoord, last_orbit->pcoord);
-        last_orbit->color = color;
-        last_orbit->dashes = dashes * spherewnd->study_->config_dashes_;
-        last_orbit->dir = d * h;
-        last_orbit->type = type;
-        last_orbit->next_point = nullptr;
-        if (dashes * spherewnd->study_->config_dashes_)
-            (*plot_l)(spherewnd, pcoord, pcoord2, color);
-        else
-            (*plot_p)(spherewnd, pcoord, color);
-        copy_x_into_y(pcoord, pcoord2);
+        h = (i == 1) ? dir : orbit.lastDir();
+
+        dashes *= spherewnd->study_->config_dashes_;
+        orbit.append(pcoord, color, dashes, d * h, type);
+        if (event != EVENT_NONE)
+            break;
     }
-    spherewnd->study_->set_current_step(fabs(hhi));
-    *orbit = last_orbit;
-    return (first_orbit_);
+    *stop = event;
+    return fabs(hhi);
 }
 
 int change_type(int type)
@@ -410,14 +324,13 @@ static double find_step(term1 *sep, double epsilon, int dir)
     return (t2);
 }
 
-orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
-                                double a11, double a12, double a21, double a22,
-                                double epsilon, sep *sep1,
-                                orbits_points **orbit, short int chart)
+double plot_separatrice(WSphere *spherewnd, double x0, double y0, double a11,
+                        double a12, double a21, double a22, double epsilon,
+                        sep *sep1, short int chart)
 {
-    double t = 0.0, h, y, pcoord[3], pcoord2[3], point[2];
+    double t = 0.0, h, y, pcoord[3], point[2];
     int i, dashes, ok = true;
-    orbits_points *first_orbit_ = nullptr, *last_orbit = nullptr, *sep2;
+    OrbitPolyline &orbit = sep1->points;
     int color, dir, type;
 
     /* if we have a line of singularities at infinity then we have to change the
@@ -432,8 +345,6 @@ orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
     /* h=(epsilon/100)*sep1->direction; */
     h = find_step(sep1->separatrice, epsilon, sep1->direction) / 100;
 
-    first_orbit_ = new orbits_points;
-    last_orbit = first_orbit_;
     point[0] = x0;
     point[1] = y0;
 
@@ -476,7 +387,6 @@ orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
         break;
     }
 
-    copy_x_into_y(pcoord, last_orbit->pcoord);
     type = sep1->type;
 
     switch (sep1->type) {
@@ -497,9 +407,7 @@ orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
         break;
     }
 
-    last_orbit->color = color;
-    last_orbit->dashes = 0;
-    copy_x_into_y(pcoord, pcoord2);
+    orbit.append(pcoord, color, 0, dir, type);
     for (i = 0; i <= 99; i++) {
         t = t + h;
         y = eval_term1(sep1->separatrice, t);
@@ -512,8 +420,6 @@ orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
             point[0] = x0 + a11 * t + a12 * y;
             point[1] = y0 + a21 * t + a22 * y;
         }
-        last_orbit->next_point = new orbits_points;
-        last_orbit = last_orbit->next_point;
         dashes = true;
 
         switch (chart) {
@@ -598,23 +504,14 @@ orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
             break;
         }
 
-        copy_x_into_y(pcoord, last_orbit->pcoord);
-        last_orbit->color = color;
-        last_orbit->dashes = dashes * spherewnd->study_->config_dashes_;
-        last_orbit->dir = dir;
-        last_orbit->type = type;
-        if (last_orbit->dashes)
-            (*plot_l)(spherewnd, pcoord, pcoord2, color);
-        else
-            (*plot_p)(spherewnd, pcoord, color);
-        copy_x_into_y(pcoord, pcoord2);
+        dashes *= spherewnd->study_->config_dashes_;
+        orbit.append(pcoord, color, dashes, dir, type);
     }
 
-    last_orbit->next_point = integrate_sep(
-        spherewnd, pcoord, spherewnd->study_->config_step_, last_orbit->dir,
-        type, spherewnd->study_->config_intpoints_, &sep2);
-    *orbit = sep2;
-    return (first_orbit_);
+    return integrate_sep(spherewnd, pcoord, spherewnd->study_->config_step_,
+                         orbit.lastDir(), type,
+                         spherewnd->study_->config_intpoints_, orbit,
+                         &sep1->event);
 }
 
 static double power(double a, double b)
@@ -645,14 +542,12 @@ void make_transformations(transformations *trans, double x0, double y0,
     }
 }
 
-static orbits_points *plot_sep_blow_up(WSphere *spherewnd, double x0, double y0,
-                                       int chart, double epsilon,
-                                       blow_up_points *de_sep,
-                                       orbits_points **orbit)
+static void plot_sep_blow_up(WSphere *spherewnd, double x0, double y0,
+                             int chart, double epsilon, blow_up_points *de_sep)
 {
-    double h, t = 0, y, pcoord[3], pcoord2[3], point[2];
+    double h, t = 0, y, pcoord[3], point[2];
     int i, color, dir, dashes, type, ok = true;
-    orbits_points *first_orbit_ = nullptr, *last_orbit = nullptr, *sep;
+    OrbitPolyline &orbit = de_sep->points;
 
     /* if we have a line of singularities at infinity then we have to change the
     chart if the chart is V1 or V2 */
@@ -684,8 +579,6 @@ static orbits_points *plot_sep_blow_up(WSphere *spherewnd, double x0, double y0,
         dir = 0;
         break;
     }
-    first_orbit_ = new orbits_points;
-    last_orbit = first_orbit_;
     point[0] = x0;
     point[1] = y0;
     switch (chart) {
@@ -724,13 +617,8 @@ static orbits_points *plot_sep_blow_up(WSphere *spherewnd, double x0, double y0,
         color = 0;
         break;
     }
-    copy_x_into_y(pcoord, last_orbit->pcoord);
-    last_orbit->color = color;
-    last_orbit->dashes = 0;
-    copy_x_into_y(pcoord, pcoord2);
+    orbit.append(pcoord, color, 0, dir, type);
     for (i = 0; i <= 99; i++) {
-        last_orbit->next_point = new orbits_points;
-        last_orbit = last_orbit->next_point;
         dashes = true;
         t = t + h;
         y = eval_term1(de_sep->sep, t);
@@ -812,25 +700,15 @@ static orbits_points *plot_sep_blow_up(WSphere *spherewnd, double x0, double y0,
                 findSepColor2(spherewnd->study_->gcf_V2_, de_sep->type, point);
             break;
         }
-        copy_x_into_y(pcoord, last_orbit->pcoord);
-        last_orbit->color = color;
-        last_orbit->dashes = dashes * spherewnd->study_->config_dashes_;
-        last_orbit->dir = dir;
-        last_orbit->type = type;
-        if (last_orbit->dashes)
-            (*plot_l)(spherewnd, pcoord, pcoord2, color);
-        else
-            (*plot_p)(spherewnd, pcoord, color);
-        copy_x_into_y(pcoord, pcoord2);
+        dashes *= spherewnd->study_->config_dashes_;
+        orbit.append(pcoord, color, dashes, dir, type);
     }
     de_sep->point[0] = t;
     de_sep->point[1] = y;
     de_sep->blow_up_vec_field = true;
-    last_orbit->next_point = integrate_blow_up(
-        spherewnd, pcoord2, de_sep, spherewnd->study_->config_step_, dir,
-        last_orbit->type, &sep, chart);
-    *orbit = sep;
-    return (first_orbit_);
+    de_sep->event =
+        integrate_blow_up(spherewnd, de_sep, spherewnd->study_->config_step_,
+                          dir, orbit.lastType(), orbit, chart);
 }
 
 /*
@@ -901,36 +779,6 @@ spherewnd->study_->selected_saddle_point_->separatrices;
     draw_selected_sep(spherewnd,spherewnd->study_->selected_sep_->first_sep_point,CW_SEP);
 }*/
 
-static void plot_all_saddle_sep(WSphere *spherewnd, saddle *point)
-{
-    sep *sep1;
-    orbits_points *points;
-    double p[3];
-
-    while (point != nullptr) {
-        if (point->notadummy) {
-            sep1 = point->separatrices;
-            while (sep1) {
-                if (sep1->last_sep_point) {
-                    copy_x_into_y(sep1->last_sep_point->pcoord, p);
-                    sep1->last_sep_point->next_point = integrate_sep(
-                        spherewnd, p, spherewnd->study_->config_currentstep_,
-                        sep1->last_sep_point->dir, sep1->last_sep_point->type,
-                        spherewnd->study_->config_intpoints_, &points);
-                    sep1->last_sep_point = points;
-                } else {
-                    sep1->first_sep_point = plot_separatrice(
-                        spherewnd, point->x0, point->y0, point->a11, point->a12,
-                        point->a21, point->a22, point->epsilon, sep1, &points,
-                        point->chart);
-                    sep1->last_sep_point = points;
-                }
-                sep1 = sep1->next_sep;
-            }
-        }
-        point = point->next_saddle;
-    }
-}
 /*
 void start_plot_se_sep( WSphere * spherewnd )
 {
@@ -995,36 +843,6 @@ spherewnd->study_->selected_se_point_->separatrices;
     draw_selected_sep(spherewnd,spherewnd->study_->selected_sep_->first_sep_point,CW_SEP);
 }
 */
-static void plot_all_se_sep(WSphere *spherewnd, semi_elementary *point)
-{
-    sep *sep1;
-    orbits_points *points;
-    double p[3];
-
-    while (point != nullptr) {
-        if (point->notadummy) {
-            sep1 = point->separatrices;
-            while (sep1 != nullptr) {
-                if (sep1->last_sep_point) {
-                    copy_x_into_y(sep1->last_sep_point->pcoord, p);
-                    sep1->last_sep_point->next_point = integrate_sep(
-                        spherewnd, p, spherewnd->study_->config_currentstep_,
-                        sep1->last_sep_point->dir, sep1->last_sep_point->type,
-                        spherewnd->study_->config_intpoints_, &points);
-                    sep1->last_sep_point = points;
-                } else {
-                    sep1->first_sep_point = plot_separatrice(
-                        spherewnd, point->x0, point->y0, point->a11, point->a12,
-                        point->a21, point->a22, point->epsilon, sep1, &points,
-                        point->chart);
-                    sep1->last_sep_point = points;
-                }
-                sep1 = sep1->next_sep;
-            }
-        }
-        point = point->next_se;
-    }
-}
 /*
 void start_plot_de_sep( WSphere * spherewnd )
 {
@@ -1129,79 +947,168 @@ spherewnd->study_->selected_de_point_->blow_up;
     draw_selected_sep(spherewnd,spherewnd->study_->selected_de_sep_->first_sep_point,CW_SEP);
 }
 */
-static void plot_all_de_sep(WSphere *spherewnd, struct degenerate *point)
+// continue the separatrice of a saddle or semi-elementary point for a
+// number of passes, or until an event ends it, returns the step size where
+// the integration stopped
+template <class point_t>
+static double continue_sep(WSphere *spherewnd, point_t *point, sep *sep1,
+                           int passes)
 {
-    blow_up_points *de_sep;
-    orbits_points *sep;
-    double p[3];
+    double p[3], step = spherewnd->study_->config_currentstep_;
+
+    for (int pass = 0; pass < passes && sep1->event == EVENT_NONE; pass++) {
+        if (!sep1->points.empty()) {
+            sep1->points.lastPoint(p);
+            step = integrate_sep(spherewnd, p, step, sep1->points.lastDir(),
+                                 sep1->points.lastType(),
+                                 spherewnd->study_->config_intpoints_,
+                                 sep1->points, &sep1->event);
+        } else {
+            step = plot_separatrice(spherewnd, point->x0, point->y0,
+                                    point->a11, point->a12, point->a21,
+                                    point->a22, point->epsilon, sep1,
+                                    point->chart);
+        }
+    }
+    return step;
+}
 
-    while (point != nullptr) {
-        if (point->notadummy) {
-            de_sep = point->blow_up;
-            while (de_sep != nullptr) {
-                if (de_sep->last_sep_point) {
-                    copy_x_into_y(de_sep->last_sep_point->pcoord, p);
-                    if (de_sep->blow_up_vec_field) {
-                        de_sep->last_sep_point->next_point = integrate_blow_up(
-                            spherewnd, p, de_sep,
-                            spherewnd->study_->config_currentstep_,
-                            de_sep->last_sep_point->dir,
-                            de_sep->last_sep_point->type, &sep, point->chart);
-                    } else {
-                        de_sep->last_sep_point->next_point = integrate_sep(
-                            spherewnd, p, spherewnd->study_->config_currentstep_,
-                            de_sep->last_sep_point->dir,
-                            de_sep->last_sep_point->type,
-                            spherewnd->study_->config_intpoints_, &sep);
-                    }
-                    de_sep->last_sep_point = sep;
-                } else {
-                    de_sep->first_sep_point = plot_sep_blow_up(
-                        spherewnd, point->x0, point->y0, point->chart,
-                        point->epsilon, de_sep, &sep);
-                    de_sep->last_sep_point = sep;
-                }
-                de_sep = de_sep->next_blow_up_point;
+// same for a separatrice of a degenerate point, the step size is only
+// returned (non zero) if the separatrice left the blow up
+static double continue_de_sep(WSphere *spherewnd, degenerate *point,
+                              blow_up_points *de_sep, int passes)
+{
+    double p[3], step = spherewnd->study_->config_currentstep_;
+    bool stepped = false;
+
+    for (int pass = 0; pass < passes && de_sep->event == EVENT_NONE;
+         pass++) {
+        if (!de_sep->points.empty()) {
+            de_sep->points.lastPoint(p);
+            if (de_sep->blow_up_vec_field) {
+                de_sep->event = integrate_blow_up(
+                    spherewnd, de_sep, step, de_sep->points.lastDir(),
+                    de_sep->points.lastType(), de_sep->points, point->chart);
+            } else {
+                step = integrate_sep(spherewnd, p, step,
+                                     de_sep->points.lastDir(),
+                                     de_sep->points.lastType(),
+                                     spherewnd->study_->config_intpoints_,
+                                     de_sep->points, &de_sep->event);
+                stepped = true;
             }
+        } else {
+            plot_sep_blow_up(spherewnd, point->x0, point->y0, point->chart,
+                             point->epsilon, de_sep);
         }
-        point = point->next_de;
     }
+    return stepped ? step : 0;
 }
 
-void plot_all_sep(WSphere *spherewnd)
+void integrate_all_sep(WSphere *spherewnd, int passes)
 {
-    plot_all_saddle_sep(spherewnd, spherewnd->study_->first_saddle_point_);
-    plot_all_se_sep(spherewnd, spherewnd->study_->first_se_point_);
-    plot_all_de_sep(spherewnd, spherewnd->study_->first_de_point_);
+    WVFStudy *study = spherewnd->study_;
+    std::vector<ThreadPool::Task> tasks;
+    std::vector<double> steps;
+
+    // every separatrice only touches its own points, so each one is a task
+    for (saddle *sp = study->first_saddle_point_; sp != nullptr;
+         sp = sp->next_saddle) {
+        if (!sp->notadummy)
+            continue;
+        for (sep *sep1 = sp->separatrices; sep1 != nullptr;
+             sep1 = sep1->next_sep) {
+            size_t i = tasks.size();
+            tasks.push_back([spherewnd, sp, sep1, passes, &steps, i]() {
+                steps[i] = continue_sep(spherewnd, sp, sep1, passes);
+            });
+        }
+    }
+    for (semi_elementary *se = study->first_se_point_; se != nullptr;
+         se = se->next_se) {
+        if (!se->notadummy)
+            continue;
+        for (sep *sep1 = se->separatrices; sep1 != nullptr;
+             sep1 = sep1->next_sep) {
+            size_t i = tasks.size();
+            tasks.push_back([spherewnd, se, sep1, passes, &steps, i]() {
+                steps[i] = continue_sep(spherewnd, se, sep1, passes);
+            });
+        }
+    }
+    for (degenerate *dp = study->first_de_point_; dp != nullptr;
+         dp = dp->next_de) {
+        if (!dp->notadummy)
+            continue;
+        for (blow_up_points *de_sep = dp->blow_up; de_sep != nullptr;
+             de_sep = de_sep->next_blow_up_point) {
+            size_t i = tasks.size();
+            tasks.push_back([spherewnd, dp, de_sep, passes, &steps, i]() {
+                steps[i] = continue_de_sep(spherewnd, dp, de_sep, passes);
+            });
+        }
+    }
+
+    steps.resize(tasks.size(), 0);
+    g_threadPool.run(tasks);
+
+    // keep the step size of the last separatrice, as a sequential loop would
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i] != 0)
+            study->set_current_step(steps[i]);
+    }
 }
 
-void draw_sep(WSphere *spherewnd, orbits_points *sep)
+void WSphere::computeSeparatrices(std::function<void()> done)
 {
-    double pcoord[3];
+    if (sepJob_ != nullptr || !(plotPrepared_ = setupPlot()))
+        return;
+
+    // the job works on study_ and the view bounds set by setupPlot(), which
+    // the session leaves alone while computing(), and the destructor cancels
+    // it before deleting them
+    std::shared_ptr<bool> alive = alive_;
+    sepJob_ = g_threadPool.submit([this]() { integrate_all_sep(this, 10); },
+                                  [this, alive, done]() {
+                                      if (!*alive)
+                                          return;
+                                      sepJob_ = nullptr;
+                                      done();
+                                  });
+}
 
-    if (sep) {
-        do {
-            if (sep->dashes)
-                (*plot_l)(spherewnd, sep->pcoord, pcoord, sep->color);
+void draw_sep(WSphere *spherewnd, const OrbitPolyline &sep)
+{
+    double pcoord[3], point[3];
+
+    for (size_t k = 0; k < sep.spans(); k++) {
+        OrbitPolyline::span s = sep.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, point);
+            if (s.dashes(i))
+                (*plot_l)(spherewnd, point, pcoord, s.color(i));
             else
-                (*plot_p)(spherewnd, sep->pcoord, sep->color);
-            copy_x_into_y(sep->pcoord, pcoord);
-        } while ((sep = sep->next_point) != nullptr);
+                (*plot_p)(spherewnd, point, s.color(i));
+            copy_x_into_y(point, pcoord);
+        }
     }
 }
 
-void draw_selected_sep(WSphere *spherewnd, orbits_points *sep, int color)
+void draw_selected_sep(WSphere *spherewnd, const OrbitPolyline &sep,
+                       int color)
 {
-    double pcoord[3];
-
-    if (sep) {
-        do {
-            if (sep->dashes)
-                (*plot_l)(spherewnd, sep->pcoord, pcoord, color);
+    double pcoord[3], point[3];
+
+    for (size_t k = 0; k < sep.spans(); k++) {
+        OrbitPolyline::span s = sep.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, point);
+            if (s.dashes(i))
+                (*plot_l)(spherewnd, point, pcoord, color);
             else
-                (*plot_p)(spherewnd, sep->pcoord, color);
-            copy_x_into_y(sep->pcoord, pcoord);
-        } while ((sep = sep->next_point) != nullptr);
+                (*plot_p)(spherewnd, point, color);
+            copy_x_into_y(point, pcoord);
+        }
     }
 }
 
@@ -1212,10 +1119,9 @@ void change_epsilon_saddle(WSphere *spherewnd, double epsilon)
     spherewnd->study_->selected_saddle_point_->epsilon = epsilon;
     separatrice = spherewnd->study_->selected_saddle_point_->separatrices;
     while (separatrice != nullptr) {
-        draw_selected_sep(spherewnd, separatrice->first_sep_point, CBACKGROUND);
-        spherewnd->study_->deleteOrbitPoint(separatrice->first_sep_point);
-        separatrice->last_sep_point = nullptr;
-        separatrice->first_sep_point = nullptr;
+        draw_selected_sep(spherewnd, separatrice->points, CBACKGROUND);
+        separatrice->points.clear();
+        separatrice->event = EVENT_NONE;
         separatrice = separatrice->next_sep;
     }
 }
@@ -1227,10 +1133,9 @@ void change_epsilon_se(WSphere *spherewnd, double epsilon)
     spherewnd->study_->selected_se_point_->epsilon = epsilon;
     separatrice = spherewnd->study_->selected_se_point_->separatrices;
     while (separatrice != nullptr) {
-        draw_selected_sep(spherewnd, separatrice->first_sep_point, CBACKGROUND);
-        spherewnd->study_->deleteOrbitPoint(separatrice->first_sep_point);
-        separatrice->last_sep_point = nullptr;
-        separatrice->first_sep_point = nullptr;
+        draw_selected_sep(spherewnd, separatrice->points, CBACKGROUND);
+        separatrice->points.clear();
+        separatrice->event = EVENT_NONE;
         separatrice = separatrice->next_sep;
     }
 }
@@ -1242,10 +1147,9 @@ void change_epsilon_de(WSphere *spherewnd, double epsilon)
     spherewnd->study_->selected_de_point_->epsilon = epsilon;
     separatrice = spherewnd->study_->selected_de_point_->blow_up;
     while (separatrice != nullptr) {
-        draw_selected_sep(spherewnd, separatrice->first_sep_point, CBACKGROUND);
-        spherewnd->study_->deleteOrbitPoint(separatrice->first_sep_point);
-        separatrice->last_sep_point = nullptr;
-        separatrice->first_sep_point = nullptr;
+        draw_selected_sep(spherewnd, separatrice->points, CBACKGROUND);
+        separatrice->points.clear();
+        separatrice->event = EVENT_NONE;
         separatrice = separatrice->next_blow_up_point;
     }
 }
@@ -48,8 +48,12 @@
 /**
  * Compute all separatrices for all singularities
  * @param spherewnd sphere object where the study and plot are stored
+ * @param passes    number of times each separatrice is continued
+ *
+ * The separatrices are integrated in parallel on the worker pool and are
+ * not drawn, WSphere::plotSeparatrices() draws them afterwards.
  */
-void plot_all_sep(WSphere *spherewnd);
+void integrate_all_sep(WSphere *spherewnd, int passes);
 /**
  * Draw separatrice
  * @param spherewnd sphere object
@@ -57,7 +61,7 @@ void plot_all_sep(WSphere *spherewnd);
  *
  * This function draws a separatrice with its default color
  */
-void draw_sep(WSphere *spherewnd, orbits_points *sep);
+void draw_sep(WSphere *spherewnd, const OrbitPolyline &sep);
 /**
  * Draw separatrice with specified color
  * @param spherewnd sphere object
@@ -66,7 +70,8 @@ void draw_sep(WSphere *spherewnd, orbits_points *sep);
  *
  * Same as draw_sep() but with a custom color
  */
-void draw_selected_sep(WSphere *spherewnd, orbits_points *sep, int color);
+void draw_selected_sep(WSphere *spherewnd, const OrbitPolyline &sep,
+                       int color);
 
 /**
  * Find color for a P4POLYNOM2 of a given type at a given point
@@ -103,11 +108,11 @@ int change_type(int type);
  * @param  a22       transformation matrix
  * @param  epsilon   radius for boundary around singularity where to start
  * integration
- * @param  sep1      Taylor approximation of invariant manifold of singularity
- * @param  orbit     linked list where integrated separatrice is stored
+ * @param  sep1      Taylor approximation of invariant manifold of singularity,
+ *                   the integrated separatrice is appended to its points and
+ *                   the event that ended it, if any, is stored in its event
  * @param  chart     chart in which integration is performed
- * @return           pointer to first element of the linked list that is
- *                           the integrated separatrice
+ * @return           step size where the integration stopped
  *
  * When the singularity is a saddle or saddle-node, first we use the Taylor
  * approximation of the invariant manifold until we meet the boundary of a
@@ -118,10 +123,9 @@ int change_type(int type);
  * or WVFStudy::integrate_lyapunov_sep() depending on which sphere are we
  * working on).
  */
-orbits_points *plot_separatrice(WSphere *spherewnd, double x0, double y0,
-                                double a11, double a12, double a21, double a22,
-                                double epsilon, sep *sep1,
-                                orbits_points **orbit, short int chart);
+double plot_separatrice(WSphere *spherewnd, double x0, double y0, double a11,
+                        double a12, double a21, double a22, double epsilon,
+                        sep *sep1, short int chart);
 
 /**
  * Apply a list of transformations to a point
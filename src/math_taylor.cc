@@ -0,0 +1,219 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "math_taylor.h"
+
+#include "file_tab.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// series kept on the stack, larger fields or orders use the heap
+#define TAYLOR_STACK 2048
+
+// coefficient k of the product of the series a and b
+static inline double cauchy(const double *a, const double *b, int k)
+{
+    double s = 0.0;
+
+    for (int i = 0; i <= k; i++)
+        s += a[i] * b[k - i];
+    return s;
+}
+
+int taylor_order(double e1)
+{
+    // the work per unit of time for a tolerance e1 is lowest at an order of
+    // about -log(e1)/2 + 1 (Jorba and Zou)
+    int n = (int)ceil(-0.5 * log(e1)) + 1;
+
+    return std::min(std::max(n, TAYLOR_MIN_ORDER), TAYLOR_MAX_ORDER);
+}
+
+double taylor_step(const flatfield &ff, bool withgcf, bool timesy, int order,
+                   double y[2], double *hh, double hmi, double hma, double e1,
+                   double *f0)
+{
+    double stackbuf[TAYLOR_STACK];
+    std::vector<double> heapbuf;
+    double *buf = stackbuf, *ptr;
+    double *T[3], *unit, *th, *G, *P, *Q, *S, *u, *x0, *x1;
+    const double *px, *py, *s, *c;
+    const int *e;
+    size_t m, nterms = ff.coeffs.size() / 3;
+    int nv = ff.nvars, n, stride, rows[3], total, i, j, k, v;
+    double g, p, q, t, a, b, rho, h, e3, hk, last;
+    bool usegcf = withgcf && ff.hasgcf;
+
+    if (order > 0)
+        n = std::min(std::max(order, TAYLOR_MIN_ORDER), TAYLOR_MAX_ORDER);
+    else
+        n = taylor_order(e1);
+    stride = n + 1;
+
+    // a table with the series of the powers 0..maxexp of each variable
+    // (row 1 is the variable itself), then the series of theta, of the gcf
+    // and of the components, and the partial products r^i*cos^j of the
+    // monomials in the cylinder
+    total = 0;
+    for (v = 0; v < nv; v++) {
+        rows[v] = std::max(ff.maxexp[v], 1) + 1;
+        total += rows[v];
+    }
+    total += 6;
+    if (nv == 3)
+        total += (int)nterms;
+    total *= stride;
+    if (total > TAYLOR_STACK) {
+        heapbuf.resize(total);
+        buf = heapbuf.data();
+    }
+    std::fill(buf, buf + total, 0.0);
+    ptr = buf;
+    for (v = 0; v < nv; v++) {
+        T[v] = ptr;
+        T[v][0] = 1.0;
+        ptr += rows[v] * stride;
+    }
+    unit = ptr;
+    unit[0] = 1.0;
+    th = unit + stride;
+    G = th + stride;
+    P = G + stride;
+    Q = P + stride;
+    S = Q + stride;
+    u = S + stride;
+
+    if (nv == 2) {
+        T[0][stride] = y[0];
+        T[1][stride] = y[1];
+        x0 = T[0] + stride;
+        x1 = T[1] + stride;
+    } else {
+        T[0][stride] = y[0];
+        T[1][stride] = cos(y[1]);
+        T[2][stride] = sin(y[1]);
+        th[0] = y[1];
+        x0 = T[0] + stride;
+        x1 = th;
+    }
+
+    // coefficient k of the field gives coefficient k+1 of the orbit; when
+    // the step will be hma anyway, the series is cut as soon as its terms
+    // at hma are below the tolerance
+    e3 = e1 * (1.0 + (fabs(y[0]) + fabs(y[1])) * 1.E-2);
+    hk = 1.0;
+    last = HUGE_VAL;
+    for (k = 0; k < n; k++) {
+        for (v = 0; v < nv; v++) {
+            for (j = 2; j <= ff.maxexp[v]; j++)
+                T[v][j * stride + k] =
+                    cauchy(T[v] + (j - 1) * stride, T[v] + stride, k);
+        }
+
+        g = p = q = 0.0;
+        e = ff.exps.data();
+        c = ff.coeffs.data();
+        for (m = 0; m < nterms; m++, e += nv, c += 3) {
+            px = T[0] + e[0] * stride;
+            py = T[1] + e[1] * stride;
+            if (e[0] == 0)
+                t = py[k];
+            else if (e[1] == 0)
+                t = px[k];
+            else
+                t = cauchy(px, py, k);
+            if (nv == 3) {
+                u[m * stride + k] = t;
+                if (e[2] != 0)
+                    t = cauchy(u + m * stride, T[2] + e[2] * stride, k);
+            }
+            g += c[0] * t;
+            p += c[1] * t;
+            q += c[2] * t;
+        }
+        G[k] = g;
+        P[k] = p;
+        Q[k] = q;
+
+        s = usegcf ? G : unit;
+        if (timesy) {
+            S[k] = cauchy(s, T[1] + stride, k);
+            s = S;
+        }
+        if (s == unit) {
+            a = P[k];
+            b = Q[k];
+        } else {
+            a = cauchy(s, P, k);
+            b = cauchy(s, Q, k);
+        }
+        x0[k + 1] = a / (k + 1);
+        x1[k + 1] = b / (k + 1);
+
+        if (nv == 3) {
+            // cos(theta)' = -sin(theta)*theta', sin(theta)' = cos(theta)*theta'
+            a = b = 0.0;
+            for (i = 0; i <= k; i++) {
+                a -= T[2][stride + i] * (k + 1 - i) * th[k + 1 - i];
+                b += T[1][stride + i] * (k + 1 - i) * th[k + 1 - i];
+            }
+            T[1][stride + k + 1] = a / (k + 1);
+            T[2][stride + k + 1] = b / (k + 1);
+        }
+
+        hk *= hma;
+        t = std::max(fabs(x0[k + 1]), fabs(x1[k + 1])) * hk;
+        if (k + 1 >= TAYLOR_MIN_ORDER && t < e3 && last < e3) {
+            n = k + 1;
+            break;
+        }
+        last = t;
+    }
+
+    // largest step for which the last two terms stay below the tolerance
+    rho = HUGE_VAL;
+    for (k = n - 1; k <= n; k++) {
+        a = std::max(fabs(x0[k]), fabs(x1[k]));
+        if (a > 0)
+            rho = std::min(rho, pow(e3 / a, 1.0 / k));
+    }
+    h = rho * exp(-0.7 / (n - 1));
+    if (std::isnan(h) || h < hmi)
+        h = hmi;
+    else if (h > hma)
+        h = hma;
+    if (*hh < 0)
+        h = -h;
+
+    a = x0[n];
+    b = x1[n];
+    for (k = n - 1; k >= 0; k--) {
+        a = a * h + x0[k];
+        b = b * h + x1[k];
+    }
+    if (f0 != nullptr) {
+        f0[0] = x0[1];
+        f0[1] = x1[1];
+    }
+    y[0] = a;
+    y[1] = b;
+    *hh = h;
+    return h;
+}
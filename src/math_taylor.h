@@ -0,0 +1,79 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MATH_TAYLOR_H
+#define MATH_TAYLOR_H
+
+/*!
+ * @brief Taylor series integrator for polynomial vector fields
+ * @file math_taylor.h
+ *
+ * The vector fields of the charts are polynomials (or polynomials in r,
+ * cos(theta) and sin(theta) in the cylinder), so the Taylor coefficients of
+ * an orbit can be computed order by order with products of series instead
+ * of evaluating the field at the 13 stages of a Runge-Kutta 7/8 attempt.
+ * The step size is chosen from the decay of the last coefficients, so a
+ * step is never rejected.
+ */
+
+struct flatfield;
+
+/**
+ * Lowest order used by taylor_step()
+ */
+#define TAYLOR_MIN_ORDER 4
+/**
+ * Highest order used by taylor_step()
+ */
+#define TAYLOR_MAX_ORDER 40
+
+/**
+ * Order of the Taylor integrator for a given tolerance
+ *
+ * @param e1 tolerance of the integration
+ * @return   order at which the cost of a step for that tolerance is lowest
+ */
+int taylor_order(double e1);
+
+/**
+ * Taylor series numeric integration step
+ *
+ * @param ff      vector field, with 2 variables (x,y), or 3 variables
+ *                (r,cos(theta),sin(theta)) for a point (r,theta) of the
+ *                cylinder
+ * @param withgcf whether to multiply the field by the gcf
+ * @param timesy  whether to multiply the field by y (only 2 variables)
+ * @param order   order of the series, 0 to choose it from @p e1
+ * @param y       point, replaced by the point after the step
+ * @param hh      step size (only its sign is used), replaced by the step
+ *                size that was taken
+ * @param hmi     minimum step size
+ * @param hma     maximum step size
+ * @param e1      epsilon
+ * @param f0      if not null, receives the vector field at the point before
+ *                the step, for rk78_dense()
+ * @return        size of the step that was taken
+ *
+ * Same contract as rk78_step(), with the same field as eval_field2() and
+ * eval_field3() with those arguments.
+ */
+double taylor_step(const flatfield &ff, bool withgcf, bool timesy, int order,
+                   double y[2], double *hh, double hmi, double hma, double e1,
+                   double *f0 = nullptr);
+
+#endif // MATH_TAYLOR_H
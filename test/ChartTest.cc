@@ -0,0 +1,129 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief The Poincaré-Lyapunov chart maps solve their equation
+ * @file ChartTest.cc
+ *
+ * A point (x,y) outside the unit ball goes to (1,u,v) on the
+ * Poincaré-Lyapunov sphere, where z=u^2 is the root of
+ * x^2 z^p + y^2 z^q = 1. For weights with a closed form (p=q, q=2p, p=2q)
+ * and without one, points from close to the ball to far away, and on the
+ * axes, must satisfy that equation to rounding and the angle v must be
+ * that of (x u^p, y u^q). Mapping (x,y) back is not checked directly, since
+ * far from the axes the angle loses the precision of the small coordinate.
+ * Points of the chart U1 must map back to themselves.
+ */
+
+#include "file_tab.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#define POINTS 1000
+#define TOLERANCE 1e-12
+
+static std::mt19937 s_random(20170628);
+
+static double uniform(double a, double b)
+{
+    return std::uniform_real_distribution<double>(a, b)(s_random);
+}
+
+// set the weights as readTables() does
+static void setWeights(WVFStudy &study, int p, int q)
+{
+    study.p_ = p;
+    study.q_ = q;
+    study.plweights_ = true;
+    study.double_p_ = p;
+    study.double_q_ = q;
+    study.double_p_plus_q_ = p + q;
+    study.double_p_minus_1_ = p - 1;
+    study.double_q_minus_1_ = q - 1;
+    study.double_q_minus_p_ = q - p;
+    study.typeofview_ = TYPEOFVIEW_SPHERE;
+    study.setupCoordinateTransformations();
+}
+
+// a point of R2 outside the unit ball, 1 in 10 on an axis
+static void randomPoint(double *x, double *y)
+{
+    double r = exp(uniform(log(1.001), log(1e6)));
+    double t = uniform(-M_PI, M_PI);
+    int axis = std::uniform_int_distribution<int>(0, 19)(s_random);
+
+    if (axis == 0)
+        t = 0;
+    else if (axis == 1)
+        t = M_PI / 2;
+    *x = r * cos(t);
+    *y = r * sin(t);
+}
+
+static int checkWeights(int p, int q)
+{
+    WVFStudy study;
+    double pcoord[3], c[2], x, y, u, res;
+    int errors = 0;
+
+    setWeights(study, p, q);
+    for (int k = 0; k < POINTS; k++) {
+        randomPoint(&x, &y);
+        (study.*study.R2_to_sphere)(x, y, pcoord);
+        u = pcoord[1];
+        res = x * x * pow(u, 2 * p) + y * y * pow(u, 2 * q) - 1;
+        c[0] = x * pow(u, p) - cos(pcoord[2]);
+        c[1] = y * pow(u, q) - sin(pcoord[2]);
+        if (pcoord[0] != 1 || !(fabs(res) <= TOLERANCE) ||
+            !(fabs(c[0]) <= TOLERANCE) || !(fabs(c[1]) <= TOLERANCE)) {
+            std::cerr << "(p,q)=(" << p << "," << q << "): (" << x << ","
+                      << y << ") has residual " << res
+                      << " and angle error (" << c[0] << "," << c[1]
+                      << ")\n";
+            errors++;
+        }
+
+        // a point of U1 with s>0, i.e. x>0
+        double s = uniform(1e-3, 1);
+        u = uniform(-10, 10);
+        (study.*study.U1_to_sphere)(u, s, pcoord);
+        (study.*study.sphere_to_U1)(pcoord[0], pcoord[1], pcoord[2], c);
+        if (!(fabs(c[0] - u) <= TOLERANCE * (1 + fabs(u))) ||
+            !(fabs(c[1] - s) <= TOLERANCE)) {
+            std::cerr << "(p,q)=(" << p << "," << q << "): U1 point (" << u
+                      << "," << s << ") maps back to (" << c[0] << ","
+                      << c[1] << ")\n";
+            errors++;
+        }
+    }
+    return errors;
+}
+
+int main()
+{
+    const int weights[][2] = {{2, 2}, {3, 3}, {1, 2}, {2, 4}, {2, 1},
+                              {4, 2}, {1, 3}, {2, 3}, {3, 2}, {3, 5},
+                              {5, 2}, {1, 7}};
+    int errors = 0;
+
+    for (size_t i = 0; i < sizeof(weights) / sizeof(weights[0]); i++)
+        errors += checkWeights(weights[i][0], weights[i][1]);
+    return errors == 0 ? 0 : 1;
+}
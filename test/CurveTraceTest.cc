@@ -0,0 +1,202 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief The native curve tracer finds whole curves
+ * @file CurveTraceTest.cc
+ *
+ * The unit circle must come out as one closed polyline of points on it,
+ * without gaps, in the plane and in polar coordinates. The polynomial
+ * 1-B*x(1-x)y(1-y)((x-1/2)^2+(y-1/2)^2) is 1 at the corners and at the
+ * center of the unit square, which is one block of the quadtree, but
+ * vanishes on two closed curves inside it, one around the center and one
+ * along the sides, that must both be found.
+ */
+
+#include "file_tab.h"
+#include "math_curvetrace.h"
+#include "math_polynom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#define TOLERANCE 1e-9
+
+typedef std::map<std::pair<int, int>, double> polynomial;
+
+static polynomial product(const polynomial &a, const polynomial &b)
+{
+    polynomial r;
+    for (polynomial::const_iterator i = a.begin(); i != a.end(); ++i) {
+        for (polynomial::const_iterator j = b.begin(); j != b.end(); ++j)
+            r[std::make_pair(i->first.first + j->first.first,
+                             i->first.second + j->first.second)] +=
+                i->second * j->second;
+    }
+    return r;
+}
+
+static void flatten(const polynomial &p, flatpoly *flat)
+{
+    P4POLYNOM2 f = nullptr;
+    for (polynomial::const_iterator i = p.begin(); i != p.end(); ++i) {
+        P4POLYNOM2 t = new term2;
+        t->exp_x = i->first.first;
+        t->exp_y = i->first.second;
+        t->coeff = i->second;
+        t->next_term2 = f;
+        f = t;
+    }
+    flatten_term2(f, flat);
+    delete_term2(f);
+}
+
+// largest gap between the angles of the points of the paths, with no path
+// returns 2*pi
+static double angleGap(const std::vector<std::vector<double>> &paths)
+{
+    std::vector<double> a;
+    for (size_t k = 0; k < paths.size(); k++) {
+        for (size_t m = 0; m < paths[k].size(); m += 2)
+            a.push_back(atan2(paths[k][m + 1], paths[k][m]));
+    }
+    if (a.empty())
+        return 2 * M_PI;
+    std::sort(a.begin(), a.end());
+    double gap = a.front() + 2 * M_PI - a.back();
+    for (size_t k = 1; k < a.size(); k++)
+        gap = std::max(gap, a[k] - a[k - 1]);
+    return gap;
+}
+
+static int checkCircle()
+{
+    polynomial p;
+    flatpoly f;
+    std::vector<std::vector<double>> paths;
+    int errors = 0;
+
+    p[std::make_pair(2, 0)] = 1;
+    p[std::make_pair(0, 2)] = 1;
+    p[std::make_pair(0, 0)] = -1;
+    flatten(p, &f);
+
+    for (int coords = TRACE_PLANE; coords <= TRACE_POLAR; coords++) {
+        paths.clear();
+        if (coords == TRACE_PLANE)
+            trace_curve(f, coords, -2, 2, -2, 2, 40, 12, &paths);
+        else
+            trace_curve(f, coords, 0, 2, -M_PI, M_PI, 40, 12, &paths);
+
+        if (paths.size() != 1) {
+            std::cerr << "circle in coordinates " << coords << " gives "
+                      << paths.size() << " paths\n";
+            errors++;
+        }
+        for (size_t k = 0; k < paths.size(); k++) {
+            const std::vector<double> &q = paths[k];
+            double x, y;
+            for (size_t m = 0; m < q.size(); m += 2) {
+                x = q[m];
+                y = q[m + 1];
+                if (coords == TRACE_POLAR) {
+                    x = q[m] * cos(q[m + 1]);
+                    y = q[m] * sin(q[m + 1]);
+                }
+                if (!(fabs(x * x + y * y - 1) <= TOLERANCE)) {
+                    std::cerr << "circle point (" << q[m] << "," << q[m + 1]
+                              << ") in coordinates " << coords
+                              << " is not on it\n";
+                    errors++;
+                }
+            }
+            if (coords == TRACE_PLANE &&
+                (q[0] != q[q.size() - 2] || q[1] != q[q.size() - 1])) {
+                std::cerr << "circle path is not closed\n";
+                errors++;
+            }
+        }
+        if (coords == TRACE_PLANE && !(angleGap(paths) <= 0.1)) {
+            std::cerr << "circle has a gap of " << angleGap(paths)
+                      << " radians\n";
+            errors++;
+        }
+    }
+    return errors;
+}
+
+static int checkOvals()
+{
+    polynomial x, y, r, p;
+    flatpoly f;
+    std::vector<std::vector<double>> paths;
+    const double B = 1000;
+    int errors = 0, ovals = 0;
+
+    // x(1-x), y(1-y) and (x-1/2)^2+(y-1/2)^2
+    x[std::make_pair(1, 0)] = 1;
+    x[std::make_pair(2, 0)] = -1;
+    y[std::make_pair(0, 1)] = 1;
+    y[std::make_pair(0, 2)] = -1;
+    r[std::make_pair(2, 0)] = 1;
+    r[std::make_pair(1, 0)] = -1;
+    r[std::make_pair(0, 2)] = 1;
+    r[std::make_pair(0, 1)] = -1;
+    r[std::make_pair(0, 0)] = 0.5;
+    p = product(product(x, y), r);
+    for (polynomial::iterator i = p.begin(); i != p.end(); ++i)
+        i->second *= -B;
+    p[std::make_pair(0, 0)] += 1;
+    flatten(p, &f);
+
+    // 64 cells of size 1/8, the coarsest blocks are the unit squares
+    trace_curve(f, TRACE_PLANE, 0, 8, 0, 8, 64, 12, &paths);
+    for (size_t k = 0; k < paths.size(); k++) {
+        const std::vector<double> &q = paths[k];
+        bool inside = true;
+        for (size_t m = 0; m < q.size(); m += 2) {
+            double v[2] = {q[m], q[m + 1]};
+            inside = inside && v[0] > 0 && v[0] < 1 && v[1] > 0 && v[1] < 1;
+            if (!(fabs(eval_flat2(f, v)) <= TOLERANCE * B)) {
+                std::cerr << "oval point (" << v[0] << "," << v[1]
+                          << ") is not on the curve\n";
+                errors++;
+            }
+        }
+        if (inside && q[0] == q[q.size() - 2] && q[1] == q[q.size() - 1])
+            ovals++;
+    }
+    if (ovals != 2) {
+        std::cerr << ovals << " closed curves found in the unit square\n";
+        errors++;
+    }
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += checkCircle();
+    errors += checkOvals();
+    return errors == 0 ? 0 : 1;
+}
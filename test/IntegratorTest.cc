@@ -0,0 +1,548 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief The integrators agree with the original RK78
+ * @file IntegratorTest.cc
+ *
+ * rk78_step() must take exactly the same steps as the RK78 of WP4 before it
+ * became a template, which is kept here as it was, with the vector field
+ * passed as a function pointer. taylor_step() must follow the exact
+ * solution of a field with a known limit cycle as closely as rk78_step(),
+ * and agree with it on a field of the cylinder with a gcf. rosenbrock_step()
+ * must follow the same exact solution, and stiff_step() must integrate a
+ * stiff linear field in a fraction of the steps of rk78_step().
+ */
+
+#include "file_tab.h"
+#include "math_numerics.h"
+#include "math_polynom.h"
+#include "math_taylor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#define STEPS 5000
+#define FINAL_TIME 5.0
+#define TOLERANCE 1e-12
+#define MAX_ERROR 1e-9
+
+// Van der Pol oscillator, its orbits tend to a limit cycle
+static void vanDerPol(double *y, double *f)
+{
+    f[0] = y[1];
+    f[1] = -y[0] + (1 - y[0] * y[0]) * y[1];
+}
+
+static void addTerm(P4POLYNOM2 *f, double coeff, int i, int j)
+{
+    P4POLYNOM2 t = new term2;
+    t->coeff = coeff;
+    t->exp_x = i;
+    t->exp_y = j;
+    t->next_term2 = *f;
+    *f = t;
+}
+
+static void addTerm(P4POLYNOM3 *f, double coeff, int i, int j, int k)
+{
+    P4POLYNOM3 t = new term3;
+    t->coeff = coeff;
+    t->exp_r = i;
+    t->exp_Co = j;
+    t->exp_Si = k;
+    t->next_term3 = *f;
+    *f = t;
+}
+
+// x'=-y+x(1-x^2-y^2), y'=x+y(1-x^2-y^2), whose orbits spiral towards the
+// unit circle: r(t)=1/sqrt(1+(1/r0^2-1)e^(-2t)) and theta(t)=theta0+t
+static void circleField(flatfield *ff)
+{
+    P4POLYNOM2 vf[2] = {nullptr, nullptr};
+
+    addTerm(&vf[0], -1, 0, 1);
+    addTerm(&vf[0], 1, 1, 0);
+    addTerm(&vf[0], -1, 3, 0);
+    addTerm(&vf[0], -1, 1, 2);
+    addTerm(&vf[1], 1, 1, 0);
+    addTerm(&vf[1], 1, 0, 1);
+    addTerm(&vf[1], -1, 2, 1);
+    addTerm(&vf[1], -1, 0, 3);
+    flatten_field2(nullptr, vf, ff);
+    delete_term2(vf[0]);
+    delete_term2(vf[1]);
+}
+
+static void circleSolution(const double y0[2], double t, double y[2])
+{
+    double r0 = hypot(y0[0], y0[1]), theta = atan2(y0[1], y0[0]) + t;
+    double r = 1 / sqrt(1 + (1 / (r0 * r0) - 1) * exp(-2 * t));
+
+    y[0] = r * cos(theta);
+    y[1] = r * sin(theta);
+}
+
+// integrate up to FINAL_TIME with a step of the rk78_step() contract,
+// return the number of steps
+template <class Step> static int integrate(Step step, double y[2])
+{
+    double t = 0, h = 0.01, hma;
+    int steps = 0;
+
+    for (; FINAL_TIME - t > 1e-14; steps++) {
+        hma = std::min(0.1, FINAL_TIME - t);
+        h = std::min(h, hma);
+        t += step(y, &h, hma);
+    }
+    return steps;
+}
+
+// the function-pointer RK78, as it was
+static void reference_rk78(void (*deriv)(double *, double *), double y[2],
+                           double *hh, double hmi, double hma, double e1)
+{
+    double beta[79], c[11], d, dd, e3, h, r[13][2], b[2], f[2];
+    int k;
+    int direction;
+
+    h = *hh;
+    if (h < 0)
+        direction = -1;
+    else
+        direction = 1;
+
+    beta[0] = 0.;
+    beta[1] = .07407407407407407;
+    beta[2] = .027777777777777776;
+    beta[3] = .083333333333333329;
+    beta[4] = .041666666666666664;
+    beta[5] = 0.;
+    beta[6] = .125;
+    beta[7] = .41666666666666669;
+    beta[8] = 0.;
+    beta[9] = -1.5625;
+    beta[10] = -beta[9];
+    beta[11] = .05;
+    beta[12] = 0.;
+    beta[13] = 0.;
+    beta[14] = .25;
+    beta[15] = .2;
+    beta[16] = -.23148148148148148;
+    beta[17] = 0.;
+    beta[18] = 0.;
+    beta[19] = 1.1574074074074074;
+    beta[20] = -2.4074074074074074;
+    beta[21] = beta[19] * 2.;
+    beta[22] = .10333333333333333;
+    beta[23] = 0.;
+    beta[24] = 0.;
+    beta[25] = 0.;
+    beta[26] = .27111111111111114;
+    beta[27] = -.22222222222222221;
+    beta[28] = .014444444444444444;
+    beta[29] = 2.;
+    beta[30] = 0.;
+    beta[31] = 0.;
+    beta[32] = -8.8333333333333339;
+    beta[33] = 15.644444444444444;
+    beta[34] = -11.888888888888889;
+    beta[35] = .74444444444444446;
+    beta[36] = 3.;
+    beta[37] = -.84259259259259256;
+    beta[38] = 0.;
+    beta[39] = 0.;
+    beta[40] = .21296296296296297;
+    beta[41] = -7.2296296296296294;
+    beta[42] = 5.7592592592592595;
+    beta[43] = -.31666666666666665;
+    beta[44] = 2.8333333333333335;
+    beta[45] = -.083333333333333329;
+    beta[46] = .58121951219512191;
+    beta[47] = 0.;
+    beta[48] = 0.;
+    beta[49] = -2.0792682926829267;
+    beta[50] = 4.3863414634146345;
+    beta[51] = -3.6707317073170733;
+    beta[52] = .52024390243902441;
+    beta[53] = .54878048780487809;
+    beta[54] = .27439024390243905;
+    beta[55] = .43902439024390244;
+    beta[56] = .014634146341463415;
+    beta[57] = 0.;
+    beta[58] = 0.;
+    beta[59] = 0.;
+    beta[60] = 0.;
+    beta[61] = -.14634146341463414;
+    beta[62] = -.014634146341463415;
+    beta[63] = -.073170731707317069;
+    beta[64] = -beta[63];
+    beta[65] = -beta[61];
+    beta[66] = 0.;
+    beta[67] = -.43341463414634146;
+    beta[68] = 0.;
+    beta[69] = 0.;
+    beta[70] = beta[49];
+    beta[71] = beta[50];
+    beta[72] = -3.524390243902439;
+    beta[73] = .53487804878048784;
+    beta[74] = .62195121951219512;
+    beta[75] = .20121951219512196;
+    beta[76] = .29268292682926828;
+    beta[77] = 0.;
+    beta[78] = 1.;
+
+    c[0] = .04880952380952381;
+    c[1] = 0.;
+    c[2] = 0.;
+    c[3] = 0.;
+    c[4] = 0.;
+    c[5] = .32380952380952382;
+    c[6] = .25714285714285712;
+    c[7] = c[6];
+    c[8] = .03214285714285714;
+    c[9] = c[8];
+    c[10] = c[0];
+
+    for (;;) {
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k];
+        deriv(b, r[0]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k] + beta[1] * r[0][k] * h;
+        deriv(b, r[1]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k] + (beta[2] * r[0][k] + beta[3] * r[1][k]) * h;
+        deriv(b, r[2]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k] + (beta[4] * r[0][k] + beta[6] * r[2][k]) * h;
+        deriv(b, r[3]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] =
+                y[k] + (beta[7] * r[0][k] + beta[9] * (r[2][k] - r[3][k])) * h;
+        deriv(b, r[4]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] =
+                y[k] +
+                (beta[11] * r[0][k] + beta[14] * r[3][k] + beta[15] * r[4][k]) *
+                    h;
+        deriv(b, r[5]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k] +
+                   (beta[16] * r[0][k] + beta[19] * r[3][k] +
+                    beta[20] * r[4][k] + beta[21] * r[5][k]) *
+                       h;
+        deriv(b, r[6]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k] +
+                   (beta[22] * r[0][k] + beta[26] * r[4][k] +
+                    beta[27] * r[5][k] + beta[28] * r[6][k]) *
+                       h;
+        deriv(b, r[7]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] =
+                y[k] +
+                (beta[29] * r[0][k] + beta[32] * r[3][k] + beta[33] * r[4][k] +
+                 beta[34] * r[5][k] + beta[35] * r[6][k] + beta[36] * r[7][k]) *
+                    h;
+        deriv(b, r[8]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] =
+                y[k] +
+                (beta[37] * r[0][k] + beta[40] * r[3][k] + beta[41] * r[4][k] +
+                 beta[42] * r[5][k] + beta[43] * r[6][k] + beta[44] * r[7][k] +
+                 beta[45] * r[8][k]) *
+                    h;
+        deriv(b, r[9]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] =
+                y[k] +
+                (beta[46] * r[0][k] + beta[49] * r[3][k] + beta[50] * r[4][k] +
+                 beta[51] * r[5][k] + beta[52] * r[6][k] + beta[53] * r[7][k] +
+                 beta[54] * r[8][k] + beta[55] * r[9][k]) *
+                    h;
+        deriv(b, r[10]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] = y[k] +
+                   (beta[56] * r[0][k] + beta[61] * (r[5][k] - r[9][k]) +
+                    beta[62] * r[6][k] + beta[63] * (r[7][k] - r[8][k])) *
+                       h;
+        deriv(b, r[11]);
+
+        for (k = 0; k < 2; ++k)
+            b[k] =
+                y[k] +
+                (beta[67] * r[0][k] + beta[70] * r[3][k] + beta[71] * r[4][k] +
+                 beta[72] * r[5][k] + beta[73] * r[6][k] + beta[74] * r[7][k] +
+                 beta[75] * r[8][k] + beta[76] * r[9][k] + r[11][k]) *
+                    h;
+        deriv(b, r[12]);
+
+        d = 0;
+        dd = 0;
+
+        for (k = 0; k < 2; ++k) {
+            b[k] = c[5] * r[5][k] + c[6] * (r[6][k] + r[7][k]) +
+                   c[8] * (r[8][k] + r[9][k]);
+            f[k] = y[k] + h * (b[k] + c[0] * (r[11][k] + r[12][k]));
+            b[k] = y[k] + h * (b[k] + c[0] * (r[0][k] + r[10][k]));
+            d = d + fabs(f[k] - b[k]);
+            dd = dd + fabs(f[k]);
+        }
+        d = d / 2;
+        e3 = e1 * (1.0 + dd * 1.E-2);
+        if (((fabs(h) <= hmi) || (d < e3)) && !(std::isnan(f[0])) &&
+            !(std::isnan(f[1])) && std::isfinite(f[0]) && std::isfinite(f[1]))
+            break;
+
+        h = h * 0.9 * sqrt(sqrt(sqrt(e3 / d)));
+
+        if ((fabs(h) < hmi) || std::isnan(h) ||
+            !std::isfinite(h)) /* h=hmi*h/fabs(h); */
+            h = hmi * direction;
+    }
+    if (d < e3 / 512)
+        d = e3 / 512;
+
+    h = h * 0.9 * sqrt(sqrt(sqrt(e3 / d)));
+    for (k = 0; k < 2; ++k)
+        y[k] = f[k];
+
+    if (fabs(h) > hma)
+        h = hma * direction;
+
+    if ((fabs(h) < hmi) || std::isnan(h) || !std::isfinite(h))
+        h = hmi * direction;
+    *hh = h;
+}
+
+// same steps as reference_rk78(), bit by bit
+static int checkTemplate()
+{
+    double y[2] = {0.5, 0.1}, yr[2] = {0.5, 0.1};
+    double h = 0.01, hr = 0.01;
+
+    for (int k = 0; k < STEPS; k++) {
+        rk78_step(vanDerPol, y, &h, 1e-7, 0.1, 1e-10);
+        reference_rk78(vanDerPol, yr, &hr, 1e-7, 0.1, 1e-10);
+        if (y[0] != yr[0] || y[1] != yr[1] || h != hr) {
+            std::cerr << "rk78_step differs from the reference at step " << k
+                      << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// taylor_step() and rk78_step() against the exact solution
+static int checkTaylor()
+{
+    flatfield ff;
+    int errors = 0;
+
+    circleField(&ff);
+    for (int k = 0; k < 8; k++) {
+        double r0 = 0.1 + 0.25 * k, exact[2];
+        double y0[2] = {r0 * cos(k), r0 * sin(k)};
+        double a[2] = {y0[0], y0[1]}, b[2] = {y0[0], y0[1]};
+        double c[2] = {y0[0], y0[1]};
+        circleSolution(y0, FINAL_TIME, exact);
+
+        integrate(
+            [&](double *y, double *h, double hma) {
+                return rk78_step([&](double *p, double *f) {
+                    eval_field2(ff, p, false, false, f);
+                }, y, h, 1e-12, hma, TOLERANCE);
+            },
+            a);
+        integrate(
+            [&](double *y, double *h, double hma) {
+                return taylor_step(ff, false, false, 0, y, h, 1e-12, hma,
+                                   TOLERANCE);
+            },
+            b);
+        integrate(
+            [&](double *y, double *h, double hma) {
+                return taylor_step(ff, false, false, 20, y, h, 1e-12, hma,
+                                   TOLERANCE);
+            },
+            c);
+
+        double ea = hypot(a[0] - exact[0], a[1] - exact[1]);
+        double eb = hypot(b[0] - exact[0], b[1] - exact[1]);
+        double ec = hypot(c[0] - exact[0], c[1] - exact[1]);
+        if (ea > MAX_ERROR || eb > MAX_ERROR || ec > MAX_ERROR) {
+            std::cerr << "orbit " << k << ": error of rk78_step " << ea
+                      << ", of taylor_step " << eb << " and " << ec
+                      << " with order 20\n";
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// taylor_step() and rk78_step() on r'=r*cos^2-0.3*r^2*sin,
+// theta'=1+r*sin*cos, with gcf 1+0.2*r*cos
+static int checkTaylorCylinder()
+{
+    P4POLYNOM3 gcf = nullptr, vf[2] = {nullptr, nullptr};
+    flatfield ff;
+
+    addTerm(&gcf, 1, 0, 0, 0);
+    addTerm(&gcf, 0.2, 1, 1, 0);
+    addTerm(&vf[0], 1, 1, 2, 0);
+    addTerm(&vf[0], -0.3, 2, 0, 1);
+    addTerm(&vf[1], 1, 0, 0, 0);
+    addTerm(&vf[1], 1, 1, 1, 1);
+    flatten_field3(gcf, vf, &ff);
+    delete_term3(gcf);
+    delete_term3(vf[0]);
+    delete_term3(vf[1]);
+
+    double a[2] = {0.5, 0.3}, b[2] = {0.5, 0.3};
+    integrate(
+        [&](double *y, double *h, double hma) {
+            return rk78_step([&](double *p, double *f) {
+                eval_field3(ff, p, true, f);
+            }, y, h, 1e-12, hma, TOLERANCE);
+        },
+        a);
+    integrate(
+        [&](double *y, double *h, double hma) {
+            return taylor_step(ff, true, false, 0, y, h, 1e-12, hma,
+                               TOLERANCE);
+        },
+        b);
+    if (hypot(a[0] - b[0], a[1] - b[1]) > MAX_ERROR) {
+        std::cerr << "taylor_step on the cylinder ends at (" << b[0] << ","
+                  << b[1] << "), rk78_step at (" << a[0] << "," << a[1]
+                  << ")\n";
+        return 1;
+    }
+    return 0;
+}
+
+// rosenbrock_step() against the exact solution, it is only of order 2
+static int checkRosenbrock()
+{
+    flatfield ff;
+    int errors = 0;
+
+    circleField(&ff);
+    for (int k = 0; k < 8; k++) {
+        double r0 = 0.1 + 0.25 * k, exact[2];
+        double y0[2] = {r0 * cos(k), r0 * sin(k)};
+        double a[2] = {y0[0], y0[1]};
+        circleSolution(y0, FINAL_TIME, exact);
+
+        integrate(
+            [&](double *y, double *h, double hma) {
+                return rosenbrock_step(
+                    [&](const double *p, double *f, double *J) {
+                        if (J != nullptr)
+                            eval_field2_jacobian(ff, p, false, false, f, J);
+                        else
+                            eval_field2(ff, p, false, false, f);
+                    },
+                    y, h, 1e-12, hma, 1e-10);
+            },
+            a);
+
+        double ea = hypot(a[0] - exact[0], a[1] - exact[1]);
+        if (ea > 1e-5) {
+            std::cerr << "orbit " << k << ": error of rosenbrock_step " << ea
+                      << "\n";
+            errors++;
+        }
+    }
+    return errors;
+}
+
+// stiff_step() on x'=-1000x, y'=-y: rk78_step() is limited by stability to
+// steps of about 0.005, the Rosenbrock steps are only limited by accuracy
+static int checkStiff()
+{
+    P4POLYNOM2 vf[2] = {nullptr, nullptr};
+    flatfield ff;
+
+    addTerm(&vf[0], -1000, 1, 0);
+    addTerm(&vf[1], -1, 0, 1);
+    flatten_field2(nullptr, vf, &ff);
+    delete_term2(vf[0]);
+    delete_term2(vf[1]);
+
+    auto deriv = [&](double *p, double *f) {
+        eval_field2(ff, p, false, false, f);
+    };
+    auto field = [&](const double *p, double *f, double *J) {
+        if (J != nullptr)
+            eval_field2_jacobian(ff, p, false, false, f, J);
+        else
+            eval_field2(ff, p, false, false, f);
+    };
+    stiff_state ss;
+    double a[2] = {1, 1}, b[2] = {1, 1};
+    int explicitSteps = integrate(
+        [&](double *y, double *h, double hma) {
+            return rk78_step(deriv, y, h, 1e-12, hma, 1e-8);
+        },
+        a);
+    int stiffSteps = integrate(
+        [&](double *y, double *h, double hma) {
+            return stiff_step(
+                [&](double *p, double *hh, double *f0) {
+                    return rk78_step(deriv, p, hh, 1e-12, hma, 1e-8, f0);
+                },
+                field, &ss, y, h, 1e-12, hma, 1e-8);
+        },
+        b);
+
+    double exact = exp(-FINAL_TIME);
+    double ea = hypot(a[0], a[1] - exact), eb = hypot(b[0], b[1] - exact);
+    if (ea > 1e-5 || eb > 1e-5 || 2 * stiffSteps > explicitSteps) {
+        std::cerr << "stiff field: rk78_step takes " << explicitSteps
+                  << " steps with error " << ea << ", stiff_step "
+                  << stiffSteps << " with error " << eb << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main()
+{
+    int errors = 0;
+
+    errors += checkTemplate();
+    errors += checkTaylor();
+    errors += checkTaylorCylinder();
+    errors += checkRosenbrock();
+    errors += checkStiff();
+    return errors == 0 ? 0 : 1;
+}
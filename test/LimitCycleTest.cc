@@ -0,0 +1,115 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief The limit cycle search finds a known cycle
+ * @file LimitCycleTest.cc
+ *
+ * The system x'=-y(1+x^2+y^2)+x(1-x^2-y^2), y'=x(1+x^2+y^2)+y(1-x^2-y^2)
+ * is r'=r(1-r^2), theta'=1+r^2 in polar coordinates, so the unit circle is
+ * its only limit cycle and it is stable. The rotation keeps the line at
+ * infinity free of singular points, so the study is computed without
+ * Maple, the cycle is searched along a section that crosses it once, and
+ * every point of the orbit found must lie on the circle. Searching again
+ * must not add the same cycle twice.
+ */
+
+#include "file_tab.h"
+#include "math_findsing.h"
+#include "math_limitcycles.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define TOLERANCE 1e-6
+
+// largest distance from the points of a cycle to the unit circle
+static double circleError(WVFStudy &study, const orbits &cycle)
+{
+    double pcoord[3], c[2], e = 0;
+
+    for (size_t k = 0; k < cycle.points.spans(); k++) {
+        OrbitPolyline::span s = cycle.points.getSpan(k);
+        for (int i = 0; i < s.size; i++) {
+            s.point(i, pcoord);
+            (study.*study.sphere_to_R2)(pcoord[0], pcoord[1], pcoord[2], c);
+            e = std::max(e, fabs(hypot(c[0], c[1]) - 1));
+        }
+    }
+    return e;
+}
+
+int main()
+{
+    char dir[] = "/tmp/wp4testXXXXXX";
+    if (mkdtemp(dir) == nullptr)
+        return 1;
+    std::string name = std::string(dir) + "/cycle";
+    std::vector<std::string> none;
+    int errors = 0;
+
+    if (!find_singularities(name, "-y*(1+x^2+y^2)+x*(1-x^2-y^2)",
+                            "x*(1+x^2+y^2)+y*(1-x^2-y^2)", none, none, 0.01,
+                            6)) {
+        std::cerr << "the study cannot be computed without Maple\n";
+        return 1;
+    }
+    WVFStudy study;
+    if (!study.readTables(name)) {
+        std::cerr << "cannot read the tables of the study\n";
+        return 1;
+    }
+    study.setupCoordinateTransformations();
+    study.config_kindvf_ = INTCONFIG_ORIGINAL;
+    study.config_hmi_ = 1e-7;
+    study.config_hma_ = 0.1;
+    study.config_tolerance_ = 1e-8;
+    study.config_step_ = 0.01;
+    study.config_lc_numpoints_ = 2000;
+
+    for (int pass = 0; pass < 2; pass++) {
+        std::vector<orbits> cycles;
+        int found = searchLimitCycle(&study, 0.1, 0.2, 2, 0.2, 0.05, &cycles);
+        if (found != 1 || cycles.size() != 1) {
+            std::cerr << "search " << pass << " found " << found
+                      << " cycles\n";
+            errors++;
+        }
+        for (size_t k = 0; k < cycles.size(); k++) {
+            double e = circleError(study, cycles[k]);
+            if (!(e <= TOLERANCE)) {
+                std::cerr << "cycle " << k << " is " << e
+                          << " away from the unit circle\n";
+                errors++;
+            }
+        }
+        int added = addLimitCycles(&study, cycles);
+        if (added != (pass == 0 ? 1 : 0)) {
+            std::cerr << "search " << pass << " added " << added
+                      << " cycles\n";
+            errors++;
+        }
+    }
+
+    std::string aux("rm -rf " + std::string(dir));
+    system(aux.c_str());
+    return errors == 0 ? 0 : 1;
+}
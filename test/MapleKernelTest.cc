@@ -0,0 +1,113 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief Consecutive jobs of a warm Maple kernel do not share state
+ * @file MapleKernelTest.cc
+ *
+ * The first job assigns names that the scripts of ScriptHandler assign
+ * (a parameter, a chart substitution, Digits) and overwrites a name of the
+ * library. The second one exits with a nonzero status if it sees any of
+ * them. Exits with 77 (skipped) where Maple is not installed.
+ */
+
+#include "MapleKernel.h"
+#include "ScriptHandler.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// write a script with the header that MapleKernel::splitScript expects
+static bool writeScript(std::string fname, std::string library,
+                        std::string body)
+{
+    std::ofstream out(fname + ".mpl");
+    out << "restart;\n"
+        << "read( \"" << library << "\" ):\n"
+        << body;
+    return out.good();
+}
+
+// run a script in the kernel and return its exit status, -1 on failure
+static int runJob(MapleKernel &kernel, std::string fname)
+{
+    std::string library;
+    siginfo_t info;
+
+    if (!MapleKernel::splitScript(fname, library) || !kernel.submit(fname))
+        return -1;
+    for (time_t start = time(nullptr); time(nullptr) - start < 60;) {
+        if (kernel.poll(info))
+            return info.si_code == CLD_EXITED ? info.si_status : -1;
+        usleep(10000);
+    }
+    return -1;
+}
+
+int main()
+{
+    if (access(MAPLE_PATH, X_OK) != 0) {
+        std::cout << "Maple not found at " << MAPLE_PATH << ", skipped\n";
+        return 77;
+    }
+
+    char dir[] = "/tmp/wp4testXXXXXX";
+    if (mkdtemp(dir) == nullptr)
+        return 1;
+    std::string library = std::string(dir) + "/lib.m";
+    std::ofstream(library) << "wp4_test_lib := 7:\n";
+
+    std::string first = std::string(dir) + "/first";
+    std::string second = std::string(dir) + "/second";
+    writeScript(first, library, "user_p := 42:\n"
+                                "u := x:\n"
+                                "Digits := 30:\n"
+                                "wp4_test_lib := 0:\n"
+                                "`quit`(0);\n");
+    writeScript(second, library, "if assigned(user_p) then `quit`(2) end if:\n"
+                                 "if assigned(u) then `quit`(3) end if:\n"
+                                 "if Digits <> 10 then `quit`(4) end if:\n"
+                                 "if wp4_test_lib <> 7 then `quit`(5) "
+                                 "end if:\n"
+                                 "`quit`(0);\n");
+
+    MapleKernel kernel(library);
+    if (!kernel.start()) {
+        std::cerr << "cannot start the Maple kernel\n";
+        return 1;
+    }
+    int status = runJob(kernel, first);
+    if (status != 0) {
+        std::cerr << "first job failed with status " << status << "\n";
+        return 1;
+    }
+    status = runJob(kernel, second);
+    if (status != 0) {
+        std::cerr << "second job saw the state of the first one, status "
+                  << status << "\n";
+        return 1;
+    }
+
+    std::string aux("rm -rf " + std::string(dir));
+    system(aux.c_str());
+    return 0;
+}
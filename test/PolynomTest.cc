@@ -0,0 +1,230 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief The flat polynomial evaluators agree with the linked lists
+ * @file PolynomTest.cc
+ *
+ * Random polynomials in two and three variables, with repeated monomials,
+ * are evaluated with eval_term2() and eval_term3() and with the flat form
+ * built from them, and random vector fields with their gcf are evaluated
+ * term by term and with the fused evaluators eval_field2() and
+ * eval_field3(). The results must agree up to rounding, relative to the
+ * size of the terms.
+ */
+
+#include "file_tab.h"
+#include "math_polynom.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#define TERMS 30
+#define MAX_DEGREE 8
+#define POINTS 200
+#define TOLERANCE 1e-12
+
+static std::mt19937 s_random(20170628);
+
+static double uniform(double a, double b)
+{
+    return std::uniform_real_distribution<double>(a, b)(s_random);
+}
+
+static int exponent()
+{
+    return std::uniform_int_distribution<int>(0, MAX_DEGREE)(s_random);
+}
+
+// random polynomial, abs gets the same monomials with |coeff|
+static P4POLYNOM2 randomTerm2(P4POLYNOM2 *abs)
+{
+    P4POLYNOM2 f = nullptr;
+    *abs = nullptr;
+    for (int i = 0; i < TERMS; i++) {
+        P4POLYNOM2 t = new term2, a = new term2;
+        a->exp_x = t->exp_x = exponent();
+        a->exp_y = t->exp_y = exponent();
+        t->coeff = uniform(-1, 1);
+        a->coeff = fabs(t->coeff);
+        t->next_term2 = f;
+        a->next_term2 = *abs;
+        f = t;
+        *abs = a;
+    }
+    return f;
+}
+
+static P4POLYNOM3 randomTerm3(P4POLYNOM3 *abs)
+{
+    P4POLYNOM3 F = nullptr;
+    *abs = nullptr;
+    for (int i = 0; i < TERMS; i++) {
+        P4POLYNOM3 t = new term3, a = new term3;
+        a->exp_r = t->exp_r = exponent();
+        a->exp_Co = t->exp_Co = exponent();
+        a->exp_Si = t->exp_Si = exponent();
+        t->coeff = uniform(-1, 1);
+        a->coeff = fabs(t->coeff);
+        t->next_term3 = F;
+        a->next_term3 = *abs;
+        F = t;
+        *abs = a;
+    }
+    return F;
+}
+
+// bound of the terms of F at radius r, since |cos| and |sin| are at most 1
+static double bound3(P4POLYNOM3 abs, double r)
+{
+    double s = 0;
+    for (; abs != nullptr; abs = abs->next_term3)
+        s += abs->coeff * pow(r, abs->exp_r);
+    return s;
+}
+
+static bool close(double value, double expected, double scale)
+{
+    return fabs(value - expected) <= TOLERANCE * (1 + scale);
+}
+
+// check eval_field2() against the linked lists of a random field
+static int checkField2(double *v)
+{
+    P4POLYNOM2 gcf, vf[2], abs[3];
+    double a[2] = {fabs(v[0]), fabs(v[1])}, f[2], g, scale;
+    flatfield ff;
+    int errors = 0;
+
+    gcf = randomTerm2(&abs[0]);
+    vf[0] = randomTerm2(&abs[1]);
+    vf[1] = randomTerm2(&abs[2]);
+    flatten_field2(gcf, vf, &ff);
+
+    for (int mode = 0; mode < 4; mode++) {
+        bool withgcf = (mode & 1) != 0, timesy = (mode & 2) != 0;
+        g = withgcf ? eval_term2(gcf, v) : 1.0;
+        scale = withgcf ? eval_term2(abs[0], a) : 1.0;
+        if (timesy) {
+            g *= v[1];
+            scale *= a[1];
+        }
+        eval_field2(ff, v, withgcf, timesy, f);
+        for (int k = 0; k < 2; k++) {
+            if (!close(f[k], g * eval_term2(vf[k], v),
+                       scale * eval_term2(abs[k + 1], a))) {
+                std::cerr << "eval_field2 component " << k << " at (" << v[0]
+                          << "," << v[1] << ") with mode " << mode
+                          << " is " << f[k] << "\n";
+                errors++;
+            }
+        }
+    }
+
+    delete_term2(gcf);
+    for (int k = 0; k < 2; k++)
+        delete_term2(vf[k]);
+    for (int k = 0; k < 3; k++)
+        delete_term2(abs[k]);
+    return errors;
+}
+
+// check eval_field3() against the linked lists of a random field
+static int checkField3(double *w)
+{
+    P4POLYNOM3 gcf, vf[2], abs[3];
+    double f[2], g, scale;
+    flatfield ff;
+    int errors = 0;
+
+    gcf = randomTerm3(&abs[0]);
+    vf[0] = randomTerm3(&abs[1]);
+    vf[1] = randomTerm3(&abs[2]);
+    flatten_field3(gcf, vf, &ff);
+
+    for (int withgcf = 0; withgcf < 2; withgcf++) {
+        g = withgcf ? eval_term3(gcf, w) : 1.0;
+        scale = withgcf ? bound3(abs[0], w[0]) : 1.0;
+        eval_field3(ff, w, withgcf != 0, f);
+        for (int k = 0; k < 2; k++) {
+            if (!close(f[k], g * eval_term3(vf[k], w),
+                       scale * bound3(abs[k + 1], w[0]))) {
+                std::cerr << "eval_field3 component " << k << " at (" << w[0]
+                          << "," << w[1] << ") with gcf " << withgcf
+                          << " is " << f[k] << "\n";
+                errors++;
+            }
+        }
+    }
+
+    delete_term3(gcf);
+    for (int k = 0; k < 2; k++)
+        delete_term3(vf[k]);
+    for (int k = 0; k < 3; k++)
+        delete_term3(abs[k]);
+    return errors;
+}
+
+int main()
+{
+    int errors = 0;
+
+    for (int n = 0; n < 20; n++) {
+        P4POLYNOM2 abs2, f = randomTerm2(&abs2);
+        P4POLYNOM3 abs3, F = randomTerm3(&abs3);
+        flatpoly flat2, flat3;
+        flatten_term2(f, &flat2);
+        flatten_term3(F, &flat3);
+
+        for (int k = 0; k < POINTS; k++) {
+            double v[2] = {uniform(-2, 2), uniform(-2, 2)};
+            double a[2] = {fabs(v[0]), fabs(v[1])};
+            double expected = eval_term2(f, v);
+            if (!close(eval_flat2(flat2, v), expected, eval_term2(abs2, a))) {
+                std::cerr << "eval_flat2 at (" << v[0] << "," << v[1]
+                          << ") is " << eval_flat2(flat2, v) << ", expected "
+                          << expected << "\n";
+                errors++;
+            }
+
+            double w[2] = {uniform(0, 2), uniform(-M_PI, M_PI)};
+            expected = eval_term3(F, w);
+            if (!close(eval_flat3(flat3, w), expected, bound3(abs3, w[0]))) {
+                std::cerr << "eval_flat3 at (" << w[0] << "," << w[1]
+                          << ") is " << eval_flat3(flat3, w) << ", expected "
+                          << expected << "\n";
+                errors++;
+            }
+        }
+
+        delete_term2(f);
+        delete_term2(abs2);
+        delete_term3(F);
+        delete_term3(abs3);
+    }
+
+    for (int n = 0; n < POINTS; n++) {
+        double v[2] = {uniform(-2, 2), uniform(-2, 2)};
+        double w[2] = {uniform(0, 2), uniform(-M_PI, M_PI)};
+        errors += checkField2(v);
+        errors += checkField3(w);
+    }
+
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+/*  This file is part of WP4 (http://github.com/oscarsaleta/WP4)
+ *
+ *  Copyright (C) 2016  O. Saleta
+ *
+ *  WP4 is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * @brief Cost and accuracy of the Taylor integrator against RK78
+ * @file TaylorBenchmark.cc
+ *
+ * Integrates ORBITS orbits of x'=x^3-x-y, y'=x+y^3-2y up to t=FINAL_TIME
+ * with rk78_step() and taylor_step() for several maximum step sizes and
+ * tolerances, and prints the time taken and the largest distance to a
+ * reference computed with an order 30 Taylor series at 1e-15. It is built
+ * with the tests but is not one of them, run it by hand.
+ */
+
+#include "file_tab.h"
+#include "math_numerics.h"
+#include "math_polynom.h"
+#include "math_taylor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#define ORBITS 200
+#define FINAL_TIME 5.0
+#define REPEAT 5
+
+static void addTerm(P4POLYNOM2 *f, double coeff, int i, int j)
+{
+    P4POLYNOM2 t = new term2;
+    t->coeff = coeff;
+    t->exp_x = i;
+    t->exp_y = j;
+    t->next_term2 = *f;
+    *f = t;
+}
+
+// integrate every orbit up to FINAL_TIME, return the time taken in ms
+template <class Step>
+static double integrate(Step step, double hma, std::vector<double> &y)
+{
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t k = 0; k < y.size(); k += 2) {
+        double t = 0, h = 0.01, hm;
+        while (FINAL_TIME - t > 1e-14) {
+            hm = std::min(hma, FINAL_TIME - t);
+            h = std::min(h, hm);
+            t += step(&y[k], &h, hm);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// best time of REPEAT runs from the seeds, y receives the end points
+template <class Step>
+static double run(Step step, double hma, const std::vector<double> &seeds,
+                  std::vector<double> &y)
+{
+    double best = 0;
+    for (int i = 0; i < REPEAT; i++) {
+        y = seeds;
+        double ms = integrate(step, hma, y);
+        if (i == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+static double maxError(const std::vector<double> &y,
+                       const std::vector<double> &ref)
+{
+    double e = 0;
+    for (size_t k = 0; k < y.size(); k += 2)
+        e = std::max(e, hypot(y[k] - ref[k], y[k + 1] - ref[k + 1]));
+    return e;
+}
+
+int main()
+{
+    P4POLYNOM2 vf[2] = {nullptr, nullptr};
+    flatfield ff;
+
+    addTerm(&vf[0], 1, 3, 0);
+    addTerm(&vf[0], -1, 1, 0);
+    addTerm(&vf[0], -1, 0, 1);
+    addTerm(&vf[1], 1, 1, 0);
+    addTerm(&vf[1], 1, 0, 3);
+    addTerm(&vf[1], -2, 0, 1);
+    flatten_field2(nullptr, vf, &ff);
+    delete_term2(vf[0]);
+    delete_term2(vf[1]);
+
+    // seeds on a grid around the origin, which attracts them
+    std::vector<double> seeds, ref, y;
+    for (int i = 0; i < ORBITS; i++) {
+        seeds.push_back(-0.8 + 1.6 * (i % 20) / 19.0);
+        seeds.push_back(-0.8 + 1.6 * (i / 20) / 9.0);
+    }
+    ref = seeds;
+    integrate(
+        [&](double *p, double *h, double hm) {
+            return taylor_step(ff, false, false, 30, p, h, 1e-15, hm, 1e-15);
+        },
+        1.0, ref);
+
+    const double hmas[] = {10, 10, 10, 10, 0.1};
+    const double tols[] = {1e-6, 1e-8, 1e-10, 1e-12, 1e-8};
+    printf("  hma   tol    rk78 ms / err       taylor ms / err\n");
+    for (int i = 0; i < 5; i++) {
+        double tol = tols[i];
+        double rk = run(
+            [&](double *p, double *h, double hm) {
+                return rk78_step([&](double *q, double *f) {
+                    eval_field2(ff, q, false, false, f);
+                }, p, h, 1e-12, hm, tol);
+            },
+            hmas[i], seeds, y);
+        double erk = maxError(y, ref);
+        double ty = run(
+            [&](double *p, double *h, double hm) {
+                return taylor_step(ff, false, false, 0, p, h, 1e-12, hm, tol);
+            },
+            hmas[i], seeds, y);
+        double ety = maxError(y, ref);
+        printf("  %-5g %-6g %5.1f / %-9.2g    %5.1f / %.2g\n", hmas[i], tol,
+               rk, erk, ty, ety);
+    }
+    return 0;
+}